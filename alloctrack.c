@@ -0,0 +1,300 @@
+/**
+ * @file        alloctrack.c
+ * @brief       Accounting of memory and surface allocations
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 21:03:52
+ * Last modify: 2021-03-07 21:03:52 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * malloc(), calloc(), realloc() and free() of the whole process and the
+ * creation and release of SDL surfaces are replaced by counting wrappers,
+ * so allocations of SDL, SDL_ttf and FreeType are counted as well. Every
+ * thread has a subsystem which is charged with its allocations, code marks
+ * its parts by enterAllocScope() and leaveAllocScope().
+ *
+ * Composition of a script frame shall not allocate: rasterization of new
+ * lines and overlays has its own subsystem and it is not checked, anything
+ * left in ALLOC_SUBSYSTEM_frame is a regression. --assert-no-alloc aborts
+ * the program at the end of such a frame, so replay of a recorded session
+ * catches it.
+ *
+ * Wrappers replace the allocator of the whole process, so they are built
+ * only by make ALLOC_TRACK=1. They need the allocator of glibc and dynamic
+ * linking, allocations are not counted on other platforms.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE                         /* RTLD_NEXT */
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "alloctrack.h"
+
+#if defined(ALLOC_TRACK) && defined(__GLIBC__)
+#include <dlfcn.h>
+#else
+#undef ALLOC_TRACK
+#define ALLOC_TRACK     0
+#endif
+
+allocTracker_t allocTracker =
+{
+    .available = ALLOC_TRACK,
+    .warmupFrames = ALLOC_WARMUP_FRAMES,
+};
+
+/* Subsystem charged with allocations of the thread */
+static __thread allocSubsystem_t scope = ALLOC_SUBSYSTEM_other;
+
+#if ALLOC_TRACK
+/* Allocator of glibc */
+extern void * __libc_malloc(size_t aSize);
+extern void * __libc_calloc(size_t aCount, size_t aSize);
+extern void * __libc_realloc(void * aPtr, size_t aSize);
+extern void   __libc_free(void * aPtr);
+
+/**
+ * @brief countAllocation Count an allocation to subsystem of the thread.
+ * It must not allocate.
+ *
+ * @param aSize[in]     Requested bytes.
+ */
+static void countAllocation(size_t aSize)
+{
+    allocCounters_t * counters = &allocTracker.subsystems[scope];
+
+    __atomic_add_fetch(&counters->allocations, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&counters->bytes, aSize, __ATOMIC_RELAXED);
+    if (scope == ALLOC_SUBSYSTEM_frame)
+    {
+        /* Only main thread draws frames */
+        if (!allocTracker.frameAllocations)
+        {
+            allocTracker.frameFirstBytes = aSize;
+        }
+        allocTracker.frameAllocations++;
+    }
+}
+
+void * malloc(size_t aSize)
+{
+    void * ptr = __libc_malloc(aSize);
+
+    if (ptr)
+    {
+        countAllocation(aSize);
+    }
+
+    return ptr;
+}
+
+void * calloc(size_t aCount, size_t aSize)
+{
+    void * ptr = __libc_calloc(aCount, aSize);
+
+    if (ptr)
+    {
+        countAllocation(aCount * aSize);
+    }
+
+    return ptr;
+}
+
+void * realloc(void * aPtr, size_t aSize)
+{
+    void * ptr = __libc_realloc(aPtr, aSize);
+
+    if (ptr)
+    {
+        /* Resizing is an allocation, it may move the block */
+        countAllocation(aSize);
+    }
+    else if (aPtr && !aSize)
+    {
+        __atomic_add_fetch(&allocTracker.subsystems[scope].frees, 1, __ATOMIC_RELAXED);
+    }
+
+    return ptr;
+}
+
+void free(void * aPtr)
+{
+    if (aPtr)
+    {
+        __atomic_add_fetch(&allocTracker.subsystems[scope].frees, 1, __ATOMIC_RELAXED);
+    }
+    __libc_free(aPtr);
+}
+
+SDL_Surface * SDL_CreateRGBSurface(Uint32 aFlags, int aWidth, int aHeight, int aDepth,
+                                   Uint32 aRmask, Uint32 aGmask, Uint32 aBmask, Uint32 aAmask)
+{
+    static SDL_Surface * (*create)(Uint32, int, int, int, Uint32, Uint32, Uint32, Uint32);
+    SDL_Surface        * surface;
+
+    if (!create)
+    {
+        create = dlsym(RTLD_NEXT, "SDL_CreateRGBSurface");
+    }
+    surface = create(aFlags, aWidth, aHeight, aDepth, aRmask, aGmask, aBmask, aAmask);
+    if (surface)
+    {
+        __atomic_add_fetch(&allocTracker.subsystems[scope].surfacesCreated, 1, __ATOMIC_RELAXED);
+    }
+
+    return surface;
+}
+
+SDL_Surface * SDL_CreateRGBSurfaceFrom(void * aPixels, int aWidth, int aHeight, int aDepth, int aPitch,
+                                       Uint32 aRmask, Uint32 aGmask, Uint32 aBmask, Uint32 aAmask)
+{
+    static SDL_Surface * (*create)(void *, int, int, int, int, Uint32, Uint32, Uint32, Uint32);
+    SDL_Surface        * surface;
+
+    if (!create)
+    {
+        create = dlsym(RTLD_NEXT, "SDL_CreateRGBSurfaceFrom");
+    }
+    surface = create(aPixels, aWidth, aHeight, aDepth, aPitch, aRmask, aGmask, aBmask, aAmask);
+    if (surface)
+    {
+        __atomic_add_fetch(&allocTracker.subsystems[scope].surfacesCreated, 1, __ATOMIC_RELAXED);
+    }
+
+    return surface;
+}
+
+void SDL_FreeSurface(SDL_Surface * aSurface)
+{
+    static void (*release)(SDL_Surface *);
+
+    if (!release)
+    {
+        release = dlsym(RTLD_NEXT, "SDL_FreeSurface");
+    }
+    /* Video surface is released by SDL_Quit(), others only at last reference */
+    if (aSurface && aSurface->refcount <= 1 && aSurface != SDL_GetVideoSurface())
+    {
+        __atomic_add_fetch(&allocTracker.subsystems[scope].surfacesFreed, 1, __ATOMIC_RELAXED);
+    }
+    release(aSurface);
+}
+#endif
+
+/**
+ * @brief getAllocSubsystemName Get name of subsystem.
+ *
+ * @param aSubsystem[in]    Subsystem.
+ * @return Name of subsystem.
+ */
+const char * getAllocSubsystemName(allocSubsystem_t aSubsystem)
+{
+    static const char * names[ALLOC_SUBSYSTEM_count] =
+    {
+        "other", "frame", "lines", "overlays", "surfaces", "preview", "script"
+    };
+
+    return aSubsystem < ALLOC_SUBSYSTEM_count ? names[aSubsystem] : "?";
+}
+
+/**
+ * @brief enterAllocScope Charge following allocations of the thread to a
+ * subsystem.
+ *
+ * @param aSubsystem[in]    Subsystem.
+ * @return Previous subsystem, it shall be passed to leaveAllocScope().
+ */
+allocSubsystem_t enterAllocScope(allocSubsystem_t aSubsystem)
+{
+    allocSubsystem_t previous = scope;
+
+    scope = aSubsystem;
+
+    return previous;
+}
+
+/**
+ * @brief leaveAllocScope Charge following allocations of the thread to the
+ * subsystem before enterAllocScope().
+ *
+ * @param aPrevious[in]     Value returned by enterAllocScope().
+ */
+void leaveAllocScope(allocSubsystem_t aPrevious)
+{
+    scope = aPrevious;
+}
+
+/**
+ * @brief restartAllocWarmup Allow allocations of a few frames. It shall be
+ * called when screen is reinitialized, SDL prepares blits at first use.
+ */
+void restartAllocWarmup(void)
+{
+    allocTracker.warmupFrames = ALLOC_WARMUP_FRAMES;
+}
+
+/**
+ * @brief allocFrameDone Check allocations of a script frame. Scope of frame
+ * is started by enterAllocScope(ALLOC_SUBSYSTEM_frame).
+ *
+ * @param aPrevious[in]     Value returned by enterAllocScope().
+ */
+void allocFrameDone(allocSubsystem_t aPrevious)
+{
+    leaveAllocScope(aPrevious);
+    if (allocTracker.warmupFrames)
+    {
+        allocTracker.warmupFrames--;
+    }
+    else
+    {
+        allocTracker.steadyFrames++;
+        if (allocTracker.frameAllocations)
+        {
+            allocTracker.allocatingFrames++;
+            if (allocTracker.assertNoAlloc)
+            {
+                errorprintf("Steady state frame %llu allocated memory %u times, first allocation: %u bytes!\n",
+                            (unsigned long long)allocTracker.steadyFrames, allocTracker.frameAllocations,
+                            allocTracker.frameFirstBytes);
+                fflush(stdout);
+                abort();
+            }
+        }
+    }
+    allocTracker.frameAllocations = 0;
+}
+
+/**
+ * @brief printAllocStats Print allocations by subsystem to console.
+ */
+void printAllocStats(void)
+{
+    const allocCounters_t * counters;
+    uint8_t                 i;
+
+    if (!allocTracker.available)
+    {
+        printf("Allocations:                      not counted, build with ALLOC_TRACK=1 on glibc\n");
+        return;
+    }
+    printf("Allocations      allocs      frees        KiB   surfaces  released\n");
+    for (i = 0; i < ALLOC_SUBSYSTEM_count; i++)
+    {
+        counters = &allocTracker.subsystems[i];
+        printf("  %-10s %10llu %10llu %10llu %10llu %9llu\n", getAllocSubsystemName(i),
+               (unsigned long long)counters->allocations, (unsigned long long)counters->frees,
+               (unsigned long long)(counters->bytes / 1024u), (unsigned long long)counters->surfacesCreated,
+               (unsigned long long)counters->surfacesFreed);
+    }
+    printf("Steady frames allocating:         %llu of %llu\n",
+           (unsigned long long)allocTracker.allocatingFrames, (unsigned long long)allocTracker.steadyFrames);
+}
@@ -0,0 +1,64 @@
+/**
+ * @file        alloctrack.h
+ * @brief       Accounting of memory and surface allocations
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 21:03:52
+ * Last modify: 2021-03-07 21:03:52 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_ALLOCTRACK_H
+#define INCLUDE_ALLOCTRACK_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define ALLOC_WARMUP_FRAMES         2       /* Script frames after screen initialization before steady state */
+
+/* Allocations are counted to the subsystem of the calling thread */
+typedef enum
+{
+    ALLOC_SUBSYSTEM_other,      /**< Not assigned, e.g. initialization and input */
+    ALLOC_SUBSYSTEM_frame,      /**< Composition of script frames without rasterization, nothing is allocated in steady state */
+    ALLOC_SUBSYSTEM_lines,      /**< Rasterization of lines to line cache */
+    ALLOC_SUBSYSTEM_overlays,   /**< Rasterization of overlays and help */
+    ALLOC_SUBSYSTEM_surfaces,   /**< Screen, background and surface of reduced resolution */
+    ALLOC_SUBSYSTEM_preview,    /**< Thumbnails of preview panel */
+    ALLOC_SUBSYSTEM_script,     /**< Loading and wrapping of scripts */
+    ALLOC_SUBSYSTEM_count       /**< Not a real subsystem, only to count subsystems */
+} allocSubsystem_t;
+
+typedef struct
+{
+    uint64_t    allocations;                /* Calls of malloc(), calloc() and realloc() */
+    uint64_t    frees;                      /* Calls of free() */
+    uint64_t    bytes;                      /* Requested bytes */
+    uint64_t    surfacesCreated;            /* Surfaces created by SDL_CreateRGBSurface*() */
+    uint64_t    surfacesFreed;              /* Surfaces released by SDL_FreeSurface() */
+} allocCounters_t;
+
+typedef struct
+{
+    bool_t          available;              /* TRUE: allocations are counted, built with ALLOC_TRACK on glibc */
+    bool_t          assertNoAlloc;          /* TRUE: program is aborted if a steady state frame allocates */
+    allocCounters_t subsystems[ALLOC_SUBSYSTEM_count];
+    uint32_t        warmupFrames;           /* Script frames left until steady state */
+    uint32_t        frameAllocations;       /* Allocations of the frame being drawn */
+    uint32_t        frameFirstBytes;        /* Size of first allocation of the frame being drawn */
+    /* Statistics */
+    uint64_t        steadyFrames;           /* Count of script frames drawn in steady state */
+    uint64_t        allocatingFrames;       /* Count of steady state frames which allocated */
+} allocTracker_t;
+
+extern allocTracker_t allocTracker;
+
+const char * getAllocSubsystemName(allocSubsystem_t aSubsystem);
+allocSubsystem_t enterAllocScope(allocSubsystem_t aSubsystem);
+void leaveAllocScope(allocSubsystem_t aPrevious);
+void restartAllocWarmup(void);
+void allocFrameDone(allocSubsystem_t aPrevious);
+void printAllocStats(void);
+
+#endif /* INCLUDE_ALLOCTRACK_H */
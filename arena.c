@@ -0,0 +1,242 @@
+/**
+ * @file        arena.c
+ * @brief       Bump pointer memory arena
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-22 18:03:45
+ * Last modify: 2021-02-22 18:03:45 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "arena.h"
+
+/**
+ * @brief allocBlock Allocate a new block which can store at least aSize bytes.
+ *
+ * @param aArena[in,out]    Arena.
+ * @param aSize[in]         Minimum usable size of block.
+ * @return New block or NULL if out of memory.
+ */
+static arenaBlock_t * allocBlock(arena_t * aArena, size_t aSize)
+{
+    arenaBlock_t * block;
+    size_t         size = aArena->blockSize ? aArena->blockSize : ARENA_DEFAULT_BLOCK_SIZE;
+
+    size = MAX(size, aSize);
+    block = malloc(sizeof(arenaBlock_t) + size);
+    if (block)
+    {
+        block->next = NULL;
+        block->size = size;
+        block->used = 0;
+        aArena->blockCount++;
+        aArena->bytesReserved += size;
+    }
+    else
+    {
+        errorprintf("Cannot allocate memory for arena!\n");
+    }
+
+    return block;
+}
+
+/**
+ * @brief arenaAlloc Allocate memory from arena. It cannot be released one
+ * by one, only all at once by arenaReset() or arenaFree().
+ *
+ * @param aArena[in,out]    Arena.
+ * @param aSize[in]         Bytes to allocate.
+ * @return Pointer to memory aligned to ARENA_ALIGNMENT or NULL if out of memory.
+ */
+void * arenaAlloc(arena_t * aArena, size_t aSize)
+{
+    void         * ptr = NULL;
+    arenaBlock_t * block = aArena->current;
+
+    aSize = (aSize + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+
+    /* Go to next block if it does not fit, blocks kept by reset are reused */
+    while (block && block->used + aSize > block->size)
+    {
+        if (block->next == NULL)
+        {
+            block->next = allocBlock(aArena, aSize);
+        }
+        block = block->next;
+        if (block)
+        {
+            block->used = 0;
+        }
+    }
+    if (block == NULL && aArena->first == NULL)
+    {
+        aArena->first = allocBlock(aArena, aSize);
+        block = aArena->first;
+    }
+
+    if (block)
+    {
+        aArena->current = block;
+        ptr = &block->data[block->used];
+        block->used += aSize;
+        aArena->allocCount++;
+        aArena->bytesUsed += aSize;
+    }
+
+    return ptr;
+}
+
+/**
+ * @brief arenaReset Release all allocations at once. Blocks are kept for
+ * next allocations.
+ *
+ * @param aArena[in,out]    Arena.
+ */
+void arenaReset(arena_t * aArena)
+{
+    aArena->current = aArena->first;
+    if (aArena->first)
+    {
+        aArena->first->used = 0;
+    }
+    aArena->allocCount = 0;
+    aArena->bytesUsed = 0;
+}
+
+/**
+ * @brief arenaFree Release all blocks of arena.
+ *
+ * @param aArena[in,out]    Arena.
+ */
+void arenaFree(arena_t * aArena)
+{
+    arenaBlock_t * block = aArena->first;
+    arenaBlock_t * next;
+
+    while (block)
+    {
+        next = block->next;
+        free(block);
+        block = next;
+    }
+    aArena->first = NULL;
+    aArena->current = NULL;
+    aArena->blockCount = 0;
+    aArena->allocCount = 0;
+    aArena->bytesUsed = 0;
+    aArena->bytesReserved = 0;
+}
+
+/**
+ * @brief arenaSpare Get size of blocks which are kept by arenaReset() and
+ * not used since then.
+ *
+ * @param aArena[in]    Arena.
+ * @return Usable bytes of blocks after the current one.
+ */
+size_t arenaSpare(const arena_t * aArena)
+{
+    const arenaBlock_t * block;
+    size_t               bytes = 0;
+
+    for (block = aArena->current ? aArena->current->next : NULL; block; block = block->next)
+    {
+        bytes += block->size;
+    }
+
+    return bytes;
+}
+
+/**
+ * @brief arenaLend Move blocks kept by arenaReset() to another arena, so it
+ * does not allocate new ones. Blocks come back by arenaAppend().
+ *
+ * @param aArena[in,out]    Arena to take unused blocks from.
+ * @param aTarget[in,out]   Arena which receives the blocks.
+ * @param aBytes[in]        Blocks are moved until this many bytes are moved
+ *                          or there is no more unused block.
+ */
+void arenaLend(arena_t * aArena, arena_t * aTarget, size_t aBytes)
+{
+    arenaBlock_t * block;
+    arenaBlock_t * last = aTarget->first;
+    size_t         bytes = 0;
+
+    while (last && last->next)
+    {
+        last = last->next;
+    }
+    while (aArena->current && aArena->current->next && bytes < aBytes)
+    {
+        block = aArena->current->next;
+        aArena->current->next = block->next;
+        block->next = NULL;
+        block->used = 0;
+        if (last)
+        {
+            last->next = block;
+        }
+        else
+        {
+            aTarget->first = block;
+            aTarget->current = block;
+        }
+        last = block;
+        bytes += block->size;
+        aArena->blockCount--;
+        aArena->bytesReserved -= block->size;
+        aTarget->blockCount++;
+        aTarget->bytesReserved += block->size;
+    }
+}
+
+/**
+ * @brief arenaAppend Move all blocks of an arena to another one. Memory
+ * allocated from the source stays valid and it is released together with
+ * the destination.
+ *
+ * @param aArena[in,out]    Destination arena.
+ * @param aSource[in,out]   Source arena, it is empty after the call.
+ */
+void arenaAppend(arena_t * aArena, arena_t * aSource)
+{
+    arenaBlock_t * last;
+
+    if (aSource->first == NULL)
+    {
+        return;
+    }
+
+    if (aArena->current)
+    {
+        /* Used blocks of source follow the current block, unused blocks of both are kept at the end */
+        for (last = aSource->first; last->next; last = last->next)
+        {
+        }
+        last->next = aArena->current->next;
+        aArena->current->next = aSource->first;
+    }
+    else
+    {
+        arenaFree(aArena);
+        aArena->first = aSource->first;
+    }
+    aArena->current = aSource->current;
+    aArena->blockCount += aSource->blockCount;
+    aArena->allocCount += aSource->allocCount;
+    aArena->bytesUsed += aSource->bytesUsed;
+    aArena->bytesReserved += aSource->bytesReserved;
+
+    aSource->first = NULL;
+    aSource->current = NULL;
+    aSource->blockCount = 0;
+    aSource->allocCount = 0;
+    aSource->bytesUsed = 0;
+    aSource->bytesReserved = 0;
+}
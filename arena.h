@@ -0,0 +1,52 @@
+/**
+ * @file        arena.h
+ * @brief       Bump pointer memory arena
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-22 18:03:45
+ * Last modify: 2021-02-22 18:03:45 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_ARENA_H
+#define INCLUDE_ARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "common.h"
+
+#define ARENA_DEFAULT_BLOCK_SIZE    (64 * 1024)
+#define ARENA_ALIGNMENT             (sizeof(void *))
+
+typedef struct arenaBlock_tag
+{
+    struct arenaBlock_tag * next;           /* Next block, NULL if it is the last one */
+    size_t                  size;           /* Usable bytes of block */
+    size_t                  used;           /* Used bytes of block */
+    uint8_t                 data[];         /* Memory of block */
+} arenaBlock_t;
+
+/* Memory is allocated in big blocks and released all at once. Blocks are
+ * kept by arenaReset(), so they are reused instead of fragmenting the heap.
+ * A zero initialized arena is ready to use. */
+typedef struct
+{
+    arenaBlock_t  * first;                  /* First block, NULL if nothing allocated yet */
+    arenaBlock_t  * current;                /* Block used for allocation */
+    size_t          blockSize;              /* Size of new blocks, 0: ARENA_DEFAULT_BLOCK_SIZE */
+    /* Statistics */
+    uint32_t        blockCount;             /* Count of blocks allocated by malloc() */
+    uint64_t        allocCount;             /* Count of allocations since last reset */
+    size_t          bytesUsed;              /* Bytes allocated since last reset */
+    size_t          bytesReserved;          /* Bytes of all blocks */
+} arena_t;
+
+void * arenaAlloc(arena_t * aArena, size_t aSize);
+void arenaReset(arena_t * aArena);
+void arenaFree(arena_t * aArena);
+size_t arenaSpare(const arena_t * aArena);
+void arenaLend(arena_t * aArena, arena_t * aTarget, size_t aBytes);
+void arenaAppend(arena_t * aArena, arena_t * aSource);
+
+#endif /* INCLUDE_ARENA_H */
@@ -0,0 +1,479 @@
+/**
+ * @file        atlas.c
+ * @brief       Glyphs of embedded fonts rasterized at build time
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 09:02:51
+ * Last modify: 2021-03-07 09:02:51 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * tools/mkatlas rasterizes the embedded fonts at the default sizes into
+ * glyphatlas.bin, which is linked into the software like the fonts. Text of
+ * those fonts is measured and rendered from the atlas, so FreeType does not
+ * load or rasterize any glyph before the first frame. Glyphs are placed the
+ * same way as SDL_ttf places them. Texts with a character which is not in
+ * the atlas, and fonts of other sizes, are rendered by SDL_ttf.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "blend.h"
+#include "fontpool.h"
+#include "atlas.h"
+
+/* Symbols for glyphatlas.o which is directly converted from .bin to object using 'ld' */
+extern uint8_t _binary_glyphatlas_bin_start[];
+extern uint8_t _binary_glyphatlas_bin_end;
+extern uint8_t _binary_glyphatlas_bin_size;
+
+atlasStats_t atlasStats;
+
+static const uint8_t * atlasData = NULL;    /* Validated atlas, NULL if there is no usable atlas */
+static uint8_t       * atlasCopy = NULL;    /* Aligned copy of atlas if linked data is not aligned */
+
+/**
+ * @brief getFonts Get fonts of atlas.
+ */
+static inline const atlasFont_t * getFonts(void)
+{
+    return (const atlasFont_t *)(atlasData + sizeof(atlasHeader_t));
+}
+
+/**
+ * @brief getGlyphs Get glyphs of a font.
+ */
+static inline const atlasGlyph_t * getGlyphs(const atlasFont_t * aFont)
+{
+    return (const atlasGlyph_t *)(atlasData + aFont->glyphOffset);
+}
+
+/**
+ * @brief isValidAtlas Check that every table and glyph is inside the atlas.
+ */
+static bool_t isValidAtlas(const uint8_t * aData, size_t aSize)
+{
+    const atlasHeader_t  * header = (const atlasHeader_t *)aData;
+    const atlasFont_t    * font;
+    const atlasGlyph_t   * glyph;
+    uint16_t               i;
+    uint16_t               j;
+
+    if (aSize < sizeof(atlasHeader_t)
+            || memcmp(header->magic, ATLAS_MAGIC, sizeof(header->magic))
+            || header->version != ATLAS_VERSION
+            || sizeof(atlasHeader_t) + (size_t)header->fontCount * sizeof(atlasFont_t) > aSize)
+    {
+        return FALSE;
+    }
+    for (i = 0; i < header->fontCount; i++)
+    {
+        font = (const atlasFont_t *)(aData + sizeof(atlasHeader_t)) + i;
+        if (font->glyphOffset % sizeof(uint32_t) || font->kerningOffset % sizeof(uint16_t)
+                || font->glyphOffset + (size_t)font->glyphCount * sizeof(atlasGlyph_t) > aSize
+                || font->kerningOffset + (size_t)font->kerningCount * sizeof(atlasKerning_t) > aSize)
+        {
+            return FALSE;
+        }
+        for (j = 0; j < font->glyphCount; j++)
+        {
+            glyph = (const atlasGlyph_t *)(aData + font->glyphOffset) + j;
+            if (glyph->pixelOffset + (size_t)glyph->w * glyph->h > aSize)
+            {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief initGlyphAtlas Check atlas linked into the software. If it is not
+ * valid, every text is rendered by SDL_ttf.
+ *
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initGlyphAtlas(void)
+{
+    const uint8_t * data = _binary_glyphatlas_bin_start;
+    size_t          size = (size_t)&_binary_glyphatlas_bin_size;
+    uint16_t        i;
+
+    memset(&atlasStats, 0, sizeof(atlasStats));
+    if ((uintptr_t)data % sizeof(uint32_t))
+    {
+        /* Linker does not align binary data */
+        atlasCopy = malloc(size);
+        if (!atlasCopy)
+        {
+            errorprintf("Cannot allocate memory for glyph atlas!\n");
+            return FALSE;
+        }
+        memcpy(atlasCopy, data, size);
+        data = atlasCopy;
+    }
+
+    if (!isValidAtlas(data, size))
+    {
+        errorprintf("Glyph atlas is invalid, fonts are rasterized at runtime.\n");
+        doneGlyphAtlas();
+        return TRUE;
+    }
+    atlasData = data;
+    for (i = 0; i < ((const atlasHeader_t *)atlasData)->fontCount; i++)
+    {
+        verboseprintf("Glyph atlas: %s %i, %u glyphs\n", getFonts()[i].name, getFonts()[i].size, getFonts()[i].glyphCount);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief findAtlasFont Find pre-rasterized glyphs of a font.
+ *
+ * @param aSource[in]   Path of font file or FONT_SOURCE_*.
+ * @param aSize[in]     Point size of font.
+ * @return Font of atlas, NULL if it is not in the atlas.
+ */
+const atlasFont_t * findAtlasFont(const char * aSource, int aSize)
+{
+    const char * name = NULL;
+    uint16_t     i;
+
+    if (!strcmp(aSource, FONT_SOURCE_EMBEDDED))
+    {
+        name = ATLAS_NAME_EMBEDDED;
+    }
+    else if (!strcmp(aSource, FONT_SOURCE_MONOSPACE))
+    {
+        name = ATLAS_NAME_MONOSPACE;
+    }
+    for (i = 0; atlasData && name && i < ((const atlasHeader_t *)atlasData)->fontCount; i++)
+    {
+        if (getFonts()[i].size == aSize && !strncmp(getFonts()[i].name, name, ATLAS_NAME_LEN))
+        {
+            return &getFonts()[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief decodeUtf8 Decode next character of UTF-8 text.
+ *
+ * @param aText[in,out] Text, it is moved to the next character.
+ * @return Code point, 0: end of text or invalid sequence.
+ */
+static uint32_t decodeUtf8(const char ** aText)
+{
+    const uint8_t * s = (const uint8_t *)*aText;
+    uint32_t        codePoint;
+    uint8_t         count;
+    uint8_t         i;
+
+    if (s[0] < 0x80)
+    {
+        codePoint = s[0];
+        count = 0;
+    }
+    else if ((s[0] & 0xE0) == 0xC0)
+    {
+        codePoint = s[0] & 0x1F;
+        count = 1;
+    }
+    else if ((s[0] & 0xF0) == 0xE0)
+    {
+        codePoint = s[0] & 0x0F;
+        count = 2;
+    }
+    else
+    {
+        /* Characters beyond the basic plane are not in atlas */
+        return 0;
+    }
+    for (i = 1; i <= count; i++)
+    {
+        if (!IS_UTF8_CONTINUATION(s[i]))
+        {
+            return 0;
+        }
+        codePoint = (codePoint << 6) | (s[i] & 0x3F);
+    }
+    *aText += count + 1;
+
+    return codePoint;
+}
+
+/**
+ * @brief findGlyph Find glyph of a character by binary search.
+ *
+ * @return Glyph, NULL if character is not in the atlas.
+ */
+static const atlasGlyph_t * findGlyph(const atlasFont_t * aFont, uint32_t aCodePoint)
+{
+    const atlasGlyph_t * glyphs = getGlyphs(aFont);
+    uint32_t             low = 0;
+    uint32_t             high = aFont->glyphCount;
+    uint32_t             middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (glyphs[middle].codePoint < aCodePoint)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return (low < aFont->glyphCount && glyphs[low].codePoint == aCodePoint) ? &glyphs[low] : NULL;
+}
+
+/**
+ * @brief getKerning Get change of pen position between two glyphs.
+ */
+static int16_t getKerning(const atlasFont_t * aFont, uint16_t aLeft, uint16_t aRight)
+{
+    const atlasKerning_t * pairs = (const atlasKerning_t *)(atlasData + aFont->kerningOffset);
+    uint32_t               key = ((uint32_t)aLeft << 16) | aRight;
+    uint32_t               low = 0;
+    uint32_t               high = aFont->kerningCount;
+    uint32_t               middle;
+
+    if (!aLeft || !aRight)
+    {
+        return 0;
+    }
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if ((((uint32_t)pairs[middle].left << 16) | pairs[middle].right) < key)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return (low < aFont->kerningCount && pairs[low].left == aLeft && pairs[low].right == aRight) ? pairs[low].x : 0;
+}
+
+/**
+ * @brief measureAtlasText Measure text like TTF_SizeUTF8().
+ *
+ * @param aFont[in]     Font of atlas.
+ * @param aText[in]     UTF-8 text.
+ * @param aWidth[out]   Width of text in pixels.
+ * @return TRUE: if every character is in the atlas.
+ */
+static bool_t measureAtlasText(const atlasFont_t * aFont, const char * aText, int * aWidth)
+{
+    const atlasGlyph_t * glyph;
+    uint32_t             codePoint;
+    uint16_t             prevIndex = 0;
+    int                  minX = 0;
+    int                  maxX = 0;
+    int                  x = 0;
+    int                  z;
+
+    while (*aText)
+    {
+        codePoint = decodeUtf8(&aText);
+        glyph = codePoint ? findGlyph(aFont, codePoint) : NULL;
+        if (!glyph)
+        {
+            return FALSE;
+        }
+        x += getKerning(aFont, prevIndex, glyph->index);
+        z = x + glyph->minX;
+        minX = MIN(minX, z);
+        z = x + MAX(glyph->advance, glyph->maxX);
+        maxX = MAX(maxX, z);
+        x += glyph->advance;
+        prevIndex = glyph->index;
+    }
+    *aWidth = maxX - minX;
+
+    return TRUE;
+}
+
+/**
+ * @brief renderAtlasText Render text from atlas to coverage mask, like
+ * TTF_RenderUTF8_Shaded() does.
+ *
+ * @param aFont[in]     Font of atlas.
+ * @param aText[in]     UTF-8 text, it is not empty.
+ * @param aBinary[in]   TRUE: coverage is thresholded like solid rendering.
+ * @return Coverage mask, NULL if a character is not in the atlas or error occurred.
+ */
+static alphaMask_t * renderAtlasText(const atlasFont_t * aFont, const char * aText, bool_t aBinary)
+{
+    const atlasGlyph_t * glyph;
+    const uint8_t      * src;
+    uint8_t            * dst;
+    alphaMask_t        * mask;
+    uint32_t             codePoint;
+    uint16_t             prevIndex = 0;
+    bool_t               first = TRUE;
+    int                  width;
+    int                  x = 0;
+    int                  dstX;
+    int                  dstY;
+    int                  col;
+    int                  row;
+
+    if (!measureAtlasText(aFont, aText, &width) || width <= 0)
+    {
+        return NULL;
+    }
+    mask = allocAlphaMask(width, aFont->height);
+    if (!mask)
+    {
+        return NULL;
+    }
+    memset(mask->pixels, 0, (size_t)mask->w * mask->h);
+
+    while (*aText)
+    {
+        codePoint = decodeUtf8(&aText);
+        glyph = findGlyph(aFont, codePoint);
+        x += getKerning(aFont, prevIndex, glyph->index);
+        if (first && glyph->minX < 0)
+        {
+            /* First glyph is shifted right if it starts left of the pen */
+            x -= glyph->minX;
+        }
+        first = FALSE;
+        src = atlasData + glyph->pixelOffset;
+        for (row = 0; row < glyph->h; row++, src += glyph->w)
+        {
+            dstY = row + aFont->ascent - glyph->maxY;
+            if (dstY < 0 || dstY >= mask->h)
+            {
+                continue;
+            }
+            dst = &mask->pixels[dstY * mask->w];
+            for (col = 0; col < glyph->w; col++)
+            {
+                dstX = x + glyph->minX + col;
+                if (dstX >= 0 && dstX < mask->w)
+                {
+                    dst[dstX] = MAX(dst[dstX], src[col]);
+                }
+            }
+        }
+        x += glyph->advance;
+        prevIndex = glyph->index;
+    }
+
+    if (aBinary)
+    {
+        for (col = 0; col < mask->w * mask->h; col++)
+        {
+            mask->pixels[col] = mask->pixels[col] >= 128 ? 255 : 0;
+        }
+    }
+
+    return mask;
+}
+
+/**
+ * @brief sizeText Measure text from atlas if possible, otherwise by SDL_ttf.
+ *
+ * @param aFont[in]     Font.
+ * @param aAtlas[in]    Pre-rasterized glyphs of font, NULL if font is not in atlas.
+ * @param aText[in]     UTF-8 text.
+ * @param aWidth[out]   Width of text in pixels.
+ * @param aHeight[out]  Height of text in pixels.
+ */
+void sizeText(TTF_Font * aFont, const atlasFont_t * aAtlas, const char * aText, int * aWidth, int * aHeight)
+{
+    if (aAtlas && measureAtlasText(aAtlas, aText, aWidth))
+    {
+        *aHeight = aAtlas->height;
+    }
+    else
+    {
+        TTF_SizeUTF8(aFont, aText, aWidth, aHeight);
+    }
+}
+
+/**
+ * @brief renderText Render text to coverage mask from atlas if possible,
+ * otherwise by SDL_ttf.
+ *
+ * @param aFont[in]     Font.
+ * @param aAtlas[in]    Pre-rasterized glyphs of font, NULL if font is not in atlas.
+ * @param aText[in]     UTF-8 text, it shall not be empty.
+ * @param aBinary[in]   TRUE: not anti-aliased (solid tier), FALSE: anti-aliased.
+ * @return Coverage mask, it shall be freed by freeAlphaMask(). NULL: error occurred.
+ */
+alphaMask_t * renderText(TTF_Font * aFont, const atlasFont_t * aAtlas, const char * aText, bool_t aBinary)
+{
+    static const SDL_Color white = { 0xFF, 0xFF, 0xFF, 0 };
+    static const SDL_Color black = { 0, 0, 0, 0 };
+    SDL_Surface * sdl_text;
+    alphaMask_t * mask = NULL;
+
+    if (aAtlas)
+    {
+        mask = renderAtlasText(aAtlas, aText, aBinary);
+        if (mask)
+        {
+            __sync_add_and_fetch(&atlasStats.atlasRenders, 1);
+            return mask;
+        }
+    }
+
+    /* Palette of white text on black is the coverage */
+    if (aBinary)
+    {
+        sdl_text = TTF_RenderUTF8_Solid(aFont, aText, white);
+    }
+    else
+    {
+        sdl_text = TTF_RenderUTF8_Shaded(aFont, aText, white, black);
+    }
+    if (sdl_text == NULL)
+    {
+        errorprintf("TTF_RenderUTF8() Failed: %s\n", TTF_GetError());
+        return NULL;
+    }
+    mask = createAlphaMask(sdl_text);
+    SDL_FreeSurface(sdl_text);
+    __sync_add_and_fetch(&atlasStats.fontRenders, 1);
+
+    return mask;
+}
+
+/**
+ * @brief printAtlasStats Print usage of atlas to console.
+ */
+void printAtlasStats(void)
+{
+    printf("Glyph atlas fonts:                %u\n", atlasData ? ((const atlasHeader_t *)atlasData)->fontCount : 0);
+    printf("Texts from atlas/by FreeType:     %u / %u\n", atlasStats.atlasRenders, atlasStats.fontRenders);
+}
+
+/**
+ * @brief doneGlyphAtlas Release copy of atlas.
+ */
+void doneGlyphAtlas(void)
+{
+    atlasData = NULL;
+    free(atlasCopy);
+    atlasCopy = NULL;
+}
@@ -0,0 +1,90 @@
+/**
+ * @file        atlas.h
+ * @brief       Glyphs of embedded fonts rasterized at build time
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 09:02:51
+ * Last modify: 2021-03-07 09:02:51 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_ATLAS_H
+#define INCLUDE_ATLAS_H
+
+#include <stdint.h>
+
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "blend.h"
+
+#define ATLAS_MAGIC                 "DTGA"
+#define ATLAS_VERSION               1
+#define ATLAS_NAME_LEN              16
+
+/* Names of embedded fonts in atlas, see FONT_SOURCE_* */
+#define ATLAS_NAME_EMBEDDED         "embedded"
+#define ATLAS_NAME_MONOSPACE        "monospace"
+
+/* Layout of atlas file written by tools/mkatlas. Offsets are from the start
+ * of file, values are in byte order of the target. */
+typedef struct
+{
+    char        magic[4];                   /* ATLAS_MAGIC */
+    uint16_t    version;                    /* ATLAS_VERSION */
+    uint16_t    fontCount;                  /* Count of atlasFont_t which follow the header */
+} atlasHeader_t;
+
+/* A font of a size, metrics are the same as SDL_ttf calculates */
+typedef struct
+{
+    char        name[ATLAS_NAME_LEN];       /* ATLAS_NAME_* */
+    int16_t     size;                       /* Point size */
+    int16_t     ascent;
+    int16_t     descent;
+    int16_t     height;
+    int16_t     lineSkip;
+    uint16_t    glyphCount;
+    uint32_t    glyphOffset;                /* Glyphs sorted by code point */
+    uint32_t    kerningCount;
+    uint32_t    kerningOffset;              /* Kerning pairs sorted by left then right glyph */
+} atlasFont_t;
+
+typedef struct
+{
+    uint32_t    codePoint;
+    uint16_t    index;                      /* Index of glyph in font, used by kerning */
+    int16_t     minX;
+    int16_t     maxX;
+    int16_t     minY;
+    int16_t     maxY;
+    int16_t     advance;
+    uint16_t    w;                          /* Size of coverage, w is the pitch too */
+    uint16_t    h;
+    uint32_t    pixelOffset;                /* Coverage of glyph, 0: background, 255: full */
+} atlasGlyph_t;
+
+typedef struct
+{
+    uint16_t    left;                       /* Index of glyphs */
+    uint16_t    right;
+    int16_t     x;                          /* Change of pen position in pixels */
+} atlasKerning_t;
+
+/* Statistics */
+typedef struct
+{
+    uint32_t    atlasRenders;               /* Texts rendered from atlas */
+    uint32_t    fontRenders;                /* Texts rendered by FreeType */
+} atlasStats_t;
+
+extern atlasStats_t atlasStats;
+
+bool_t initGlyphAtlas(void);
+const atlasFont_t * findAtlasFont(const char * aSource, int aSize);
+void sizeText(TTF_Font * aFont, const atlasFont_t * aAtlas, const char * aText, int * aWidth, int * aHeight);
+alphaMask_t * renderText(TTF_Font * aFont, const atlasFont_t * aAtlas, const char * aText, bool_t aBinary);
+void printAtlasStats(void);
+void doneGlyphAtlas(void);
+
+#endif /* INCLUDE_ATLAS_H */
@@ -0,0 +1,794 @@
+/**
+ * @file        blend.c
+ * @brief       Coverage masks of text and blending them to surfaces
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-26 18:44:02
+ * Last modify: 2021-02-26 18:44:02 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Text is rasterized once by SDL_ttf as white on black, then only its
+ * coverage is stored. Color is applied when the mask is drawn, so changing
+ * colors does not need rendering text again. Masks with outline and shadow
+ * are drawn by a table of two tones (see blend.h). Row kernels are selected at
+ * startup by features of the processor, see blendkernel.h.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__arm__) && defined(__linux__)
+#include <sys/auxv.h>
+#endif
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "stats.h"
+#include "blendkernel.h"
+#include "blend.h"
+
+#define BLEND_MAX_VARIANTS      4           /* Scalar and vectorized variants of kernels */
+#define BLEND_HWCAP_NEON        (1 << 12)   /* HWCAP_NEON of 32-bit ARM Linux */
+#define BLEND_BENCH_WIDTH       1920        /* Size of mask used by benchmark */
+#define BLEND_BENCH_HEIGHT      64
+#define BLEND_BENCH_ROUNDS      200
+
+/* Mapped pixels from background (0) to text color (255), used by BLEND_MODE_lut */
+static Uint32            lut[256];
+static SDL_PixelFormat   lutFormat;         /* Copy of format, pointer may be reused by a new surface */
+static SDL_Color         lutColor;
+static SDL_Color         lutBackground;
+
+/* Mapped pixels of two tones of masks with effects, used by drawEffectMask() */
+static Uint32            effectLut[256];
+static SDL_PixelFormat   effectLutFormat;
+static SDL_Color         effectLutColor;
+static SDL_Color         effectLutEffectColor;
+static SDL_Color         effectLutBackground;
+
+/**
+ * @brief isSameColor Compare two colors.
+ */
+static bool_t isSameColor(SDL_Color aColor1, SDL_Color aColor2)
+{
+    return aColor1.r == aColor2.r && aColor1.g == aColor2.g && aColor1.b == aColor2.b;
+}
+
+/**
+ * @brief blendRow32Scalar Blend color to a row of 32-bit pixels, see blendRow32_t.
+ */
+static void blendRow32Scalar(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = blendPixel32(aDst[i], aColor, aMask[i]);
+        }
+    }
+}
+
+/**
+ * @brief keyRow32Scalar Fill pixels with coverage by color, see keyRow32_t.
+ */
+static void keyRow32Scalar(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aColor;
+        }
+    }
+}
+
+/**
+ * @brief lutRow32Scalar Fill pixels by mapped color of coverage, see lutRow32_t.
+ */
+static void lutRow32Scalar(uint32_t * aDst, const uint8_t * aMask, int aCount, const uint32_t * aLut)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aLut[aMask[i]];
+        }
+    }
+}
+
+/**
+ * @brief maxRow8Scalar Maximum of two rows of coverage, see maxRow8_t.
+ */
+static void maxRow8Scalar(uint8_t * aDst, const uint8_t * aSrc, int aCount)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        aDst[i] = MAX(aDst[i], aSrc[i]);
+    }
+}
+
+/**
+ * @brief sumRow16Scalar Update running sums of coverage, see sumRow16_t.
+ */
+static void sumRow16Scalar(uint16_t * aSum, const uint8_t * aAdd, const uint8_t * aSub, int aCount)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        aSum[i] += aAdd[i] - aSub[i];
+    }
+}
+
+/**
+ * @brief repeatRow32Scalar Enlarge a row of pixels, see repeatRow32_t.
+ */
+static void repeatRow32Scalar(uint32_t * aDst, const uint32_t * aSrc, int aCount, int aFactor)
+{
+    int i;
+
+    for (i = 0; i < aCount; i++)
+    {
+        aDst[i] = aSrc[i / aFactor];
+    }
+}
+
+static const blendKernels_t scalarKernels =
+{
+    .name = "scalar",
+    .blendRow32 = blendRow32Scalar,
+    .keyRow32 = keyRow32Scalar,
+    .lutRow32 = lutRow32Scalar,
+    .maxRow8 = maxRow8Scalar,
+    .sumRow16 = sumRow16Scalar,
+    .repeatRow32 = repeatRow32Scalar,
+};
+
+/* Kernels selected by initBlendKernels() */
+static const blendKernels_t * kernels = &scalarKernels;
+
+/**
+ * @brief getSupportedKernels Get variants of kernels which can run on this
+ * processor.
+ *
+ * @param aKernels[out] Variants, from slowest to fastest.
+ * @return Count of variants, at least 1.
+ */
+static uint8_t getSupportedKernels(const blendKernels_t * aKernels[BLEND_MAX_VARIANTS])
+{
+    uint8_t count = 0;
+
+    aKernels[count++] = &scalarKernels;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2") && getSse2BlendKernels())
+    {
+        aKernels[count++] = getSse2BlendKernels();
+    }
+    /* It checks that the operating system saves AVX registers too */
+    if (__builtin_cpu_supports("avx2") && getAvx2BlendKernels())
+    {
+        aKernels[count++] = getAvx2BlendKernels();
+    }
+#elif defined(__aarch64__)
+    if (getNeonBlendKernels())
+    {
+        aKernels[count++] = getNeonBlendKernels();
+    }
+#elif defined(__arm__) && defined(__linux__)
+    if ((getauxval(AT_HWCAP) & BLEND_HWCAP_NEON) && getNeonBlendKernels())
+    {
+        aKernels[count++] = getNeonBlendKernels();
+    }
+#endif
+
+    return count;
+}
+
+/**
+ * @brief initBlendKernels Select the fastest kernels supported by the
+ * processor. It shall be called before any thread draws text.
+ */
+void initBlendKernels(void)
+{
+    const blendKernels_t * supported[BLEND_MAX_VARIANTS];
+
+    kernels = supported[getSupportedKernels(supported) - 1];
+}
+
+/**
+ * @brief getBlendKernelName Get name of the selected kernels.
+ *
+ * @return Name of kernels.
+ */
+const char * getBlendKernelName(void)
+{
+    return kernels->name;
+}
+
+/**
+ * @brief getBlendKernels Get the selected kernels.
+ *
+ * @return Kernels.
+ */
+const blendKernels_t * getBlendKernels(void)
+{
+    return kernels;
+}
+
+/**
+ * @brief getPixel Read a pixel of any depth.
+ */
+static inline Uint32 getPixel(const uint8_t * aPixel, uint8_t aBytesPerPixel)
+{
+    Uint32 pixel;
+
+    switch (aBytesPerPixel)
+    {
+        case 1:
+            pixel = *aPixel;
+            break;
+        case 2:
+            pixel = *(const Uint16 *)aPixel;
+            break;
+        case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            pixel = (aPixel[0] << 16) | (aPixel[1] << 8) | aPixel[2];
+#else
+            pixel = aPixel[0] | (aPixel[1] << 8) | (aPixel[2] << 16);
+#endif
+            break;
+        default:
+            pixel = *(const Uint32 *)aPixel;
+            break;
+    }
+
+    return pixel;
+}
+
+/**
+ * @brief putPixel Write a pixel of any depth.
+ */
+static inline void putPixel(uint8_t * aPixel, uint8_t aBytesPerPixel, Uint32 aValue)
+{
+    switch (aBytesPerPixel)
+    {
+        case 1:
+            *aPixel = aValue;
+            break;
+        case 2:
+            *(Uint16 *)aPixel = aValue;
+            break;
+        case 3:
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+            aPixel[0] = aValue >> 16;
+            aPixel[1] = aValue >> 8;
+            aPixel[2] = aValue;
+#else
+            aPixel[0] = aValue;
+            aPixel[1] = aValue >> 8;
+            aPixel[2] = aValue >> 16;
+#endif
+            break;
+        default:
+            *(Uint32 *)aPixel = aValue;
+            break;
+    }
+}
+
+/**
+ * @brief isSameFormat Compare pixel format to a copy of format.
+ */
+static bool_t isSameFormat(const SDL_PixelFormat * aCopy, const SDL_PixelFormat * aFormat)
+{
+    return aCopy->BytesPerPixel == aFormat->BytesPerPixel
+            && aCopy->Rmask == aFormat->Rmask
+            && aCopy->Gmask == aFormat->Gmask
+            && aCopy->Bmask == aFormat->Bmask;
+}
+
+/**
+ * @brief updateLut Calculate mapped pixels from background to text color if
+ * colors or pixel format have changed.
+ */
+static void updateLut(SDL_PixelFormat * aFormat, SDL_Color aColor, SDL_Color aBackground)
+{
+    uint16_t i;
+
+    if (isSameFormat(&lutFormat, aFormat)
+            && isSameColor(lutColor, aColor)
+            && isSameColor(lutBackground, aBackground))
+    {
+        return;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        lut[i] = SDL_MapRGB(aFormat,
+                            mix(aBackground.r, aColor.r, i),
+                            mix(aBackground.g, aColor.g, i),
+                            mix(aBackground.b, aColor.b, i));
+    }
+    lutFormat = *aFormat;
+    lutColor = aColor;
+    lutBackground = aBackground;
+}
+
+/**
+ * @brief getToneCoverage Get coverage of a tone of mask with effects.
+ *
+ * @param aValue[in] Pixel of mask with padding.
+ * @return Coverage of effect color if value is below EFFECT_TONE_TEXT,
+ * otherwise coverage of text color on effect color.
+ */
+static inline uint8_t getToneCoverage(uint8_t aValue)
+{
+    uint8_t level = aValue >= EFFECT_TONE_TEXT ? aValue - EFFECT_TONE_TEXT : aValue;
+
+    return (level * 255u + 63u) / 127u;
+}
+
+/**
+ * @brief updateEffectLut Calculate mapped pixels of two tones if colors or
+ * pixel format have changed.
+ */
+static void updateEffectLut(SDL_PixelFormat * aFormat, SDL_Color aColor, SDL_Color aEffectColor, SDL_Color aBackground)
+{
+    SDL_Color from;
+    SDL_Color to;
+    uint16_t  i;
+
+    if (isSameFormat(&effectLutFormat, aFormat)
+            && isSameColor(effectLutColor, aColor)
+            && isSameColor(effectLutEffectColor, aEffectColor)
+            && isSameColor(effectLutBackground, aBackground))
+    {
+        return;
+    }
+
+    for (i = 0; i < 256; i++)
+    {
+        from = i >= EFFECT_TONE_TEXT ? aEffectColor : aBackground;
+        to = i >= EFFECT_TONE_TEXT ? aColor : aEffectColor;
+        effectLut[i] = SDL_MapRGB(aFormat,
+                                  mix(from.r, to.r, getToneCoverage(i)),
+                                  mix(from.g, to.g, getToneCoverage(i)),
+                                  mix(from.b, to.b, getToneCoverage(i)));
+    }
+    effectLutFormat = *aFormat;
+    effectLutColor = aColor;
+    effectLutEffectColor = aEffectColor;
+    effectLutBackground = aBackground;
+}
+
+/**
+ * @brief allocAlphaMask Allocate coverage mask without padding, its pixels
+ * are not initialized.
+ *
+ * @param aWidth[in]    Width in pixels.
+ * @param aHeight[in]   Height in pixels.
+ * @return Mask, it shall be freed by freeAlphaMask(). NULL: error occurred.
+ */
+alphaMask_t * allocAlphaMask(uint16_t aWidth, uint16_t aHeight)
+{
+    alphaMask_t * mask;
+
+    mask = malloc(sizeof(alphaMask_t) + (size_t)aWidth * aHeight);
+    if (!mask)
+    {
+        errorprintf("Cannot allocate coverage mask!\n");
+        return NULL;
+    }
+    mask->w = aWidth;
+    mask->h = aHeight;
+    mask->padding = 0;
+    mask->pixels = (uint8_t *)(mask + 1);
+
+    return mask;
+}
+
+/**
+ * @brief createAlphaMask Create coverage mask from text rendered by SDL_ttf
+ * as white on black, by TTF_RenderUTF8_Solid() or TTF_RenderUTF8_Shaded().
+ *
+ * @param aText[in] 8-bit rendered text.
+ * @return Mask, it shall be freed by freeAlphaMask(). NULL: error occurred.
+ */
+alphaMask_t * createAlphaMask(SDL_Surface * aText)
+{
+    alphaMask_t     * mask;
+    SDL_Palette     * palette = aText->format->palette;
+    uint8_t           coverage[256];
+    const uint8_t   * row;
+    bool_t            identity = TRUE;
+    uint16_t          x;
+    uint16_t          y;
+    uint16_t          i;
+
+    if (aText->format->BytesPerPixel != 1)
+    {
+        errorprintf("Coverage mask can be created only from 8-bit surface!\n");
+        return NULL;
+    }
+
+    mask = allocAlphaMask(aText->w, aText->h);
+    if (!mask)
+    {
+        return NULL;
+    }
+
+    /* Gray levels of palette are the coverage, count of levels depends on SDL_ttf version */
+    for (i = 0; i < 256; i++)
+    {
+        coverage[i] = (palette && i < palette->ncolors) ? palette->colors[i].r : i;
+        identity = identity && coverage[i] == i;
+    }
+
+    if (SDL_MUSTLOCK(aText))
+    {
+        SDL_LockSurface(aText);
+    }
+    for (y = 0; y < aText->h; y++)
+    {
+        row = (const uint8_t *)aText->pixels + y * aText->pitch;
+        if (identity)
+        {
+            /* Palette of shaded text is gray levels from 0 to 255 */
+            memcpy(&mask->pixels[y * mask->w], row, mask->w);
+        }
+        else
+        {
+            for (x = 0; x < aText->w; x++)
+            {
+                mask->pixels[y * mask->w + x] = coverage[row[x]];
+            }
+        }
+    }
+    if (SDL_MUSTLOCK(aText))
+    {
+        SDL_UnlockSurface(aText);
+    }
+
+    return mask;
+}
+
+/**
+ * @brief freeAlphaMask Release coverage mask.
+ *
+ * @param aMask[in] Mask to release, it can be NULL.
+ */
+void freeAlphaMask(alphaMask_t * aMask)
+{
+    free(aMask);
+}
+
+/**
+ * @brief drawAlphaMask Draw text color to surface by coverage mask.
+ *
+ * @param aDst[in,out]      Destination surface, it is clipped by its clip rectangle.
+ * @param x[in]             X coordinate of mask on destination.
+ * @param y[in]             Y coordinate of mask on destination.
+ * @param aMask[in]         Coverage mask.
+ * @param aColor[in]        Text color.
+ * @param aBackground[in]   Background color, only used by BLEND_MODE_lut.
+ * @param aMode[in]         How coverage is applied.
+ */
+void drawAlphaMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                   SDL_Color aColor, SDL_Color aBackground, blendMode_t aMode)
+{
+    SDL_PixelFormat * format = aDst->format;
+    uint8_t           bpp = format->BytesPerPixel;
+    int               x0 = MAX(x, aDst->clip_rect.x);
+    int               y0 = MAX(y, aDst->clip_rect.y);
+    int               x1 = MIN(x + aMask->w, aDst->clip_rect.x + aDst->clip_rect.w);
+    int               y1 = MIN(y + aMask->h, aDst->clip_rect.y + aDst->clip_rect.h);
+    Uint32            color = SDL_MapRGB(format, aColor.r, aColor.g, aColor.b);
+    bool_t            fast32 = bpp == 4 && !format->Rloss && !format->Gloss && !format->Bloss;
+    const uint8_t   * m;
+    uint8_t         * d;
+    Uint8             r;
+    Uint8             g;
+    Uint8             b;
+    int               i;
+    int               j;
+
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+    if (aMode == BLEND_MODE_lut)
+    {
+        updateLut(format, aColor, aBackground);
+    }
+
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_LockSurface(aDst);
+    }
+    for (j = y0; j < y1; j++)
+    {
+        m = aMask->pixels + (j - y) * aMask->w + (x0 - x);
+        d = (uint8_t *)aDst->pixels + j * aDst->pitch + x0 * bpp;
+        if (bpp == 4)
+        {
+            /* Kernels of 32-bit pixels */
+            if (aMode == BLEND_MODE_key)
+            {
+                kernels->keyRow32((uint32_t *)d, m, x1 - x0, color);
+                continue;
+            }
+            if (aMode == BLEND_MODE_lut)
+            {
+                kernels->lutRow32((uint32_t *)d, m, x1 - x0, lut);
+                continue;
+            }
+            if (fast32)
+            {
+                kernels->blendRow32((uint32_t *)d, m, x1 - x0, color);
+                continue;
+            }
+        }
+        for (i = 0; i < x1 - x0; i++, d += bpp)
+        {
+            if (!m[i])
+            {
+                continue;
+            }
+            switch (aMode)
+            {
+                case BLEND_MODE_key:
+                    putPixel(d, bpp, color);
+                    break;
+                case BLEND_MODE_lut:
+                    putPixel(d, bpp, lut[m[i]]);
+                    break;
+                case BLEND_MODE_blend:
+                default:
+                    SDL_GetRGB(getPixel(d, bpp), format, &r, &g, &b);
+                    putPixel(d, bpp, SDL_MapRGB(format, mix(r, aColor.r, m[i]),
+                                                mix(g, aColor.g, m[i]), mix(b, aColor.b, m[i])));
+                    break;
+            }
+        }
+    }
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_UnlockSurface(aDst);
+    }
+}
+
+/**
+ * @brief drawEffectMask Draw text with outline and shadow to surface by a
+ * mask with padding, see createEffectMask().
+ *
+ * @param aDst[in,out]      Destination surface, it is clipped by its clip rectangle.
+ * @param x[in]             X coordinate of mask on destination, including padding.
+ * @param y[in]             Y coordinate of mask on destination, including padding.
+ * @param aMask[in]         Mask of two tones.
+ * @param aColor[in]        Text color.
+ * @param aEffectColor[in]  Color of outline and shadow.
+ * @param aBackground[in]   Background color, not used by BLEND_MODE_blend.
+ * @param aMode[in]         How coverage is applied. BLEND_MODE_key is drawn
+ *                          like BLEND_MODE_lut, it costs the same.
+ */
+void drawEffectMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                    SDL_Color aColor, SDL_Color aEffectColor, SDL_Color aBackground, blendMode_t aMode)
+{
+    SDL_PixelFormat * format = aDst->format;
+    uint8_t           bpp = format->BytesPerPixel;
+    int               x0 = MAX(x, aDst->clip_rect.x);
+    int               y0 = MAX(y, aDst->clip_rect.y);
+    int               x1 = MIN(x + aMask->w, aDst->clip_rect.x + aDst->clip_rect.w);
+    int               y1 = MIN(y + aMask->h, aDst->clip_rect.y + aDst->clip_rect.h);
+    Uint32            effect = SDL_MapRGB(format, aEffectColor.r, aEffectColor.g, aEffectColor.b);
+    bool_t            fast32 = bpp == 4 && !format->Rloss && !format->Gloss && !format->Bloss;
+    const uint8_t   * m;
+    uint8_t         * d;
+    Uint8             r;
+    Uint8             g;
+    Uint8             b;
+    int               i;
+    int               j;
+
+    if (x0 >= x1 || y0 >= y1)
+    {
+        return;
+    }
+    updateEffectLut(format, aColor, aEffectColor, aBackground);
+
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_LockSurface(aDst);
+    }
+    for (j = y0; j < y1; j++)
+    {
+        m = aMask->pixels + (j - y) * aMask->w + (x0 - x);
+        d = (uint8_t *)aDst->pixels + j * aDst->pitch + x0 * bpp;
+        if (aMode != BLEND_MODE_blend && bpp == 4)
+        {
+            kernels->lutRow32((uint32_t *)d, m, x1 - x0, effectLut);
+            continue;
+        }
+        for (i = 0; i < x1 - x0; i++, d += bpp)
+        {
+            if (!m[i])
+            {
+                continue;
+            }
+            if (aMode != BLEND_MODE_blend || m[i] >= EFFECT_TONE_TEXT)
+            {
+                /* Text tone is opaque, effect is under it */
+                putPixel(d, bpp, effectLut[m[i]]);
+            }
+            else if (fast32)
+            {
+                *(uint32_t *)d = blendPixel32(*(uint32_t *)d, effect, getToneCoverage(m[i]));
+            }
+            else
+            {
+                SDL_GetRGB(getPixel(d, bpp), format, &r, &g, &b);
+                putPixel(d, bpp, SDL_MapRGB(format, mix(r, aEffectColor.r, getToneCoverage(m[i])),
+                                            mix(g, aEffectColor.g, getToneCoverage(m[i])),
+                                            mix(b, aEffectColor.b, getToneCoverage(m[i]))));
+            }
+        }
+    }
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_UnlockSurface(aDst);
+    }
+}
+
+/**
+ * @brief benchBlendKernels Run every supported variant of kernels on a
+ * text-like mask, check them against the scalar kernels and print their
+ * speed.
+ *
+ * @return TRUE: if every variant gave the same pixels as scalar kernels.
+ */
+bool_t benchBlendKernels(void)
+{
+    const blendKernels_t * supported[BLEND_MAX_VARIANTS];
+    uint8_t                count = getSupportedKernels(supported);
+    size_t                 pixelCount = (size_t)BLEND_BENCH_WIDTH * BLEND_BENCH_HEIGHT;
+    uint8_t              * mask = malloc(pixelCount);
+    uint32_t             * expected = malloc(pixelCount * sizeof(uint32_t) * 6);
+    uint32_t             * pixels = malloc(pixelCount * sizeof(uint32_t));
+    uint32_t             * halfRows = malloc(pixelCount / 2 * sizeof(uint32_t));
+    uint8_t              * bytes = malloc(pixelCount);
+    uint16_t               sums[BLEND_BENCH_WIDTH];
+    uint32_t               benchLut[256];
+    uint32_t               seed = 12345;
+    double                 mpxPerSec[6];
+    uint64_t               startUs;
+    bool_t                 ok = TRUE;
+    bool_t                 same;
+    size_t                 i;
+    uint32_t               run;
+    uint32_t               round;
+    uint8_t                k;
+    uint8_t                v;
+    int                    y;
+
+    if (!mask || !expected || !pixels || !halfRows || !bytes)
+    {
+        errorprintf("Cannot allocate memory for benchmark!\n");
+        free(mask);
+        free(expected);
+        free(pixels);
+        free(halfRows);
+        free(bytes);
+        return FALSE;
+    }
+
+    /* Runs of background and strokes with anti-aliased edges, like text.
+     * Rows of ascenders and descenders are mostly background. */
+    for (i = 0; i < pixelCount; )
+    {
+        y = i / BLEND_BENCH_WIDTH;
+        seed = seed * 1103515245u + 12345u;
+        run = (seed >> 16) % (y < BLEND_BENCH_HEIGHT / 4 || y >= BLEND_BENCH_HEIGHT * 3 / 4 ? 400 : 24);
+        memset(&mask[i], 0, MIN(run, pixelCount - i));
+        i += run;
+        for (run = (seed >> 8) % 6; run > 0 && i < pixelCount; run--, i++)
+        {
+            mask[i] = (run == 1 || ((seed >> 4) & 1)) ? (uint8_t)(seed >> 24) | 1 : 255;
+        }
+    }
+    for (i = 0; i < 256; i++)
+    {
+        benchLut[i] = 0x00010101u * i;
+    }
+    for (i = 0; i < pixelCount / 2; i++)
+    {
+        halfRows[i] = 0x00102030u + i * 3;
+    }
+
+    printf("Kernel       blend Mpx/s    key Mpx/s    lut Mpx/s    max Mpx/s    sum Mpx/s repeat Mpx/s\n");
+    for (k = 0; k < count; k++)
+    {
+        /* Output of scalar kernels is the reference */
+        same = TRUE;
+        for (v = 0; v < 6; v++)
+        {
+            for (i = 0; i < pixelCount; i++)
+            {
+                pixels[i] = 0x00203040u + i;
+                bytes[i] = i * 7;
+            }
+            memset(sums, 0, sizeof(sums));
+            startUs = getTimeUs();
+            for (round = 0; round < BLEND_BENCH_ROUNDS; round++)
+            {
+                for (y = 0; y < BLEND_BENCH_HEIGHT; y++)
+                {
+                    size_t offset = (size_t)y * BLEND_BENCH_WIDTH;
+
+                    switch (v)
+                    {
+                        case 0:
+                            supported[k]->blendRow32(&pixels[offset], &mask[offset], BLEND_BENCH_WIDTH, 0x00C0FFEEu);
+                            break;
+                        case 1:
+                            supported[k]->keyRow32(&pixels[offset], &mask[offset], BLEND_BENCH_WIDTH, 0x00C0FFEEu);
+                            break;
+                        case 2:
+                            supported[k]->lutRow32(&pixels[offset], &mask[offset], BLEND_BENCH_WIDTH, benchLut);
+                            break;
+                        case 3:
+                            /* Dilation of outline, mask is shifted by a pixel */
+                            supported[k]->maxRow8(&bytes[offset + 1], &mask[offset], BLEND_BENCH_WIDTH - 1);
+                            break;
+                        case 4:
+                            /* Vertical box blur of shadow */
+                            supported[k]->sumRow16(sums, &mask[offset],
+                                                   &mask[((y + 5) % BLEND_BENCH_HEIGHT) * BLEND_BENCH_WIDTH],
+                                                   BLEND_BENCH_WIDTH);
+                            break;
+                        default:
+                            /* Upscaling of picture rendered at half resolution */
+                            supported[k]->repeatRow32(&pixels[offset], &halfRows[offset / 2], BLEND_BENCH_WIDTH, 2);
+                            break;
+                    }
+                }
+            }
+            for (i = 0; (v == 3 || v == 4) && i < pixelCount; i++)
+            {
+                /* Results of effect kernels are compared as pixels */
+                pixels[i] = v == 3 ? bytes[i] : i < BLEND_BENCH_WIDTH ? sums[i] : 0;
+            }
+            mpxPerSec[v] = (double)pixelCount * BLEND_BENCH_ROUNDS / MAX(getTimeUs() - startUs, 1u);
+            if (k == 0)
+            {
+                memcpy(&expected[v * pixelCount], pixels, pixelCount * sizeof(uint32_t));
+            }
+            else if (memcmp(&expected[v * pixelCount], pixels, pixelCount * sizeof(uint32_t)))
+            {
+                same = FALSE;
+            }
+        }
+        printf("%-12s %11.1f %12.1f %12.1f %12.1f %12.1f %12.1f%s%s\n", supported[k]->name,
+               mpxPerSec[0], mpxPerSec[1], mpxPerSec[2], mpxPerSec[3], mpxPerSec[4], mpxPerSec[5],
+               supported[k] == kernels ? " (selected)" : "", same ? "" : " MISMATCH");
+        ok = ok && same;
+    }
+
+    free(mask);
+    free(expected);
+    free(pixels);
+    free(halfRows);
+    free(bytes);
+
+    return ok;
+}
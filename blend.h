@@ -0,0 +1,56 @@
+/**
+ * @file        blend.h
+ * @brief       Coverage masks of text and blending them to surfaces
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-26 18:44:02
+ * Last modify: 2021-02-26 18:44:02 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_BLEND_H
+#define INCLUDE_BLEND_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+
+typedef enum
+{
+    BLEND_MODE_key,             /**< Pixels with coverage are set to text color */
+    BLEND_MODE_lut,             /**< Text is drawn onto background color, destination is not read */
+    BLEND_MODE_blend,           /**< Text color is blended onto destination by coverage */
+} blendMode_t;
+
+/**
+ * Coverage of rendered text, 0: background, 255: text color. It does not
+ * depend on color or pixel format, so it can be drawn with any of them.
+ *
+ * A mask with padding has outline and shadow around the text (see effect.h),
+ * its pixels have two tones: 0..127 is coverage of effect color on
+ * background, 128..255 is coverage of text color on effect color.
+ */
+typedef struct
+{
+    uint16_t    w;                          /**< Width in pixels, it is the pitch too */
+    uint16_t    h;                          /**< Height in pixels */
+    uint16_t    padding;                    /**< Pixels of effects around text, 0: coverage of text only */
+    uint8_t   * pixels;                     /**< Coverage of pixels */
+} alphaMask_t;
+
+#define EFFECT_TONE_TEXT            128     /**< First value of text tone in mask with padding */
+
+void initBlendKernels(void);
+const char * getBlendKernelName(void);
+alphaMask_t * allocAlphaMask(uint16_t aWidth, uint16_t aHeight);
+alphaMask_t * createAlphaMask(SDL_Surface * aText);
+void freeAlphaMask(alphaMask_t * aMask);
+void drawAlphaMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                   SDL_Color aColor, SDL_Color aBackground, blendMode_t aMode);
+void drawEffectMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                    SDL_Color aColor, SDL_Color aEffectColor, SDL_Color aBackground, blendMode_t aMode);
+bool_t benchBlendKernels(void);
+
+#endif /* INCLUDE_BLEND_H */
@@ -0,0 +1,268 @@
+/**
+ * @file        blendavx2.c
+ * @brief       Pixel kernels vectorized by AVX2
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-05 18:21:40
+ * Last modify: 2021-03-05 18:21:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * This file is compiled with -mavx2 on x86, the kernels are used only if
+ * the processor and the operating system support AVX2.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "common.h"
+#include "blendkernel.h"
+
+#if defined(__AVX2__)
+/**
+ * @brief mix16x16 Mix sixteen 16-bit lanes, same as mix().
+ */
+static inline __m256i mix16x16(__m256i aDst, __m256i aSrc, __m256i aCoverage)
+{
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i c128 = _mm256_set1_epi16(128);
+    __m256i t;
+
+    /* Sum is at most 255 * 255 + 128, it fits in unsigned 16 bits */
+    t = _mm256_add_epi16(_mm256_mullo_epi16(aSrc, aCoverage),
+                         _mm256_mullo_epi16(aDst, _mm256_sub_epi16(c255, aCoverage)));
+    t = _mm256_add_epi16(t, c128);
+    t = _mm256_add_epi16(t, _mm256_srli_epi16(t, 8));
+
+    return _mm256_srli_epi16(t, 8);
+}
+
+/**
+ * @brief loadCoverage8 Load coverage of eight pixels to 32-bit lanes.
+ */
+static inline __m256i loadCoverage8(const uint8_t * aMask)
+{
+    return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)aMask));
+}
+
+/**
+ * @brief blendRow32Avx2 Blend color to a row of 32-bit pixels, see blendRow32_t.
+ */
+static void blendRow32Avx2(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i color = _mm256_set1_epi32(aColor);
+    const __m256i src = _mm256_unpacklo_epi8(color, zero);
+    const __m256i spread = _mm256_set1_epi32(0x01010101);
+    uint64_t      m;
+    int           i = 0;
+
+    for (; i + 8 <= aCount; i += 8)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            /* Most pixels of a line are background */
+            continue;
+        }
+        if (m == UINT64_MAX)
+        {
+            _mm256_storeu_si256((__m256i *)(aDst + i), color);
+            continue;
+        }
+
+        /* Coverage of a pixel is copied to its four channels */
+        __m256i d = _mm256_loadu_si256((const __m256i *)(aDst + i));
+        __m256i a = _mm256_mullo_epi32(loadCoverage8(aMask + i), spread);
+        __m256i lo = mix16x16(_mm256_unpacklo_epi8(d, zero), src, _mm256_unpacklo_epi8(a, zero));
+        __m256i hi = mix16x16(_mm256_unpackhi_epi8(d, zero), src, _mm256_unpackhi_epi8(a, zero));
+        _mm256_storeu_si256((__m256i *)(aDst + i), _mm256_packus_epi16(lo, hi));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = blendPixel32(aDst[i], aColor, aMask[i]);
+        }
+    }
+}
+
+/**
+ * @brief keyRow32Avx2 Fill pixels with coverage by color, see keyRow32_t.
+ */
+static void keyRow32Avx2(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i color = _mm256_set1_epi32(aColor);
+    uint64_t      m;
+    int           i = 0;
+
+    for (; i + 8 <= aCount; i += 8)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            continue;
+        }
+        if (m == UINT64_MAX)
+        {
+            _mm256_storeu_si256((__m256i *)(aDst + i), color);
+            continue;
+        }
+
+        /* Lanes without coverage keep destination */
+        __m256i keep = _mm256_cmpeq_epi32(loadCoverage8(aMask + i), zero);
+        __m256i d = _mm256_loadu_si256((const __m256i *)(aDst + i));
+        _mm256_storeu_si256((__m256i *)(aDst + i), _mm256_blendv_epi8(color, d, keep));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aColor;
+        }
+    }
+}
+
+/**
+ * @brief lutRow32Avx2 Fill pixels by mapped color of coverage, see lutRow32_t.
+ */
+static void lutRow32Avx2(uint32_t * aDst, const uint8_t * aMask, int aCount, const uint32_t * aLut)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    uint64_t      m;
+    int           i = 0;
+
+    for (; i + 8 <= aCount; i += 8)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            continue;
+        }
+
+        __m256i a = loadCoverage8(aMask + i);
+        __m256i keep = _mm256_cmpeq_epi32(a, zero);
+        __m256i mapped = _mm256_i32gather_epi32((const int *)aLut, a, sizeof(uint32_t));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(aDst + i));
+        _mm256_storeu_si256((__m256i *)(aDst + i), _mm256_blendv_epi8(mapped, d, keep));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aLut[aMask[i]];
+        }
+    }
+}
+
+/**
+ * @brief maxRow8Avx2 Maximum of two rows of coverage, see maxRow8_t.
+ */
+static void maxRow8Avx2(uint8_t * aDst, const uint8_t * aSrc, int aCount)
+{
+    int i = 0;
+
+    for (; i + 32 <= aCount; i += 32)
+    {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(aDst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(aSrc + i));
+        _mm256_storeu_si256((__m256i *)(aDst + i), _mm256_max_epu8(d, s));
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = MAX(aDst[i], aSrc[i]);
+    }
+}
+
+/**
+ * @brief sumRow16Avx2 Update running sums of coverage, see sumRow16_t.
+ */
+static void sumRow16Avx2(uint16_t * aSum, const uint8_t * aAdd, const uint8_t * aSub, int aCount)
+{
+    int i = 0;
+
+    for (; i + 16 <= aCount; i += 16)
+    {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(aSum + i));
+        __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(aAdd + i)));
+        __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(aSub + i)));
+        _mm256_storeu_si256((__m256i *)(aSum + i), _mm256_sub_epi16(_mm256_add_epi16(s, a), b));
+    }
+    for (; i < aCount; i++)
+    {
+        aSum[i] += aAdd[i] - aSub[i];
+    }
+}
+
+/**
+ * @brief repeatRow32Avx2 Enlarge a row of pixels, see repeatRow32_t. Factors
+ * 2 and 4 are vectorized.
+ */
+static void repeatRow32Avx2(uint32_t * aDst, const uint32_t * aSrc, int aCount, int aFactor)
+{
+    const __m256i pairs0 = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const __m256i pairs1 = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+    const __m256i quads0 = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    const __m256i two = _mm256_set1_epi32(2);
+    int           i = 0;
+    int           j = 0;
+
+    if (aFactor == 2)
+    {
+        for (; i + 16 <= aCount; i += 16, j += 8)
+        {
+            __m256i s = _mm256_loadu_si256((const __m256i *)(aSrc + j));
+            _mm256_storeu_si256((__m256i *)(aDst + i), _mm256_permutevar8x32_epi32(s, pairs0));
+            _mm256_storeu_si256((__m256i *)(aDst + i + 8), _mm256_permutevar8x32_epi32(s, pairs1));
+        }
+    }
+    else if (aFactor == 4)
+    {
+        for (; i + 32 <= aCount; i += 32, j += 8)
+        {
+            __m256i s = _mm256_loadu_si256((const __m256i *)(aSrc + j));
+            __m256i q = quads0;
+            int     k;
+
+            for (k = 0; k < 32; k += 8, q = _mm256_add_epi32(q, two))
+            {
+                _mm256_storeu_si256((__m256i *)(aDst + i + k), _mm256_permutevar8x32_epi32(s, q));
+            }
+        }
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = aSrc[i / aFactor];
+    }
+}
+
+static const blendKernels_t avx2Kernels =
+{
+    .name = "AVX2",
+    .blendRow32 = blendRow32Avx2,
+    .keyRow32 = keyRow32Avx2,
+    .lutRow32 = lutRow32Avx2,
+    .maxRow8 = maxRow8Avx2,
+    .sumRow16 = sumRow16Avx2,
+    .repeatRow32 = repeatRow32Avx2,
+};
+#endif
+
+/**
+ * @brief getAvx2BlendKernels Get kernels vectorized by AVX2.
+ *
+ * @return Kernels, NULL: they are not compiled for this architecture.
+ */
+const blendKernels_t * getAvx2BlendKernels(void)
+{
+#if defined(__AVX2__)
+    return &avx2Kernels;
+#else
+    return NULL;
+#endif
+}
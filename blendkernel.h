@@ -0,0 +1,70 @@
+/**
+ * @file        blendkernel.h
+ * @brief       Variants of pixel kernels selected by CPU features
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-05 18:21:40
+ * Last modify: 2021-03-05 18:21:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_BLENDKERNEL_H
+#define INCLUDE_BLENDKERNEL_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+/* Kernels of a row. Mask has a coverage byte per pixel, 0 is background. */
+typedef void (*blendRow32_t)(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor);
+typedef void (*keyRow32_t)(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor);
+typedef void (*lutRow32_t)(uint32_t * aDst, const uint8_t * aMask, int aCount, const uint32_t * aLut);
+/* Kernels of text effects: dilation and box blur of coverage */
+typedef void (*maxRow8_t)(uint8_t * aDst, const uint8_t * aSrc, int aCount);
+typedef void (*sumRow16_t)(uint16_t * aSum, const uint8_t * aAdd, const uint8_t * aSub, int aCount);
+/* Kernel of upscaling: every source pixel is repeated aFactor times, aCount is count of destination pixels */
+typedef void (*repeatRow32_t)(uint32_t * aDst, const uint32_t * aSrc, int aCount, int aFactor);
+
+typedef struct
+{
+    const char    * name;
+    blendRow32_t    blendRow32;             /* Blend color to 32-bit pixels with 8-bit channels */
+    keyRow32_t      keyRow32;               /* Fill pixels with coverage by color */
+    lutRow32_t      lutRow32;               /* Fill pixels with coverage by mapped color of coverage */
+    maxRow8_t       maxRow8;                /* Destination is maximum of destination and source */
+    sumRow16_t      sumRow16;               /* Add a row to running sums and subtract another one */
+    repeatRow32_t   repeatRow32;            /* Enlarge a row of 32-bit pixels by an integer factor */
+} blendKernels_t;
+
+/**
+ * @brief mix Mix two 8-bit values by coverage with rounding.
+ *
+ * @return (aSrc * aCoverage + aDst * (255 - aCoverage)) / 255
+ */
+static inline uint8_t mix(uint8_t aDst, uint8_t aSrc, uint8_t aCoverage)
+{
+    uint32_t t = aSrc * aCoverage + aDst * (255u - aCoverage) + 128u;
+
+    return (t + (t >> 8)) >> 8;
+}
+
+/**
+ * @brief blendPixel32 Blend color to a 32-bit pixel with 8-bit channels.
+ */
+static inline uint32_t blendPixel32(uint32_t aDst, uint32_t aColor, uint8_t aCoverage)
+{
+    return  (uint32_t)mix(aDst,       aColor,       aCoverage)
+         | ((uint32_t)mix(aDst >> 8,  aColor >> 8,  aCoverage) << 8)
+         | ((uint32_t)mix(aDst >> 16, aColor >> 16, aCoverage) << 16)
+         | ((uint32_t)mix(aDst >> 24, aColor >> 24, aCoverage) << 24);
+}
+
+/* Kernels selected by initBlendKernels() */
+const blendKernels_t * getBlendKernels(void);
+
+/* Variants return NULL if they were not compiled for this architecture */
+const blendKernels_t * getSse2BlendKernels(void);
+const blendKernels_t * getAvx2BlendKernels(void);
+const blendKernels_t * getNeonBlendKernels(void);
+
+#endif /* INCLUDE_BLENDKERNEL_H */
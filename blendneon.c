@@ -0,0 +1,240 @@
+/**
+ * @file        blendneon.c
+ * @brief       Pixel kernels vectorized by NEON
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-05 18:21:40
+ * Last modify: 2021-03-05 18:21:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * This file is compiled with -mfpu=neon on 32-bit ARM, the kernels are used
+ * only if the processor has NEON (Pi Zero does not have it). NEON is always
+ * present on 64-bit ARM.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BLEND_NEON  1
+#endif
+
+#include "common.h"
+#include "blendkernel.h"
+
+#if defined(BLEND_NEON)
+/**
+ * @brief isZero16 Check if 16 bytes are all zero.
+ */
+static inline bool_t isZero16(const uint8_t * aBytes)
+{
+    uint8x16_t v = vld1q_u8(aBytes);
+    uint8x8_t  o = vorr_u8(vget_low_u8(v), vget_high_u8(v));
+
+    return vget_lane_u64(vreinterpret_u64_u8(o), 0) == 0;
+}
+
+/**
+ * @brief blendRow32Neon Blend color to a row of 32-bit pixels, see blendRow32_t.
+ */
+static void blendRow32Neon(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const uint8x8_t  src = vreinterpret_u8_u32(vdup_n_u32(aColor));
+    const uint16x8_t c128 = vdupq_n_u16(128);
+    int              i = 0;
+
+    for (; i + 2 <= aCount; i += 2)
+    {
+        uint32_t a0 = aMask[i];
+        uint32_t a1 = aMask[i + 1];
+
+        if ((a0 | a1) == 0)
+        {
+            /* Most pixels of a line are background */
+            continue;
+        }
+
+        uint8x8_t  d = vld1_u8((const uint8_t *)(aDst + i));
+        uint8x8_t  a = vreinterpret_u8_u32(vset_lane_u32(a1 * 0x01010101u, vdup_n_u32(a0 * 0x01010101u), 1));
+        /* 255 - a is the same as ~a */
+        uint16x8_t t = vmlal_u8(vmull_u8(src, a), d, vmvn_u8(a));
+        t = vaddq_u16(t, c128);
+        t = vaddq_u16(t, vshrq_n_u16(t, 8));
+        vst1_u8((uint8_t *)(aDst + i), vshrn_n_u16(t, 8));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = blendPixel32(aDst[i], aColor, aMask[i]);
+        }
+    }
+}
+
+/**
+ * @brief keyRow32Neon Fill pixels with coverage by color, see keyRow32_t.
+ */
+static void keyRow32Neon(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const uint32x4_t color = vdupq_n_u32(aColor);
+    const uint32x4_t zero = vdupq_n_u32(0);
+    uint32_t         m;
+    int              i = 0;
+
+    for (; i + 4 <= aCount; i += 4)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            continue;
+        }
+        if (m == UINT32_MAX)
+        {
+            vst1q_u32(aDst + i, color);
+            continue;
+        }
+
+        /* Lanes without coverage keep destination */
+        uint16x8_t a16 = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(m)));
+        uint32x4_t keep = vceqq_u32(vmovl_u16(vget_low_u16(a16)), zero);
+        vst1q_u32(aDst + i, vbslq_u32(keep, vld1q_u32(aDst + i), color));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aColor;
+        }
+    }
+}
+
+/**
+ * @brief lutRow32Neon Fill pixels by mapped color of coverage, see lutRow32_t.
+ */
+static void lutRow32Neon(uint32_t * aDst, const uint8_t * aMask, int aCount, const uint32_t * aLut)
+{
+    int i = 0;
+    int j;
+
+    for (; i + 16 <= aCount; i += 16)
+    {
+        /* There is no gather, only runs of background are skipped at once */
+        if (isZero16(aMask + i))
+        {
+            continue;
+        }
+        for (j = i; j < i + 16; j++)
+        {
+            if (aMask[j])
+            {
+                aDst[j] = aLut[aMask[j]];
+            }
+        }
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aLut[aMask[i]];
+        }
+    }
+}
+
+/**
+ * @brief maxRow8Neon Maximum of two rows of coverage, see maxRow8_t.
+ */
+static void maxRow8Neon(uint8_t * aDst, const uint8_t * aSrc, int aCount)
+{
+    int i = 0;
+
+    for (; i + 16 <= aCount; i += 16)
+    {
+        vst1q_u8(aDst + i, vmaxq_u8(vld1q_u8(aDst + i), vld1q_u8(aSrc + i)));
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = MAX(aDst[i], aSrc[i]);
+    }
+}
+
+/**
+ * @brief sumRow16Neon Update running sums of coverage, see sumRow16_t.
+ */
+static void sumRow16Neon(uint16_t * aSum, const uint8_t * aAdd, const uint8_t * aSub, int aCount)
+{
+    int i = 0;
+
+    for (; i + 8 <= aCount; i += 8)
+    {
+        uint16x8_t s = vaddw_u8(vld1q_u16(aSum + i), vld1_u8(aAdd + i));
+        vst1q_u16(aSum + i, vsubw_u8(s, vld1_u8(aSub + i)));
+    }
+    for (; i < aCount; i++)
+    {
+        aSum[i] += aAdd[i] - aSub[i];
+    }
+}
+
+/**
+ * @brief repeatRow32Neon Enlarge a row of pixels, see repeatRow32_t. Factors
+ * 2 and 4 are vectorized.
+ */
+static void repeatRow32Neon(uint32_t * aDst, const uint32_t * aSrc, int aCount, int aFactor)
+{
+    int i = 0;
+    int j = 0;
+
+    if (aFactor == 2)
+    {
+        for (; i + 8 <= aCount; i += 8, j += 4)
+        {
+            uint32x4_t   s = vld1q_u32(aSrc + j);
+            uint32x4x2_t d = vzipq_u32(s, s);
+            vst1q_u32(aDst + i, d.val[0]);
+            vst1q_u32(aDst + i + 4, d.val[1]);
+        }
+    }
+    else if (aFactor == 4)
+    {
+        for (; i + 16 <= aCount; i += 16, j += 4)
+        {
+            uint32x4_t s = vld1q_u32(aSrc + j);
+            vst1q_u32(aDst + i, vdupq_lane_u32(vget_low_u32(s), 0));
+            vst1q_u32(aDst + i + 4, vdupq_lane_u32(vget_low_u32(s), 1));
+            vst1q_u32(aDst + i + 8, vdupq_lane_u32(vget_high_u32(s), 0));
+            vst1q_u32(aDst + i + 12, vdupq_lane_u32(vget_high_u32(s), 1));
+        }
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = aSrc[i / aFactor];
+    }
+}
+
+static const blendKernels_t neonKernels =
+{
+    .name = "NEON",
+    .blendRow32 = blendRow32Neon,
+    .keyRow32 = keyRow32Neon,
+    .lutRow32 = lutRow32Neon,
+    .maxRow8 = maxRow8Neon,
+    .sumRow16 = sumRow16Neon,
+    .repeatRow32 = repeatRow32Neon,
+};
+#endif
+
+/**
+ * @brief getNeonBlendKernels Get kernels vectorized by NEON.
+ *
+ * @return Kernels, NULL: they are not compiled for this architecture.
+ */
+const blendKernels_t * getNeonBlendKernels(void)
+{
+#if defined(BLEND_NEON)
+    return &neonKernels;
+#else
+    return NULL;
+#endif
+}
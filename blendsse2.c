@@ -0,0 +1,266 @@
+/**
+ * @file        blendsse2.c
+ * @brief       Pixel kernels vectorized by SSE2
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-05 18:21:40
+ * Last modify: 2021-03-05 18:21:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * This file is compiled with -msse2 on x86, the kernels are used only if
+ * the processor has SSE2.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "common.h"
+#include "blendkernel.h"
+
+#if defined(__SSE2__)
+/**
+ * @brief mix16x8 Mix eight 16-bit lanes, same as mix().
+ */
+static inline __m128i mix16x8(__m128i aDst, __m128i aSrc, __m128i aCoverage)
+{
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i c128 = _mm_set1_epi16(128);
+    __m128i t;
+
+    /* Sum is at most 255 * 255 + 128, it fits in unsigned 16 bits */
+    t = _mm_add_epi16(_mm_mullo_epi16(aSrc, aCoverage),
+                      _mm_mullo_epi16(aDst, _mm_sub_epi16(c255, aCoverage)));
+    t = _mm_add_epi16(t, c128);
+    t = _mm_add_epi16(t, _mm_srli_epi16(t, 8));
+
+    return _mm_srli_epi16(t, 8);
+}
+
+/**
+ * @brief isAll16 Check if 16 bytes are all equal to a value.
+ */
+static inline bool_t isAll16(const uint8_t * aBytes, __m128i aValue)
+{
+    __m128i v = _mm_loadu_si128((const __m128i *)aBytes);
+
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(v, aValue)) == 0xFFFF;
+}
+
+/**
+ * @brief blendRow32Sse2 Blend color to a row of 32-bit pixels, see blendRow32_t.
+ */
+static void blendRow32Sse2(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color = _mm_set1_epi32(aColor);
+    const __m128i src = _mm_unpacklo_epi8(color, zero);
+    uint32_t      m;
+    int           i = 0;
+
+    for (; i + 4 <= aCount; i += 4)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            /* Most pixels of a line are background */
+            continue;
+        }
+        if (m == UINT32_MAX)
+        {
+            _mm_storeu_si128((__m128i *)(aDst + i), color);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128((const __m128i *)(aDst + i));
+        __m128i a = _mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero);
+        a = _mm_unpacklo_epi16(a, a);
+        __m128i lo = mix16x8(_mm_unpacklo_epi8(d, zero), src, _mm_unpacklo_epi32(a, a));
+        __m128i hi = mix16x8(_mm_unpackhi_epi8(d, zero), src, _mm_unpackhi_epi32(a, a));
+        _mm_storeu_si128((__m128i *)(aDst + i), _mm_packus_epi16(lo, hi));
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = blendPixel32(aDst[i], aColor, aMask[i]);
+        }
+    }
+}
+
+/**
+ * @brief keyRow32Sse2 Fill pixels with coverage by color, see keyRow32_t.
+ */
+static void keyRow32Sse2(uint32_t * aDst, const uint8_t * aMask, int aCount, uint32_t aColor)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color = _mm_set1_epi32(aColor);
+    uint32_t      m;
+    int           i = 0;
+
+    for (; i + 4 <= aCount; i += 4)
+    {
+        memcpy(&m, aMask + i, sizeof(m));
+        if (m == 0)
+        {
+            continue;
+        }
+        if (m == UINT32_MAX)
+        {
+            _mm_storeu_si128((__m128i *)(aDst + i), color);
+            continue;
+        }
+
+        /* Lanes without coverage keep destination */
+        __m128i a = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(m), zero), zero);
+        __m128i keep = _mm_cmpeq_epi32(a, zero);
+        __m128i d = _mm_loadu_si128((const __m128i *)(aDst + i));
+        d = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, color));
+        _mm_storeu_si128((__m128i *)(aDst + i), d);
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aColor;
+        }
+    }
+}
+
+/**
+ * @brief lutRow32Sse2 Fill pixels by mapped color of coverage, see lutRow32_t.
+ */
+static void lutRow32Sse2(uint32_t * aDst, const uint8_t * aMask, int aCount, const uint32_t * aLut)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int           i = 0;
+    int           j;
+
+    for (; i + 16 <= aCount; i += 16)
+    {
+        /* There is no gather, only runs of background are skipped at once */
+        if (isAll16(aMask + i, zero))
+        {
+            continue;
+        }
+        for (j = i; j < i + 16; j++)
+        {
+            if (aMask[j])
+            {
+                aDst[j] = aLut[aMask[j]];
+            }
+        }
+    }
+    for (; i < aCount; i++)
+    {
+        if (aMask[i])
+        {
+            aDst[i] = aLut[aMask[i]];
+        }
+    }
+}
+
+/**
+ * @brief maxRow8Sse2 Maximum of two rows of coverage, see maxRow8_t.
+ */
+static void maxRow8Sse2(uint8_t * aDst, const uint8_t * aSrc, int aCount)
+{
+    int i = 0;
+
+    for (; i + 16 <= aCount; i += 16)
+    {
+        __m128i d = _mm_loadu_si128((const __m128i *)(aDst + i));
+        __m128i s = _mm_loadu_si128((const __m128i *)(aSrc + i));
+        _mm_storeu_si128((__m128i *)(aDst + i), _mm_max_epu8(d, s));
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = MAX(aDst[i], aSrc[i]);
+    }
+}
+
+/**
+ * @brief sumRow16Sse2 Update running sums of coverage, see sumRow16_t.
+ */
+static void sumRow16Sse2(uint16_t * aSum, const uint8_t * aAdd, const uint8_t * aSub, int aCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int           i = 0;
+
+    for (; i + 8 <= aCount; i += 8)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i *)(aSum + i));
+        __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(aAdd + i)), zero);
+        __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(aSub + i)), zero);
+        _mm_storeu_si128((__m128i *)(aSum + i), _mm_sub_epi16(_mm_add_epi16(s, a), b));
+    }
+    for (; i < aCount; i++)
+    {
+        aSum[i] += aAdd[i] - aSub[i];
+    }
+}
+
+/**
+ * @brief repeatRow32Sse2 Enlarge a row of pixels, see repeatRow32_t. Factors
+ * 2 and 4 are vectorized.
+ */
+static void repeatRow32Sse2(uint32_t * aDst, const uint32_t * aSrc, int aCount, int aFactor)
+{
+    int i = 0;
+    int j = 0;
+
+    if (aFactor == 2)
+    {
+        for (; i + 8 <= aCount; i += 8, j += 4)
+        {
+            __m128i s = _mm_loadu_si128((const __m128i *)(aSrc + j));
+            _mm_storeu_si128((__m128i *)(aDst + i), _mm_unpacklo_epi32(s, s));
+            _mm_storeu_si128((__m128i *)(aDst + i + 4), _mm_unpackhi_epi32(s, s));
+        }
+    }
+    else if (aFactor == 4)
+    {
+        for (; i + 16 <= aCount; i += 16, j += 4)
+        {
+            __m128i s = _mm_loadu_si128((const __m128i *)(aSrc + j));
+            _mm_storeu_si128((__m128i *)(aDst + i), _mm_shuffle_epi32(s, 0x00));
+            _mm_storeu_si128((__m128i *)(aDst + i + 4), _mm_shuffle_epi32(s, 0x55));
+            _mm_storeu_si128((__m128i *)(aDst + i + 8), _mm_shuffle_epi32(s, 0xAA));
+            _mm_storeu_si128((__m128i *)(aDst + i + 12), _mm_shuffle_epi32(s, 0xFF));
+        }
+    }
+    for (; i < aCount; i++)
+    {
+        aDst[i] = aSrc[i / aFactor];
+    }
+}
+
+static const blendKernels_t sse2Kernels =
+{
+    .name = "SSE2",
+    .blendRow32 = blendRow32Sse2,
+    .keyRow32 = keyRow32Sse2,
+    .lutRow32 = lutRow32Sse2,
+    .maxRow8 = maxRow8Sse2,
+    .sumRow16 = sumRow16Sse2,
+    .repeatRow32 = repeatRow32Sse2,
+};
+#endif
+
+/**
+ * @brief getSse2BlendKernels Get kernels vectorized by SSE2.
+ *
+ * @return Kernels, NULL: they are not compiled for this architecture.
+ */
+const blendKernels_t * getSse2BlendKernels(void)
+{
+#if defined(__SSE2__)
+    return &sse2Kernels;
+#else
+    return NULL;
+#endif
+}
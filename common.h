@@ -35,6 +35,7 @@
 #define CHR_LF                      '\n'    /* Line feed */
 #define CHR_TAB                     '\t'    /* Tabulator */
 #define IS_WHITESPACE(c)    ((c) == CHR_SPACE || (c) == CHR_CR || (c) == CHR_LF || (c) == CHR_TAB)
+#define IS_UTF8_CONTINUATION(c)     (((uint8_t)(c) & 0xC0) == 0x80)
 
 #define TELEPROMPTER_IS_PAUSED()    (main_state_machine == STATE_paused)
 #define TELEPROMPTER_IS_RUNNING()   (main_state_machine == STATE_running)
@@ -87,6 +88,17 @@ typedef struct
     bool_t      full_screen;
     bool_t      text_fading;
     bool_t      verbose;
+    uint8_t     max_fps;        /* Maximum frame rate, 0: unlimited */
+    uint8_t     render_quality; /* Render quality tier, see quality_t. 0: automatic */
+    uint8_t     present_mode;   /* Presentation mode, see presentMode_t. 0: automatic */
+    bool_t      render_ahead;   /* TRUE: compose frames in back buffer when display is in video memory */
+    uint8_t     wrap_threads;   /* Count of threads wrapping big scripts, 0: count of processors */
+    bool_t      show_preview;   /* TRUE: overview of whole script is shown next to the text */
+    uint8_t     outline_px;     /* Width of outline around text, 0: no outline */
+    uint8_t     shadow_px;      /* Offset of drop shadow of text, 0: no shadow */
+    SDL_Color   effect_color;   /* Color of outline and shadow */
+    uint16_t    rotation;       /* Clockwise rotation of picture on display in degrees: 0, 90, 180 or 270 */
+    uint8_t     render_scale;   /* Script is composed at 1/render_scale of resolution. 0: automatic */
 } config_t;
 
 /* Teleprompter related */
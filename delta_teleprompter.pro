@@ -3,13 +3,58 @@ CONFIG += console
 CONFIG -= qt
 
 include(other.pro)
-SOURCES += ./gfx.c \
+SOURCES += ./alloctrack.c \
+./arena.c \
+./atlas.c \
+./blend.c \
+./blendavx2.c \
+./blendneon.c \
+./blendsse2.c \
+./edit.c \
+./effect.c \
+./fontpool.c \
+./gfx.c \
+./latency.c \
+./linecache.c \
 ./linkedlist.c \
-./main.c
+./loader.c \
+./main.c \
+./metrics.c \
+./playlist.c \
+./present.c \
+./preview.c \
+./quality.c \
+./replay.c \
+./rotate.c \
+./scale.c \
+./script.c \
+./search.c \
+./stats.c
 
-HEADERS += ./common.h \
+HEADERS += ./alloctrack.h \
+./arena.h \
+./atlas.h \
+./blend.h \
+./blendkernel.h \
+./common.h \
+./edit.h \
+./effect.h \
+./fontpool.h \
+./latency.h \
+./linecache.h \
 ./linkedlist.h \
+./metrics.h \
+./playlist.h \
+./present.h \
+./preview.h \
+./quality.h \
+./replay.h \
+./rotate.h \
+./scale.h \
 ./script.h \
+./search.h \
+./loader.h \
+./stats.h \
 ./gfx.h \
 ./dejavusans_ttf.h
 
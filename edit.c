@@ -0,0 +1,981 @@
+/**
+ * @file        edit.c
+ * @brief       Editing of script while it is shown
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-28 10:21:37
+ * Last modify: 2021-02-28 10:21:37 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Script is edited in a piece table, so the loaded script is never changed
+ * and an edit costs the same on any size of script. Only the lines of the
+ * edited paragraph around the change are wrapped again and replaced in the
+ * wrapped script, other lines keep their cached masks.
+ *
+ * Editing is limited to one line of a paragraph, so white spaces between
+ * paragraphs are never changed. Therefore the character before a paragraph
+ * is always in the loaded script and position of paragraph in the document
+ * can be found from its offset in the loaded script.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "linecache.h"
+#include "stats.h"
+#include "replay.h"
+#include "edit.h"
+
+editPrompt_t editPrompt;
+saveJob_t saveJob;
+
+/**
+ * @brief reserveAdd Make room for text in the add buffer.
+ *
+ * @param aDocument[in,out] Document.
+ * @param aLength[in]       Length of text to add.
+ * @return TRUE: if there is enough room.
+ */
+static bool_t reserveAdd(document_t * aDocument, size_t aLength)
+{
+    size_t size;
+    char * add;
+
+    if (aDocument->addLength + aLength > aDocument->addSize)
+    {
+        size = MAX(aDocument->addSize * 2, MAX(aDocument->addLength + aLength, EDIT_ADD_MIN_SIZE));
+        add = realloc(aDocument->add, size);
+        if (add == NULL)
+        {
+            errorprintf("Cannot allocate memory for edited text!\n");
+            return FALSE;
+        }
+        aDocument->add = add;
+        aDocument->addSize = size;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief reservePieces Make room for new pieces.
+ *
+ * @param aDocument[in,out] Document.
+ * @param aCount[in]        Count of new pieces.
+ * @return TRUE: if there is enough room.
+ */
+static bool_t reservePieces(document_t * aDocument, size_t aCount)
+{
+    size_t    size;
+    piece_t * pieces;
+
+    if (aDocument->pieceCount + aCount > aDocument->pieceSize)
+    {
+        size = MAX(aDocument->pieceSize * 2, MAX(aDocument->pieceCount + aCount, EDIT_PIECE_MIN_COUNT));
+        pieces = realloc(aDocument->pieces, size * sizeof(piece_t));
+        if (pieces == NULL)
+        {
+            errorprintf("Cannot allocate memory for pieces of script!\n");
+            return FALSE;
+        }
+        aDocument->pieces = pieces;
+        aDocument->pieceSize = size;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief getPieceText Get text of a piece.
+ *
+ * @param aDocument[in] Document.
+ * @param aPiece[in]    Piece of document.
+ * @return First character of piece.
+ */
+static inline const char * getPieceText(const document_t * aDocument, const piece_t * aPiece)
+{
+    return (aPiece->added ? aDocument->add : aDocument->script) + aPiece->start;
+}
+
+/**
+ * @brief findPiece Find piece which contains a character of document.
+ *
+ * @param aDocument[in]     Document.
+ * @param aPosition[in]     Position of character in document.
+ * @param aPieceStart[out]  Position of first character of piece.
+ * @return Index of piece, pieceCount if position is the end of document.
+ */
+static size_t findPiece(const document_t * aDocument, size_t aPosition, size_t * aPieceStart)
+{
+    size_t start = 0;
+    size_t i;
+
+    for (i = 0; i < aDocument->pieceCount && start + aDocument->pieces[i].length <= aPosition; i++)
+    {
+        start += aDocument->pieces[i].length;
+    }
+    *aPieceStart = start;
+
+    return i;
+}
+
+/**
+ * @brief splitPiece Split a piece into two.
+ *
+ * @param aDocument[in,out] Document, it shall have room for one more piece.
+ * @param aIndex[in]        Index of piece.
+ * @param aAt[in]           Length of first part, 1 .. length - 1.
+ */
+static void splitPiece(document_t * aDocument, size_t aIndex, size_t aAt)
+{
+    piece_t * piece = &aDocument->pieces[aIndex];
+
+    memmove(piece + 2, piece + 1, (aDocument->pieceCount - aIndex - 1) * sizeof(piece_t));
+    piece[1].added = piece->added;
+    piece[1].start = piece->start + aAt;
+    piece[1].length = piece->length - aAt;
+    piece->length = aAt;
+    aDocument->pieceCount++;
+}
+
+/**
+ * @brief insertText Insert text into document.
+ *
+ * @param aDocument[in,out] Document.
+ * @param aPosition[in]     Text is inserted before this character.
+ * @param aText[in]         Text to insert.
+ * @param aLength[in]       Length of text.
+ * @return TRUE: if successfully inserted.
+ */
+static bool_t insertText(document_t * aDocument, size_t aPosition, const char * aText, size_t aLength)
+{
+    size_t    start;
+    size_t    i;
+    piece_t * piece;
+
+    if (aLength == 0)
+    {
+        return TRUE;
+    }
+    if (!reserveAdd(aDocument, aLength) || !reservePieces(aDocument, 2))
+    {
+        return FALSE;
+    }
+
+    i = findPiece(aDocument, aPosition, &start);
+    piece = i ? &aDocument->pieces[i - 1] : NULL;
+    if (aPosition == start && piece && piece->added && piece->start + piece->length == aDocument->addLength)
+    {
+        /* Typing goes on after previous insertion */
+        piece->length += aLength;
+    }
+    else
+    {
+        if (aPosition > start)
+        {
+            splitPiece(aDocument, i, aPosition - start);
+            i++;
+        }
+        piece = &aDocument->pieces[i];
+        memmove(piece + 1, piece, (aDocument->pieceCount - i) * sizeof(piece_t));
+        piece->added = TRUE;
+        piece->start = aDocument->addLength;
+        piece->length = aLength;
+        aDocument->pieceCount++;
+    }
+    memcpy(aDocument->add + aDocument->addLength, aText, aLength);
+    aDocument->addLength += aLength;
+    aDocument->length += aLength;
+
+    return TRUE;
+}
+
+/**
+ * @brief deleteText Delete text from document. Deleted text stays in its
+ * buffer, only pieces are changed.
+ *
+ * @param aDocument[in,out] Document.
+ * @param aPosition[in]     First character to delete.
+ * @param aLength[in]       Count of characters to delete.
+ * @return TRUE: if successfully deleted.
+ */
+static bool_t deleteText(document_t * aDocument, size_t aPosition, size_t aLength)
+{
+    size_t    start;
+    size_t    at;
+    size_t    count;
+    size_t    i;
+    piece_t * piece;
+
+    while (aLength)
+    {
+        if (!reservePieces(aDocument, 1))
+        {
+            return FALSE;
+        }
+        i = findPiece(aDocument, aPosition, &start);
+        if (i >= aDocument->pieceCount)
+        {
+            break;
+        }
+        piece = &aDocument->pieces[i];
+        at = aPosition - start;
+        count = MIN(aLength, piece->length - at);
+        if (count == piece->length)
+        {
+            memmove(piece, piece + 1, (aDocument->pieceCount - i - 1) * sizeof(piece_t));
+            aDocument->pieceCount--;
+        }
+        else if (at == 0)
+        {
+            piece->start += count;
+            piece->length -= count;
+        }
+        else if (at + count == piece->length)
+        {
+            piece->length -= count;
+        }
+        else
+        {
+            /* Text is deleted from the middle of piece */
+            splitPiece(aDocument, i, at);
+            piece[1].start += count;
+            piece[1].length -= count;
+        }
+        aLength -= count;
+        aDocument->length -= count;
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief readText Copy text of document.
+ *
+ * @param aDocument[in] Document.
+ * @param aPosition[in] First character to copy.
+ * @param aLength[in]   Count of characters to copy.
+ * @param aBuffer[out]  Text is copied here, it is not terminated.
+ */
+static void readText(const document_t * aDocument, size_t aPosition, size_t aLength, char * aBuffer)
+{
+    size_t start;
+    size_t at;
+    size_t count;
+    size_t i;
+
+    for (i = findPiece(aDocument, aPosition, &start); i < aDocument->pieceCount && aLength; i++)
+    {
+        at = aPosition - start;
+        count = MIN(aLength, aDocument->pieces[i].length - at);
+        memcpy(aBuffer, getPieceText(aDocument, &aDocument->pieces[i]) + at, count);
+        aBuffer += count;
+        aPosition += count;
+        aLength -= count;
+        start += aDocument->pieces[i].length;
+    }
+}
+
+/**
+ * @brief getPosition Get position of a character of loaded script in document.
+ *
+ * @param aDocument[in] Document.
+ * @param aOffset[in]   Offset of character in loaded script, it shall not be deleted.
+ * @return Position of character in document.
+ */
+static size_t getPosition(const document_t * aDocument, size_t aOffset)
+{
+    size_t          position = 0;
+    size_t          i;
+    const piece_t * piece;
+
+    for (i = 0; i < aDocument->pieceCount; i++)
+    {
+        piece = &aDocument->pieces[i];
+        /* Pieces of loaded script are in order of their offsets */
+        if (!piece->added && aOffset < piece->start + piece->length)
+        {
+            return position + (aOffset > piece->start ? aOffset - piece->start : 0);
+        }
+        position += piece->length;
+    }
+
+    return position;
+}
+
+/**
+ * @brief getParagraphPosition Get position of edited paragraph in document.
+ *
+ * @param aDocument[in] Document.
+ * @return Position of first character of paragraph.
+ */
+static size_t getParagraphPosition(const document_t * aDocument)
+{
+    /* Character before paragraph is a white space, it cannot be edited */
+    return editPrompt.paragraph ? getPosition(aDocument, editPrompt.paragraph - 1) + 1 : 0;
+}
+
+/**
+ * @brief initDocument Start a document which is the same as the loaded
+ * script. Previous document is released.
+ *
+ * @param aDocument[out]    Document.
+ * @param aScript[in]       Loaded script, it shall not be changed or released
+ *                          while document is used.
+ */
+void initDocument(document_t * aDocument, const char * aScript)
+{
+    freeDocument(aDocument);
+    aDocument->script = aScript;
+    aDocument->length = aScript ? strlen(aScript) : 0;
+    if (aDocument->length && reservePieces(aDocument, 1))
+    {
+        aDocument->pieces[0].added = FALSE;
+        aDocument->pieces[0].start = 0;
+        aDocument->pieces[0].length = aDocument->length;
+        aDocument->pieceCount = 1;
+    }
+}
+
+/**
+ * @brief freeDocument Release pieces and typed text of document.
+ *
+ * @param aDocument[in,out] Document.
+ */
+void freeDocument(document_t * aDocument)
+{
+    free(aDocument->add);
+    free(aDocument->pieces);
+    free(aDocument->undoPieces);
+    memset(aDocument, 0, sizeof(document_t));
+}
+
+/**
+ * @brief flattenDocument Copy document into one buffer, so it can be
+ * wrapped as a whole.
+ *
+ * @param aDocument[in] Document.
+ * @return Terminated text of document, it shall be released by free().
+ *         NULL: out of memory.
+ */
+char * flattenDocument(const document_t * aDocument)
+{
+    char * buffer = malloc(aDocument->length + 1); // +1 end of string
+
+    if (buffer)
+    {
+        readText(aDocument, 0, aDocument->length, buffer);
+        buffer[aDocument->length] = CHR_EOS;
+    }
+    else
+    {
+        errorprintf("Cannot allocate memory for script!\n");
+    }
+
+    return buffer;
+}
+
+/**
+ * @brief syncDirectory Flush directory of a file, so renaming the file
+ * survives a crash.
+ *
+ * @param aPath[in] Path of file.
+ */
+static void syncDirectory(const char * aPath)
+{
+    char         path[MAX_PATH_LEN];
+    const char * slash = strrchr(aPath, '/');
+    int          fd;
+
+    if (slash)
+    {
+        snprintf(path, sizeof(path), "%.*s", (int)(slash - aPath + 1), aPath);
+    }
+    else
+    {
+        strcpy(path, ".");
+    }
+    fd = open(path, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**
+ * @brief writeDocument Write document to file atomically: it is written to a
+ * temporary file which replaces the file only if everything was written.
+ *
+ * @param aDocument[in] Document.
+ * @param aPath[in]     Path of file.
+ * @return TRUE: if successfully written.
+ */
+static bool_t writeDocument(const document_t * aDocument, const char * aPath)
+{
+    bool_t          ok = FALSE;
+    char            path[MAX_PATH_LEN + 8];
+    struct stat     st;
+    FILE          * file;
+    int             fd;
+    size_t          i;
+    const piece_t * piece;
+    uint64_t        start_us = getTimeUs();
+
+    snprintf(path, sizeof(path), "%s.XXXXXX", aPath);
+    fd = mkstemp(path);
+    if (fd >= 0)
+    {
+        /* Keep permissions of script */
+        if (stat(aPath, &st) == 0)
+        {
+            fchmod(fd, st.st_mode & 07777);
+        }
+        file = fdopen(fd, "wb");
+        if (file)
+        {
+            ok = TRUE;
+            for (i = 0; i < aDocument->pieceCount && ok; i++)
+            {
+                piece = &aDocument->pieces[i];
+                ok = fwrite(getPieceText(aDocument, piece), 1, piece->length, file) == piece->length;
+            }
+            ok = ok && fflush(file) == 0 && fsync(fd) == 0;
+            if (fclose(file))
+            {
+                ok = FALSE;
+            }
+        }
+        else
+        {
+            close(fd);
+        }
+        if (ok)
+        {
+            ok = rename(path, aPath) == 0;
+        }
+        if (ok)
+        {
+            syncDirectory(aPath);
+            verboseprintf("Script saved in %llu ms.\n", (unsigned long long)((getTimeUs() - start_us) / 1000u));
+        }
+        else
+        {
+            errorprintf("Cannot write script: %s\n", strerror(errno));
+            unlink(path);
+        }
+    }
+    else
+    {
+        errorprintf("Cannot create temporary file of script: %s\n", strerror(errno));
+    }
+
+    return ok;
+}
+
+/**
+ * @brief setSaveState Change state of save. It can be called from any thread.
+ */
+static void setSaveState(saveState_t aState)
+{
+    SDL_mutexP(saveJob.mutex);
+    saveJob.state = aState;
+    SDL_mutexV(saveJob.mutex);
+}
+
+/**
+ * @brief getSaveState Get state of save without blocking.
+ */
+static saveState_t getSaveState(void)
+{
+    saveState_t state;
+
+    SDL_mutexP(saveJob.mutex);
+    state = saveJob.state;
+    SDL_mutexV(saveJob.mutex);
+
+    return state;
+}
+
+/**
+ * @brief isSaveDone Check if save thread is finished.
+ */
+static bool_t isSaveDone(void * aParam)
+{
+    (void)aParam;
+
+    return getSaveState() == SAVE_STATE_done;
+}
+
+/**
+ * @brief saveThread Write snapshot of document. It runs in separate thread,
+ * so the shown script is not stopped by writing and flushing the file.
+ *
+ * @param aParam Not used.
+ * @return 0: if script was saved.
+ */
+static int saveThread(void * aParam)
+{
+    (void)aParam;
+
+    saveJob.ok = !strlen(saveJob.path) || writeDocument(&saveJob.snapshot, saveJob.path);
+    setSaveState(SAVE_STATE_done);
+
+    return saveJob.ok ? 0 : 1;
+}
+
+/**
+ * @brief initSave Prepare saving of script in background.
+ *
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initSave(void)
+{
+    memset(&saveJob, 0, sizeof(saveJob));
+    saveJob.mutex = SDL_CreateMutex();
+    if (saveJob.mutex == NULL)
+    {
+        errorprintf("SDL_CreateMutex() Failed: %s\n", SDL_GetError());
+    }
+
+    return saveJob.mutex != NULL;
+}
+
+/**
+ * @brief startSave Start saving document in background. Pieces and typed
+ * text are copied, so the document can be edited while it is saved. Result
+ * is taken by updateSave().
+ *
+ * @param aDocument[in,out] Document, it is marked as not modified.
+ * @param aPath[in]         Path of file. NULL: file is not written, but save
+ *                          is reported as in recorded session.
+ * @return TRUE: if save was started, FALSE: out of memory.
+ */
+bool_t startSave(document_t * aDocument, const char * aPath)
+{
+    document_t * snapshot = &saveJob.snapshot;
+    bool_t       ok;
+
+    /* Previous save is superseded, only its failure is kept */
+    if (getSaveState() != SAVE_STATE_idle)
+    {
+        waitSave();
+        if (!saveJob.ok)
+        {
+            aDocument->modified = TRUE;
+        }
+        freeDocument(snapshot);
+        setSaveState(SAVE_STATE_idle);
+    }
+
+    if (aPath)
+    {
+        snapshot->script = aDocument->script;
+        snapshot->length = aDocument->length;
+        snapshot->add = malloc(aDocument->addLength + 1); // +1 empty add buffer
+        snapshot->pieces = malloc(aDocument->pieceCount * sizeof(piece_t) + 1);
+        ok = snapshot->add && snapshot->pieces;
+        if (ok)
+        {
+            if (aDocument->addLength)
+            {
+                memcpy(snapshot->add, aDocument->add, aDocument->addLength);
+            }
+            snapshot->addLength = aDocument->addLength;
+            memcpy(snapshot->pieces, aDocument->pieces, aDocument->pieceCount * sizeof(piece_t));
+            snapshot->pieceCount = aDocument->pieceCount;
+            strncpy(saveJob.path, aPath, sizeof(saveJob.path) - 1);
+            saveJob.path[sizeof(saveJob.path) - 1] = CHR_EOS;
+        }
+        else
+        {
+            errorprintf("Cannot allocate memory to save script!\n");
+            freeDocument(snapshot);
+        }
+    }
+    else
+    {
+        ok = TRUE;
+        saveJob.path[0] = CHR_EOS;
+    }
+
+    if (ok)
+    {
+        aDocument->modified = FALSE;
+        setSaveState(SAVE_STATE_busy);
+        saveJob.starts++;
+        saveJob.thread = strlen(saveJob.path) ? SDL_CreateThread(saveThread, NULL) : NULL;
+        if (saveJob.thread == NULL)
+        {
+            if (strlen(saveJob.path))
+            {
+                errorprintf("SDL_CreateThread() Failed: %s\n", SDL_GetError());
+            }
+            /* Script is written by this thread */
+            saveThread(NULL);
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * @brief isSaving Check if result of a started save is not taken yet.
+ *
+ * @return TRUE: if script is being saved.
+ */
+bool_t isSaving(void)
+{
+    return saveJob.mutex && getSaveState() != SAVE_STATE_idle;
+}
+
+/**
+ * @brief updateSave Take result of finished save. While recording or
+ * replaying, it is taken at the same iteration in both runs.
+ *
+ * @param aDocument[in,out] Document, it is marked as modified if save failed.
+ * @param aOk[out]          TRUE: script was successfully saved.
+ * @return TRUE: if a save has finished.
+ */
+bool_t updateSave(document_t * aDocument, bool_t * aOk)
+{
+    bool_t finished = isSaving() && replaySync(REPLAY_GATE_SAVE, saveJob.starts, isSaveDone, NULL);
+
+    if (finished)
+    {
+        waitSave();
+        *aOk = saveJob.ok;
+        if (!saveJob.ok)
+        {
+            aDocument->modified = TRUE;
+        }
+        freeDocument(&saveJob.snapshot);
+        setSaveState(SAVE_STATE_idle);
+    }
+
+    return finished;
+}
+
+/**
+ * @brief waitSave Wait until script is written. It shall be called before
+ * the loaded script is released. Result stays to be taken by updateSave().
+ */
+void waitSave(void)
+{
+    if (saveJob.thread)
+    {
+        SDL_WaitThread(saveJob.thread, NULL);
+        saveJob.thread = NULL;
+    }
+}
+
+/**
+ * @brief doneSave Wait for save thread and release its snapshot.
+ */
+void doneSave(void)
+{
+    waitSave();
+    freeDocument(&saveJob.snapshot);
+    if (saveJob.mutex)
+    {
+        SDL_DestroyMutex(saveJob.mutex);
+    }
+    memset(&saveJob, 0, sizeof(saveJob));
+}
+
+/**
+ * @brief findEditedLine Find the first line of text which is fully visible.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @return Line. NULL: there is no text on the screen.
+ */
+static linkedListElement_t * findEditedLine(wrappedScript_t * aWrappedScript)
+{
+    linkedListElement_t * element = aWrappedScript->wrappedScriptList.actual;
+    uint16_t              height_px = aWrappedScript->wrappedScriptHeightPx;
+    uint32_t              hidden_px;
+    uint32_t              i;
+
+    if (!height_px)
+    {
+        return NULL;
+    }
+
+    /* Skip lines which are above the text area */
+    hidden_px = MAX(aWrappedScript->config->video_size_y_px - aWrappedScript->maxHeightPx, 0) / 2
+                + aWrappedScript->heightOffsetPx;
+    for (i = (hidden_px + height_px - 1) / height_px; i > 0 && element; i--)
+    {
+        element = element->next;
+    }
+    for (i = 0; i < aWrappedScript->linePerScreen && element
+         && getScriptElementColumn(element) == LINE_COLUMN_NONE; i++)
+    {
+        element = element->next;
+    }
+
+    return element && getScriptElementColumn(element) != LINE_COLUMN_NONE ? element : NULL;
+}
+
+/**
+ * @brief getParagraphLines Get lines of edited paragraph.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @param aFirst[out]           First line of paragraph.
+ * @param aLast[out]            Last line of paragraph.
+ */
+static void getParagraphLines(wrappedScript_t * aWrappedScript, linkedListElement_t ** aFirst,
+                              linkedListElement_t ** aLast)
+{
+    linkedListElement_t * element;
+    size_t                column;
+
+    *aFirst = editPrompt.before ? editPrompt.before->next : aWrappedScript->wrappedScriptList.first;
+    for (element = *aFirst; element->next; element = element->next)
+    {
+        column = getScriptElementColumn(element->next);
+        if (column == 0 || column == LINE_COLUMN_NONE)
+        {
+            /* Next paragraph or separator */
+            break;
+        }
+    }
+    *aLast = element;
+}
+
+/**
+ * @brief wrapEditedParagraph Wrap edited paragraph again from document after
+ * a change. Text is read from the first line of rewrap until a bit after the
+ * change, it is read further only if new lines did not line up with old ones.
+ *
+ * @param aDocument[in]             Document of wrapped script.
+ * @param aWrappedScript[in,out]    Wrapped script.
+ * @param aChangeEnd[in]            Column of first character after the changed text.
+ * @param aShift[in]                Change of length of paragraph.
+ * @return Count of bytes wrapped again.
+ */
+static size_t wrapEditedParagraph(const document_t * aDocument, wrappedScript_t * aWrappedScript,
+                                  size_t aChangeEnd, ptrdiff_t aShift)
+{
+    bool_t   ok = TRUE;
+    bool_t   complete = FALSE;
+    size_t   start = getScriptElementColumn(editPrompt.rewrap.first);
+    size_t   length = MIN(aChangeEnd + EDIT_REWRAP_MIN_BYTES, editPrompt.paragraphLength) - start;
+    size_t   position = getParagraphPosition(aDocument) + start;
+    char   * text;
+
+    while (ok && !complete)
+    {
+        if (length > editPrompt.textSize)
+        {
+            text = realloc(editPrompt.text, length);
+            ok = text != NULL;
+            if (ok)
+            {
+                editPrompt.text = text;
+                editPrompt.textSize = length;
+            }
+            else
+            {
+                errorprintf("Cannot allocate memory for edited paragraph!\n");
+            }
+        }
+        if (ok)
+        {
+            readText(aDocument, position, length, editPrompt.text);
+            ok = rewrapParagraph(aWrappedScript, &editPrompt.rewrap, editPrompt.text, length,
+                                 start + length == editPrompt.paragraphLength, aChangeEnd, aShift, &complete);
+        }
+        if (ok && !complete)
+        {
+            length = MIN(length * 2, editPrompt.paragraphLength - start);
+        }
+    }
+    /* Memory of replaced lines is reused by other lines */
+    invalidateLineMasks(aWrappedScript->releasedLines);
+
+    return length;
+}
+
+/**
+ * @brief startEdit Start editing the first line of text on the screen.
+ *
+ * @param aDocument[in,out]     Document of wrapped script.
+ * @param aWrappedScript[in]    Wrapped script.
+ * @return TRUE: if editing was started. FALSE: there is no line to edit.
+ */
+bool_t startEdit(document_t * aDocument, wrappedScript_t * aWrappedScript)
+{
+    linkedListElement_t * element = findEditedLine(aWrappedScript);
+    linkedListElement_t * first;
+    linkedListElement_t * last;
+    const char          * item;
+
+    if (!aDocument->script || !element || strlen(element->item) >= EDIT_MAX_LINE_LEN)
+    {
+        return FALSE;
+    }
+
+    /* Pieces are kept to undo editing, text of line is not enough: its white
+     * spaces are shown as spaces */
+    free(aDocument->undoPieces);
+    aDocument->undoPieces = malloc(MAX(aDocument->pieceCount, 1) * sizeof(piece_t));
+    if (aDocument->undoPieces == NULL)
+    {
+        errorprintf("Cannot allocate memory to undo editing!\n");
+        return FALSE;
+    }
+    memcpy(aDocument->undoPieces, aDocument->pieces, aDocument->pieceCount * sizeof(piece_t));
+    aDocument->undoCount = aDocument->pieceCount;
+    aDocument->undoLength = aDocument->length;
+
+    for (first = element; getScriptElementColumn(first) != 0; first = first->prev)
+    {
+    }
+    editPrompt.before = first->prev;
+    editPrompt.paragraph = getScriptElementOffset(first);
+    editPrompt.column = getScriptElementColumn(element);
+    /* Lines cover their paragraph without gaps */
+    getParagraphLines(aWrappedScript, &first, &last);
+    item = last->item;
+    editPrompt.paragraphLength = getScriptElementColumn(last) + strlen(item);
+    editPrompt.undoParagraphLength = editPrompt.paragraphLength;
+    startRewrap(&editPrompt.rewrap, element, last->next);
+
+    strcpy(editPrompt.line, element->item);
+    strcpy(editPrompt.lastLine, element->item);
+    editPrompt.wasModified = aDocument->modified;
+    editPrompt.active = TRUE;
+    editPrompt.generation++;
+
+    return TRUE;
+}
+
+/**
+ * @brief updateEdit Apply typed text to document and wrap the edited
+ * paragraph again. It shall be called regularly while editing.
+ *
+ * @param aDocument[in,out]         Document of wrapped script.
+ * @param aWrappedScript[in,out]    Wrapped script.
+ */
+void updateEdit(document_t * aDocument, wrappedScript_t * aWrappedScript)
+{
+    bool_t                ok;
+    size_t                old_len;
+    size_t                new_len;
+    size_t                prefix = 0;
+    size_t                suffix = 0;
+    size_t                position;
+    size_t                wrapped;
+    uint64_t              start_us = getTimeUs();
+
+    if (!editPrompt.active || !strcmp(editPrompt.line, editPrompt.lastLine))
+    {
+        return;
+    }
+
+    /* Only the changed part is replaced */
+    old_len = strlen(editPrompt.lastLine);
+    new_len = strlen(editPrompt.line);
+    while (prefix < old_len && prefix < new_len && editPrompt.line[prefix] == editPrompt.lastLine[prefix])
+    {
+        prefix++;
+    }
+    while (suffix < old_len - prefix && suffix < new_len - prefix
+           && editPrompt.line[new_len - suffix - 1] == editPrompt.lastLine[old_len - suffix - 1])
+    {
+        suffix++;
+    }
+    position = getParagraphPosition(aDocument) + editPrompt.column + prefix;
+    ok = deleteText(aDocument, position, old_len - prefix - suffix)
+         && insertText(aDocument, position, editPrompt.line + prefix, new_len - prefix - suffix);
+    if (ok)
+    {
+        strcpy(editPrompt.lastLine, editPrompt.line);
+        editPrompt.paragraphLength = editPrompt.paragraphLength - old_len + new_len;
+        aDocument->edited = TRUE;
+        aDocument->modified = TRUE;
+        wrapped = wrapEditedParagraph(aDocument, aWrappedScript, editPrompt.column + new_len - suffix,
+                                      (ptrdiff_t)new_len - (ptrdiff_t)old_len);
+        verboseprintf("Edit: %lu bytes of paragraph of %lu bytes wrapped in %llu us, %lu pieces\n",
+                      (unsigned long)wrapped, (unsigned long)editPrompt.paragraphLength,
+                      (unsigned long long)(getTimeUs() - start_us), (unsigned long)aDocument->pieceCount);
+    }
+    else
+    {
+        /* Typed text is dropped */
+        strcpy(editPrompt.line, editPrompt.lastLine);
+    }
+    editPrompt.generation++;
+}
+
+/**
+ * @brief stopEdit Stop editing. Saving of accepted edits is started in
+ * background, cancelled ones are undone by restoring the pieces. Typed text
+ * stays in the add buffer.
+ *
+ * @param aDocument[in,out]         Document of wrapped script.
+ * @param aWrappedScript[in,out]    Wrapped script.
+ * @param aAccept[in]               TRUE: save document, FALSE: restore edited line.
+ * @param aPath[in]                 Document is saved to this file, NULL: it is not written.
+ * @return TRUE: if successfully finished, FALSE: saving could not be started.
+ */
+bool_t stopEdit(document_t * aDocument, wrappedScript_t * aWrappedScript, bool_t aAccept, const char * aPath)
+{
+    bool_t    ok = TRUE;
+    size_t    length;
+    ptrdiff_t shift;
+
+    if (editPrompt.active)
+    {
+        if (aAccept)
+        {
+            updateEdit(aDocument, aWrappedScript);
+            if (aDocument->modified)
+            {
+                ok = startSave(aDocument, aPath);
+            }
+        }
+        else if (strcmp(editPrompt.line, editPrompt.lastLine) || aDocument->length != aDocument->undoLength
+                 || aDocument->pieceCount != aDocument->undoCount
+                 || memcmp(aDocument->pieces, aDocument->undoPieces, aDocument->pieceCount * sizeof(piece_t)))
+        {
+            /* Array of pieces never shrinks, there is room for them */
+            memcpy(aDocument->pieces, aDocument->undoPieces, aDocument->undoCount * sizeof(piece_t));
+            aDocument->pieceCount = aDocument->undoCount;
+            aDocument->length = aDocument->undoLength;
+            aDocument->modified = editPrompt.wasModified;
+            /* Only the edited line was changed, its original length is restored */
+            length = strlen(editPrompt.lastLine) + editPrompt.undoParagraphLength - editPrompt.paragraphLength;
+            shift = (ptrdiff_t)editPrompt.undoParagraphLength - (ptrdiff_t)editPrompt.paragraphLength;
+            editPrompt.paragraphLength = editPrompt.undoParagraphLength;
+            wrapEditedParagraph(aDocument, aWrappedScript, editPrompt.column + length, shift);
+        }
+        stopRewrap(&editPrompt.rewrap);
+        free(editPrompt.text);
+        editPrompt.text = NULL;
+        editPrompt.textSize = 0;
+        free(aDocument->undoPieces);
+        aDocument->undoPieces = NULL;
+        aDocument->undoCount = 0;
+        editPrompt.active = FALSE;
+        editPrompt.before = NULL;
+        editPrompt.generation++;
+    }
+
+    return ok;
+}
@@ -0,0 +1,110 @@
+/**
+ * @file        edit.h
+ * @brief       Editing of script while it is shown
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-28 10:21:37
+ * Last modify: 2021-02-28 10:21:37 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_EDIT_H
+#define INCLUDE_EDIT_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+
+#define EDIT_MAX_LINE_LEN           256     /* Maximum length of edited line, including end of string */
+#define EDIT_ADD_MIN_SIZE           4096    /* Initial size of buffer of typed text */
+#define EDIT_PIECE_MIN_COUNT        64      /* Initial count of pieces */
+#define EDIT_REWRAP_MIN_BYTES       1024    /* Text after the change which is read to wrap edited paragraph again */
+
+/* Part of document, its text is in the loaded script or in the add buffer */
+typedef struct
+{
+    bool_t          added;                  /* TRUE: text was typed, FALSE: text is in loaded script */
+    size_t          start;                  /* Offset of text in its buffer */
+    size_t          length;                 /* Length of text */
+} piece_t;
+
+/* Piece table: loaded script is never changed, typed text is appended to
+ * the add buffer and the document is the sequence of pieces */
+typedef struct
+{
+    const char    * script;                 /* Loaded script, it is not owned by the document */
+    char          * add;                    /* Typed text */
+    size_t          addLength;              /* Used bytes of add buffer */
+    size_t          addSize;                /* Size of add buffer */
+    piece_t       * pieces;                 /* Pieces in order of document */
+    size_t          pieceCount;             /* Count of pieces */
+    size_t          pieceSize;              /* Count of allocated pieces */
+    size_t          length;                 /* Length of document */
+    piece_t       * undoPieces;             /* Pieces when editing of line was started */
+    size_t          undoCount;              /* Count of undoPieces */
+    size_t          undoLength;             /* Length of document when editing of line was started */
+    bool_t          edited;                 /* TRUE: document differs from loaded script */
+    bool_t          modified;               /* TRUE: document was changed since it was saved */
+} document_t;
+
+/* State of line editor */
+typedef struct
+{
+    bool_t          active;                 /* TRUE: prompt is shown */
+    char            line[EDIT_MAX_LINE_LEN];     /* Text typed by user */
+    char            lastLine[EDIT_MAX_LINE_LEN]; /* Text which is already in document */
+    linkedListElement_t * before;           /* Line before edited paragraph, it is not replaced by editing */
+    size_t          paragraph;              /* Offset of edited paragraph in loaded script */
+    size_t          paragraphLength;        /* Length of edited paragraph in document */
+    size_t          undoParagraphLength;    /* Length of paragraph when editing was started */
+    size_t          column;                 /* Offset of edited text in paragraph */
+    rewrapState_t   rewrap;                 /* Lines of paragraph which are wrapped again */
+    char          * text;                   /* Text of paragraph to wrap again */
+    size_t          textSize;               /* Size of text buffer */
+    bool_t          wasModified;            /* Modified flag of document when editing was started */
+    uint32_t        generation;             /* Incremented when prompt changes */
+} editPrompt_t;
+
+typedef enum
+{
+    SAVE_STATE_idle,            /**< Script is not being saved. */
+    SAVE_STATE_busy,            /**< Save thread is running. */
+    SAVE_STATE_done,            /**< Script is saved, result is not taken yet. */
+} saveState_t;
+
+/* Script is written in background from a copy of the piece table. Text of
+ * loaded script is not copied, it shall not be released while saving. */
+typedef struct
+{
+    SDL_Thread    * thread;                 /* Save thread, NULL if not running */
+    SDL_mutex     * mutex;                  /* Protects state */
+    saveState_t     state;
+    uint32_t        starts;                 /* Count of started saves */
+    char            path[MAX_PATH_LEN];     /* Path of script, empty: script is not written */
+    document_t      snapshot;               /* Pieces and typed text when save was started */
+    bool_t          ok;                     /* TRUE: script was successfully saved */
+} saveJob_t;
+
+extern editPrompt_t editPrompt;
+extern saveJob_t saveJob;
+
+void initDocument(document_t * aDocument, const char * aScript);
+void freeDocument(document_t * aDocument);
+char * flattenDocument(const document_t * aDocument);
+bool_t initSave(void);
+bool_t startSave(document_t * aDocument, const char * aPath);
+bool_t isSaving(void);
+bool_t updateSave(document_t * aDocument, bool_t * aOk);
+void waitSave(void);
+void doneSave(void);
+bool_t startEdit(document_t * aDocument, wrappedScript_t * aWrappedScript);
+void updateEdit(document_t * aDocument, wrappedScript_t * aWrappedScript);
+bool_t stopEdit(document_t * aDocument, wrappedScript_t * aWrappedScript, bool_t aAccept, const char * aPath);
+
+#endif /* INCLUDE_EDIT_H */
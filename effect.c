@@ -0,0 +1,235 @@
+/**
+ * @file        effect.c
+ * @brief       Outline and drop shadow of rendered text
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-06 10:12:25
+ * Last modify: 2021-03-06 10:12:25 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Outline is the coverage of text dilated by a square, shadow is the
+ * coverage moved down and right then blurred by a box. Both filters are
+ * separable: rows are filtered first, then columns, by the vectorized row
+ * kernels of blendkernel.h. Effects are calculated once when a line is
+ * rendered and the result is a single mask of two tones, so drawing it
+ * costs the same as drawing plain text.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "blendkernel.h"
+#include "blend.h"
+#include "effect.h"
+
+/**
+ * @brief getShadowBlur Get radius of box blur of shadow.
+ */
+static uint8_t getShadowBlur(uint8_t aShadowPx)
+{
+    return (aShadowPx + 1) / 2;
+}
+
+/**
+ * @brief getEffectPadding Get pixels needed around text by effects.
+ *
+ * @param aOutlinePx[in]    Width of outline, 0: no outline.
+ * @param aShadowPx[in]     Offset of shadow, 0: no shadow.
+ * @return Padding on each side of text.
+ */
+uint16_t getEffectPadding(uint8_t aOutlinePx, uint8_t aShadowPx)
+{
+    return aOutlinePx + aShadowPx + getShadowBlur(aShadowPx);
+}
+
+/**
+ * @brief dilate Dilate coverage by a square.
+ *
+ * @param aDst[out]     Dilated coverage.
+ * @param aSrc[in]      Coverage, it is zero at least aRadius pixels from the edges.
+ * @param aTmp[out]     Temporary plane of the same size.
+ * @param aWidth[in]    Width of planes.
+ * @param aHeight[in]   Height of planes.
+ * @param aRadius[in]   Half size of square.
+ */
+static void dilate(uint8_t * aDst, const uint8_t * aSrc, uint8_t * aTmp,
+                   uint16_t aWidth, uint16_t aHeight, uint8_t aRadius)
+{
+    const blendKernels_t * k = getBlendKernels();
+    uint16_t               y;
+    uint8_t                i;
+
+    /* Rows: maximum of pixels at most radius left and right */
+    memcpy(aTmp, aSrc, (size_t)aWidth * aHeight);
+    for (y = 0; y < aHeight; y++)
+    {
+        for (i = 1; i <= aRadius; i++)
+        {
+            k->maxRow8(&aTmp[y * aWidth + i], &aSrc[y * aWidth], aWidth - i);
+            k->maxRow8(&aTmp[y * aWidth], &aSrc[y * aWidth + i], aWidth - i);
+        }
+    }
+
+    /* Columns: maximum of rows at most radius above and below */
+    memcpy(aDst, aTmp, (size_t)aWidth * aHeight);
+    for (y = 0; y < aHeight; y++)
+    {
+        for (i = 1; i <= aRadius; i++)
+        {
+            if (y >= i)
+            {
+                k->maxRow8(&aDst[y * aWidth], &aTmp[(y - i) * aWidth], aWidth);
+            }
+            if (y + i < aHeight)
+            {
+                k->maxRow8(&aDst[y * aWidth], &aTmp[(y + i) * aWidth], aWidth);
+            }
+        }
+    }
+}
+
+/**
+ * @brief blur Blur coverage by a box.
+ *
+ * @param aDst[out]     Blurred coverage, it can be the same plane as aSrc.
+ * @param aSrc[in]      Coverage.
+ * @param aTmp[out]     Temporary plane of the same size.
+ * @param aSums[out]    Temporary sums of a row.
+ * @param aZeros[in]    A row of zeros.
+ * @param aWidth[in]    Width of planes.
+ * @param aHeight[in]   Height of planes.
+ * @param aRadius[in]   Half size of box.
+ */
+static void blur(uint8_t * aDst, const uint8_t * aSrc, uint8_t * aTmp, uint16_t * aSums, const uint8_t * aZeros,
+                 uint16_t aWidth, uint16_t aHeight, uint8_t aRadius)
+{
+    const blendKernels_t * k = getBlendKernels();
+    uint16_t               size = 2 * aRadius + 1;
+    /* Sum is at most 255 * 17, division by size is multiplication by rounded up reciprocal */
+    uint32_t               reciprocal = (65536u + size - 1) / size;
+    const uint8_t        * src;
+    uint8_t              * dst;
+    uint32_t               sum;
+    uint16_t               x;
+    uint16_t               y;
+
+    /* Rows: running sum of pixels at most radius left and right */
+    for (y = 0; y < aHeight; y++)
+    {
+        src = &aSrc[y * aWidth];
+        dst = &aTmp[y * aWidth];
+        sum = 0;
+        for (x = 0; x < aRadius && x < aWidth; x++)
+        {
+            sum += src[x];
+        }
+        for (x = 0; x < aWidth; x++)
+        {
+            if (x + aRadius < aWidth)
+            {
+                sum += src[x + aRadius];
+            }
+            dst[x] = (sum * reciprocal) >> 16;
+            if (x >= aRadius)
+            {
+                sum -= src[x - aRadius];
+            }
+        }
+    }
+
+    /* Columns: running sums of rows at most radius above and below */
+    memset(aSums, 0, aWidth * sizeof(uint16_t));
+    for (y = 0; y < aRadius && y < aHeight; y++)
+    {
+        k->sumRow16(aSums, &aTmp[y * aWidth], aZeros, aWidth);
+    }
+    for (y = 0; y < aHeight; y++)
+    {
+        k->sumRow16(aSums,
+                    y + aRadius < aHeight ? &aTmp[(y + aRadius) * aWidth] : aZeros,
+                    y > aRadius ? &aTmp[(y - aRadius - 1) * aWidth] : aZeros,
+                    aWidth);
+        dst = &aDst[y * aWidth];
+        for (x = 0; x < aWidth; x++)
+        {
+            dst[x] = ((uint32_t)aSums[x] * reciprocal) >> 16;
+        }
+    }
+}
+
+/**
+ * @brief createEffectMask Create mask of text with outline and shadow. Text
+ * is drawn over its effects: where text has coverage the effects are
+ * assumed to be opaque, it is true for outline and nearly true for shadow.
+ *
+ * @param aText[in]         Coverage of text, without padding.
+ * @param aOutlinePx[in]    Width of outline, 0: no outline.
+ * @param aShadowPx[in]     Offset of shadow to down and right, 0: no shadow.
+ * @return Mask of two tones with padding, it shall be freed by
+ * freeAlphaMask(). NULL: error occurred.
+ */
+alphaMask_t * createEffectMask(const alphaMask_t * aText, uint8_t aOutlinePx, uint8_t aShadowPx)
+{
+    uint16_t      padding = getEffectPadding(aOutlinePx, aShadowPx);
+    uint16_t      w = aText->w + 2 * padding;
+    uint16_t      h = aText->h + 2 * padding;
+    size_t        size = (size_t)w * h;
+    alphaMask_t * mask;
+    uint8_t     * planes;
+    uint8_t     * text;
+    uint8_t     * effect;
+    uint8_t     * tmp;
+    uint16_t    * sums;
+    uint8_t     * zeros;
+    size_t        i;
+    uint16_t      y;
+
+    mask = allocAlphaMask(w, h);
+    /* Sums and zeros of a row, text, effects and temporary plane */
+    planes = calloc(1, w * sizeof(uint16_t) + w + size * 3);
+    if (!mask || !planes)
+    {
+        errorprintf("Cannot allocate memory for text effects!\n");
+        freeAlphaMask(mask);
+        free(planes);
+        return NULL;
+    }
+    sums = (uint16_t *)planes;
+    zeros = (uint8_t *)(sums + w);
+    text = zeros + w;
+    effect = text + size;
+    tmp = effect + size;
+
+    for (y = 0; y < aText->h; y++)
+    {
+        memcpy(&text[(y + padding) * w + padding], &aText->pixels[y * aText->w], aText->w);
+    }
+
+    if (aOutlinePx)
+    {
+        dilate(effect, text, tmp, w, h, aOutlinePx);
+    }
+    if (aShadowPx)
+    {
+        /* Shadow is blurred into the pixels of mask, they are overwritten later */
+        memset(tmp, 0, size);
+        for (y = 0; y < aText->h; y++)
+        {
+            memcpy(&tmp[(y + padding + aShadowPx) * w + padding + aShadowPx], &aText->pixels[y * aText->w], aText->w);
+        }
+        blur(tmp, tmp, mask->pixels, sums, zeros, w, h, getShadowBlur(aShadowPx));
+        getBlendKernels()->maxRow8(effect, tmp, (int)size);
+    }
+
+    for (i = 0; i < size; i++)
+    {
+        mask->pixels[i] = text[i] ? EFFECT_TONE_TEXT + (text[i] >> 1) : effect[i] >> 1;
+    }
+    mask->padding = padding;
+    free(planes);
+
+    return mask;
+}
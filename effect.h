@@ -0,0 +1,25 @@
+/**
+ * @file        effect.h
+ * @brief       Outline and drop shadow of rendered text
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-06 10:12:25
+ * Last modify: 2021-03-06 10:12:25 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_EFFECT_H
+#define INCLUDE_EFFECT_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "blend.h"
+
+#define EFFECT_MAX_OUTLINE_PX       8       /* Maximum width of outline */
+#define EFFECT_MAX_SHADOW_PX        8       /* Maximum offset of shadow */
+
+uint16_t getEffectPadding(uint8_t aOutlinePx, uint8_t aShadowPx);
+alphaMask_t * createEffectMask(const alphaMask_t * aText, uint8_t aOutlinePx, uint8_t aShadowPx);
+
+#endif /* INCLUDE_EFFECT_H */
@@ -0,0 +1,431 @@
+/**
+ * @file        fontpool.c
+ * @brief       Pool of opened fonts
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-23 20:15:02
+ * Last modify: 2021-02-23 20:15:02 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Fonts are kept open after they are released, so changing the font size
+ * back and forth does not open and parse the font again. Font files are read
+ * only once and opened from memory for every size.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "fontpool.h"
+
+/* Symbols for DejaVuSans.o which is directly converted from .ttf to object using 'ld' */
+extern uint8_t _binary_DejaVuSans_ttf_start[];
+extern uint8_t _binary_DejaVuSans_ttf_end;
+extern uint8_t _binary_DejaVuSans_ttf_size;
+/* Symbols for consola.o which is directly converted from .ttf to object using 'ld' */
+extern uint8_t _binary_consola_ttf_start[];
+extern uint8_t _binary_consola_ttf_end;
+extern uint8_t _binary_consola_ttf_size;
+
+SDL_mutex      * fontPoolMutex = NULL;  /* Fonts can be acquired by loader thread too */
+fontSource_t     fontSources[FONT_POOL_SOURCE_COUNT];
+fontPoolEntry_t  fontPool[FONT_POOL_SIZE];
+uint32_t         fontPoolUseCounter = 0;
+
+/**
+ * @brief readFontFile Read whole font file into memory.
+ *
+ * @param aPath[in]     Path of font file.
+ * @param aSource[out]  Content of font file is stored here.
+ * @return TRUE: if font file was read.
+ */
+static bool_t readFontFile(const char * aPath, fontSource_t * aSource)
+{
+    bool_t    ok = FALSE;
+    FILE    * file;
+    long      fileSize;
+    uint8_t * data;
+
+    verboseprintf("Reading font file '%s'... ", aPath);
+    file = fopen(aPath, "rb");
+    if (file)
+    {
+        if (fseek(file, 0, SEEK_END) == 0 && (fileSize = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0)
+        {
+            data = malloc(fileSize);
+            if (data)
+            {
+                if (fread(data, 1, fileSize, file) == (size_t)fileSize)
+                {
+                    aSource->data = data;
+                    aSource->size = fileSize;
+                    aSource->embedded = FALSE;
+                    verboseprintf("Done.\n");
+                    ok = TRUE;
+                }
+                else
+                {
+                    errorprintf("Cannot read font file!\n");
+                    free(data);
+                }
+            }
+            else
+            {
+                errorprintf("Cannot allocate memory for font!\n");
+            }
+        }
+        else
+        {
+            errorprintf("Cannot get size of font file!\n");
+        }
+        fclose(file);
+    }
+    else
+    {
+        errorprintf("Cannot open font file '%s'!\n", aPath);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief freeFontSource Release content of font file if it is not used by
+ * any opened font.
+ */
+static void freeFontSource(fontSource_t * aSource)
+{
+    uint8_t i;
+
+    for (i = 0; i < FONT_POOL_SIZE; i++)
+    {
+        if (fontPool[i].source == aSource)
+        {
+            return;
+        }
+    }
+    if (!aSource->embedded)
+    {
+        free((void *)aSource->data);
+    }
+    aSource->data = NULL;
+    aSource->path[0] = CHR_EOS;
+}
+
+/**
+ * @brief getFontSource Find font file in memory or read it.
+ *
+ * @param aSource[in]   Path of font file or FONT_SOURCE_*.
+ * @return Content of font file or NULL if error occurred.
+ */
+static fontSource_t * getFontSource(const char * aSource)
+{
+    fontSource_t * source = NULL;
+    fontSource_t * freeSource = NULL;
+    uint8_t        i;
+
+    for (i = 0; i < FONT_POOL_SOURCE_COUNT && !source; i++)
+    {
+        if (fontSources[i].data == NULL)
+        {
+            freeSource = freeSource ? freeSource : &fontSources[i];
+        }
+        else if (!strcmp(fontSources[i].path, aSource))
+        {
+            source = &fontSources[i];
+        }
+    }
+    for (i = 0; i < FONT_POOL_SOURCE_COUNT && !source && !freeSource; i++)
+    {
+        /* Try to drop a font file which is not used by any font */
+        freeFontSource(&fontSources[i]);
+        if (fontSources[i].data == NULL)
+        {
+            freeSource = &fontSources[i];
+        }
+    }
+
+    if (!source && freeSource)
+    {
+        if (!strcmp(aSource, FONT_SOURCE_EMBEDDED))
+        {
+            freeSource->data = _binary_DejaVuSans_ttf_start;
+            freeSource->size = (size_t)&_binary_DejaVuSans_ttf_size;
+            freeSource->embedded = TRUE;
+        }
+        else if (!strcmp(aSource, FONT_SOURCE_MONOSPACE))
+        {
+            freeSource->data = _binary_consola_ttf_start;
+            freeSource->size = (size_t)&_binary_consola_ttf_size;
+            freeSource->embedded = TRUE;
+        }
+        else
+        {
+            readFontFile(aSource, freeSource);
+        }
+        if (freeSource->data)
+        {
+            strncpy(freeSource->path, aSource, sizeof(freeSource->path) - 1);
+            freeSource->path[sizeof(freeSource->path) - 1] = CHR_EOS;
+            source = freeSource;
+        }
+    }
+    else if (!source)
+    {
+        errorprintf("Too many font files are in use!\n");
+    }
+
+    return source;
+}
+
+/**
+ * @brief initFontPool Initialize pool of fonts. TTF_Init() shall be called before.
+ *
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initFontPool(void)
+{
+    bool_t ok = TRUE;
+
+    memset(fontSources, 0, sizeof(fontSources));
+    memset(fontPool, 0, sizeof(fontPool));
+    fontPoolMutex = SDL_CreateMutex();
+    if (fontPoolMutex == NULL)
+    {
+        errorprintf("SDL_CreateMutex() Failed: %s\n", SDL_GetError());
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief doneFontPool Close all fonts of pool and release font files.
+ */
+void doneFontPool(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < FONT_POOL_SIZE; i++)
+    {
+        if (fontPool[i].font)
+        {
+            if (fontPool[i].refCount)
+            {
+                errorprintf("Font is still in use!\n");
+            }
+            TTF_CloseFont(fontPool[i].font);
+        }
+        fontPool[i].source = NULL;
+        fontPool[i].font = NULL;
+        fontPool[i].atlas = NULL;
+    }
+    for (i = 0; i < FONT_POOL_SOURCE_COUNT; i++)
+    {
+        if (fontSources[i].data)
+        {
+            freeFontSource(&fontSources[i]);
+        }
+    }
+    if (fontPoolMutex)
+    {
+        SDL_DestroyMutex(fontPoolMutex);
+        fontPoolMutex = NULL;
+    }
+}
+
+/**
+ * @brief acquireFont Get font of the specified size. If it is already
+ * open, it is returned without touching the file system. Otherwise it is
+ * opened from memory and the least recently used unused font is closed.
+ * It can be called from any thread.
+ *
+ * @param aSource[in]   Path of font file or FONT_SOURCE_*.
+ * @param aSize[in]     Point size of font.
+ * @return Font or NULL if error occurred. It shall be released by releaseFont().
+ */
+TTF_Font * acquireFont(const char * aSource, int aSize)
+{
+    TTF_Font        * font = NULL;
+    fontPoolEntry_t * entry = NULL;
+    fontPoolEntry_t * victim = NULL;
+    fontSource_t    * source;
+    uint8_t           i;
+
+    SDL_mutexP(fontPoolMutex);
+    fontPoolUseCounter++;
+    for (i = 0; i < FONT_POOL_SIZE && !entry; i++)
+    {
+        if (fontPool[i].font && fontPool[i].size == aSize && !strcmp(fontPool[i].source->path, aSource))
+        {
+            entry = &fontPool[i];
+        }
+        else if (!fontPool[i].refCount
+                 && (!victim || !fontPool[i].font || (victim->font && fontPool[i].lastUse < victim->lastUse)))
+        {
+            victim = &fontPool[i];
+        }
+    }
+
+    if (entry)
+    {
+        debugprintf("Font %s %i is in pool\n", aSource, aSize);
+    }
+    else if (victim)
+    {
+        if (victim->font)
+        {
+            verboseprintf("Closing unused font %s %i\n", victim->source->path, victim->size);
+            TTF_CloseFont(victim->font);
+            victim->font = NULL;
+            victim->atlas = NULL;
+            source = victim->source;
+            victim->source = NULL;
+            freeFontSource(source);
+        }
+        source = getFontSource(aSource);
+        if (source)
+        {
+            verboseprintf("Opening font %s %i\n", source->path, aSize);
+            victim->font = TTF_OpenFontRW(SDL_RWFromConstMem(source->data, source->size), 1, aSize);
+            if (victim->font)
+            {
+                victim->source = source;
+                victim->size = aSize;
+                victim->atlas = findAtlasFont(source->path, aSize);
+                entry = victim;
+            }
+            else
+            {
+                errorprintf("TTF_OpenFontRW() Failed: %s\n", TTF_GetError());
+                freeFontSource(source);
+            }
+        }
+    }
+    else
+    {
+        errorprintf("All fonts of pool are in use!\n");
+    }
+
+    if (entry)
+    {
+        entry->refCount++;
+        entry->lastUse = fontPoolUseCounter;
+        font = entry->font;
+    }
+    SDL_mutexV(fontPoolMutex);
+
+    return font;
+}
+
+/**
+ * @brief releaseFont Release font got by acquireFont(). Font is kept open
+ * until its slot is needed by another font.
+ *
+ * @param aFont[in] Font to release. It can be NULL.
+ */
+void releaseFont(TTF_Font * aFont)
+{
+    uint8_t i;
+    bool_t  found = FALSE;
+
+    if (aFont)
+    {
+        SDL_mutexP(fontPoolMutex);
+        for (i = 0; i < FONT_POOL_SIZE && !found; i++)
+        {
+            if (fontPool[i].font == aFont && fontPool[i].refCount)
+            {
+                fontPool[i].refCount--;
+                found = TRUE;
+            }
+        }
+        SDL_mutexV(fontPoolMutex);
+        if (!found)
+        {
+            errorprintf("Font is not in pool!\n");
+        }
+    }
+}
+
+/**
+ * @brief getFontAtlas Get glyphs of an acquired font which were rasterized
+ * at build time.
+ *
+ * @param aFont[in] Font got by acquireFont(). It can be NULL.
+ * @return Glyphs for sizeText() and renderText(), NULL if font is not in atlas.
+ */
+const atlasFont_t * getFontAtlas(TTF_Font * aFont)
+{
+    const atlasFont_t * atlas = NULL;
+    uint8_t             i;
+
+    SDL_mutexP(fontPoolMutex);
+    for (i = 0; i < FONT_POOL_SIZE && aFont; i++)
+    {
+        if (fontPool[i].font == aFont)
+        {
+            atlas = fontPool[i].atlas;
+            break;
+        }
+    }
+    SDL_mutexV(fontPoolMutex);
+
+    return atlas;
+}
+
+/**
+ * @brief openPrivateFont Open another instance of an acquired font. FreeType
+ * faces shall not be used by more threads at the same time, so every thread
+ * which measures text in parallel needs its own instance. Glyph cache of the
+ * instance is private to the thread as well.
+ *
+ * @param aFont[in] Font got by acquireFont(), it shall be kept acquired
+ *                  while the private instance is open.
+ * @return Font of the same file and size, or NULL if error occurred. It shall
+ *         be closed by closePrivateFont().
+ */
+TTF_Font * openPrivateFont(TTF_Font * aFont)
+{
+    TTF_Font * font = NULL;
+    uint8_t    i;
+
+    SDL_mutexP(fontPoolMutex);
+    for (i = 0; i < FONT_POOL_SIZE && !font; i++)
+    {
+        if (aFont && fontPool[i].font == aFont)
+        {
+            font = TTF_OpenFontRW(SDL_RWFromConstMem(fontPool[i].source->data, fontPool[i].source->size),
+                                  1, fontPool[i].size);
+            if (font == NULL)
+            {
+                errorprintf("TTF_OpenFontRW() Failed: %s\n", TTF_GetError());
+                break;
+            }
+        }
+    }
+    SDL_mutexV(fontPoolMutex);
+
+    return font;
+}
+
+/**
+ * @brief closePrivateFont Close font opened by openPrivateFont().
+ *
+ * @param aFont[in] Font to close. It can be NULL.
+ */
+void closePrivateFont(TTF_Font * aFont)
+{
+    if (aFont)
+    {
+        /* Creating and destroying faces of FreeType shall be serialized */
+        SDL_mutexP(fontPoolMutex);
+        TTF_CloseFont(aFont);
+        SDL_mutexV(fontPoolMutex);
+    }
+}
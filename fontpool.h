@@ -0,0 +1,56 @@
+/**
+ * @file        fontpool.h
+ * @brief       Pool of opened fonts
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-23 20:15:02
+ * Last modify: 2021-02-23 20:15:02 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_FONTPOOL_H
+#define INCLUDE_FONTPOOL_H
+
+#include <stdint.h>
+
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "atlas.h"
+
+#define FONT_POOL_SIZE              16      /* Count of fonts kept open */
+#define FONT_POOL_SOURCE_COUNT      4       /* Count of font files kept in memory */
+
+/* Names of fonts which are embedded into this software */
+#define FONT_SOURCE_EMBEDDED        ""
+#define FONT_SOURCE_MONOSPACE       "<monospace>"
+
+/* Content of a font file, it is shared by all sizes of the font */
+typedef struct
+{
+    char            path[MAX_PATH_LEN];     /* Path of font file or FONT_SOURCE_* */
+    const uint8_t * data;                   /* Content of font file, NULL if slot is free */
+    size_t          size;                   /* Size of content in bytes */
+    bool_t          embedded;               /* TRUE: data is linked into software, it is not released */
+} fontSource_t;
+
+/* An opened font of a size */
+typedef struct
+{
+    fontSource_t  * source;                 /* Font file, NULL if slot is free */
+    int             size;                   /* Point size */
+    TTF_Font      * font;                   /* Opened font */
+    const atlasFont_t * atlas;              /* Pre-rasterized glyphs of font, NULL if there are none */
+    uint32_t        refCount;               /* Count of users, it can be closed if 0 */
+    uint32_t        lastUse;                /* For least recently used replacement */
+} fontPoolEntry_t;
+
+bool_t initFontPool(void);
+void doneFontPool(void);
+TTF_Font * acquireFont(const char * aSource, int aSize);
+void releaseFont(TTF_Font * aFont);
+const atlasFont_t * getFontAtlas(TTF_Font * aFont);
+TTF_Font * openPrivateFont(TTF_Font * aFont);
+void closePrivateFont(TTF_Font * aFont);
+
+#endif /* INCLUDE_FONTPOOL_H */
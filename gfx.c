@@ -22,10 +22,69 @@
 #include "gfx.h"
 #include "linkedlist.h"
 #include "script.h"
+#include "stats.h"
+#include "quality.h"
+#include "linecache.h"
+#include "present.h"
+#include "search.h"
+#include "edit.h"
+#include "playlist.h"
+#include "preview.h"
+#include "replay.h"
+#include "metrics.h"
+#include "latency.h"
+#include "fontpool.h"
+#include "atlas.h"
+#include "rotate.h"
+#include "scale.h"
+#include "alloctrack.h"
 
-#define DEFAULT_INFO_TEXT_TIMER     200 // display text for 2 seconds
+#define DEFAULT_INFO_TEXT_TIME_MS   2000    // display text for 2 seconds
+#define FRAME_KEY_SIZE              256     // maximum size of frame key, see isFrameDue()
 
-uint32_t     infoTextTimer = DEFAULT_INFO_TEXT_TIMER;
+typedef enum
+{
+    FRAME_KIND_script,
+    FRAME_KIND_help,
+    FRAME_KIND_status,
+    FRAME_KIND_progress,
+} frameKind_t;
+
+/* Everything which changes the picture of drawScreen() */
+typedef struct
+{
+    frameKind_t           kind;
+    main_state_machine_t  state;
+    linkedListElement_t * actual;
+    uint32_t              layoutGeneration;
+    uint32_t              layoutRevision;
+    uint16_t              heightOffsetPx;
+    uint16_t              maxWidthPx;
+    uint16_t              maxHeightPx;
+    bool_t                alignCenter;
+    bool_t                textFading;
+    bool_t                infoTextVisible;
+    uint32_t              infoTextGeneration;
+    bool_t                statsVisible;
+    uint32_t              statsGeneration;
+    bool_t                searchVisible;
+    uint32_t              searchGeneration;
+    bool_t                editVisible;
+    uint32_t              editGeneration;
+    uint32_t              textCursor;
+    bool_t                previewVisible;
+    uint32_t              previewGeneration;
+    SDL_Color             textColor;
+    SDL_Color             backgroundColor;
+    uint8_t               outlinePx;
+    uint8_t               shadowPx;
+    SDL_Color             effectColor;
+    quality_t             quality;
+    uint8_t               scale;
+} scriptFrameKey_t;
+
+uint32_t     infoTextStartTick = 0;     /* 0: info text is not shown yet */
+uint32_t     infoTextGeneration = 0;    /* Incremented when info text changes */
 char infoText[512] = "Telepromter started";
 const char* helpText[] =
 {
@@ -52,12 +111,45 @@ const char* helpText[] =
     "count when pressed up/down",
     "F5/F6: Descrease/increase text width",
     "F7/F8: Descrease/increase text height",
+    "F9: Toggle statistics",
+    "F10: Search, Up/Down: previous/next hit",
     "F11: Toggle fullscreen",
+    "F12: Edit line, Enter: save, Escape: undo",
+    "Tab: Toggle overview of script",
     ""
     "Press 'Enter' to start teleprompter."
 };
 
 extern wrappedScript_t wrappedScript;
+extern uint32_t textCursor;
+extern playlist_t playlist;
+
+/* Cached masks of static and rarely changing texts */
+uint32_t     overlayGeneration = 1;     /* Incremented when all overlays shall be rendered again */
+overlay_t    infoOverlay;
+overlay_t    pausedOverlays[4];
+overlay_t    endOverlays[2];
+overlay_t    statusOverlay;
+overlay_t    progressOverlay;
+overlay_t    helpOverlays[sizeof(helpText) / sizeof(helpText[0])];
+SDL_Surface* helpSurface = NULL;        /* Background with help text, NULL if not rendered yet */
+uint32_t     helpGeneration = 0;
+SDL_Color    helpColor;
+overlay_t    statsOverlay;
+overlay_t    searchOverlay;
+overlay_t    editOverlay;
+
+/* Frame governor: a frame is presented only if its key differs from the previous one */
+uint8_t      lastFrameKey[FRAME_KEY_SIZE];
+size_t       lastFrameKeySize = 0;
+uint32_t     lastPresentTick = 0;
+bool_t       redrawRequested = TRUE;
+/* Position of script, it is drawn at the best quality and resolution if it stands still */
+linkedListElement_t * stillActual = NULL;
+uint32_t     stillLayoutGeneration = 0;
+uint32_t     stillLayoutRevision = 0;
+uint16_t     stillHeightOffsetPx = 0;
+uint32_t     stillTick = 0;
 
 SDL_Surface * loadImage(const char* filename)
 {
@@ -100,29 +192,295 @@ SDL_Surface * loadImage(const char* filename)
   return optimizedImage;
 }
 
+/**
+ * @brief isFrameDue Frame governor. Decide if a new frame shall be presented.
+ * A frame is presented if its key differs from the key of previous frame and
+ * the frame rate limit (config.max_fps) allows it. So the rate of frames
+ * follows the rate of changes (e.g. scroll speed) up to the limit.
+ *
+ * @param aKey[in]      Everything which changes the picture. Padding shall be zeroed.
+ * @param aKeySize[in]  Size of key in bytes.
+ * @return TRUE: if frame shall be drawn and presented.
+ */
+static bool_t isFrameDue(const void * aKey, size_t aKeySize)
+{
+    bool_t   due = FALSE;
+    bool_t   changed;
+    uint32_t now = getTicks();
+
+    updateStats();
+    changed = redrawRequested || aKeySize != lastFrameKeySize || memcmp(aKey, lastFrameKey, aKeySize);
+    if (changed)
+    {
+        if (!config.max_fps || now - lastPresentTick >= OS_TICKS_PER_SEC / config.max_fps)
+        {
+            due = TRUE;
+        }
+    }
+    latencyFrameDecided(changed, due);
+
+    if (due)
+    {
+        lastFrameKeySize = MIN(aKeySize, sizeof(lastFrameKey));
+        memcpy(lastFrameKey, aKey, lastFrameKeySize);
+        lastPresentTick = now;
+        redrawRequested = FALSE;
+        stats.framesRendered++;
+        stats.lastFrameConversionBlits = stats.frameConversionBlits;
+        stats.frameConversionBlits = 0;
+    }
+    else
+    {
+        stats.framesSkipped++;
+    }
+
+    return due;
+}
+
+/**
+ * @brief isScriptSettled Check if script has not moved for QUALITY_SETTLE_MS.
+ * Faster tiers and reduced resolution are needed only while text moves, a
+ * still script shall be drawn again at the best tier and resolution.
+ *
+ * @param aKey[in]      Key of actual frame.
+ * @return TRUE: if script stands still.
+ */
+static bool_t isScriptSettled(const scriptFrameKey_t * aKey)
+{
+    uint32_t now = getTicks();
+
+    if (aKey->actual != stillActual || aKey->layoutGeneration != stillLayoutGeneration
+        || aKey->layoutRevision != stillLayoutRevision || aKey->heightOffsetPx != stillHeightOffsetPx)
+    {
+        stillActual = aKey->actual;
+        stillLayoutGeneration = aKey->layoutGeneration;
+        stillLayoutRevision = aKey->layoutRevision;
+        stillHeightOffsetPx = aKey->heightOffsetPx;
+        stillTick = now;
+    }
+
+    return now - stillTick >= QUALITY_SETTLE_MS;
+}
+
+/**
+ * @brief getBlendMode Get how coverage masks are drawn by the tier.
+ *
+ * @param aQuality[in]  Tier of actual frame.
+ * @return Blend mode of tier.
+ */
+static blendMode_t getBlendMode(quality_t aQuality)
+{
+    blendMode_t mode;
+
+    switch (aQuality)
+    {
+        case QUALITY_solid:
+            mode = BLEND_MODE_key;
+            break;
+        case QUALITY_shaded:
+            /* Lines are drawn onto background filled with one color */
+            mode = BLEND_MODE_lut;
+            break;
+        case QUALITY_blended:
+        default:
+            mode = BLEND_MODE_blend;
+            break;
+    }
+
+    return mode;
+}
+
+/**
+ * @brief isSameFormat Check if pixels can be copied between surfaces without
+ * conversion. Alpha channel is not taken into account, blending is necessary
+ * anyway.
+ *
+ * @param aSrc[in]  Format of source surface.
+ * @param aDst[in]  Format of destination surface.
+ * @return TRUE: if color channels have the same layout.
+ */
+static bool_t isSameFormat(const SDL_PixelFormat * aSrc, const SDL_PixelFormat * aDst)
+{
+    return aSrc->BytesPerPixel == aDst->BytesPerPixel
+        && aSrc->Rmask == aDst->Rmask
+        && aSrc->Gmask == aDst->Gmask
+        && aSrc->Bmask == aDst->Bmask;
+}
+
+/**
+ * @brief gfx_blit Blit surface and count it if pixel format has to be
+ * converted.
+ *
+ * @param aSrc[in]      Source surface.
+ * @param aSrcRect[in]  Area of source surface, NULL: whole surface.
+ * @param aDst[in]      Destination surface.
+ * @param aDstRect[in]  Position on destination surface, NULL: top left corner.
+ * @return TRUE: if successfully blitted.
+ */
+bool_t gfx_blit(SDL_Surface * aSrc, SDL_Rect * aSrcRect, SDL_Surface * aDst, SDL_Rect * aDstRect)
+{
+    bool_t ok = TRUE;
+
+    if (!isSameFormat(aSrc->format, aDst->format))
+    {
+        stats.conversionBlits++;
+        stats.frameConversionBlits++;
+    }
+    if (SDL_BlitSurface(aSrc, aSrcRect, aDst, aDstRect) != 0)
+    {
+        errorprintf("SDL_BlitSurface() Failed: %s\n", SDL_GetError());
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief gfx_display_format Convert surface to the format of screen. Unlike
+ * SDL_DisplayFormat() the surface stays in system memory if frames are
+ * composed in a back buffer. Surfaces with alpha channel get the color masks
+ * of screen and alpha in the unused byte, like SDL_DisplayFormatAlpha() does
+ * with the display surface. If screen is not 32 bits, ARGB is used.
+ *
+ * @param aSurface[in]  Surface to convert.
+ * @param aAlpha[in]    TRUE: alpha channel of surface is kept.
+ * @return Converted surface, caller shall free it. NULL: error occurred.
+ */
+SDL_Surface * gfx_display_format(SDL_Surface * aSurface, bool_t aAlpha)
+{
+    SDL_PixelFormat * format = screen->format;
+    SDL_Surface     * alphaFormat = NULL;
+    SDL_Surface     * converted = NULL;
+    Uint32            rMask = 0x00FF0000;
+    Uint32            gMask = 0x0000FF00;
+    Uint32            bMask = 0x000000FF;
+
+    if (aAlpha)
+    {
+        if (format->BytesPerPixel == 4 && (format->Rmask | format->Gmask | format->Bmask) != 0xFFFFFFFF)
+        {
+            rMask = format->Rmask;
+            gMask = format->Gmask;
+            bMask = format->Bmask;
+        }
+        /* Only the format of this surface is used */
+        alphaFormat = SDL_CreateRGBSurface(SDL_SWSURFACE, 1, 1, 32, rMask, gMask, bMask, ~(rMask | gMask | bMask));
+        if (alphaFormat)
+        {
+            converted = SDL_ConvertSurface(aSurface, alphaFormat->format, SDL_SWSURFACE | SDL_SRCALPHA);
+            SDL_FreeSurface(alphaFormat);
+        }
+    }
+    else
+    {
+        converted = SDL_ConvertSurface(aSurface, format,
+                                       (screen->flags & SDL_HWSURFACE) | (aSurface->flags & SDL_SRCCOLORKEY));
+    }
+    if (!converted)
+    {
+        errorprintf("Cannot convert surface to display format: %s\n", SDL_GetError());
+    }
+
+    return converted;
+}
+
+/**
+ * @brief gfx_create_surface Create surface in the format of screen, so it can
+ * be blitted without conversion.
+ *
+ * @param aWidthPx[in]  Width of surface.
+ * @param aHeightPx[in] Height of surface.
+ * @param aAlpha[in]    TRUE: surface has alpha channel.
+ * @return Surface. NULL: error occurred.
+ */
+SDL_Surface * gfx_create_surface(uint16_t aWidthPx, uint16_t aHeightPx, bool_t aAlpha)
+{
+    SDL_Surface * surface;
+    SDL_Surface * converted = NULL;
+
+    /* Depth and masks are only temporary, surface is converted to display format */
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE, aWidthPx, aHeightPx, 32,
+                                   0x00FF0000, 0x0000FF00, 0x000000FF, aAlpha ? 0xFF000000 : 0);
+    if (surface)
+    {
+        converted = gfx_display_format(surface, aAlpha);
+        SDL_FreeSurface(surface);
+    }
+    else
+    {
+        errorprintf("SDL_CreateRGBSurface() Failed: %s\n", SDL_GetError());
+    }
+
+    return converted;
+}
+
+/**
+ * @brief gfx_request_redraw Next frame will be presented even if nothing
+ * seems to be changed. It shall be called when screen is reinitialized.
+ */
+void gfx_request_redraw(void)
+{
+    redrawRequested = TRUE;
+}
+
+/**
+ * @brief isInfoTextVisible Check if info text at top of screen shall be shown.
+ *
+ * @return TRUE: if info text was set less than DEFAULT_INFO_TEXT_TIME_MS before.
+ */
+static bool_t isInfoTextVisible(void)
+{
+    if (!infoTextStartTick)
+    {
+        /* Time is measured from first display */
+        infoTextStartTick = getTicks();
+    }
+
+    return getTicks() - infoTextStartTick < DEFAULT_INFO_TEXT_TIME_MS;
+}
+
+/**
+ * @brief formatPrompt Print label and typed text with cursor.
+ *
+ * @param aBuffer[out]  Text of prompt.
+ * @param aSize[in]     Size of buffer.
+ * @param aLabel[in]    Label of prompt.
+ * @param aText[in]     Typed text, cursor is at textCursor.
+ * @return Length of prompt.
+ */
+static size_t formatPrompt(char * aBuffer, size_t aSize, const char * aLabel, const char * aText)
+{
+    int cursor = MIN(textCursor, strlen(aText));
+    int len;
+
+    len = snprintf(aBuffer, aSize, "%s: %.*s%s%s", aLabel, cursor, aText, aText[cursor] ? "|" : "_", aText + cursor);
+
+    return MIN((size_t)MAX(len, 0), aSize - 1);
+}
+
 void printCommon (void)
 {
     SDL_Rect sdl_rect;
     Uint32 background_color;
-    char s[64];
+    char s[128];
     background_color = SDL_MapRGB(screen->format, config.background_color.r, config.background_color.g, config.background_color.b);
 
-    if (infoTextTimer)
+    if (isInfoTextVisible())
     {
         sdl_rect.x = 0;
         sdl_rect.y = 0;
         sdl_rect.w = config.video_size_x_px;
         sdl_rect.h = TEXT_Y(2) + FONT_NORMAL_SIZE_Y_PX / 2;
-        SDL_FillRect(screen, &sdl_rect, background_color);
+        fillRotatedRect(screen, &sdl_rect, background_color);
         gfx_line_draw (0, TEXT_Y(2), config.video_size_x_px, TEXT_Y(2));
 
-        gfx_font_print_center(TEXT_Y(1), infoText);
-        infoTextTimer--;
+        gfx_overlay_print_center(&infoOverlay, TEXT_Y(1), infoText);
     }
     if (TELEPROMPTER_IS_FINISHED())
     {
-        gfx_font_print_center(TEXT_Y_CENTER(0), "Press Enter/Space to replay,");
-        gfx_font_print_center(TEXT_Y_CENTER(1), "Escape to quit...");
+        gfx_overlay_print_center(&endOverlays[0], TEXT_Y_CENTER(0), playlist.count > 1
+                                 ? "Press Enter/Space for next script," : "Press Enter/Space to replay,");
+        gfx_overlay_print_center(&endOverlays[1], TEXT_Y_CENTER(1), "Escape to quit...");
     }
     else if (TELEPROMPTER_IS_PAUSED())
     {
@@ -130,102 +488,246 @@ void printCommon (void)
         sdl_rect.y = 0;
         sdl_rect.w = config.video_size_x_px;
         sdl_rect.h = TEXT_Y(5) + FONT_NORMAL_SIZE_Y_PX / 2;
-        SDL_FillRect(screen, &sdl_rect, background_color);
+        fillRotatedRect(screen, &sdl_rect, background_color);
 
         gfx_line_draw (0, TEXT_Y(5), config.video_size_x_px, TEXT_Y(5));
 
-        gfx_font_print_center(TEXT_Y(1), "** PAUSED **");
+        gfx_overlay_print_center(&pausedOverlays[0], TEXT_Y(1), "** PAUSED **");
         snprintf (s, sizeof (s), "Delta Teleprompter v%i.%i.%i", VERSION_MAJOR, VERSION_MINOR, VERSION_REVISION);
-        gfx_font_print_center(TEXT_Y(2), s);
-        gfx_font_print_center(TEXT_Y(3), "Copyright (C) Peter Ivanov");
-        gfx_font_print_center(TEXT_Y(4), "<ivanovp@gmail.com>, 2021");
+        gfx_overlay_print_center(&pausedOverlays[1], TEXT_Y(2), s);
+        gfx_overlay_print_center(&pausedOverlays[2], TEXT_Y(3), "Copyright (C) Peter Ivanov");
+        gfx_overlay_print_center(&pausedOverlays[3], TEXT_Y(4), "<ivanovp@gmail.com>, 2021");
     }
     else
     {
     }
+    if (searchPrompt.active)
+    {
+        char   prompt[SEARCH_MAX_QUERY_LEN + 32];
+        size_t len;
+
+        sdl_rect.x = 0;
+        sdl_rect.y = config.video_size_y_px - TEXT_Y(3);
+        sdl_rect.w = config.video_size_x_px;
+        sdl_rect.h = TEXT_Y(2);
+        fillRotatedRect(screen, &sdl_rect, background_color);
+        gfx_line_draw (0, sdl_rect.y, config.video_size_x_px, sdl_rect.y);
+
+        len = formatPrompt(prompt, sizeof(prompt), "Search", searchPrompt.query);
+        if (searchPrompt.hitNumber)
+        {
+            snprintf (prompt + len, sizeof (prompt) - len, "  %u/%u", searchPrompt.hitNumber, searchPrompt.hitCount);
+        }
+        else if (searchPrompt.hitCount)
+        {
+            /* Number of hit is not known if there are too many */
+            snprintf (prompt + len, sizeof (prompt) - len, "  %u hits", searchPrompt.hitCount);
+        }
+        else if (searchPrompt.query[0])
+        {
+            snprintf (prompt + len, sizeof (prompt) - len, "  no match");
+        }
+        gfx_overlay_print_center(&searchOverlay, config.video_size_y_px - TEXT_Y(2), prompt);
+    }
+    if (editPrompt.active)
+    {
+        char prompt[EDIT_MAX_LINE_LEN + 16];
+
+        sdl_rect.x = 0;
+        sdl_rect.y = config.video_size_y_px - TEXT_Y(3);
+        sdl_rect.w = config.video_size_x_px;
+        sdl_rect.h = TEXT_Y(2);
+        fillRotatedRect(screen, &sdl_rect, background_color);
+        gfx_line_draw (0, sdl_rect.y, config.video_size_x_px, sdl_rect.y);
+
+        formatPrompt(prompt, sizeof(prompt), "Edit", editPrompt.line);
+        gfx_overlay_print_center(&editOverlay, config.video_size_y_px - TEXT_Y(2), prompt);
+    }
+    if (stats.visible)
+    {
+        replayVolatileFrame();
+        getStatsText(s, sizeof(s));
+        gfx_overlay_print(&statsOverlay, ttf_font_small_monospace, 0, config.video_size_y_px - FONT_SMALL_SIZE_Y_PX, s);
+    }
 }
 
-void drawScript(wrappedScript_t * aWrappedScript)
+/**
+ * @brief scaleCoordinate Divide coordinate by factor of resolution, rounding
+ * towards negative infinity, so lines above the screen keep their spacing.
+ */
+static inline Sint16 scaleCoordinate(int aPx, uint8_t aScale)
+{
+    return aPx >= 0 ? aPx / aScale : -((-aPx + aScale - 1) / aScale);
+}
+
+/**
+ * @brief drawScript Draw visible lines of script.
+ *
+ * @param aDst[in,out]          Surface of display size or of 1/aScale of
+ *                              display size, see getScaledSurface().
+ * @param aWrappedScript[in]    Script to draw.
+ * @param aScale[in]            Factor of resolution of aDst.
+ * @param aQuality[in]          Tier of every line of the frame.
+ */
+void drawScript(SDL_Surface * aDst, wrappedScript_t * aWrappedScript, uint8_t aScale, quality_t aQuality)
 {
-    char                * text = NULL;
     SDL_Rect              sdl_rect;
-    SDL_Surface         * sdl_text;
+    const alphaMask_t   * mask;
     linkedList_t        * wrappedScriptList = &( aWrappedScript->wrappedScriptList );
-    TTF_Font            * ttfFont = aWrappedScript->ttf_font;
     linkedListElement_t * linkedListElement = wrappedScriptList->actual;
     config_t            * config = aWrappedScript->config;
-    SDL_Color             sdlTextColor = config->text_color;
     Sint16                y_hide_px = (config->video_size_y_px - aWrappedScript->maxHeightPx) / 2;
-    Sint16                x = (config->video_size_x_px - aWrappedScript->maxWidthPx) / 2;
-    Sint16                y = -(aWrappedScript->heightOffsetPx);
+    /* Size of picture on aDst */
+    Sint16                widthPx = (config->video_size_x_px + aScale - 1) / aScale;
+    Sint16                heightPx = (config->video_size_y_px + aScale - 1) / aScale;
+    /* Text is centered on the screen without the preview panel */
+    Sint16                areaWidthPx = (config->video_size_x_px - getPreviewWidth()) / aScale;
+    Sint16                x = (config->video_size_x_px - getPreviewWidth() - aWrappedScript->maxWidthPx) / 2 / aScale;
+    int                   y = -(aWrappedScript->heightOffsetPx);
     Uint32                background_color;
 
     sdl_rect.x = x;
-    sdl_rect.y = y;
+    sdl_rect.y = scaleCoordinate(y, aScale);
 
     debugprintf("%s start\n", __FUNCTION__);
+    lineCacheNewFrame();
     /* Display lines of script until reaching end of script or end of display */
-    while (linkedListElement && sdl_rect.y < (Sint16)config->video_size_y_px)
+    while (linkedListElement && sdl_rect.y < heightPx)
     {
-        text = (char*)linkedListElement->item;
-        debugprintf("y: %i\t[%s]\n", y, text);
-
-        sdl_text = TTF_RenderUTF8_Blended(ttfFont, text, sdlTextColor);
-        if (sdl_text == NULL)
-        {
-            errorprintf("TTF_RenderUTF8_Blended() Failed: %s\n", TTF_GetError());
-            break;
-        }
+        debugprintf("y: %i\t[%s]\n", y, (char*)linkedListElement->item);
 
-        if (config->align_center)
+        /* Every line of a frame is drawn with the same tier and resolution */
+        mask = getLineMask(aWrappedScript, linkedListElement, aQuality, aScale);
+        if (mask)
         {
-            sdl_rect.x = config->video_size_x_px / 2 - sdl_text->clip_rect.w / 2;
-        }
-
-        sdl_rect.w = sdl_text->clip_rect.w;
-        sdl_rect.h = sdl_text->clip_rect.h;
+            if (config->align_center)
+            {
+                /* Padding of effects is the same on both sides */
+                sdl_rect.x = areaWidthPx / 2 - getMaskWidth(mask) / 2;
+            }
+            else
+            {
+                sdl_rect.x = x - mask->padding;
+            }
 
-        // Apply the text to the display
-        if (SDL_BlitSurface(sdl_text, NULL, screen, &sdl_rect) != 0)
-        {
-            errorprintf("SDL_BlitSurface() Failed: %s\n", SDL_GetError());
+            // Apply the text to the display
+            if (mask->padding)
+            {
+                drawRotatedEffectMask(aDst, sdl_rect.x, sdl_rect.y - mask->padding, mask, config->text_color,
+                                      config->effect_color, config->background_color, getBlendMode(aQuality));
+            }
+            else
+            {
+                drawRotatedAlphaMask(aDst, sdl_rect.x, sdl_rect.y, mask, config->text_color, config->background_color,
+                                     getBlendMode(aQuality));
+            }
         }
 
-        SDL_FreeSurface(sdl_text);
-
         /* Advance to next gfx_line_draw of script */
         y += aWrappedScript->wrappedScriptHeightPx;
-        sdl_rect.y = y;
+        sdl_rect.y = scaleCoordinate(y, aScale);
         linkedListElement = linkedListElement->next;
     }
 
-    background_color = SDL_MapRGB(screen->format, config->background_color.r, config->background_color.g, config->background_color.b);
+    background_color = SDL_MapRGB(aDst->format, config->background_color.r, config->background_color.g, config->background_color.b);
 
     // TODO add fading
     sdl_rect.x = 0;
     sdl_rect.y = 0;
-    sdl_rect.w = config->video_size_x_px;
-    sdl_rect.h = y_hide_px;
-    SDL_FillRect(screen, &sdl_rect, background_color);
+    sdl_rect.w = widthPx;
+    sdl_rect.h = (y_hide_px + aScale - 1) / aScale;
+    fillRotatedRect(aDst, &sdl_rect, background_color);
 
     sdl_rect.x = 0;
-    sdl_rect.y = config->video_size_y_px - y_hide_px;
-    sdl_rect.w = config->video_size_x_px;
-    sdl_rect.h = y_hide_px;
-    SDL_FillRect(screen, &sdl_rect, background_color);
+    sdl_rect.y = (config->video_size_y_px - y_hide_px) / aScale;
+    sdl_rect.w = widthPx;
+    sdl_rect.h = heightPx - sdl_rect.y;
+    fillRotatedRect(aDst, &sdl_rect, background_color);
 
     debugprintf("%s end\n", __FUNCTION__);
 }
 
 void drawScreen (void)
 {
-    // Restore background
-    SDL_BlitSurface(background, NULL, screen, NULL);
+    scriptFrameKey_t key;
+    bool_t           settled;
+
+    /* New thumbnails change the frame */
+    updatePreview(&wrappedScript);
+
+    memset(&key, 0, sizeof(key));
+    key.kind = FRAME_KIND_script;
+    key.state = main_state_machine;
+    key.actual = wrappedScript.wrappedScriptList.actual;
+    key.layoutGeneration = wrappedScript.generation;
+    key.layoutRevision = wrappedScript.revision;
+    key.heightOffsetPx = wrappedScript.heightOffsetPx;
+    key.maxWidthPx = wrappedScript.maxWidthPx;
+    key.maxHeightPx = wrappedScript.maxHeightPx;
+    key.alignCenter = config.align_center;
+    key.textFading = config.text_fading;
+    key.infoTextVisible = isInfoTextVisible();
+    key.infoTextGeneration = infoTextGeneration;
+    key.statsVisible = stats.visible;
+    key.statsGeneration = stats.visible ? stats.generation : 0;
+    key.searchVisible = searchPrompt.active;
+    key.searchGeneration = searchPrompt.generation;
+    key.editVisible = editPrompt.active;
+    key.editGeneration = editPrompt.generation;
+    key.textCursor = textCursor;
+    key.previewVisible = config.show_preview;
+    key.previewGeneration = preview.generation;
+    key.textColor = config.text_color;
+    key.backgroundColor = config.background_color;
+    key.outlinePx = config.outline_px;
+    key.shadowPx = config.shadow_px;
+    key.effectColor = config.effect_color;
+    /* A change of tier or resolution redraws the frame, a still script is upgraded at once. Replay draws with
+     * the tier and resolution of recorded frame. */
+    settled = isScriptSettled(&key);
+    key.quality = (quality_t)replayQuality(settled ? getSettledQuality() : selectQuality());
+    key.scale = replayRenderScale(settled ? getSettledRenderScale() : selectRenderScale());
+    if (!isFrameDue(&key, sizeof(key)))
+    {
+        /* Nothing has changed since last frame */
+        return;
+    }
 
-    drawScript(&wrappedScript);
+    uint64_t         startUs = getTimeUs();
+    uint32_t         frameUs;
+    /* Rasterization of lines and overlays has its own scope, the rest of frame shall not allocate */
+    allocSubsystem_t allocScope = enterAllocScope(ALLOC_SUBSYSTEM_frame);
+    uint8_t          scale = key.scale;
+    SDL_Surface    * scaled = scale > 1 ? getScaledSurface(scale) : NULL;
+
+    if (scaled)
+    {
+        /* Script is composed at reduced resolution and enlarged to the whole screen */
+        SDL_FillRect(scaled, NULL, SDL_MapRGB(scaled->format, config.background_color.r,
+                                              config.background_color.g, config.background_color.b));
+        drawScript(scaled, &wrappedScript, scale, key.quality);
+        upscaleSurface(scaled, screen, scale);
+    }
+    else
+    {
+        // Restore background
+        gfx_blit(background, NULL, screen, NULL);
+        drawScript(screen, &wrappedScript, 1, key.quality);
+    }
+    drawPreview(screen, &wrappedScript);
     printCommon ();
+    frameUs = getTimeUs() - startUs;
+    if (!settled)
+    {
+        /* Frames of a still script do not tell if moving text fits the budget */
+        qualityFrameDone(frameUs);
+        renderScaleFrameDone(frameUs);
+    }
+    replayFrameTime(frameUs);
+    metricsFrameDone(frameUs);
+    allocFrameDone(allocScope);
 
-    SDL_Flip( screen );
+    presentFrame();
 }
 
 /**
@@ -244,18 +746,112 @@ void drawInfoScreen (const char *aFmt, ...)
 {
     static va_list valist;
     char buf[128];
-    int  delayCntr = 500;
 
     va_start (valist, aFmt);
     vsnprintf (buf, sizeof (buf), aFmt, valist);
     va_end (valist);
-    SDL_BlitSurface(background, NULL, screen, NULL);
-    gfx_font_print_center(screen->h / 2, buf);
-    SDL_Flip(screen);
-    while (delayCntr-- && !eventHandler())
+    drawStatusScreen(buf);
+}
+
+/**
+ * @brief drawStatusScreen
+ * Prints message in the center of screen without waiting.
+ * Note: display shall be initialized to use this function!
+ *
+ * @param aMessage[in] Message to print.
+ */
+void drawStatusScreen (const char *aMessage)
+{
+    struct
+    {
+        frameKind_t kind;
+        char        message[128];
+    } key;
+
+    memset(&key, 0, sizeof(key));
+    key.kind = FRAME_KIND_status;
+    strncpy(key.message, aMessage, sizeof(key.message) - 1);
+    if (!isFrameDue(&key, sizeof(key)))
     {
-        SDL_Delay(1);
+        return;
     }
+
+    gfx_blit(background, NULL, screen, NULL);
+    gfx_overlay_print_center(&statusOverlay, config.video_size_y_px / 2, aMessage);
+    presentFrame();
+}
+
+/**
+ * @brief drawProgressScreen
+ * Prints status message and progress bar of loading without waiting.
+ * Reading and wrapping of script are displayed as two halves of the bar.
+ *
+ * @param aProgress[in] Progress of loading.
+ */
+void drawProgressScreen (const loadProgress_t * aProgress)
+{
+    SDL_Rect sdl_rect;
+    Uint32   text_color;
+    char     s[64];
+    Sint16   x1 = config.video_size_x_px / 8;
+    Sint16   x2 = config.video_size_x_px - x1;
+    Sint16   y1 = TEXT_Y_CENTER(0);
+    Sint16   y2 = TEXT_Y_CENTER(1) - FONT_NORMAL_SIZE_Y_PX / 4;
+    uint64_t done = 0;
+
+    if (aProgress->bytesTotal)
+    {
+        done = (uint64_t)(aProgress->bytesRead + aProgress->bytesWrapped) * (x2 - x1)
+                / (2u * aProgress->bytesTotal);
+    }
+
+    struct
+    {
+        frameKind_t    kind;
+        uint64_t       done;
+        loadProgress_t progress;
+    } key;
+
+    memset(&key, 0, sizeof(key));
+    key.kind = FRAME_KIND_progress;
+    key.done = done;
+    /* Counters are shown in KiB and lines, message is compared as a string */
+    strncpy(key.progress.message, aProgress->message, sizeof(key.progress.message) - 1);
+    key.progress.bytesRead = aProgress->bytesRead / 1024;
+    key.progress.bytesTotal = aProgress->bytesTotal / 1024;
+    key.progress.linesWrapped = aProgress->linesWrapped;
+    if (!isFrameDue(&key, sizeof(key)))
+    {
+        return;
+    }
+
+    gfx_blit(background, NULL, screen, NULL);
+    gfx_overlay_print_center(&statusOverlay, TEXT_Y_CENTER(-2), aProgress->message);
+
+    /* Frame of progress bar */
+    gfx_line_draw (x1, y1, x2, y1);
+    gfx_line_draw (x1, y2, x2, y2);
+    gfx_line_draw (x1, y1, x1, y2);
+    gfx_line_draw (x2, y1, x2, y2);
+    /* Filled part of progress bar */
+    text_color = SDL_MapRGB(screen->format, config.text_color.r, config.text_color.g, config.text_color.b);
+    sdl_rect.x = x1;
+    sdl_rect.y = y1;
+    sdl_rect.w = MIN(done, (uint64_t)(x2 - x1));
+    sdl_rect.h = y2 - y1;
+    fillRotatedRect(screen, &sdl_rect, text_color);
+
+    if (aProgress->linesWrapped)
+    {
+        snprintf (s, sizeof (s), "%lu KiB, %llu lines", (unsigned long)(aProgress->bytesTotal / 1024),
+                  (unsigned long long)aProgress->linesWrapped);
+    }
+    else
+    {
+        snprintf (s, sizeof (s), "%lu / %lu KiB", (unsigned long)(aProgress->bytesRead / 1024), (unsigned long)(aProgress->bytesTotal / 1024));
+    }
+    gfx_overlay_print_center(&progressOverlay, TEXT_Y_CENTER(2), s);
+    presentFrame();
 }
 
 /**
@@ -277,84 +873,221 @@ void drawTopInfoScreen (const char *aFmt, ...)
     va_start (valist, aFmt);
     vsnprintf (infoText, sizeof (infoText), aFmt, valist);
     va_end (valist);
-    infoTextTimer = DEFAULT_INFO_TEXT_TIMER;
+    infoTextStartTick = getTicks();
+    infoTextGeneration++;
 }
 
 /**
- * @brief drawHelp
- * Print help text in the center of the screen.
+ * @brief renderHelpSurface
+ * Render background and help text into helpSurface. Text is rasterized only
+ * once, it is drawn again if color or screen has changed.
+ *
+ * @return TRUE: if helpSurface is up to date.
  */
-void drawHelpScreen(void)
+static bool_t renderHelpSurface(void)
 {
-    uint8_t i;
+    uint8_t             i;
+    const alphaMask_t * mask;
+
+    if (helpSurface && helpGeneration == overlayGeneration
+            && helpColor.r == config.text_color.r
+            && helpColor.g == config.text_color.g
+            && helpColor.b == config.text_color.b)
+    {
+        return TRUE;
+    }
+
+    if (helpSurface)
+    {
+        SDL_FreeSurface(helpSurface);
+        helpSurface = NULL;
+    }
+    helpSurface = gfx_display_format(background, FALSE);
+    if (helpSurface == NULL)
+    {
+        return FALSE;
+    }
 
-    SDL_BlitSurface(background, NULL, screen, NULL);
     uint16_t y_center = config.video_size_y_px / FONT_SMALL_SIZE_Y_PX / 2 - (sizeof(helpText) / sizeof(helpText[0]) / 2);
     for (i = 0; i < sizeof(helpText) / sizeof(helpText[0]); i++)
     {
-        gfx_font_small_print_center(TEXT_SMALL_Y(y_center + i), (char*) helpText[i]);
+        mask = gfx_overlay_render(&helpOverlays[i], ttf_font_small_monospace, helpText[i]);
+        if (mask)
+        {
+            drawRotatedAlphaMask(helpSurface, config.video_size_x_px / 2 - getMaskWidth(mask) / 2,
+                                 TEXT_SMALL_Y(y_center + i), mask, config.text_color, config.background_color,
+                                 BLEND_MODE_lut);
+        }
     }
-    SDL_Flip(screen);
+
+    helpGeneration = overlayGeneration;
+    helpColor = config.text_color;
+
+    return TRUE;
 }
 
-#if USE_INTERNAL_SDL_FONT == 0
-void gfx_font_print_center(int y, const char *str)
+/**
+ * @brief drawHelp
+ * Print help text in the center of the screen.
+ */
+void drawHelpScreen(void)
 {
-    SDL_Surface   * sdl_text;
-    SDL_Rect        sdl_rect;
-    SDL_Color       sdlTextColor = config.text_color;
-    int             len = strlen(str);
+    struct
+    {
+        frameKind_t kind;
+        uint32_t    generation;
+    } key;
+    bool_t ok = renderHelpSurface();
 
-    if (len && ttf_font_monospace)
+    memset(&key, 0, sizeof(key));
+    key.kind = FRAME_KIND_help;
+    key.generation = helpGeneration;
+    if (!isFrameDue(&key, sizeof(key)))
     {
-        sdl_text = TTF_RenderUTF8_Blended(ttf_font_monospace, str, sdlTextColor);
-        if (sdl_text == NULL)
-        {
-            errorprintf("TTF_RenderUTF8_Blended() Failed: %s\n", TTF_GetError());
-        }
+        return;
+    }
 
-        sdl_rect.x = screen->w / 2 - len / 2 * FONT_NORMAL_SIZE_X_PX;
-        sdl_rect.y = y;
-        sdl_rect.w = sdl_text->clip_rect.w;
-        sdl_rect.h = sdl_text->clip_rect.h;
+    if (ok)
+    {
+        gfx_blit(helpSurface, NULL, screen, NULL);
+    }
+    presentFrame();
+}
 
-        // Apply the text to the display
-        if (SDL_BlitSurface(sdl_text, NULL, screen, &sdl_rect) != 0)
-        {
-            errorprintf("SDL_BlitSurface() Failed: %s\n", SDL_GetError());
-        }
+/**
+ * @brief gfx_invalidate_overlays
+ * All cached overlays will be rendered again before next use. It shall be
+ * called when display format or fonts are changed.
+ */
+void gfx_invalidate_overlays(void)
+{
+    overlayGeneration++;
+    redrawRequested = TRUE;
+}
 
-        SDL_FreeSurface(sdl_text);
+/**
+ * @brief gfx_free_overlays
+ * Release masks of all cached overlays.
+ */
+void gfx_free_overlays(void)
+{
+    uint8_t i;
+
+    gfx_overlay_free(&infoOverlay);
+    gfx_overlay_free(&statusOverlay);
+    gfx_overlay_free(&progressOverlay);
+    gfx_overlay_free(&statsOverlay);
+    gfx_overlay_free(&searchOverlay);
+    gfx_overlay_free(&editOverlay);
+    for (i = 0; i < sizeof(pausedOverlays) / sizeof(pausedOverlays[0]); i++)
+    {
+        gfx_overlay_free(&pausedOverlays[i]);
+    }
+    for (i = 0; i < sizeof(endOverlays) / sizeof(endOverlays[0]); i++)
+    {
+        gfx_overlay_free(&endOverlays[i]);
+    }
+    for (i = 0; i < sizeof(helpOverlays) / sizeof(helpOverlays[0]); i++)
+    {
+        gfx_overlay_free(&helpOverlays[i]);
+    }
+    if (helpSurface)
+    {
+        SDL_FreeSurface(helpSurface);
+        helpSurface = NULL;
     }
 }
 
-void gfx_font_small_print_center(int y, const char *str)
+#if USE_INTERNAL_SDL_FONT == 0
+/**
+ * @brief gfx_overlay_render Rasterize text into overlay if text or font has
+ * changed since last call.
+ *
+ * @param aOverlay[in,out]  Overlay which stores rasterized text.
+ * @param aFont[in]         Font to use.
+ * @param aText[in]         Text to rasterize.
+ * @return Coverage mask of overlay. NULL: if text is empty or error occurred.
+ */
+const alphaMask_t * gfx_overlay_render(overlay_t * aOverlay, TTF_Font * aFont, const char * aText)
 {
-    SDL_Surface   * sdl_text;
-    SDL_Rect        sdl_rect;
-    SDL_Color       sdlTextColor = config.text_color;
-    int             len = strlen(str);
+    allocSubsystem_t allocScope;
 
-    if (len && ttf_font_small_monospace)
+    if (aOverlay->valid
+            && aOverlay->generation == overlayGeneration
+            && aOverlay->ttf_font == aFont
+            && !strncmp(aOverlay->text, aText, sizeof(aOverlay->text)))
     {
-        sdl_text = TTF_RenderUTF8_Blended(ttf_font_small_monospace, str, sdlTextColor);
-        if (sdl_text == NULL)
-        {
-            errorprintf("TTF_RenderUTF8_Blended() Failed: %s\n", TTF_GetError());
-        }
+        /* Cached mask is up to date */
+        return aOverlay->mask;
+    }
 
-        sdl_rect.x = screen->w / 2 - len / 2 * FONT_SMALL_SIZE_X_PX;
-        sdl_rect.y = y;
-        sdl_rect.w = sdl_text->clip_rect.w;
-        sdl_rect.h = sdl_text->clip_rect.h;
+    allocScope = enterAllocScope(ALLOC_SUBSYSTEM_overlays);
+    gfx_overlay_free(aOverlay);
+    if (aText[0] && aFont)
+    {
+        /* Overlays are stored in orientation of display */
+        aOverlay->mask = rotateAlphaMask(renderText(aFont, getFontAtlas(aFont), aText, FALSE));
+    }
+    leaveAllocScope(allocScope);
+    strncpy(aOverlay->text, aText, sizeof(aOverlay->text) - 1);
+    aOverlay->text[sizeof(aOverlay->text) - 1] = CHR_EOS;
+    aOverlay->ttf_font = aFont;
+    aOverlay->generation = overlayGeneration;
+    aOverlay->valid = TRUE;
 
-        // Apply the text to the display
-        if (SDL_BlitSurface(sdl_text, NULL, screen, &sdl_rect) != 0)
-        {
-            errorprintf("SDL_BlitSurface() Failed: %s\n", SDL_GetError());
-        }
+    return aOverlay->mask;
+}
 
-        SDL_FreeSurface(sdl_text);
+/**
+ * @brief gfx_overlay_print_center Print cached text in the center of screen
+ * using normal monospace font. Text is rendered only if it has changed.
+ *
+ * @param aOverlay[in,out]  Overlay which stores rasterized text.
+ * @param y[in]             Y coordinate of text.
+ * @param str[in]           Text to print.
+ */
+void gfx_overlay_print_center(overlay_t * aOverlay, int y, const char * str)
+{
+    const alphaMask_t * mask;
+    int                 len = strlen(str);
+
+    mask = gfx_overlay_render(aOverlay, ttf_font_monospace, str);
+    if (mask)
+    {
+        drawRotatedAlphaMask(screen, config.video_size_x_px / 2 - len / 2 * FONT_NORMAL_SIZE_X_PX, y, mask,
+                             config.text_color, config.background_color, BLEND_MODE_blend);
     }
 }
+
+/**
+ * @brief gfx_overlay_print Print cached text to the specified position.
+ *
+ * @param aOverlay[in,out]  Overlay which stores rasterized text.
+ * @param aFont[in]         Font to use.
+ * @param x[in]             X coordinate of text.
+ * @param y[in]             Y coordinate of text.
+ * @param str[in]           Text to print.
+ */
+void gfx_overlay_print(overlay_t * aOverlay, TTF_Font * aFont, int x, int y, const char * str)
+{
+    const alphaMask_t * mask;
+
+    mask = gfx_overlay_render(aOverlay, aFont, str);
+    if (mask)
+    {
+        drawRotatedAlphaMask(screen, x, y, mask, config.text_color, config.background_color, BLEND_MODE_blend);
+    }
+}
+
+/**
+ * @brief gfx_overlay_free Release mask of overlay.
+ *
+ * @param aOverlay[in,out]  Overlay to release.
+ */
+void gfx_overlay_free(overlay_t * aOverlay)
+{
+    freeAlphaMask(aOverlay->mask);
+    aOverlay->mask = NULL;
+    aOverlay->valid = FALSE;
+}
 #endif
@@ -14,6 +14,8 @@
 
 #include "common.h"
 #include "linkedlist.h"
+#include "script.h"
+#include "blend.h"
 
 #if USE_INTERNAL_SDL_FONT
 #define FONT_SMALL_SIZE_X_PX    8
@@ -35,22 +37,49 @@ extern int ttf_font_small_size_y;
 #define TEXT_Y_0                (0)
 #define TEXT_X(x)               (TEXT_X_0 + FONT_NORMAL_SIZE_X_PX * (x))
 #define TEXT_Y(y)               (TEXT_Y_0 + (FONT_NORMAL_SIZE_Y_PX) * (y))
-#define TEXT_Y_CENTER(y)        (screen->h / 2 + (FONT_NORMAL_SIZE_Y_PX) * (y))
+#define TEXT_Y_CENTER(y)        (config.video_size_y_px / 2 + (FONT_NORMAL_SIZE_Y_PX) * (y))
 #define TEXT_SMALL_X(x)         (TEXT_X_0 + FONT_SMALL_SIZE_X_PX * (x))
 #define TEXT_SMALL_Y(y)         (TEXT_Y_0 + (FONT_SMALL_SIZE_Y_PX) * (y))
-#define TEXT_SMALL_Y_CENTER(y)  (screen->h / 2 + (FONT_SMALL_SIZE_Y_PX) * (y))
+#define TEXT_SMALL_Y_CENTER(y)  (config.video_size_y_px / 2 + (FONT_SMALL_SIZE_Y_PX) * (y))
+
+#define OVERLAY_TEXT_SIZE       512
+
+/**
+ * Text rasterized once into a coverage mask, it can be drawn with any color.
+ * It is rasterized again only if text or font changes or
+ * gfx_invalidate_overlays() is called.
+ */
+typedef struct
+{
+    alphaMask_t * mask;                     /**< Coverage of text, NULL if text is empty */
+    TTF_Font    * ttf_font;                 /**< Font used to rasterize mask */
+    uint32_t      generation;               /**< Value of overlay generation when mask was rasterized */
+    bool_t        valid;                    /**< TRUE: mask is up to date */
+    char          text[OVERLAY_TEXT_SIZE];  /**< Rendered text */
+} overlay_t;
 
 #if USE_INTERNAL_SDL_FONT
 #define gfx_font_print(x,y,s)                   stringRGBA(screen, x, y, s, config.text_color.r, config.text_color.g, config.text_color.b, 0xFF)
 #define gfx_font_print_fromright(x,y,s)         stringRGBA(screen, x - strlen(s) * FONT_NORMAL_SIZE_X_PX, y, s, config.text_color.r, config.text_color.g, config.text_color.b, 0xFF)
 #define gfx_font_print_center(y,s)              stringRGBA(screen, screen->w / 2 - strlen(s) / 2 * FONT_NORMAL_SIZE_X_PX, y, s, config.text_color.r, config.text_color.g, config.text_color.b, 0xFF)
 #define gfx_font_small_print_center(y,s)        gfx_font_print_center(y,s)
+#define gfx_overlay_print_center(o,y,s)         gfx_font_print_center(y,s)
+#define gfx_overlay_print(o,f,x,y,s)            gfx_font_print(x,y,s)
+#define gfx_overlay_free(o)
 #else
-void gfx_font_print_center(int y, const char * str);
-void gfx_font_small_print_center(int y, const char * str);
+const alphaMask_t * gfx_overlay_render(overlay_t * aOverlay, TTF_Font * aFont, const char * aText);
+void gfx_overlay_print_center(overlay_t * aOverlay, int y, const char * str);
+void gfx_overlay_print(overlay_t * aOverlay, TTF_Font * aFont, int x, int y, const char * str);
+void gfx_overlay_free(overlay_t * aOverlay);
 #endif
+void gfx_invalidate_overlays(void);
+void gfx_request_redraw(void);
+bool_t gfx_blit(SDL_Surface * aSrc, SDL_Rect * aSrcRect, SDL_Surface * aDst, SDL_Rect * aDstRect);
+SDL_Surface * gfx_display_format(SDL_Surface * aSurface, bool_t aAlpha);
+SDL_Surface * gfx_create_surface(uint16_t aWidthPx, uint16_t aHeightPx, bool_t aAlpha);
+void gfx_free_overlays(void);
 
-#define gfx_line_draw(x1, y1, x2, y2)                lineRGBA(screen, x1, y1, x2, y2, config.text_color.r, config.text_color.g, config.text_color.b, 0xFF)
+#define gfx_line_draw(x1, y1, x2, y2)                drawRotatedLine(screen, x1, y1, x2, y2, config.text_color)
 
 extern SDL_Surface* background;
 extern SDL_Surface* alphaSurface;
@@ -59,6 +88,8 @@ extern SDL_Surface* screen;
 void printCommon (void);
 void drawScreen (void);
 void drawInfoScreen (const char *aFmt, ...);
+void drawStatusScreen (const char *aMessage);
+void drawProgressScreen (const loadProgress_t * aProgress);
 void drawTopInfoScreen (const char *aFmt, ...);
 void drawHelpScreen(void);
 
@@ -0,0 +1,189 @@
+/**
+ * @file        latency.c
+ * @brief       Measurement of latency from input to display
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-06 16:40:08
+ * Last modify: 2021-03-06 16:40:08 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * A key press is timestamped when SDL_PollEvent() returns it. It is handled
+ * in the same loop iteration by handleTeleprompterKeys() and
+ * handleMainStateMachine(), then the frame governor decides about the next
+ * frame. The latency of the input ends when SDL_Flip() of the first frame
+ * after it returns. If the governor finds the picture unchanged, the input
+ * had no visible effect and it is not measured.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "stats.h"
+#include "latency.h"
+
+latency_t latency;
+
+/* Upper limits of latency buckets in microseconds, last bucket is +Inf */
+static const uint32_t bucketLimitsUs[LATENCY_BUCKET_COUNT - 1] =
+{
+    4000, 8000, 16667, 33333, 50000, 66667, 100000, 150000, 250000
+};
+
+/**
+ * @brief getLatencyBucketLimitUs Get upper limit of a latency bucket.
+ *
+ * @param aBucket[in] Index of bucket.
+ * @return Upper limit in microseconds, UINT32_MAX for the last bucket.
+ */
+uint32_t getLatencyBucketLimitUs(uint8_t aBucket)
+{
+    return aBucket < LATENCY_BUCKET_COUNT - 1 ? bucketLimitsUs[aBucket] : UINT32_MAX;
+}
+
+/**
+ * @brief latencyInputPolled Timestamp an event returned by SDL_PollEvent().
+ * Only key presses are measured.
+ *
+ * @param aEvent[in] Polled event.
+ */
+void latencyInputPolled(const SDL_Event * aEvent)
+{
+    if (aEvent->type != SDL_KEYDOWN)
+    {
+        return;
+    }
+    if (latency.pendingCount >= LATENCY_MAX_PENDING)
+    {
+        latency.overflowed++;
+        return;
+    }
+    latency.polledUs[latency.pendingCount++] = getTimeUs();
+}
+
+/**
+ * @brief latencyFrameDecided Note decision of frame governor. Inputs are
+ * handled when it is called.
+ *
+ * @param aChanged[in]  TRUE: picture changed since last frame.
+ * @param aDue[in]      TRUE: frame is drawn and presented.
+ */
+void latencyFrameDecided(bool_t aChanged, bool_t aDue)
+{
+    if (!latency.pendingCount)
+    {
+        return;
+    }
+    if (!aChanged)
+    {
+        /* Inputs did not change what is on display */
+        latency.unchanged += latency.pendingCount;
+        latency.pendingCount = 0;
+        latency.decidedUs = 0;
+    }
+    else if (aDue && !latency.decidedUs)
+    {
+        latency.decidedUs = getTimeUs();
+    }
+}
+
+/**
+ * @brief latencyFramePresented Measure inputs shown by the frame, it shall
+ * be called when SDL_Flip() has returned.
+ */
+void latencyFramePresented(void)
+{
+    uint64_t now;
+    uint32_t us;
+    uint8_t  i;
+    uint8_t  bucket;
+
+    if (!latency.pendingCount || !latency.decidedUs)
+    {
+        return;
+    }
+
+    now = getTimeUs();
+    for (i = 0; i < latency.pendingCount; i++)
+    {
+        us = (uint32_t)(now - latency.polledUs[i]);
+        for (bucket = 0; bucket < LATENCY_BUCKET_COUNT - 1 && us > bucketLimitsUs[bucket]; bucket++)
+        {
+        }
+        latency.buckets[bucket]++;
+        latency.count++;
+        latency.totalUs += us;
+        latency.handleUsTotal += latency.decidedUs - latency.polledUs[i];
+        latency.maxUs = MAX(latency.maxUs, us);
+        latency.lastUs = us;
+    }
+    latency.pendingCount = 0;
+    latency.decidedUs = 0;
+}
+
+/**
+ * @brief getPercentileUs Get upper limit of bucket which contains a
+ * percentile of latencies.
+ */
+static uint32_t getPercentileUs(uint8_t aPercent)
+{
+    uint64_t cumulative = 0;
+    uint8_t  i;
+
+    for (i = 0; i < LATENCY_BUCKET_COUNT - 1; i++)
+    {
+        cumulative += latency.buckets[i];
+        if (cumulative * 100u >= latency.count * aPercent)
+        {
+            return bucketLimitsUs[i];
+        }
+    }
+
+    return latency.maxUs;
+}
+
+/**
+ * @brief printLatencyStats Print latency histogram to console.
+ */
+void printLatencyStats(void)
+{
+    uint8_t i;
+
+    printf("Input latency:                    %llu inputs", (unsigned long long)latency.count);
+    if (latency.count)
+    {
+        printf(", %llu us average, %u us maximum, p50 <= %u us, p95 <= %u us, p99 <= %u us",
+               (unsigned long long)(latency.totalUs / latency.count), latency.maxUs,
+               getPercentileUs(50), getPercentileUs(95), getPercentileUs(99));
+    }
+    printf("\n");
+    if (latency.count)
+    {
+        printf("Input handling/drawing:           %llu / %llu us average\n",
+               (unsigned long long)(latency.handleUsTotal / latency.count),
+               (unsigned long long)((latency.totalUs - latency.handleUsTotal) / latency.count));
+        printf("Input latency histogram:         ");
+        for (i = 0; i < LATENCY_BUCKET_COUNT; i++)
+        {
+            if (i < LATENCY_BUCKET_COUNT - 1)
+            {
+                printf(" <=%uus: %llu", bucketLimitsUs[i], (unsigned long long)latency.buckets[i]);
+            }
+            else
+            {
+                printf(" more: %llu", (unsigned long long)latency.buckets[i]);
+            }
+        }
+        printf("\n");
+    }
+    printf("Inputs without visible change:    %llu", (unsigned long long)latency.unchanged);
+    if (latency.overflowed)
+    {
+        printf(", %llu not measured", (unsigned long long)latency.overflowed);
+    }
+    printf("\n");
+}
@@ -0,0 +1,47 @@
+/**
+ * @file        latency.h
+ * @brief       Measurement of latency from input to display
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-06 16:40:08
+ * Last modify: 2021-03-06 16:40:08 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_LATENCY_H
+#define INCLUDE_LATENCY_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+
+#define LATENCY_BUCKET_COUNT        10      /* Buckets of latency histogram, last one is +Inf */
+#define LATENCY_MAX_PENDING         32      /* Inputs waiting for a frame */
+
+typedef struct
+{
+    uint64_t    polledUs[LATENCY_MAX_PENDING];  /* Time of polling inputs which are not yet on display */
+    uint8_t     pendingCount;
+    uint64_t    decidedUs;                  /* Time when frame governor accepted a frame after inputs, 0: not yet */
+    /* Statistics */
+    uint64_t    buckets[LATENCY_BUCKET_COUNT];  /* Count of inputs per bucket, not cumulative */
+    uint64_t    count;                      /* Inputs reached display */
+    uint64_t    totalUs;                    /* Sum of latencies */
+    uint64_t    handleUsTotal;              /* Sum of time from polling to accepted frame */
+    uint32_t    maxUs;
+    uint32_t    lastUs;
+    uint64_t    unchanged;                  /* Inputs which did not change the picture */
+    uint64_t    overflowed;                 /* Inputs not measured because too many were pending */
+} latency_t;
+
+extern latency_t latency;
+
+uint32_t getLatencyBucketLimitUs(uint8_t aBucket);
+void latencyInputPolled(const SDL_Event * aEvent);
+void latencyFrameDecided(bool_t aChanged, bool_t aDue);
+void latencyFramePresented(void);
+void printLatencyStats(void);
+
+#endif /* INCLUDE_LATENCY_H */
@@ -0,0 +1,270 @@
+/**
+ * @file        linecache.c
+ * @brief       Cache of rendered lines of script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-24 20:05:11
+ * Last modify: 2021-02-24 20:05:11 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Lines are rasterized to coverage masks when they appear on the screen and
+ * kept until they are evicted. Masks do not depend on colors or display
+ * format. A line rasterized by the solid tier is rasterized again when
+ * quality is raised, but at most one line per frame. Outline and shadow are
+ * calculated with the mask, so they cost nothing while scrolling. Lines of
+ * frames composed at reduced resolution are cached at that resolution.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "blend.h"
+#include "effect.h"
+#include "atlas.h"
+#include "rotate.h"
+#include "quality.h"
+#include "scale.h"
+#include "alloctrack.h"
+#include "linecache.h"
+
+lineCache_t lineCache;
+
+/**
+ * @brief freeEntry Release mask of cache entry.
+ */
+static void freeEntry(lineCacheEntry_t * aEntry)
+{
+    if (aEntry->mask)
+    {
+        lineCache.bytes -= aEntry->mask->w * aEntry->mask->h;
+        freeAlphaMask(aEntry->mask);
+        aEntry->mask = NULL;
+    }
+    aEntry->element = NULL;
+}
+
+/**
+ * @brief scaleEffectPx Get size of effect at reduced resolution. An effect
+ * does not disappear, it is at least a pixel.
+ */
+static uint8_t scaleEffectPx(uint8_t aPx, uint8_t aScale)
+{
+    uint8_t px = (aPx + aScale / 2) / aScale;
+
+    return aPx ? MAX(px, 1) : 0;
+}
+
+/**
+ * @brief renderLine Rasterize a line to coverage mask.
+ *
+ * @param aFont[in]     Font to use.
+ * @param aAtlas[in]    Pre-rasterized glyphs of font, NULL if font is not in atlas.
+ * @param aText[in]     Text of line.
+ * @param aBinary[in]   TRUE: not anti-aliased (solid tier), FALSE: anti-aliased.
+ * @param aOutlinePx[in] Width of outline, 0: no outline.
+ * @param aShadowPx[in] Offset of shadow, 0: no shadow.
+ * @param aScale[in]    Mask is reduced to 1/scale of resolution, 1: full resolution.
+ * @return Coverage mask or NULL if line is empty or error occurred.
+ */
+static alphaMask_t * renderLine(TTF_Font * aFont, const atlasFont_t * aAtlas, const char * aText, bool_t aBinary,
+                                uint8_t aOutlinePx, uint8_t aShadowPx, uint8_t aScale)
+{
+    alphaMask_t    * mask;
+    alphaMask_t    * effectMask;
+    allocSubsystem_t allocScope;
+
+    if (aText[0] == CHR_EOS)
+    {
+        /* Nothing to render */
+        return NULL;
+    }
+
+    allocScope = enterAllocScope(ALLOC_SUBSYSTEM_lines);
+    mask = renderText(aFont, aAtlas, aText, aBinary);
+    /* Coverage is reduced before effects, tones of effect mask cannot be averaged */
+    mask = downscaleAlphaMask(mask, aScale, aBinary);
+
+    if (mask && (aOutlinePx || aShadowPx))
+    {
+        effectMask = createEffectMask(mask, scaleEffectPx(aOutlinePx, aScale), scaleEffectPx(aShadowPx, aScale));
+        if (effectMask)
+        {
+            freeAlphaMask(mask);
+            mask = effectMask;
+        }
+    }
+
+    /* Lines are stored in orientation of display, effects are already applied upright */
+    mask = rotateAlphaMask(mask);
+    leaveAllocScope(allocScope);
+
+    return mask;
+}
+
+/**
+ * @brief getVictim Find a free entry or the least recently used one.
+ */
+static lineCacheEntry_t * getVictim(void)
+{
+    lineCacheEntry_t * victim = &lineCache.entries[0];
+    uint16_t           i;
+
+    for (i = 0; i < LINE_CACHE_SIZE && victim->element; i++)
+    {
+        if (!lineCache.entries[i].element || lineCache.entries[i].lastUse < victim->lastUse)
+        {
+            victim = &lineCache.entries[i];
+        }
+    }
+
+    return victim;
+}
+
+/**
+ * @brief lineCacheNewFrame Start a new frame. Lines used in actual frame
+ * are not evicted during the frame.
+ */
+void lineCacheNewFrame(void)
+{
+    lineCache.frame++;
+    lineCache.upgraded = FALSE;
+}
+
+/**
+ * @brief getLineMask Get coverage mask of line from cache or rasterize it.
+ *
+ * @param aWrappedScript[in]    Wrapped script which contains the line.
+ * @param aElement[in]          Line of script.
+ * @param aQuality[in]          Tier of actual frame.
+ * @param aScale[in]            Frame is composed at 1/scale of resolution.
+ * @return Coverage mask or NULL if line is empty. Mask with padding has
+ * outline or shadow, see drawEffectMask().
+ */
+const alphaMask_t * getLineMask(wrappedScript_t * aWrappedScript, linkedListElement_t * aElement, quality_t aQuality,
+                                uint8_t aScale)
+{
+    lineCacheEntry_t * entry = NULL;
+    bool_t             binary = (aQuality == QUALITY_solid);
+    uint8_t            outlinePx = aWrappedScript->config->outline_px;
+    uint8_t            shadowPx = aWrappedScript->config->shadow_px;
+    uint16_t           i;
+
+    for (i = 0; i < LINE_CACHE_SIZE && !entry; i++)
+    {
+        if (lineCache.entries[i].element == aElement
+                && lineCache.entries[i].layoutGeneration == aWrappedScript->generation
+                && lineCache.entries[i].scale == aScale
+                && lineCache.entries[i].outlinePx == outlinePx
+                && lineCache.entries[i].shadowPx == shadowPx)
+        {
+            entry = &lineCache.entries[i];
+        }
+    }
+
+    if (entry && entry->binary && !binary && !lineCache.upgraded)
+    {
+        /* Quality raised: rasterize line again, only one line per frame */
+        lineCache.upgraded = TRUE;
+        freeEntry(entry);
+        entry = NULL;
+    }
+
+    if (entry)
+    {
+        lineCache.hits++;
+    }
+    else
+    {
+        lineCache.misses++;
+        entry = getVictim();
+        freeEntry(entry);
+        entry->lastUse = lineCache.frame;
+        entry->mask = renderLine(aWrappedScript->ttf_font, aWrappedScript->atlas, (const char *)aElement->item, binary,
+                                 outlinePx, shadowPx, aScale);
+        entry->element = aElement;
+        entry->layoutGeneration = aWrappedScript->generation;
+        entry->binary = binary;
+        entry->scale = aScale;
+        entry->outlinePx = outlinePx;
+        entry->shadowPx = shadowPx;
+        if (entry->mask)
+        {
+            lineCache.bytes += entry->mask->w * entry->mask->h;
+        }
+
+        /* Drop least recently used lines of previous frames if too much memory is used */
+        while (lineCache.bytes > LINE_CACHE_MAX_BYTES)
+        {
+            lineCacheEntry_t * victim = NULL;
+            for (i = 0; i < LINE_CACHE_SIZE; i++)
+            {
+                if (lineCache.entries[i].mask && lineCache.entries[i].lastUse != lineCache.frame
+                        && (!victim || lineCache.entries[i].lastUse < victim->lastUse))
+                {
+                    victim = &lineCache.entries[i];
+                }
+            }
+            if (!victim)
+            {
+                break;
+            }
+            freeEntry(victim);
+        }
+    }
+    entry->lastUse = lineCache.frame;
+
+    return entry->mask;
+}
+
+/**
+ * @brief invalidateLineCache Release all cached lines. It shall be called
+ * if screen is reinitialized.
+ */
+void invalidateLineCache(void)
+{
+    uint16_t i;
+
+    for (i = 0; i < LINE_CACHE_SIZE; i++)
+    {
+        freeEntry(&lineCache.entries[i]);
+    }
+}
+
+/**
+ * @brief invalidateLineMasks Release cached masks of lines which were
+ * replaced, their memory can be reused by other lines.
+ *
+ * @param aReleased[in] Released lines linked by their next pointer.
+ */
+void invalidateLineMasks(const linkedListElement_t * aReleased)
+{
+    const linkedListElement_t * element;
+    uint16_t                    i;
+
+    for (element = aReleased; element; element = element->next)
+    {
+        for (i = 0; i < LINE_CACHE_SIZE; i++)
+        {
+            if (lineCache.entries[i].element == element)
+            {
+                freeEntry(&lineCache.entries[i]);
+            }
+        }
+    }
+}
+
+/**
+ * @brief freeLineCache Release all cached lines.
+ */
+void freeLineCache(void)
+{
+    invalidateLineCache();
+}
@@ -0,0 +1,59 @@
+/**
+ * @file        linecache.h
+ * @brief       Cache of rendered lines of script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-24 20:05:11
+ * Last modify: 2021-02-24 20:05:11 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_LINECACHE_H
+#define INCLUDE_LINECACHE_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "quality.h"
+#include "blend.h"
+
+#define LINE_CACHE_SIZE             256                 /* Maximum count of cached lines */
+#define LINE_CACHE_MAX_BYTES        (8 * 1024 * 1024)   /* Maximum memory of cached lines, one byte per pixel */
+
+typedef struct
+{
+    linkedListElement_t * element;          /* Line of script, NULL if entry is free */
+    uint32_t              layoutGeneration; /* Generation of wrapped script */
+    bool_t                binary;           /* TRUE: rasterized without anti-aliasing by solid tier */
+    uint8_t               scale;            /* Mask is rendered at 1/scale of resolution */
+    uint8_t               outlinePx;        /* Width of outline in mask */
+    uint8_t               shadowPx;         /* Offset of shadow in mask */
+    alphaMask_t         * mask;             /* Coverage of line with its effects, NULL for empty line */
+    uint32_t              lastUse;          /* Frame of last use */
+} lineCacheEntry_t;
+
+typedef struct
+{
+    lineCacheEntry_t      entries[LINE_CACHE_SIZE];
+    uint32_t              frame;            /* Counter of frames, see lineCacheNewFrame() */
+    size_t                bytes;            /* Memory used by masks */
+    bool_t                upgraded;         /* TRUE: a line was upgraded in this frame */
+    /* Statistics */
+    uint64_t              hits;
+    uint64_t              misses;
+} lineCache_t;
+
+extern lineCache_t lineCache;
+
+void lineCacheNewFrame(void);
+const alphaMask_t * getLineMask(wrappedScript_t * aWrappedScript, linkedListElement_t * aElement, quality_t aQuality,
+                                uint8_t aScale);
+void invalidateLineCache(void);
+void invalidateLineMasks(const linkedListElement_t * aReleased);
+void freeLineCache(void);
+
+#endif /* INCLUDE_LINECACHE_H */
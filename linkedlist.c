@@ -76,6 +76,18 @@ void freeLinkedList (linkedList_t* aLinkedList)
     {
         linkedList = freeElement (linkedList);
     }
+    resetLinkedList (aLinkedList);
+}
+
+/**
+ * @brief resetLinkedList
+ * Make linked list empty without releasing elements. It is used when
+ * elements are allocated from an arena.
+ *
+ * @param aLinkedList
+ */
+void resetLinkedList (linkedList_t* aLinkedList)
+{
     aLinkedList->first = NULL;
     aLinkedList->last = NULL;
     aLinkedList->actual = NULL;
@@ -83,41 +95,194 @@ void freeLinkedList (linkedList_t* aLinkedList)
     aLinkedList->it_prev = NULL;
 }
 
+/**
+ * @brief fillScriptLine Copy script text into a line and add the line to the
+ * end of linked list.
+ *
+ * @param aLine[out]        Memory of line, it is big enough for the text.
+ * @param aText[in]         Text to copy, it does not need to be terminated.
+ * @param aLen[in]          Length of text.
+ * @param aOffset[in]       Offset of text in script buffer.
+ * @param aColumn[in]       Offset of text in its paragraph, LINE_COLUMN_NONE: not text of script.
+ * @param aLinkedList[out]  Line will be added to this linked list.
+ */
+static void fillScriptLine(scriptLine_t * aLine, const char * aText, size_t aLen, size_t aOffset, size_t aColumn,
+                           linkedList_t * aLinkedList)
+{
+    linkedListElement_t * element = &aLine->element;
+    char * item = (char *)(aLine + 1);
+    size_t i;
+
+    aLine->offset = aOffset;
+    aLine->column = aColumn;
+    for (i = 0; i < aLen; i++)
+    {
+        item[i] = IS_WHITESPACE(aText[i]) ? CHR_SPACE : aText[i];
+    }
+    item[aLen] = CHR_EOS;
+    element->item = item;
+    element->next = NULL;
+    element->prev = aLinkedList->it_prev;
+
+    (*aLinkedList->it) = element;
+    aLinkedList->last = element;
+    aLinkedList->it_prev = element;
+    aLinkedList->it = &(element->next);
+}
+
 /**
  * @brief addScriptElement Allocate and add script text to linked list
+ * Element and text are allocated together from the arena, so they are
+ * released by arenaReset() and not by freeLinkedList(). White spaces are
+ * replaced with spaces in the copy, script buffer is not changed.
  *
  * @param aText[in]         Text to add (it will be copied, so it can be released).
+ * @param aLen[in]          Length of text, it does not need to be terminated.
+ * @param aOffset[in]       Offset of text in script buffer.
+ * @param aColumn[in]       Offset of text in its paragraph, LINE_COLUMN_NONE: not text of script.
  * @param aLinkedList[out]  Text will be added to this linked list.
+ * @param aArena[in,out]    Memory of element and text is allocated from here.
  * @return TRUE: if allocation succeeded.
  */
-bool_t addScriptElement(char * aText, linkedList_t * aLinkedList)
+bool_t addScriptElement(const char * aText, size_t aLen, size_t aOffset, size_t aColumn,
+                        linkedList_t * aLinkedList, arena_t * aArena)
 {
     bool_t ok = TRUE;
-    size_t len = strlen(aText);
-    char * linkedListText = malloc(len + 1); // +1 due to end of string
+    scriptLine_t * line;
 
-    if (linkedListText)
+    line = arenaAlloc(aArena, sizeof(scriptLine_t) + aLen + 1); // +1 due to end of string
+    if (line)
     {
-        strncpy(linkedListText, aText, len + 1);
-
-        (*aLinkedList->it) = allocElement (linkedListText, NULL, aLinkedList->it_prev);
-        if (*aLinkedList->it)
-        {
-            aLinkedList->last = *(aLinkedList->it);
-            aLinkedList->it_prev = *(aLinkedList->it);
-            aLinkedList->it = &((*(aLinkedList->it))->next);
-        }
-        else
-        {
-            errorprintf("Cannot allocate memory for list element!\n");
-            ok = FALSE;
-        }
+        fillScriptLine(line, aText, aLen, aOffset, aColumn, aLinkedList);
     }
     else
     {
-        errorprintf("Cannot allocate memory for text!\n");
+        errorprintf("Cannot allocate memory for list element!\n");
         ok = FALSE;
     }
 
     return ok;
 }
+
+/**
+ * @brief addReleasedScriptElement Add script text to linked list like
+ * addScriptElement(), but memory of a released line is reused if it is big
+ * enough.
+ *
+ * @param aText[in]         Text to add (it will be copied, so it can be released).
+ * @param aLen[in]          Length of text, it does not need to be terminated.
+ * @param aOffset[in]       Offset of text in script buffer.
+ * @param aColumn[in]       Offset of text in its paragraph, LINE_COLUMN_NONE: not text of script.
+ * @param aReleased[in,out] Lines released by releaseScriptElement(), reused one is removed.
+ * @param aLinkedList[out]  Text will be added to this linked list.
+ * @param aArena[in,out]    Memory is allocated from here if no released line is big enough.
+ * @return TRUE: if allocation succeeded.
+ */
+bool_t addReleasedScriptElement(const char * aText, size_t aLen, size_t aOffset, size_t aColumn,
+                                linkedListElement_t ** aReleased, linkedList_t * aLinkedList, arena_t * aArena)
+{
+    linkedListElement_t ** released;
+    scriptLine_t         * line;
+
+    for (released = aReleased; *released; released = &(*released)->next)
+    {
+        /* Offset of released line is its capacity */
+        if (getScriptElementOffset(*released) >= aLen)
+        {
+            line = (scriptLine_t *)*released;
+            *released = line->element.next;
+            fillScriptLine(line, aText, aLen, aOffset, aColumn, aLinkedList);
+            return TRUE;
+        }
+    }
+
+    return addScriptElement(aText, aLen, aOffset, aColumn, aLinkedList, aArena);
+}
+
+/**
+ * @brief releaseScriptElement Put a line which is no longer in the list to
+ * released lines, so its memory can be reused by addReleasedScriptElement().
+ *
+ * @param aReleased[in,out] Released lines linked by their next pointer.
+ * @param aElement[in]      Element added by addScriptElement().
+ */
+void releaseScriptElement(linkedListElement_t ** aReleased, linkedListElement_t * aElement)
+{
+    scriptLine_t * line = (scriptLine_t *)aElement;
+    size_t         size = sizeof(scriptLine_t) + strlen(aElement->item) + 1;
+
+    /* Arena rounds up every allocation, the padding can be used as well */
+    size = (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    line->offset = size - sizeof(scriptLine_t) - 1;
+    line->column = LINE_COLUMN_NONE;
+    aElement->prev = NULL;
+    aElement->next = *aReleased;
+    *aReleased = aElement;
+}
+
+/**
+ * @brief getScriptElementOffset Get offset of line in script buffer.
+ *
+ * @param aElement[in]  Element added by addScriptElement().
+ * @return Offset of first character of line.
+ */
+size_t getScriptElementOffset(const linkedListElement_t * aElement)
+{
+    return ((const scriptLine_t *)aElement)->offset;
+}
+
+/**
+ * @brief getScriptElementColumn Get offset of line in its paragraph.
+ *
+ * @param aElement[in]  Element added by addScriptElement().
+ * @return Offset of first character of line from start of paragraph,
+ *         LINE_COLUMN_NONE if line is not text of script.
+ */
+size_t getScriptElementColumn(const linkedListElement_t * aElement)
+{
+    return ((const scriptLine_t *)aElement)->column;
+}
+
+/**
+ * @brief setScriptElementOffset Change offset of line in script buffer.
+ *
+ * @param aElement[in,out]  Element added by addScriptElement().
+ * @param aOffset[in]       Offset of first character of line.
+ */
+void setScriptElementOffset(linkedListElement_t * aElement, size_t aOffset)
+{
+    ((scriptLine_t *)aElement)->offset = aOffset;
+}
+
+/**
+ * @brief setScriptElementColumn Change offset of line in its paragraph.
+ *
+ * @param aElement[in,out]  Element added by addScriptElement().
+ * @param aColumn[in]       Offset of first character of line from start of paragraph.
+ */
+void setScriptElementColumn(linkedListElement_t * aElement, size_t aColumn)
+{
+    ((scriptLine_t *)aElement)->column = aColumn;
+}
+
+/**
+ * @brief appendLinkedList Move all elements of a linked list to the end of
+ * another one.
+ *
+ * @param aLinkedList[in,out]   Destination list.
+ * @param aSource[in,out]       Source list, it is empty after the call.
+ */
+void appendLinkedList(linkedList_t * aLinkedList, linkedList_t * aSource)
+{
+    if (aSource->first == NULL)
+    {
+        return;
+    }
+
+    aSource->first->prev = aLinkedList->last;
+    (*aLinkedList->it) = aSource->first;
+    aLinkedList->last = aSource->last;
+    aLinkedList->it_prev = aSource->last;
+    aLinkedList->it = &(aSource->last->next);
+    resetLinkedList(aSource);
+}
@@ -14,6 +14,7 @@
 #include <stdint.h>
 
 #include "common.h"
+#include "arena.h"
 
 typedef struct linkedListElement_tag
 {
@@ -31,10 +32,30 @@ typedef struct
     linkedListElement_t* it_prev;   /**< List previous element. Used to build list. */
 } linkedList_t;
 
+/* Line of wrapped script, element, offset and text are allocated together */
+typedef struct
+{
+    linkedListElement_t element;            /* Element in list of lines, item points after this structure */
+    size_t              offset;             /* Offset of first character of line in script buffer */
+    size_t              column;             /* Offset of line in its paragraph, LINE_COLUMN_NONE: not text of script */
+} scriptLine_t;
+
+#define LINE_COLUMN_NONE            SIZE_MAX    /* Column of countdown and separator lines */
+
 linkedListElement_t* allocElement (void* aItem, linkedListElement_t* aNext, linkedListElement_t* aPrev);
 linkedListElement_t* freeElement (linkedListElement_t* aLinkedList);
 void freeLinkedList (linkedList_t* aLinkedList);
-bool_t addScriptElement(char * aText, linkedList_t * aLinkedList);
+void resetLinkedList (linkedList_t* aLinkedList);
+bool_t addScriptElement(const char * aText, size_t aLen, size_t aOffset, size_t aColumn,
+                        linkedList_t * aLinkedList, arena_t * aArena);
+bool_t addReleasedScriptElement(const char * aText, size_t aLen, size_t aOffset, size_t aColumn,
+                                linkedListElement_t ** aReleased, linkedList_t * aLinkedList, arena_t * aArena);
+void releaseScriptElement(linkedListElement_t ** aReleased, linkedListElement_t * aElement);
+size_t getScriptElementOffset(const linkedListElement_t * aElement);
+size_t getScriptElementColumn(const linkedListElement_t * aElement);
+void setScriptElementOffset(linkedListElement_t * aElement, size_t aOffset);
+void setScriptElementColumn(linkedListElement_t * aElement, size_t aColumn);
+void appendLinkedList(linkedList_t * aLinkedList, linkedList_t * aSource);
 
 #endif /* INCLUDE_COMMON_H */
 
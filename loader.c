@@ -0,0 +1,303 @@
+/**
+ * @file        loader.c
+ * @brief       Background loading of font and script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-20 10:12:31
+ * Last modify: 2021-02-20 10:12:31 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_ttf.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "search.h"
+#include "alloctrack.h"
+#include "preview.h"
+#include "loader.h"
+
+/**
+ * @brief setLoaderState Change state of loader. It can be called from any thread.
+ */
+static void setLoaderState(loader_t * aLoader, loaderState_t aState)
+{
+    SDL_mutexP(aLoader->status.mutex);
+    aLoader->state = aState;
+    SDL_mutexV(aLoader->status.mutex);
+}
+
+/**
+ * @brief freeLoaderResult Release font, script, wrapped script and search
+ * index of loader.
+ */
+static void freeLoaderResult(loader_t * aLoader)
+{
+    freeSearchIndex(&aLoader->searchIndex);
+    if (aLoader->scriptBuffer)
+    {
+        free(aLoader->scriptBuffer);
+        aLoader->scriptBuffer = NULL;
+    }
+    freeWrappedScript(&aLoader->wrappedScript);
+}
+
+/**
+ * @brief loaderThread Load font and script, then wrap and index script. It
+ * runs in separate thread, so it shall not use the screen.
+ *
+ * @param aParam Pointer to loader.
+ * @return 0: if successfully loaded.
+ */
+static int loaderThread(void * aParam)
+{
+    loader_t * loader = (loader_t *) aParam;
+    bool_t     ok;
+
+    enterAllocScope(ALLOC_SUBSYSTEM_script);
+    setLoadStatus(&loader->status, "Loading font...");
+    ok = loadFont(loader->ttfFilePath, loader->ttfSize, &loader->wrappedScript);
+    if (ok)
+    {
+        ok = loadScript(loader->scriptFilePath, &loader->scriptBuffer, &loader->status);
+    }
+    else
+    {
+        setLoadStatus(&loader->status, "ERROR: Cannot load font!");
+    }
+    if (ok)
+    {
+        ok = wrapScript(loader->scriptBuffer, loader->maxWidthPx, loader->maxHeightPx,
+                        &loader->wrappedScript, &loader->status);
+    }
+    if (ok)
+    {
+        /* Script can be shown without search index */
+        buildSearchIndex(&loader->searchIndex, loader->scriptBuffer, &loader->status);
+        setLoadStatus(&loader->status, "Script loaded.");
+    }
+
+    setLoaderState(loader, ok ? LOADER_STATE_done : LOADER_STATE_error);
+
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief loaderInit Initialize loader.
+ *
+ * @param aLoader[out]  Loader to initialize.
+ * @return TRUE: if successfully initialized.
+ */
+bool_t loaderInit(loader_t * aLoader)
+{
+    memset(aLoader, 0, sizeof(*aLoader));
+    aLoader->state = LOADER_STATE_idle;
+    aLoader->wrappedScript.wrappedScriptList.it = &aLoader->wrappedScript.wrappedScriptList.first;
+
+    return initLoadStatus(&aLoader->status);
+}
+
+/**
+ * @brief loaderStart Start loading font and script in background.
+ * Parameters are copied from the configuration, so it can be changed
+ * during loading.
+ *
+ * @param aLoader[in,out]   Loader to start. It shall be in idle state.
+ * @param aConfig[in]       Configuration to use.
+ * @param aScriptFilePath[in] Script to load, it is not necessarily the
+ *                          script of configuration.
+ * @return TRUE: if loader thread started.
+ */
+bool_t loaderStart(loader_t * aLoader, config_t * aConfig, const char * aScriptFilePath)
+{
+    bool_t ok = FALSE;
+
+    if (aLoader->state == LOADER_STATE_idle && !aLoader->thread)
+    {
+        freeLoaderResult(aLoader);
+        strncpy(aLoader->scriptFilePath, aScriptFilePath, sizeof(aLoader->scriptFilePath) - 1);
+        strncpy(aLoader->ttfFilePath, aConfig->ttf_file_path, sizeof(aLoader->ttfFilePath) - 1);
+        aLoader->ttfSize = aConfig->ttf_size;
+        aLoader->maxWidthPx = getWrapWidth(aConfig);
+        aLoader->maxHeightPx = (float)aConfig->video_size_y_px * aConfig->text_height_percent / 100.0f;
+        aLoader->wrappedScript.config = aConfig;
+        SDL_mutexP(aLoader->status.mutex);
+        memset(&aLoader->status.progress, 0, sizeof(aLoader->status.progress));
+        aLoader->status.cancel = FALSE;
+        SDL_mutexV(aLoader->status.mutex);
+        setLoadStatus(&aLoader->status, "Loading script...");
+        setLoaderState(aLoader, LOADER_STATE_busy);
+        aLoader->runs++;
+
+        verboseprintf("Starting loader thread... ");
+        aLoader->thread = SDL_CreateThread(loaderThread, aLoader);
+        if (aLoader->thread)
+        {
+            verboseprintf("Done.\n");
+            ok = TRUE;
+        }
+        else
+        {
+            errorprintf("SDL_CreateThread() Failed: %s\n", SDL_GetError());
+            setLoadStatus(&aLoader->status, "ERROR: Cannot start loader!");
+            setLoaderState(aLoader, LOADER_STATE_error);
+        }
+    }
+    else
+    {
+        errorprintf("Loader is already started!\n");
+    }
+
+    return ok;
+}
+
+/**
+ * @brief loaderGetState Get state of loader without blocking.
+ *
+ * @param aLoader[in]   Loader.
+ * @return Actual state of loader.
+ */
+loaderState_t loaderGetState(loader_t * aLoader)
+{
+    loaderState_t state;
+
+    SDL_mutexP(aLoader->status.mutex);
+    state = aLoader->state;
+    SDL_mutexV(aLoader->status.mutex);
+
+    return state;
+}
+
+/**
+ * @brief loaderIsCurrent Check if loader prepares the script with the actual
+ * font and text area. Result of loader is useless if font or size of text
+ * area was changed since it was started.
+ *
+ * @param aLoader[in]       Loader.
+ * @param aConfig[in]       Actual configuration.
+ * @param aScriptFilePath[in] Script which is expected.
+ * @return TRUE: if parameters of loader match.
+ */
+bool_t loaderIsCurrent(loader_t * aLoader, config_t * aConfig, const char * aScriptFilePath)
+{
+    return !strcmp(aLoader->scriptFilePath, aScriptFilePath)
+        && !strcmp(aLoader->ttfFilePath, aConfig->ttf_file_path)
+        && aLoader->ttfSize == aConfig->ttf_size
+        && aLoader->maxWidthPx == getWrapWidth(aConfig)
+        && aLoader->maxHeightPx == (uint16_t)((float)aConfig->video_size_y_px * aConfig->text_height_percent / 100.0f);
+}
+
+/**
+ * @brief loaderCancel Request loader to stop. It does not wait for loader
+ * thread, loader goes to error state soon.
+ *
+ * @param aLoader[in,out]   Loader to cancel.
+ */
+void loaderCancel(loader_t * aLoader)
+{
+    if (aLoader->thread)
+    {
+        verboseprintf("Cancelling loader...\n");
+        cancelLoad(&aLoader->status);
+    }
+}
+
+/**
+ * @brief loaderTake Take result of finished loader. Previous font, script,
+ * wrapped script and search index are released. Loader goes to idle state,
+ * even if error occurred.
+ *
+ * @param aLoader[in,out]       Loader in done or error state.
+ * @param aScriptBuffer[out]    Loaded script.
+ * @param aWrappedScript[out]   Font and wrapped script.
+ * @param aSearchIndex[out]     Search index of script.
+ * @return TRUE: if result was taken, FALSE: if loading failed.
+ */
+bool_t loaderTake(loader_t * aLoader, char ** aScriptBuffer, wrappedScript_t * aWrappedScript,
+                  searchIndex_t * aSearchIndex)
+{
+    bool_t ok = FALSE;
+
+    if (aLoader->thread)
+    {
+        SDL_WaitThread(aLoader->thread, NULL);
+        aLoader->thread = NULL;
+    }
+
+    if (aLoader->state == LOADER_STATE_done)
+    {
+        if (*aScriptBuffer)
+        {
+            free(*aScriptBuffer);
+        }
+        freeWrappedScript(aWrappedScript);
+        freeSearchIndex(aSearchIndex);
+
+        *aScriptBuffer = aLoader->scriptBuffer;
+        *aWrappedScript = aLoader->wrappedScript;
+        *aSearchIndex = aLoader->searchIndex;
+        if (aWrappedScript->wrappedScriptList.first == NULL)
+        {
+            aWrappedScript->wrappedScriptList.it = &aWrappedScript->wrappedScriptList.first;
+        }
+
+        /* Result is owned by caller */
+        aLoader->scriptBuffer = NULL;
+        memset(&aLoader->wrappedScript, 0, sizeof(aLoader->wrappedScript));
+        memset(&aLoader->searchIndex, 0, sizeof(aLoader->searchIndex));
+        aLoader->wrappedScript.wrappedScriptList.it = &aLoader->wrappedScript.wrappedScriptList.first;
+        ok = TRUE;
+    }
+    else
+    {
+        freeLoaderResult(aLoader);
+    }
+    setLoaderState(aLoader, LOADER_STATE_idle);
+
+    return ok;
+}
+
+/**
+ * @brief loaderDiscard Throw away result of finished loader. Loader goes to
+ * idle state, so it can be started again.
+ *
+ * @param aLoader[in,out]   Loader in done or error state.
+ */
+void loaderDiscard(loader_t * aLoader)
+{
+    if (aLoader->thread)
+    {
+        SDL_WaitThread(aLoader->thread, NULL);
+        aLoader->thread = NULL;
+    }
+    freeLoaderResult(aLoader);
+    setLoaderState(aLoader, LOADER_STATE_idle);
+}
+
+/**
+ * @brief loaderDone Wait for loader thread and release resources of loader.
+ *
+ * @param aLoader[in]   Loader to release.
+ */
+void loaderDone(loader_t * aLoader)
+{
+    loaderCancel(aLoader);
+    if (aLoader->thread)
+    {
+        verboseprintf("Waiting for loader thread... ");
+        SDL_WaitThread(aLoader->thread, NULL);
+        aLoader->thread = NULL;
+        verboseprintf("Done.\n");
+    }
+    freeLoaderResult(aLoader);
+    doneLoadStatus(&aLoader->status);
+}
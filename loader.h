@@ -0,0 +1,59 @@
+/**
+ * @file        loader.h
+ * @brief       Background loading of font and script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-20 10:12:31
+ * Last modify: 2021-02-20 10:12:31 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_LOADER_H
+#define INCLUDE_LOADER_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+#include "common.h"
+#include "script.h"
+#include "search.h"
+
+typedef enum
+{
+    LOADER_STATE_idle,          /**< Loader is not started or result is already taken. */
+    LOADER_STATE_busy,          /**< Font, script and layout are being prepared. */
+    LOADER_STATE_done,          /**< Script is ready to show. */
+    LOADER_STATE_error,         /**< Error occurred, see status message. */
+} loaderState_t;
+
+typedef struct
+{
+    SDL_Thread    * thread;                             /* Loader thread, NULL if not running */
+    loaderState_t   state;                              /* Protected by status.mutex */
+    uint32_t        runs;                               /* Count of started loader threads */
+    loadStatus_t    status;                             /* Status message of loading */
+    /* Parameters of loading, copied at loaderStart() */
+    char            scriptFilePath[MAX_PATH_LEN];
+    char            ttfFilePath[MAX_PATH_LEN];
+    uint16_t        ttfSize;
+    uint16_t        maxWidthPx;
+    uint16_t        maxHeightPx;
+    /* Result of loading */
+    char          * scriptBuffer;
+    wrappedScript_t wrappedScript;
+    searchIndex_t   searchIndex;
+} loader_t;
+
+bool_t loaderInit(loader_t * aLoader);
+bool_t loaderStart(loader_t * aLoader, config_t * aConfig, const char * aScriptFilePath);
+loaderState_t loaderGetState(loader_t * aLoader);
+bool_t loaderIsCurrent(loader_t * aLoader, config_t * aConfig, const char * aScriptFilePath);
+void loaderCancel(loader_t * aLoader);
+bool_t loaderTake(loader_t * aLoader, char ** aScriptBuffer, wrappedScript_t * aWrappedScript,
+                  searchIndex_t * aSearchIndex);
+void loaderDiscard(loader_t * aLoader);
+void loaderDone(loader_t * aLoader);
+
+#endif /* INCLUDE_LOADER_H */
@@ -31,6 +31,25 @@
 #include "gfx.h"
 #include "linkedlist.h"
 #include "script.h"
+#include "loader.h"
+#include "stats.h"
+#include "fontpool.h"
+#include "atlas.h"
+#include "quality.h"
+#include "linecache.h"
+#include "present.h"
+#include "blend.h"
+#include "effect.h"
+#include "rotate.h"
+#include "scale.h"
+#include "alloctrack.h"
+#include "search.h"
+#include "edit.h"
+#include "playlist.h"
+#include "preview.h"
+#include "replay.h"
+#include "metrics.h"
+#include "latency.h"
 
 #define CONFIG_DIR                  "/.delta_teleprompter"
 #define CONFIG_FILENAME             CONFIG_DIR "/teleprompter.bin"
@@ -57,7 +76,9 @@
 #define KEY_F10                     19
 #define KEY_F11                     20
 #define KEY_F12                     21
-#define KEY_COUNT                   22 /* not a real key, just to count keys */
+#define KEY_ESCAPE                  22
+#define KEY_TAB                     23
+#define KEY_COUNT                   24 /* not a real key, just to count keys */
 
 #define FAST_REPEAT_TICK            150
 #define NORMAL_REPEAT_TICK          250
@@ -77,6 +98,8 @@
 #define MIN_TEXT_HEIGHT_PERCENT     10
 #define TEXT_HEIGHT_PERCENT_STEP    5
 
+#define DEFAULT_MAX_FPS             60      /* Typical refresh rate of displays */
+
 #define MAX_SCROLL_LINE_COUNT       100
 #define MIN_SCROLL_LINE_COUNT       1
 #define SCROLL_LINE_COUNT_STEP      1
@@ -100,7 +123,7 @@ const char *homeDir;
 /* Default configuration, could be overwritten by loadConfig() */
 config_t config =
 {
-    .version = 1,
+    .version = 10,
     .script_file_path = "script.txt",
     .ttf_file_path = "",
     .ttf_size = 36,
@@ -108,7 +131,7 @@ config_t config =
     .text_height_percent = 90,
     .video_size_x_px = 640,
     .video_size_y_px = 480,
-    .video_depth_bit = 16,
+    .video_depth_bit = 0,                   // 0: native depth of display
     .background_color = { 0, 0, 0, 0},      // default background color is black
     .text_color = { 0xFF, 0xFF, 0xFF, 0 },  // default text color is white
     .align_center = TRUE,
@@ -116,6 +139,17 @@ config_t config =
     .scroll_line_count = 5,
     .full_screen = FALSE,
     .verbose = FALSE,
+    .max_fps = DEFAULT_MAX_FPS,
+    .render_quality = QUALITY_auto,
+    .present_mode = PRESENT_MODE_auto,
+    .render_ahead = TRUE,
+    .wrap_threads = 0,
+    .show_preview = FALSE,
+    .outline_px = 0,
+    .shadow_px = 0,
+    .effect_color = { 0, 0, 0, 0 },         // default color of outline and shadow is black
+    .rotation = 0,
+    .render_scale = 1,                      // full resolution
 };
 
 /* Teleprompter related */
@@ -125,6 +159,8 @@ bool_t       teleprompterRunning   = TRUE;
 main_state_machine_t main_state_machine = STATE_undefined;
 main_state_machine_t main_state_machine_next = STATE_undefined;
 
+uint8_t nativeDepthBit = 0; /* Depth of display before setting video mode */
+
 // The surfaces (the sceen itself, background, etc.)
 SDL_Surface* background = NULL;
 SDL_Surface* alphaSurface = NULL;
@@ -132,6 +168,7 @@ SDL_Surface* screen = NULL;
 bool_t textInputIsStarted = FALSE;
 char * text = NULL;
 uint32_t textLength = 0;
+uint32_t textCursor = 0; /* Typed characters are inserted here */
 char * scriptBuffer = NULL;
 wrappedScript_t wrappedScript =
 {
@@ -140,8 +177,22 @@ wrappedScript_t wrappedScript =
     .wrappedScriptHeightPx = 0,
     .config = &config,
 };
+loader_t loaders[2];
+loader_t * loader = &loaders[0];    /* Loads font and script in background */
+loader_t * preloader = &loaders[1]; /* Prepares next script of playlist while the current one is shown */
+playlist_t playlist; /* Scripts given by -s */
+searchIndex_t searchIndex; /* Search index of scriptBuffer */
+document_t document; /* Edited script, scriptBuffer is not changed by editing */
 SDL_TimerID autoScrollTimer = NULL;
 bool_t printConfig = FALSE; /* Only print actual configuration then exit */
+bool_t wrapBench = FALSE;   /* Only measure wrapping with different count of threads then exit */
+bool_t wrapSelfTest = FALSE; /* Only compare wrapping of random scripts with reference then exit */
+uint32_t layoutBenchMiB = 0; /* Only measure layout of generated scripts up to this size then exit, 0: no */
+bool_t blendBench = FALSE;  /* Only measure variants of pixel kernels then exit */
+char recordPath[MAX_PATH_LEN] = ""; /* Input is recorded to this log, empty: no */
+char replayPath[MAX_PATH_LEN] = ""; /* Input is replayed from this log, empty: no */
+bool_t replayRealTime = FALSE; /* TRUE: replay waits for recorded time, FALSE: maximum speed */
+char metricsPath[MAX_PATH_LEN] = ""; /* Metrics are exported to this file, empty: no */
 /* Normal monospace font */
 TTF_Font * ttf_font_monospace = NULL;
 uint16_t ttf_font_monospace_size = 1;
@@ -153,14 +204,6 @@ uint16_t ttf_font_small_monospace_size = 1;
 int ttf_font_small_size_x = 1;
 int ttf_font_small_size_y = 1;
 
-/* Symbols for DejaVuSans.o which is directly converted from .ttf to object using 'ld' */
-extern uint8_t _binary_DejaVuSans_ttf_start[];
-extern uint8_t _binary_DejaVuSans_ttf_end;
-extern uint8_t _binary_DejaVuSans_ttf_size;
-/* Symbols for consola.o which is directly converted from .ttf to object using 'ld' */
-extern uint8_t _binary_consola_ttf_start[];
-extern uint8_t _binary_consola_ttf_end;
-extern uint8_t _binary_consola_ttf_size;
 
 Uint32 timerCallbackFunc(Uint32 interval, void *param)
 {
@@ -268,316 +311,14 @@ bool_t saveConfig (void)
     return ok;
 }
 
-/**
- * @brief loadFont Load font from file. If no file path is given it loads embedded font.
- *
- * @param aFontFilePath[in]     Font to load. It can be NULL or zero length string as well.
- * @param aFontSize[in]         Font size to use.
- * @param aWrappedScript[out]   Font of script to be filled.
- * @return TRUE: if any font successfully loaded.
- */
-bool_t loadFont(const char * aFontFilePath, int aFontSize, wrappedScript_t *aWrappedScript)
-{
-    bool ok = TRUE;
-
-    if (aWrappedScript->ttf_font)
-    {
-        verboseprintf("Releasing previous font... ");
-        TTF_CloseFont(aWrappedScript->ttf_font);
-        aWrappedScript->ttf_font = NULL;
-        verboseprintf("Done.\n");
-    }
-    // Load a TrueType font
-    if (aFontFilePath != NULL && strlen(aFontFilePath))
-    {
-        verboseprintf("Loading font '%s'... ", aFontFilePath);
-        aWrappedScript->ttf_font = TTF_OpenFont(aFontFilePath, aFontSize);
-        if (aWrappedScript->ttf_font != NULL)
-        {
-            verboseprintf("Done.\n");
-        }
-        else
-        {
-            errorprintf("TTF_OpenFont() Failed: %s\n", TTF_GetError());
-        }
-    }
-
-    if (aWrappedScript->ttf_font == NULL)
-    {
-        verboseprintf("Loading embedded font\n");
-        // Load TrueType font which is embedded into this software
-        SDL_RWops* rwops = SDL_RWFromConstMem(_binary_DejaVuSans_ttf_start, (size_t)&_binary_DejaVuSans_ttf_size);
-        aWrappedScript->ttf_font = TTF_OpenFontRW(rwops, 1, aFontSize);
-        if (aWrappedScript->ttf_font == NULL)
-        {
-            errorprintf("TTF_OpenFont() Failed: %s\n", TTF_GetError());
-            ok = FALSE;
-        }
-    }
-
-    return ok;
-}
-
-/**
- * @brief loadScript Load script from file.
- *
- * @param[in]  aScriptFilePath  Script to load.
- * @param[out] aScriptBuffer    Target buffer.
- *
- * @return TRUE: if script successfully loaded. FALSE: if error occured. Error text is printed to screen.
- */
-bool_t loadScript(const char * aScriptFilePath, char ** aScriptBuffer)
-{
-    bool_t  ok = FALSE;
-    FILE  * file;
-    size_t  fileSize;
-    size_t  readBytes;
-
-    drawInfoScreen("Loading script...");
-
-    if (*aScriptBuffer)
-    {
-        verboseprintf("Releasing memory... ");
-        free(*aScriptBuffer);
-        *aScriptBuffer = NULL;
-        verboseprintf("Done\n");
-    }
-
-    verboseprintf("Open file %s ... ", aScriptFilePath);
-    file = fopen(aScriptFilePath, "r");
-    if (file)
-    {
-        verboseprintf("Done.\n");
-        if (fseek(file, 0, SEEK_END) == 0)
-        {
-            fileSize = ftell(file);
-            if (fileSize)
-            {
-                if (fseek(file, 0, SEEK_SET) == 0)
-                {
-                    verboseprintf("Script size: %lu\n", fileSize);
-                    verboseprintf("Allocating memory... ");
-                    *aScriptBuffer = malloc(fileSize + 1); // +1 end of string
-                    if (*aScriptBuffer)
-                    {
-                        verboseprintf("Done.\n");
-                        readBytes = fread(*aScriptBuffer, 1, fileSize, file);
-                        verboseprintf("%lu bytes were read\n", readBytes);
-                        if (readBytes == fileSize)
-                        {
-                            (*aScriptBuffer)[fileSize] = CHR_EOS; // end of string
-                            drawInfoScreen("Script loaded.");
-                            ok = TRUE;
-                        }
-                        else
-                        {
-                            errorprintf("Cannot read from script file!\n");
-                            verboseprintf("errno: %i\n", errno);
-                            verboseprintf("strerror: %s\n", strerror(errno));
-                            drawInfoScreen("ERROR: Cannot read from script file!");
-                        }
-                    }
-                    else
-                    {
-                        errorprintf("Cannot allocate memory for script!\n");
-                        drawInfoScreen("ERROR: Cannot allocate memory for script!");
-                    }
-                }
-                else
-                {
-                    errorprintf("Cannot seek to beginning of file!\n");
-                    drawInfoScreen("ERROR: Cannot seek to beginning of file!");
-                }
-            }
-            else
-            {
-                errorprintf("File is empty!\n");
-                drawInfoScreen("ERROR: File is empty!");
-            }
-        }
-        else
-        {
-            drawInfoScreen("ERROR: Cannot seek to end of file!");
-        }
-        verboseprintf("Closing file... ");
-        if (!fclose(file))
-        {
-            verboseprintf("Done.\n");
-        }
-        else
-        {
-            errorprintf("Cannot close file!\n");
-        }
-    }
-    else
-    {
-        errorprintf("Cannot open script file!\n");
-        drawInfoScreen("ERROR: Cannot open script file!");
-    }
-
-    return ok;
-}
-
-/**
- * @brief wrapScript Wrap script to the specified width.
- *
- * @param aScriptBuffer[in]     Input text to wrap.
- * @param aMaxWidthPx[in]       Maximum width of text in pixels.
- * @param aWrappedScript[out]   Wrapped text.
- * @return
- */
-bool_t wrapScript(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript)
-{
-    bool_t   ok = TRUE;
-    uint32_t i;
-    char   * start_ptr;         /* Start of text */
-    char   * end_ptr;           /* End of text */
-    char   * prev_end_ptr;      /* Previous end of text (to detect overflow of line) */
-    int      text_width_px;
-    int      text_height_px;
-    char     text[1024] = " "; /* Empty string by default, later will be filled */
-    size_t   len;
-    uint32_t additional_line_count;
-
-    verboseprintf("Wrap script to %i x %i... ", aMaxWidthPx, aMaxHeightPx);
-    aWrappedScript->maxWidthPx = aMaxWidthPx;
-    aWrappedScript->maxHeightPx = aMaxHeightPx;
-
-    freeLinkedList(&aWrappedScript->wrappedScriptList);
-    // Initialize iterator
-    aWrappedScript->wrappedScriptList.it = &(aWrappedScript->wrappedScriptList.first);
-
-    /* Add empty lines, so the scrolling will start with empty screen */
-    TTF_SizeUTF8(aWrappedScript->ttf_font, text, &text_width_px, &text_height_px);
-    aWrappedScript->linePerScreen = aMaxHeightPx / text_height_px;
-    additional_line_count = aWrappedScript->linePerScreen + 4;
-    for (i = 0u; i < additional_line_count && ok; i++)
-    {
-        if (i == additional_line_count - 6)
-        {
-            text[0] = '3';
-        }
-        if (i == additional_line_count - 5)
-        {
-            text[0] = ' ';
-        }
-        if (i == additional_line_count - 4)
-        {
-            text[0] = '2';
-        }
-        if (i == additional_line_count - 3)
-        {
-            text[0] = ' ';
-        }
-        if (i == additional_line_count - 2)
-        {
-            text[0] = '1';
-        }
-        if (i == additional_line_count - 1)
-        {
-            text[0] = ' ';
-        }
-        ok = addScriptElement(text, &(aWrappedScript->wrappedScriptList));
-    }
-
-    start_ptr = aScriptBuffer;
-    end_ptr = start_ptr;
-    prev_end_ptr = start_ptr;
-
-    for (i = 0; aScriptBuffer[i] && ok; i++)
-    {
-        if (IS_WHITESPACE(aScriptBuffer[i]))
-        {
-            // Search end of white spaces
-            for (; IS_WHITESPACE(aScriptBuffer[i]); i++)
-            {
-                // replace \n and \t with space
-                // TODO interpret new line and start a new line?
-                aScriptBuffer[i] = ' ';
-            }
-
-            prev_end_ptr = end_ptr;
-            end_ptr = &aScriptBuffer[i];
-            len = (uintptr_t)end_ptr - (uintptr_t)start_ptr;
-            if (len < sizeof(text) - 1) // -1 due to end of string
-            {
-                strncpy(text, start_ptr, len);
-                text[len] = CHR_EOS; // end of string
-//                printf("text: [%s]\n", text);
-                TTF_SizeUTF8(aWrappedScript->ttf_font, text, &text_width_px, &text_height_px);
-//                printf("width_px: %i height_px: %i\n", text_width_px, text_height_px);
-
-                // Check if next word is longer than necessary
-                if (text_width_px >= aMaxWidthPx)
-                {
-                    // It's longer, wrap text at previous word
-                    len = (uintptr_t)prev_end_ptr - (uintptr_t)start_ptr;
-                    strncpy(text, start_ptr, len);
-                    text[len] = CHR_EOS; // end of string
-                    ok = addScriptElement(text, &(aWrappedScript->wrappedScriptList));
-                    start_ptr = prev_end_ptr;
-                }
-            }
-            else
-            {
-                errorprintf("Text too long!\n");
-                ok = FALSE;
-            }
-        }
-    }
-
-    if (ok)
-    {
-        // Add last chunk of text
-        len = (uintptr_t)&aScriptBuffer[i] - (uintptr_t)start_ptr;
-        strncpy(text, start_ptr, len);
-        text[len] = CHR_EOS; // end of string
-        addScriptElement(text, &(aWrappedScript->wrappedScriptList));
-        aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.first;
-        aWrappedScript->wrappedScriptHeightPx = text_height_px;
-    }
-    else
-    {
-        /* Error occurred: free linked list */
-        // FIXME display some text?
-        freeLinkedList(&aWrappedScript->wrappedScriptList);
-    }
-    verboseprintf("Done.\n");
-
-    return ok;
-}
-
-/**
- * @brief printScript Debug function which prints all text from wrapped script.
- * @param aWrappedScriptList
- */
-void printScript(linkedList_t * aWrappedScriptList)
-{
-    linkedListElement_t* linkedListElement = aWrappedScriptList->actual;
-
-    printf("%s start\n", __FUNCTION__);
-    while (linkedListElement)
-    {
-        printf("[%s]\n", (char*)linkedListElement->item);
-        linkedListElement = linkedListElement->next;
-    }
-    printf("%s end\n", __FUNCTION__);
-}
-
 void initScreen(void)
 {
-    Uint32 flags = SDL_SWSURFACE;
-
-    if (screen)
-    {
-        SDL_FreeSurface(screen);
-    }
+    uint8_t          depth = config.video_depth_bit ? config.video_depth_bit : nativeDepthBit;
+    allocSubsystem_t allocScope = enterAllocScope(ALLOC_SUBSYSTEM_surfaces);
 
-    if (config.full_screen)
-    {
-        flags |= SDL_FULLSCREEN;
-    }
-    screen = SDL_SetVideoMode(config.video_size_x_px, config.video_size_y_px, config.video_depth_bit, flags);
+    /* Frames are composed to screen, it can be a back buffer. Video size is
+     * the size of picture, display is rotated. */
+    screen = presentInit(getDisplayWidth(), getDisplayHeight(), depth, config.full_screen);
 
     if (background)
     {
@@ -587,14 +328,23 @@ void initScreen(void)
     {
         SDL_FreeSurface(alphaSurface);
     }
-    // Create background image
-    background = SDL_CreateRGBSurface(SDL_SWSURFACE,
-                                      config.video_size_x_px, config.video_size_y_px, config.video_depth_bit,
-                                      config.background_color.r, config.background_color.g, config.background_color.b, 0);
+    // Create background image in the format of screen
+    background = gfx_create_surface(getDisplayWidth(), getDisplayHeight(), FALSE);
+    if (background)
+    {
+        SDL_FillRect(background, NULL, SDL_MapRGB(background->format, config.background_color.r,
+                                                  config.background_color.g, config.background_color.b));
+    }
+
+    alphaSurface = gfx_create_surface(getDisplayWidth(), getDisplayHeight(), TRUE);
+    verboseprintf("Display format: %i bit (%s depth), R: 0x%08X G: 0x%08X B: 0x%08X\n",
+                  screen->format->BitsPerPixel, config.video_depth_bit ? "requested" : "native",
+                  screen->format->Rmask, screen->format->Gmask, screen->format->Bmask);
 
-    alphaSurface = SDL_CreateRGBSurface(SDL_SRCALPHA,
-                                        config.video_size_x_px, config.video_size_y_px, config.video_depth_bit,
-                                        0, 0, 0, 0xFF);
+    /* Display format may have changed, cached texts shall be rendered again */
+    gfx_invalidate_overlays();
+    invalidateLineCache();
+    invalidateScaledSurface();
 
 #if 0
     uint16_t y;
@@ -607,7 +357,11 @@ void initScreen(void)
     SDL_ShowCursor(SDL_DISABLE);
 
     //Apply image to screen
-    SDL_BlitSurface(background, NULL, screen, NULL);
+    gfx_blit(background, NULL, screen, NULL);
+
+    /* Blits to new surfaces are prepared at first use */
+    restartAllocWarmup();
+    leaveAllocScope(allocScope);
 }
 
 
@@ -632,10 +386,11 @@ void initTimer(void)
 void printHelp(const char * cmd)
 {
     printf("Usage:\n"
-           "%s [-s <script.txt>] [-f <font.ttf>] [-i] [-S <font size>] [-tw <width%%>] [-th <height%%>]\n"
+           "%s [-s <script.txt> [<script2.txt> ...]] [-f <font.ttf>] [-i] [-S <font size>] [-tw <width%%>] [-th <height%%>]\n"
            "\n"
            "Switches:\n"
-           "-s or --script: load script to display\n"
+           "-s or --script: load script to display. More scripts are shown one after the other,\n"
+           "    @<playlist.txt> means a file which lists scripts, one path per line.\n"
            "-f or --font: load TrueType font to be used to display script\n"
            "-i or --internal-font: use internal font\n"
            "-S or --font-size: specify font size\n"
@@ -643,13 +398,38 @@ void printHelp(const char * cmd)
            "-th or --text-height-percent: display text height in percent\n"
            "-vx or --video-size-x: screen size in direction X in pixels. Default: 640.\n"
            "-vy or --video-size-y: screen size in direction Y in pixels. Default: 480.\n"
-           "-vd or --video-depth-bit: pixel depth in bits. Default: 16.\n"
+           "-vd or --video-depth-bit: pixel depth in bits, 0: native depth of display. Default: 0.\n"
            "-bgc or --background-color: background color in RGB format. Default: 0x000000 (black).\n"
            "-tc or --text-color: text color in RGB format. Default: 0xFFFFFF (white).\n"
+           "-ol or --outline: width of outline around text in pixels, 0..8. Default: 0.\n"
+           "-sh or --shadow: offset of drop shadow of text in pixels, 0..8. Default: 0.\n"
+           "-ec or --effect-color: color of outline and shadow in RGB format. Default: 0x000000 (black).\n"
+           "-rot or --rotation: clockwise rotation of picture on display: 0, 90, 180 or 270. Default: 0.\n"
+           "    Video size is the size of picture, display is set to the rotated size.\n"
            "-c or --align-center: align text to center. Default.\n"
            "-l or --align-left: align text to left.\n"
            "-a or --auto-scroll-speed: specify speed of auto scrolling. Default: 240.\n"
            "-slc or --scroll-line-count: specify count of lines which scrolled by up/down. Default: 4.\n"
+           "-fps or --max-fps: maximum frame rate, 0..255, 0: unlimited. Default: 60.\n"
+           "-rq or --render-quality: auto, solid, shaded or blended. Default: auto.\n"
+           "-rs or --render-scale: compose script at 1/1..1/4 of resolution, auto: reduce it if solid quality\n"
+           "    cannot hold the frame rate. Default: 1.\n"
+           "-pm or --present-mode: auto, software or hardware. Default: auto.\n"
+           "-ra or --render-ahead: compose frames in back buffer if display is in video memory. Default.\n"
+           "-nra or --no-render-ahead: compose frames directly on display surface.\n"
+           "-wt or --wrap-threads: count of threads wrapping big scripts, 0: count of processors. Default: 0.\n"
+           "--wrap-bench: wrap script with 1..8 threads, print time of each then exit.\n"
+           "--wrap-selftest: wrap random scripts with 1..8 chunks, compare with reference wrapper then exit.\n"
+           "--blend-bench: measure every variant of text blending kernels supported by the processor then exit.\n"
+           "--layout-bench: wrap generated scripts from 1 MiB up to the specified MiB, print time and memory then exit.\n"
+           "-pv or --preview: show overview of whole script next to the text.\n"
+           "-npv or --no-preview: do not show overview of script. Default.\n"
+           "--metrics <metrics.prom>: export runtime metrics to file in Prometheus text format every second.\n"
+           "--record <input.log>: record input to log.\n"
+           "--replay <input.log>: replay recorded input without window, frames are checked.\n"
+           "--replay-speed: real or max. Default: max.\n"
+           "--assert-no-alloc: abort if composing a script frame allocates memory, rasterization of new lines\n"
+           "    and overlays is not checked. Build with ALLOC_TRACK=1.\n"
            "-fs or --full-screen: switch display to full screen mode.\n"
            "-w or --window: switch display to windowed mode.\n"
            "-v or --verbose: verbose mode.\n"
@@ -693,7 +473,7 @@ SDL_Color getSDLColor(const char *str)
  * @param argv  Array of command line parameters.
  * @return Next argument or NULL if no more arguments.
  */
-char * getNextArg(uint8_t * index, int argc, char *argv[])
+char * getNextArg(int * index, int argc, char *argv[])
 {
     char *arg = NULL;
 
@@ -715,7 +495,8 @@ char * getNextArg(uint8_t * index, int argc, char *argv[])
  */
 bool_t initArgs (int argc, char* argv[])
 {
-    uint8_t argIdx;
+    int     argIdx;
+    int     i;
     char  * arg;
     bool_t  ok = TRUE;
 
@@ -724,17 +505,38 @@ bool_t initArgs (int argc, char* argv[])
         arg = argv[argIdx];
         if (!strcmp(arg, "-s") || !strcmp(arg, "--script"))
         {
-            /* Script file path */
+            /* Script file paths until next switch, they are shown one after the other */
             arg = getNextArg(&argIdx, argc, argv);
-            if (arg)
+            if (!arg)
+            {
+                errorprintf("Script file path missing!\n");
+                ok = FALSE;
+            }
+            while (arg && ok)
             {
-                strncpy(config.script_file_path, arg, sizeof(config.script_file_path));
+                if (arg[0] == PLAYLIST_FILE_PREFIX)
+                {
+                    ok = addPlaylistFile(&playlist, &arg[1]);
+                }
+                else
+                {
+                    ok = addPlaylistItem(&playlist, arg);
+                }
+                arg = NULL;
+                if (argIdx + 1 < argc && argv[argIdx + 1][0] != '-')
+                {
+                    arg = getNextArg(&argIdx, argc, argv);
+                }
             }
-            else
+            if (ok && playlist.count == 0)
             {
-                errorprintf("Script file path missing!\n");
+                errorprintf("Playlist is empty!\n");
                 ok = FALSE;
             }
+            if (ok)
+            {
+                strncpy(config.script_file_path, getPlaylistItem(&playlist, 0), sizeof(config.script_file_path) - 1);
+            }
         }
         else if (!strcmp(arg, "-f") || !strcmp(arg, "--font"))
         {
@@ -867,6 +669,62 @@ bool_t initArgs (int argc, char* argv[])
                 ok = FALSE;
             }
         }
+        else if (!strcmp(arg, "-ol") || !strcmp(arg, "--outline"))
+        {
+            /* Outline around text */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && atoi(arg) >= 0 && atoi(arg) <= EFFECT_MAX_OUTLINE_PX)
+            {
+                config.outline_px = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Outline width missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-sh") || !strcmp(arg, "--shadow"))
+        {
+            /* Drop shadow of text */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && atoi(arg) >= 0 && atoi(arg) <= EFFECT_MAX_SHADOW_PX)
+            {
+                config.shadow_px = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Shadow offset missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-ec") || !strcmp(arg, "--effect-color"))
+        {
+            /* Color of outline and shadow */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg)
+            {
+                config.effect_color = getSDLColor(arg);
+            }
+            else
+            {
+                errorprintf("Effect color missing!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-rot") || !strcmp(arg, "--rotation"))
+        {
+            /* Display is mounted rotated */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && isValidRotation(atoi(arg)))
+            {
+                config.rotation = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Rotation missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
         else if (!strcmp(arg, "-c") || !strcmp(arg, "--align-center"))
         {
             /* Align text to center */
@@ -905,6 +763,81 @@ bool_t initArgs (int argc, char* argv[])
                 ok = FALSE;
             }
         }
+        else if (!strcmp(arg, "-fps") || !strcmp(arg, "--max-fps"))
+        {
+            /* Maximum frame rate */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && atoi(arg) >= 0 && atoi(arg) <= UINT8_MAX)
+            {
+                config.max_fps = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Maximum frame rate missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-rq") || !strcmp(arg, "--render-quality"))
+        {
+            /* Render quality tier */
+            arg = getNextArg(&argIdx, argc, argv);
+            for (i = 0; arg && i < QUALITY_count && strcmp(arg, getQualityName(i)); i++)
+            {
+            }
+            if (arg && i < QUALITY_count)
+            {
+                config.render_quality = i;
+            }
+            else
+            {
+                errorprintf("Render quality missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-rs") || !strcmp(arg, "--render-scale"))
+        {
+            /* Internal resolution of script */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (!arg || !parseRenderScale(arg, &config.render_scale))
+            {
+                errorprintf("Render scale missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-pm") || !strcmp(arg, "--present-mode"))
+        {
+            /* Presentation mode */
+            arg = getNextArg(&argIdx, argc, argv);
+            for (i = 0; arg && i < PRESENT_MODE_count && strcmp(arg, getPresentModeName(i)); i++)
+            {
+            }
+            if (arg && i < PRESENT_MODE_count)
+            {
+                config.present_mode = i;
+            }
+            else
+            {
+                errorprintf("Present mode missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "-ra") || !strcmp(arg, "--render-ahead"))
+        {
+            config.render_ahead = TRUE;
+        }
+        else if (!strcmp(arg, "-nra") || !strcmp(arg, "--no-render-ahead"))
+        {
+            config.render_ahead = FALSE;
+        }
+        else if (!strcmp(arg, "-pv") || !strcmp(arg, "--preview"))
+        {
+            /* Overview of whole script for operator */
+            config.show_preview = TRUE;
+        }
+        else if (!strcmp(arg, "-npv") || !strcmp(arg, "--no-preview"))
+        {
+            config.show_preview = FALSE;
+        }
         else if (!strcmp(arg, "-fs") || !strcmp(arg, "--full-screen"))
         {
             /* Full screen mode */
@@ -930,19 +863,114 @@ bool_t initArgs (int argc, char* argv[])
             /* Print configuration then exit */
             printConfig = TRUE;
         }
-        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        else if (!strcmp(arg, "-wt") || !strcmp(arg, "--wrap-threads"))
         {
-            printHelp(argv[0]);
-            exit(0);
+            /* Count of threads wrapping big scripts */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && atoi(arg) >= 0 && atoi(arg) <= WRAP_MAX_THREADS)
+            {
+                config.wrap_threads = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Count of wrap threads missing or invalid!\n");
+                ok = FALSE;
+            }
         }
-        else
+        else if (!strcmp(arg, "--wrap-bench"))
         {
-            errorprintf("Unknown parameter!\n");
-            ok = FALSE;
+            /* Measure wrapping then exit */
+            wrapBench = TRUE;
         }
-    }
-    if (!ok)
-    {
+        else if (!strcmp(arg, "--wrap-selftest"))
+        {
+            /* Check wrapping then exit */
+            wrapSelfTest = TRUE;
+        }
+        else if (!strcmp(arg, "--blend-bench"))
+        {
+            /* Measure kernels then exit */
+            blendBench = TRUE;
+        }
+        else if (!strcmp(arg, "--layout-bench"))
+        {
+            /* Measure layout of generated scripts then exit */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && atoi(arg) > 0)
+            {
+                layoutBenchMiB = atoi(arg);
+            }
+            else
+            {
+                errorprintf("Size of layout benchmark missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "--record") || !strcmp(arg, "--replay"))
+        {
+            /* Log of input */
+            char * path = !strcmp(arg, "--record") ? recordPath : replayPath;
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg)
+            {
+                strncpy(path, arg, MAX_PATH_LEN - 1);
+            }
+            else
+            {
+                errorprintf("Path of input log missing!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "--metrics"))
+        {
+            /* File of exported metrics */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg)
+            {
+                strncpy(metricsPath, arg, sizeof(metricsPath) - 1);
+            }
+            else
+            {
+                errorprintf("Path of metrics file missing!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "--replay-speed"))
+        {
+            /* Speed of replay */
+            arg = getNextArg(&argIdx, argc, argv);
+            if (arg && (!strcmp(arg, "real") || !strcmp(arg, "max")))
+            {
+                replayRealTime = !strcmp(arg, "real");
+            }
+            else
+            {
+                errorprintf("Replay speed missing or invalid!\n");
+                ok = FALSE;
+            }
+        }
+        else if (!strcmp(arg, "--assert-no-alloc"))
+        {
+            /* Steady state frames shall not allocate */
+            if (!allocTracker.available)
+            {
+                errorprintf("Allocations are not counted, build with ALLOC_TRACK=1 on glibc!\n");
+            }
+            allocTracker.assertNoAlloc = TRUE;
+        }
+        else if (!strcmp(arg, "-h") || !strcmp(arg, "--help"))
+        {
+            printHelp(argv[0]);
+            exit(0);
+        }
+        else
+        {
+            errorprintf("Unknown parameter!\n");
+            ok = FALSE;
+        }
+    }
+    if (!ok)
+    {
         printf("\n"
                "See help: -h\n");
     }
@@ -1017,10 +1045,41 @@ bool_t init (int argc, char* argv[])
         exit(2);
     }
 
+    initBlendKernels();
+    if (blendBench)
+    {
+        exit(benchBlendKernels() ? 0 : 1);
+    }
+    if (wrapSelfTest)
+    {
+        /* Text is measured by a stub, font is not needed */
+        exit(selfTestWrapScript() ? 0 : 1);
+    }
+
+    if (replayPath[0])
+    {
+        /* Replay is headless */
+        setenv("SDL_VIDEODRIVER", "dummy", 0);
+        if (!replayStart(replayPath, replayRealTime, &config, &introTimer, &playlist))
+        {
+            exit(2);
+        }
+    }
+
     SDL_Init(SDL_INIT_TIMER | SDL_INIT_VIDEO);
 //    SDL_Init(SDL_INIT_EVERYTHING);
 
+    if (recordPath[0] && !replayPath[0])
+    {
+        if (!recordStart(recordPath, &config, introTimer, &playlist))
+        {
+            exit(2);
+        }
+    }
+
     videoInfo = SDL_GetVideoInfo();
+    /* Before setting video mode it describes the native format of display */
+    nativeDepthBit = videoInfo->vfmt->BitsPerPixel;
 
     if (config.verbose || printConfig)
     {
@@ -1039,10 +1098,23 @@ bool_t init (int argc, char* argv[])
         printf("Auto scroll speed:     %i\n", config.auto_scroll_speed);
         printf("Scroll line count:     %i\n", config.scroll_line_count);
         printf("Full screen:           %i\n", config.full_screen);
+        printf("Maximum frame rate:    %i\n", config.max_fps);
+        printf("Render quality:        %s\n", getQualityName(config.render_quality));
+        printf("Render scale:          %s\n", getRenderScaleName(config.render_scale));
+        printf("Present mode:          %s\n", getPresentModeName(config.present_mode));
+        printf("Render ahead:          %i\n", config.render_ahead);
+        printf("Wrap threads:          %i\n", config.wrap_threads);
+        printf("Preview:               %i\n", config.show_preview);
+        printf("Outline:               %i px\n", config.outline_px);
+        printf("Shadow:                %i px\n", config.shadow_px);
+        printf("Effect color:          %02X %02X %02X\n", config.effect_color.r, config.effect_color.g, config.effect_color.b);
+        printf("Rotation:              %i degrees\n", config.rotation);
         printf("\n");
         printf("VIDEO\n");
         printf("-----\n");
         printf("Actual screen size:               %i x %i\n", videoInfo->current_w, videoInfo->current_h);
+        printf("Native depth:                     %i bit\n", nativeDepthBit);
+        printf("Text blend kernel:                %s\n", getBlendKernelName());
         printf("Video memory:                     %i KiB\n", videoInfo->video_mem);
         printf("Hardware surface available:       %i\n", videoInfo->hw_available);	/**< Flag: Can you create hardware surfaces? */
         printf("Window manager available:         %i\n", videoInfo->wm_available);	/**< Flag: Can you talk to a window manager? */
@@ -1073,32 +1145,35 @@ bool_t init (int argc, char* argv[])
         exit(1);
     }
 
+    if (!initGlyphAtlas() || !initFontPool())
+    {
+        exit(1);
+    }
+
     verboseprintf("Loading embedded monospace font\n");
     // Load TrueType font which is embedded into this software
-    SDL_RWops* rwops = SDL_RWFromConstMem(_binary_consola_ttf_start, (size_t)&_binary_consola_ttf_size);
     ttf_font_monospace_size = config.video_size_y_px / 16;
-    ttf_font_monospace = TTF_OpenFontRW(rwops, 1, ttf_font_monospace_size);
+    ttf_font_monospace = acquireFont(FONT_SOURCE_MONOSPACE, ttf_font_monospace_size);
     if (ttf_font_monospace == NULL)
     {
-        errorprintf("TTF_OpenFontRW() Failed: %s\n", TTF_GetError());
+        errorprintf("Cannot load monospace font!\n");
         exit(1);
     }
     /* The font is monospace, so every character should have same geometry */
     /* Letter 'A' is used... */
-    TTF_SizeText(ttf_font_monospace, "A", &ttf_font_size_x, &ttf_font_size_y);
+    sizeText(ttf_font_monospace, getFontAtlas(ttf_font_monospace), "A", &ttf_font_size_x, &ttf_font_size_y);
 
-    // Load TrueType font which is embedded into this software
-    rwops = SDL_RWFromConstMem(_binary_consola_ttf_start, (size_t)&_binary_consola_ttf_size);
+    // Same embedded font data is used, only size differs
     ttf_font_small_monospace_size = config.video_size_y_px / 28;
-    ttf_font_small_monospace = TTF_OpenFontRW(rwops, 1, ttf_font_small_monospace_size);
+    ttf_font_small_monospace = acquireFont(FONT_SOURCE_MONOSPACE, ttf_font_small_monospace_size);
     if (ttf_font_small_monospace == NULL)
     {
-        errorprintf("TTF_OpenFontRW() Failed: %s\n", TTF_GetError());
+        errorprintf("Cannot load monospace font!\n");
         exit(1);
     }
     /* The font is monospace, so every character should have same geometry */
     /* Letter 'A' is used... */
-    TTF_SizeText(ttf_font_small_monospace, "A", &ttf_font_small_size_x, &ttf_font_small_size_y);
+    sizeText(ttf_font_small_monospace, getFontAtlas(ttf_font_small_monospace), "A", &ttf_font_small_size_x, &ttf_font_small_size_y);
 
     for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
     {
@@ -1109,76 +1184,337 @@ bool_t init (int argc, char* argv[])
     keys[KEY_LEFT].repeatTick = FAST_REPEAT_TICK;
     keys[KEY_RIGHT].repeatTick = FAST_REPEAT_TICK;
 
+    initStats();
+    if (!initPreview() || !initSave() || !initMetrics(metricsPath))
+    {
+        exit(1);
+    }
+
+    if (wrapBench)
+    {
+        /* Script is wrapped synchronously by this thread, then software exits */
+        bool_t ok = loadFont(config.ttf_file_path, config.ttf_size, &wrappedScript)
+             && loadScript(config.script_file_path, &scriptBuffer, NULL)
+             && benchWrapScript(scriptBuffer,
+                                getWrapWidth(&config),
+                                (float)config.video_size_y_px * config.text_height_percent / 100.0f,
+                                &wrappedScript);
+        free(scriptBuffer);
+        scriptBuffer = NULL;
+        freeWrappedScript(&wrappedScript);
+        TTF_Quit();
+        SDL_Quit();
+        exit(ok ? 0 : 1);
+    }
+
+    if (layoutBenchMiB)
+    {
+        bool_t ok = loadFont(config.ttf_file_path, config.ttf_size, &wrappedScript)
+             && benchLayoutScaling((size_t)layoutBenchMiB << 20,
+                                   getWrapWidth(&config),
+                                   (float)config.video_size_y_px * config.text_height_percent / 100.0f,
+                                   &wrappedScript);
+        freeWrappedScript(&wrappedScript);
+        TTF_Quit();
+        SDL_Quit();
+        exit(ok ? 0 : 1);
+    }
+
+    /* Start loading script while intro is shown */
+    if (!loaderInit(loader) || !loaderInit(preloader))
+    {
+        exit(1);
+    }
+    loaderStart(loader, &config, config.script_file_path);
+
     return TRUE;
 }
 
 /**
- * @brief scrollScriptUpPx Scroll text up by one pixel.
+ * @brief openSearchPrompt
+ * Start incremental search. Typed characters are collected into the query
+ * until prompt is closed.
+ */
+void openSearchPrompt(void)
+{
+    startSearch(&wrappedScript);
+    text = searchPrompt.query;
+    textLength = sizeof(searchPrompt.query);
+    textCursor = strlen(text);
+    textInputIsStarted = TRUE;
+}
+
+/**
+ * @brief closeSearchPrompt
+ * Stop incremental search.
+ *
+ * @param aAccept[in] TRUE: stay at actual hit, FALSE: go back to origin of search.
+ */
+void closeSearchPrompt(bool_t aAccept)
+{
+    stopSearch(&wrappedScript, aAccept);
+    textInputIsStarted = FALSE;
+    text = NULL;
+    textLength = 0;
+}
+
+/**
+ * @brief handleSearchKeys
+ * Search as query is typed. Enter keeps the hit, Escape goes back, Up/Down
+ * and F10 move between hits.
+ */
+void handleSearchKeys(void)
+{
+    updateSearch(&searchIndex, &wrappedScript);
+    if (IS_PRESSED_CHANGED(KEY_ENTER))
+    {
+        closeSearchPrompt(TRUE);
+    }
+    else if (IS_PRESSED_CHANGED(KEY_ESCAPE))
+    {
+        closeSearchPrompt(FALSE);
+    }
+    else if (IS_PRESSED_CHANGED(KEY_DOWN) || IS_PRESSED_CHANGED(KEY_F10))
+    {
+        jumpToNextHit(&searchIndex, &wrappedScript, TRUE);
+    }
+    else if (IS_PRESSED_CHANGED(KEY_UP))
+    {
+        jumpToNextHit(&searchIndex, &wrappedScript, FALSE);
+    }
+}
+
+/**
+ * @brief openEditPrompt
+ * Start editing the first line of text on the screen. Text stays in place
+ * until editing is finished.
+ */
+void openEditPrompt(void)
+{
+    if (startEdit(&document, &wrappedScript))
+    {
+        text = editPrompt.line;
+        textLength = sizeof(editPrompt.line);
+        textCursor = strlen(text);
+        textInputIsStarted = TRUE;
+    }
+    else
+    {
+        drawTopInfoScreen("No line to edit");
+    }
+}
+
+/**
+ * @brief closeEditPrompt
+ * Stop editing.
  *
- * @param aWrappedScript[in] Script to be scrolled.
+ * @param aAccept[in] TRUE: save script, FALSE: restore edited line.
  */
-void scrollScriptUpPx(wrappedScript_t * aWrappedScript)
+void closeEditPrompt(bool_t aAccept)
 {
-    aWrappedScript->heightOffsetPx++;
-    if (aWrappedScript->heightOffsetPx >= aWrappedScript->wrappedScriptHeightPx
-            && aWrappedScript->wrappedScriptList.actual)
+    if (editPrompt.active)
     {
-        if (aWrappedScript->wrappedScriptList.actual->next)
+        /* Replay does not overwrite the script */
+        if (!stopEdit(&document, &wrappedScript, aAccept,
+                      replay.mode == REPLAY_MODE_replay ? NULL : config.script_file_path))
         {
-            /* Advance to next line */
-            aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->next;
-            aWrappedScript->heightOffsetPx = 0;
-            aWrappedScript->isEnd = FALSE;
+            drawTopInfoScreen("Cannot save script!");
         }
-        else
+        else if (aAccept && isSaving())
+        {
+            /* Result is shown by checkSave() */
+            drawTopInfoScreen("Saving script...");
+        }
+        else if (aAccept)
         {
-            aWrappedScript->isEnd = TRUE;
+            drawTopInfoScreen("Script saved");
         }
+        textInputIsStarted = FALSE;
+        text = NULL;
+        textLength = 0;
     }
 }
 
 /**
- * @brief scrollScriptUp Scroll text up by specified count of lines.
- *
- * @param aWrappedScript[in]    Script to be scrolled.
- * @param lineCount[in]         Line count to scroll.
+ * @brief checkSave
+ * Show result of saving script in background.
+ */
+void checkSave(void)
+{
+    bool_t ok;
+
+    if (updateSave(&document, &ok))
+    {
+        drawTopInfoScreen(ok ? "Script saved" : "Cannot save script!");
+    }
+}
+
+/**
+ * @brief handleEditKeys
+ * Apply typed text to the script. Enter and F12 save the script, Escape
+ * restores the line.
+ */
+void handleEditKeys(void)
+{
+    updateEdit(&document, &wrappedScript);
+    if (IS_PRESSED_CHANGED(KEY_ENTER) || IS_PRESSED_CHANGED(KEY_F12))
+    {
+        closeEditPrompt(TRUE);
+    }
+    else if (IS_PRESSED_CHANGED(KEY_ESCAPE))
+    {
+        closeEditPrompt(FALSE);
+    }
+}
+
+/**
+ * @brief applyEdits
+ * Make the edited document the loaded script before it is wrapped as a
+ * whole. Search index is built again, because offsets of script change.
  */
-void scrollScriptUp(wrappedScript_t * aWrappedScript, int lineCount)
+void applyEdits(void)
 {
-    while (lineCount > 0)
+    char * buffer;
+    bool_t modified = document.modified;
+
+    if (document.edited)
     {
-        if (aWrappedScript->wrappedScriptList.actual)
+        buffer = flattenDocument(&document);
+        if (buffer)
         {
-            if (aWrappedScript->wrappedScriptList.actual->next)
-            {
-                aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->next;
-                aWrappedScript->isEnd = FALSE;
-            }
-            else
-            {
-                aWrappedScript->isEnd = TRUE;
-            }
+            buildSearchIndex(&searchIndex, buffer, NULL);
+            /* Saved pieces may point to the loaded script */
+            waitSave();
+            free(scriptBuffer);
+            scriptBuffer = buffer;
+            initDocument(&document, scriptBuffer);
+            document.modified = modified;
         }
-        lineCount--;
     }
 }
 
 /**
- * @brief scrollScriptDown Scroll text down by specified count of lines.
+ * @brief showLoadedScript
+ * Take script prepared by loader and show it immediately.
+ */
+void showLoadedScript(void)
+{
+    waitSave();
+    loaderTake(loader, &scriptBuffer, &wrappedScript, &searchIndex);
+    initDocument(&document, scriptBuffer);
+    wrappedScript.isEnd = FALSE;
+    main_state_machine = STATE_running;
+    if (playlist.count > 1)
+    {
+        drawTopInfoScreen("Script %u/%u", playlist.current + 1, playlist.count);
+    }
+}
+
+/**
+ * @brief isLoaderFinished
+ * Check if loader thread has finished, successfully or not.
+ */
+static bool_t isLoaderFinished(void * aParam)
+{
+    loaderState_t state = loaderGetState((loader_t *)aParam);
+
+    return state == LOADER_STATE_done || state == LOADER_STATE_error;
+}
+
+/**
+ * @brief getLoaderState
+ * Get state of loader. While recording or replaying, a finished loader is
+ * reported at the same iteration in both runs.
  *
- * @param aWrappedScript[in]    Script to be scrolled.
- * @param lineCount[in]         Line count to scroll.
+ * @param aLoader[in] One of loaders.
+ * @return State of loader.
+ */
+loaderState_t getLoaderState(loader_t * aLoader)
+{
+    loaderState_t state = loaderGetState(aLoader);
+
+    if (state != LOADER_STATE_idle)
+    {
+        state = replaySync(REPLAY_GATE_LOADER + (aLoader - loaders), aLoader->runs, isLoaderFinished, aLoader)
+                ? loaderGetState(aLoader) : LOADER_STATE_busy;
+    }
+
+    return state;
+}
+
+/**
+ * @brief preloadNextScript
+ * Prepare next script of playlist in background while the current one is
+ * shown. If font or size of text area was changed, the prepared layout is
+ * thrown away and the next script is prepared again.
  */
-void scrollScriptDown(wrappedScript_t * aWrappedScript, int lineCount)
+void preloadNextScript(void)
 {
-    while (lineCount > 0)
+    const char * path = getPlaylistItem(&playlist, getNextPlaylistIndex(&playlist));
+
+    if (playlist.count > 1)
     {
-        if (aWrappedScript->wrappedScriptList.actual
-                && aWrappedScript->wrappedScriptList.actual->prev)
+        switch (getLoaderState(preloader))
         {
-            aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->prev;
+            case LOADER_STATE_idle:
+                loaderStart(preloader, &config, path);
+                break;
+            case LOADER_STATE_busy:
+                if (!preloader->status.cancel && !loaderIsCurrent(preloader, &config, path))
+                {
+                    /* Loader will report error soon, then it is started again */
+                    loaderCancel(preloader);
+                }
+                break;
+            case LOADER_STATE_done:
+            case LOADER_STATE_error:
+            default:
+                if (!loaderIsCurrent(preloader, &config, path))
+                {
+                    loaderDiscard(preloader);
+                }
+                break;
         }
-        lineCount--;
+    }
+}
+
+/**
+ * @brief startNextScript
+ * Show next script of playlist. If it is already prepared, it is shown at
+ * once, otherwise it is loaded while progress is shown.
+ */
+void startNextScript(void)
+{
+    loader_t    * next = preloader;
+    loaderState_t state;
+    uint64_t      start_us = getTimeUs();
+
+    playlist.current = getNextPlaylistIndex(&playlist);
+    strncpy(config.script_file_path, getPlaylistItem(&playlist, playlist.current),
+            sizeof(config.script_file_path) - 1);
+    /* Loader of shown script prepares the following one */
+    preloader = loader;
+    loader = next;
+    state = getLoaderState(loader);
+    if (state == LOADER_STATE_done && loaderIsCurrent(loader, &config, config.script_file_path))
+    {
+        showLoadedScript();
+        verboseprintf("Switched to prepared script '%s' in %llu us\n", config.script_file_path,
+                      (unsigned long long)(getTimeUs() - start_us));
+    }
+    else
+    {
+        if (state == LOADER_STATE_busy && !loaderIsCurrent(loader, &config, config.script_file_path))
+        {
+            /* Loader thread is not waited for, loading state discards its result when it stops */
+            loaderCancel(loader);
+        }
+        else if (state != LOADER_STATE_busy)
+        {
+            /* Failed script is loaded again, it may have been fixed since. Thread has already finished. */
+            loaderDiscard(loader);
+        }
+        main_state_machine = STATE_load_script;
     }
 }
 
@@ -1237,11 +1573,13 @@ void handleTeleprompterKeys (void)
     {
         /* Scroll script up */
         scrollScriptUp(&wrappedScript, config.scroll_line_count);
+        qualityFastMotion();
     }
     else if (IS_PRESSED_CHANGED(KEY_DOWN))
     {
         /* Scroll script down */
         scrollScriptDown(&wrappedScript, config.scroll_line_count);
+        qualityFastMotion();
     }
     if (IS_PRESSED_CHANGED(KEY_F2))
     {
@@ -1315,6 +1653,31 @@ void handleTeleprompterKeys (void)
         verboseprintf("Text height: %i%%\n", config.text_height_percent);
         drawTopInfoScreen("Text height: %i%%", config.text_height_percent);
     }
+    if (IS_PRESSED_CHANGED(KEY_F9))
+    {
+        stats.visible = !stats.visible;
+        verboseprintf("Statistics: %i\n", stats.visible);
+    }
+    if (IS_PRESSED_CHANGED(KEY_F10))
+    {
+        openSearchPrompt();
+    }
+    if (IS_PRESSED_CHANGED(KEY_F12))
+    {
+        openEditPrompt();
+    }
+    if (IS_PRESSED_CHANGED(KEY_TAB))
+    {
+        uint16_t widthPx = getWrapWidth(&config);
+
+        config.show_preview = !config.show_preview;
+        verboseprintf("Preview: %i\n", config.show_preview);
+        if (getWrapWidth(&config) != widthPx)
+        {
+            /* Text shall fit beside the panel */
+            loadFontWrap = TRUE;
+        }
+    }
     if (IS_PRESSED_CHANGED(KEY_F11))
     {
         config.full_screen = !config.full_screen;
@@ -1336,10 +1699,11 @@ void handleTeleprompterKeys (void)
         ok = loadFont(config.ttf_file_path, config.ttf_size, &wrappedScript);
         if (ok)
         {
+            applyEdits();
             wrapScript(scriptBuffer,
-                       (float)config.video_size_x_px * config.text_width_percent / 100.0f,
+                       getWrapWidth(&config),
                        (float)config.video_size_y_px * config.text_height_percent / 100.0f,
-                       &wrappedScript);
+                       &wrappedScript, NULL);
         }
     }
 }
@@ -1350,7 +1714,14 @@ void handleTeleprompterKeys (void)
  */
 void handleMainStateMachine (void)
 {
-    bool    ok;
+    loadProgress_t loadProgress;
+
+    if (TELEPROMPTER_IS_RUNNING() || TELEPROMPTER_IS_PAUSED() || TELEPROMPTER_IS_FINISHED())
+    {
+        /* Loading of shown script is not slowed down by preparing the next one */
+        preloadNextScript();
+    }
+    checkSave();
 
     switch (main_state_machine)
     {
@@ -1372,30 +1743,46 @@ void handleMainStateMachine (void)
             drawHelpScreen();
             break;
         case STATE_load_script:
-            ok = loadFont(config.ttf_file_path, config.ttf_size, &wrappedScript);
-            if (ok)
+            /* Font and script are loaded by loader thread, do not block here */
+            switch (getLoaderState(loader))
             {
-                ok = loadScript(config.script_file_path, &scriptBuffer);
-            }
-            if (ok)
-            {
-                ok = wrapScript(scriptBuffer,
-                                (float)config.video_size_x_px * config.text_width_percent / 100.0f,
-                                (float)config.video_size_y_px * config.text_height_percent / 100.0f,
-                                &wrappedScript);
-            }
-            if (ok)
-            {
-                /* Script successfully loaded, immediately show it */
-                main_state_machine = STATE_running;
-            }
-            else
-            {
-                /* Error occured, leave error message on the screen for a while */
-                main_state_machine_next = STATE_end;
-                main_state_machine = STATE_load_script_wait;
+                case LOADER_STATE_idle:
+                    loaderStart(loader, &config, config.script_file_path);
+                    break;
+                case LOADER_STATE_busy:
+                    if (IS_PRESSED_CHANGED(KEY_ESCAPE))
+                    {
+                        /* Loader will report error soon */
+                        loaderCancel(loader);
+                    }
+                    replayVolatileFrame();
+                    getLoadProgress(&loader->status, &loadProgress);
+                    drawProgressScreen(&loadProgress);
+                    break;
+                case LOADER_STATE_done:
+                case LOADER_STATE_error:
+                default:
+                    if (!loaderIsCurrent(loader, &config, config.script_file_path))
+                    {
+                        /* Cancelled loader of another script or layout has stopped, start it again */
+                        loaderDiscard(loader);
+                    }
+                    else if (loaderGetState(loader) == LOADER_STATE_done)
+                    {
+                        /* Script successfully loaded, immediately show it */
+                        showLoadedScript();
+                    }
+                    else
+                    {
+                        waitSave();
+                        loaderTake(loader, &scriptBuffer, &wrappedScript, &searchIndex);
+                        /* Error occured, leave error message on the screen for a while */
+                        wrappedScript.isEnd = FALSE;
+                        main_state_machine_next = STATE_end;
+                        main_state_machine = STATE_load_script_wait;
+                    }
+                    break;
             }
-            wrappedScript.isEnd = FALSE;
             break;
         case STATE_load_script_wait:
             loadScriptTimer--;
@@ -1403,38 +1790,68 @@ void handleMainStateMachine (void)
             {
                 main_state_machine = main_state_machine_next;
             }
+            getLoadProgress(&loader->status, &loadProgress);
+            drawStatusScreen(loadProgress.message);
             break;
         case STATE_running:
-            handleTeleprompterKeys ();
-            if (IS_PRESSED_CHANGED(KEY_ENTER) || IS_PRESSED_CHANGED(KEY_SPACE))
+            if (textInputIsStarted && editPrompt.active)
             {
-                main_state_machine = STATE_paused;
+                /* Keys belong to the line editor, scrolling is stopped */
+                handleEditKeys();
             }
-            if (IS_PRESSED_CHANGED(KEY_F1))
+            else if (textInputIsStarted)
             {
-                main_state_machine = STATE_help;
-                main_state_machine_next = STATE_running;
+                /* Keys belong to the search prompt, scrolling goes on */
+                handleSearchKeys();
+            }
+            else
+            {
+                handleTeleprompterKeys ();
+                if (IS_PRESSED_CHANGED(KEY_ENTER) || IS_PRESSED_CHANGED(KEY_SPACE))
+                {
+                    main_state_machine = STATE_paused;
+                }
+                if (IS_PRESSED_CHANGED(KEY_F1))
+                {
+                    main_state_machine = STATE_help;
+                    main_state_machine_next = STATE_running;
+                }
             }
             drawScreen ();
             if (wrappedScript.isEnd)
             {
+                closeEditPrompt(TRUE);
+                closeSearchPrompt(TRUE);
                 main_state_machine = STATE_end;
             }
             break;
         case STATE_paused:
-            handleTeleprompterKeys();
-            if (IS_PRESSED_CHANGED(KEY_ENTER) || IS_PRESSED_CHANGED(KEY_SPACE))
+            if (textInputIsStarted && editPrompt.active)
             {
-                main_state_machine = STATE_running;
+                handleEditKeys();
             }
-            if (IS_PRESSED_CHANGED(KEY_F1))
+            else if (textInputIsStarted)
             {
-                main_state_machine = STATE_help;
-                main_state_machine_next = STATE_paused;
+                handleSearchKeys();
+            }
+            else
+            {
+                handleTeleprompterKeys();
+                if (IS_PRESSED_CHANGED(KEY_ENTER) || IS_PRESSED_CHANGED(KEY_SPACE))
+                {
+                    main_state_machine = STATE_running;
+                }
+                if (IS_PRESSED_CHANGED(KEY_F1))
+                {
+                    main_state_machine = STATE_help;
+                    main_state_machine_next = STATE_paused;
+                }
             }
             drawScreen ();
             if (wrappedScript.isEnd)
             {
+                closeEditPrompt(TRUE);
+                closeSearchPrompt(TRUE);
                 main_state_machine = STATE_end;
             }
             break;
@@ -1444,7 +1861,14 @@ void handleMainStateMachine (void)
                 /* Restart teleprompter */
                 introTimer = DEFAULT_INTRO_TIMER;
                 loadScriptTimer = DEFAULT_LOAD_SCRIPT_TIMER;
-                main_state_machine = STATE_load_script;
+                if (playlist.count > 1)
+                {
+                    startNextScript();
+                }
+                else
+                {
+                    main_state_machine = STATE_load_script;
+                }
             }
             if (IS_PRESSED_CHANGED(KEY_F1))
             {
@@ -1468,7 +1892,7 @@ void key_pressed(uint8_t key_index, bool_t pressed)
         keys[key_index].pressed = pressed;
         if (pressed)
         {
-            keys[key_index].pressTick = SDL_GetTicks() + keys[key_index].repeatTick;
+            keys[key_index].pressTick = getTicks() + keys[key_index].repeatTick;
         }
         else
         {
@@ -1481,209 +1905,302 @@ void key_pressed(uint8_t key_index, bool_t pressed)
     }
 }
 
+/**
+ * @brief handleEvent
+ * Apply an input event got from SDL or from replay log.
+ *
+ * @param aEvent[in] Event.
+ * @return TRUE: if event changes the teleprompter.
+ */
+bool_t handleEvent(SDL_Event * aEvent)
+{
+    bool_t eventOccurred = FALSE;
+
+    if (aEvent->type == SDL_USEREVENT)
+    {
+        /* Edited line stays in place */
+        if (TELEPROMPTER_IS_RUNNING() && !editPrompt.active)
+        {
+            scrollScriptUpPx(&wrappedScript);
+        }
+    }
+    else if (aEvent->type == SDL_KEYDOWN)
+    {
+        eventOccurred = TRUE;
+        if (textInputIsStarted && text)
+        {
+          uint32_t len = strnlen(text, textLength);
+          uint32_t pos;
+          textCursor = MIN(textCursor, len);
+          if (aEvent->key.keysym.sym >= 32 && aEvent->key.keysym.sym <= 126)
+          {
+            if (len < textLength - 1)
+            {
+                memmove(&text[textCursor + 1], &text[textCursor], len - textCursor + 1);
+                text[textCursor] = aEvent->key.keysym.sym;
+                if ((aEvent->key.keysym.mod & (KMOD_RSHIFT | KMOD_LSHIFT))
+                        && text[textCursor] >= 'a' && text[textCursor] <= 'z')
+                {
+                  /* Make upper case */
+                  text[textCursor] &= 0xDF;
+                }
+                textCursor++;
+            }
+          }
+          /* Cursor moves and characters are deleted by whole UTF-8 sequences */
+          if (aEvent->key.keysym.sym == SDLK_BACKSPACE && textCursor > 0)
+          {
+            for (pos = textCursor - 1; pos > 0 && IS_UTF8_CONTINUATION(text[pos]); pos--)
+            {
+            }
+            memmove(&text[pos], &text[textCursor], len - textCursor + 1);
+            textCursor = pos;
+          }
+          if (aEvent->key.keysym.sym == SDLK_DELETE && textCursor < len)
+          {
+            for (pos = textCursor + 1; pos < len && IS_UTF8_CONTINUATION(text[pos]); pos++)
+            {
+            }
+            memmove(&text[textCursor], &text[pos], len - pos + 1);
+          }
+          if (aEvent->key.keysym.sym == SDLK_LEFT)
+          {
+            while (textCursor > 0 && IS_UTF8_CONTINUATION(text[--textCursor]))
+            {
+            }
+          }
+          if (aEvent->key.keysym.sym == SDLK_RIGHT)
+          {
+            while (textCursor < len && IS_UTF8_CONTINUATION(text[++textCursor]))
+            {
+            }
+          }
+          if (aEvent->key.keysym.sym == SDLK_HOME)
+          {
+            textCursor = 0;
+          }
+          if (aEvent->key.keysym.sym == SDLK_END)
+          {
+            textCursor = len;
+          }
+        }
+
+        switch (aEvent->key.keysym.sym)
+        {
+            case SDLK_UP:
+                key_pressed(KEY_UP, TRUE);
+                break;
+            case SDLK_DOWN:
+                key_pressed(KEY_DOWN, TRUE);
+                break;
+            case SDLK_LEFT:
+                key_pressed(KEY_LEFT, TRUE);
+                break;
+            case SDLK_RIGHT:
+                key_pressed(KEY_RIGHT, TRUE);
+                break;
+            case SDLK_RETURN:
+            case SDLK_KP_ENTER:
+                key_pressed(KEY_ENTER, TRUE);
+                break;
+            case SDLK_SPACE:
+                key_pressed(KEY_SPACE, TRUE);
+                break;
+            case SDLK_PLUS:
+            case SDLK_KP_PLUS:
+                key_pressed(KEY_PLUS, TRUE);
+                break;
+            case SDLK_MINUS:
+            case SDLK_KP_MINUS:
+                key_pressed(KEY_MINUS, TRUE);
+                break;
+            case SDLK_F1:
+                key_pressed(KEY_F1, TRUE);
+                break;
+            case SDLK_F2:
+                key_pressed(KEY_F2, TRUE);
+                break;
+            case SDLK_F3:
+                key_pressed(KEY_F3, TRUE);
+                break;
+            case SDLK_F4:
+                key_pressed(KEY_F4, TRUE);
+                break;
+            case SDLK_F5:
+                key_pressed(KEY_F5, TRUE);
+                break;
+            case SDLK_F6:
+                key_pressed(KEY_F6, TRUE);
+                break;
+            case SDLK_F7:
+                key_pressed(KEY_F7, TRUE);
+                break;
+            case SDLK_F8:
+                key_pressed(KEY_F8, TRUE);
+                break;
+            case SDLK_F9:
+                key_pressed(KEY_F9, TRUE);
+                break;
+            case SDLK_F10:
+                key_pressed(KEY_F10, TRUE);
+                break;
+            case SDLK_F11:
+                key_pressed(KEY_F11, TRUE);
+                break;
+            case SDLK_F12:
+                key_pressed(KEY_F12, TRUE);
+                break;
+            case SDLK_TAB:
+                key_pressed(KEY_TAB, TRUE);
+                break;
+            case SDLK_ESCAPE:
+                key_pressed(KEY_ESCAPE, TRUE);
+                /* Escape cancels loading, search or editing instead of exit */
+                if (main_state_machine != STATE_load_script && !textInputIsStarted)
+                {
+                    teleprompterRunning = FALSE;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    else if (aEvent->type == SDL_KEYUP)
+    {
+        /* Releasing key should not be an event as it disturbs drawInfoScreen() */
+        switch (aEvent->key.keysym.sym)
+        {
+            case SDLK_UP:
+                key_pressed(KEY_UP, FALSE);
+                break;
+            case SDLK_DOWN:
+                key_pressed(KEY_DOWN, FALSE);
+                break;
+            case SDLK_LEFT:
+                key_pressed(KEY_LEFT, FALSE);
+                break;
+            case SDLK_RIGHT:
+                key_pressed(KEY_RIGHT, FALSE);
+                break;
+            case SDLK_RETURN:
+            case SDLK_KP_ENTER:
+                key_pressed(KEY_ENTER, FALSE);
+                break;
+            case SDLK_SPACE:
+                key_pressed(KEY_SPACE, FALSE);
+                break;
+            case SDLK_PLUS:
+            case SDLK_KP_PLUS:
+                key_pressed(KEY_PLUS, FALSE);
+                break;
+            case SDLK_MINUS:
+            case SDLK_KP_MINUS:
+                key_pressed(KEY_MINUS, FALSE);
+                break;
+            case SDLK_F1:
+                key_pressed(KEY_F1, FALSE);
+                break;
+            case SDLK_F2:
+                key_pressed(KEY_F2, FALSE);
+                break;
+            case SDLK_F3:
+                key_pressed(KEY_F3, FALSE);
+                break;
+            case SDLK_F4:
+                key_pressed(KEY_F4, FALSE);
+                break;
+            case SDLK_F5:
+                key_pressed(KEY_F5, FALSE);
+                break;
+            case SDLK_F6:
+                key_pressed(KEY_F6, FALSE);
+                break;
+            case SDLK_F7:
+                key_pressed(KEY_F7, FALSE);
+                break;
+            case SDLK_F8:
+                key_pressed(KEY_F8, FALSE);
+                break;
+            case SDLK_F9:
+                key_pressed(KEY_F9, FALSE);
+                break;
+            case SDLK_F10:
+                key_pressed(KEY_F10, FALSE);
+                break;
+            case SDLK_F11:
+                key_pressed(KEY_F11, FALSE);
+                break;
+            case SDLK_F12:
+                key_pressed(KEY_F12, FALSE);
+                break;
+            case SDLK_TAB:
+                key_pressed(KEY_TAB, FALSE);
+                break;
+            case SDLK_ESCAPE:
+                key_pressed(KEY_ESCAPE, FALSE);
+                break;
+            default:
+                break;
+        }
+    }
+    else if (aEvent->type == SDL_QUIT) /* If the user has Xed out the window */
+    {
+        eventOccurred = TRUE;
+        /* Quit the program */
+        teleprompterRunning = FALSE;
+    }
+
+    return eventOccurred;
+}
+
 bool_t eventHandler()
 {
     int i;
     SDL_Event event;
     bool_t    eventOccurred = FALSE;
 
+    if (!replayIteration())
+    {
+        /* Replay log is finished */
+        teleprompterRunning = FALSE;
+        return FALSE;
+    }
+
     for (i = 0; i < KEY_COUNT; i++)
     {
         keys[i].changed = FALSE;
-        if (keys[i].pressed && keys[i].pressTick < SDL_GetTicks())
+        if (keys[i].pressed && keys[i].pressTick < getTicks())
         {
             /* Simulate key has just pressed */
             keys[i].changed = TRUE;
-            keys[i].pressTick = SDL_GetTicks() + keys[i].repeatTick;
+            keys[i].pressTick = getTicks() + keys[i].repeatTick;
             eventOccurred = TRUE;
         }
     }
 
-    while (SDL_PollEvent(&event))
+    if (replay.mode == REPLAY_MODE_replay)
     {
-        if (event.type == SDL_USEREVENT)
+        /* Input comes from log, only closing the window stops replay */
+        while (SDL_PollEvent(&event))
         {
-            if (TELEPROMPTER_IS_RUNNING())
+            if (event.type == SDL_QUIT)
             {
-                scrollScriptUpPx(&wrappedScript);
+                teleprompterRunning = FALSE;
             }
         }
-        else if (event.type == SDL_KEYDOWN)
+        while (replayNextEvent(&event))
         {
-            eventOccurred = TRUE;
-            if (textInputIsStarted && text)
-            {
-              uint32_t len = strnlen(text, textLength);
-              if (event.key.keysym.sym >= 32 && event.key.keysym.sym <= 126)
-              {
-                if (len < textLength - 1)
-                {
-                    text[len] = event.key.keysym.sym;
-                    if (event.key.keysym.mod & (KMOD_RSHIFT | KMOD_LSHIFT) )
-                    {
-                      /* Make upper case */
-                      text[len] &= 0xDF;
-                    }
-                    text[len + 1] = 0;
-                }
-              }
-              if (event.key.keysym.sym == SDLK_BACKSPACE && len > 0)
-              {
-                text[len - 1] = 0;
-              }
-            }
-
-            switch (event.key.keysym.sym)
-            {
-                case SDLK_UP:
-                    key_pressed(KEY_UP, TRUE);
-                    break;
-                case SDLK_DOWN:
-                    key_pressed(KEY_DOWN, TRUE);
-                    break;
-                case SDLK_LEFT:
-                    key_pressed(KEY_LEFT, TRUE);
-                    break;
-                case SDLK_RIGHT:
-                    key_pressed(KEY_RIGHT, TRUE);
-                    break;
-                case SDLK_RETURN:
-                case SDLK_KP_ENTER:
-                    key_pressed(KEY_ENTER, TRUE);
-                    break;
-                case SDLK_SPACE:
-                    key_pressed(KEY_SPACE, TRUE);
-                    break;
-                case SDLK_PLUS:
-                case SDLK_KP_PLUS:
-                    key_pressed(KEY_PLUS, TRUE);
-                    break;
-                case SDLK_MINUS:
-                case SDLK_KP_MINUS:
-                    key_pressed(KEY_MINUS, TRUE);
-                    break;
-                case SDLK_F1:
-                    key_pressed(KEY_F1, TRUE);
-                    break;
-                case SDLK_F2:
-                    key_pressed(KEY_F2, TRUE);
-                    break;
-                case SDLK_F3:
-                    key_pressed(KEY_F3, TRUE);
-                    break;
-                case SDLK_F4:
-                    key_pressed(KEY_F4, TRUE);
-                    break;
-                case SDLK_F5:
-                    key_pressed(KEY_F5, TRUE);
-                    break;
-                case SDLK_F6:
-                    key_pressed(KEY_F6, TRUE);
-                    break;
-                case SDLK_F7:
-                    key_pressed(KEY_F7, TRUE);
-                    break;
-                case SDLK_F8:
-                    key_pressed(KEY_F8, TRUE);
-                    break;
-                case SDLK_F9:
-                    key_pressed(KEY_F9, TRUE);
-                    break;
-                case SDLK_F10:
-                    key_pressed(KEY_F10, TRUE);
-                    break;
-                case SDLK_F11:
-                    key_pressed(KEY_F11, TRUE);
-                    break;
-                case SDLK_F12:
-                    key_pressed(KEY_F12, TRUE);
-                    break;
-                case SDLK_ESCAPE:
-                    teleprompterRunning = FALSE;
-                    break;
-                default:
-                    break;
-            }
+            latencyInputPolled(&event);
+            eventOccurred |= handleEvent(&event);
         }
-        else if (event.type == SDL_KEYUP)
-        {
-            /* Releasing key should not be an event as it disturbs drawInfoScreen() */
-            switch (event.key.keysym.sym)
-            {
-                case SDLK_UP:
-                    key_pressed(KEY_UP, FALSE);
-                    break;
-                case SDLK_DOWN:
-                    key_pressed(KEY_DOWN, FALSE);
-                    break;
-                case SDLK_LEFT:
-                    key_pressed(KEY_LEFT, FALSE);
-                    break;
-                case SDLK_RIGHT:
-                    key_pressed(KEY_RIGHT, FALSE);
-                    break;
-                case SDLK_RETURN:
-                case SDLK_KP_ENTER:
-                    key_pressed(KEY_ENTER, FALSE);
-                    break;
-                case SDLK_SPACE:
-                    key_pressed(KEY_SPACE, FALSE);
-                    break;
-                case SDLK_PLUS:
-                case SDLK_KP_PLUS:
-                    key_pressed(KEY_PLUS, FALSE);
-                    break;
-                case SDLK_MINUS:
-                case SDLK_KP_MINUS:
-                    key_pressed(KEY_MINUS, FALSE);
-                    break;
-                case SDLK_F1:
-                    key_pressed(KEY_F1, FALSE);
-                    break;
-                case SDLK_F2:
-                    key_pressed(KEY_F2, FALSE);
-                    break;
-                case SDLK_F3:
-                    key_pressed(KEY_F3, FALSE);
-                    break;
-                case SDLK_F4:
-                    key_pressed(KEY_F4, FALSE);
-                    break;
-                case SDLK_F5:
-                    key_pressed(KEY_F5, FALSE);
-                    break;
-                case SDLK_F6:
-                    key_pressed(KEY_F6, FALSE);
-                    break;
-                case SDLK_F7:
-                    key_pressed(KEY_F7, FALSE);
-                    break;
-                case SDLK_F8:
-                    key_pressed(KEY_F8, FALSE);
-                    break;
-                case SDLK_F9:
-                    key_pressed(KEY_F9, FALSE);
-                    break;
-                case SDLK_F10:
-                    key_pressed(KEY_F10, FALSE);
-                    break;
-                case SDLK_F11:
-                    key_pressed(KEY_F11, FALSE);
-                    break;
-                case SDLK_F12:
-                    key_pressed(KEY_F12, FALSE);
-                    break;
-                case SDLK_ESCAPE:
-                    break;
-                default:
-                    break;
-            }
-        }
-        else if (event.type == SDL_QUIT) /* If the user has Xed out the window */
+    }
+    else
+    {
+        while (SDL_PollEvent(&event))
         {
-            eventOccurred = TRUE;
-            /* Quit the program */
-            teleprompterRunning = FALSE;
+            latencyInputPolled(&event);
+            recordEvent(&event);
+            eventOccurred |= handleEvent(&event);
         }
     }
 
@@ -1702,7 +2219,11 @@ void run (void)
     {
         eventHandler();
         handleMainStateMachine ();
-        SDL_Delay(1);
+        publishMetrics(&wrappedScript);
+        if (replay.mode != REPLAY_MODE_replay)
+        {
+            SDL_Delay(1);
+        }
     }
 }
 
@@ -1712,8 +2233,28 @@ void run (void)
  */
 void done (void)
 {
-    saveConfig ();
+    /* Replay runs with configuration of recorded session */
+    if (replay.mode != REPLAY_MODE_replay)
+    {
+        saveConfig ();
+    }
+
+    loaderDone(loader);
+    loaderDone(preloader);
+    freePlaylist(&playlist);
+    donePreview();
+    doneSave();
+    doneMetrics();
 
+    if (config.verbose)
+    {
+        printStats();
+    }
+    printReplayStats();
+    replayDone();
+
+    freeSearchIndex(&searchIndex);
+    freeDocument(&document);
     if (scriptBuffer)
     {
         verboseprintf("Releasing memory... ");
@@ -1722,33 +2263,25 @@ void done (void)
         verboseprintf("Done\n");
     }
 
-    if (wrappedScript.wrappedScriptList.first)
-    {
-        verboseprintf("Releasing linked list... ");
-        freeLinkedList(&wrappedScript.wrappedScriptList);
-        verboseprintf("Done\n");
-    }
+    verboseprintf("Releasing wrapped script... ");
+    freeWrappedScript(&wrappedScript);
+    verboseprintf("Done\n");
 
-    if (wrappedScript.ttf_font)
-    {
-        TTF_CloseFont(wrappedScript.ttf_font);
-        wrappedScript.ttf_font = NULL;
-    }
-    if (ttf_font_monospace)
-    {
-        TTF_CloseFont(ttf_font_monospace);
-        ttf_font_monospace = NULL;
-    }
-    if (ttf_font_small_monospace)
-    {
-        TTF_CloseFont(ttf_font_small_monospace);
-        ttf_font_small_monospace = NULL;
-    }
+    releaseFont(ttf_font_monospace);
+    ttf_font_monospace = NULL;
+    releaseFont(ttf_font_small_monospace);
+    ttf_font_small_monospace = NULL;
+    doneFontPool();
+    doneGlyphAtlas();
 
     //Free the surfaces
+    gfx_free_overlays();
+    freeLineCache();
+    invalidateScaledSurface();
     SDL_FreeSurface(background);
     SDL_FreeSurface(alphaSurface);
-    SDL_FreeSurface(screen);
+    presentDone();
+    screen = NULL;
 
     // Quit TTF
     TTF_Quit();
@@ -0,0 +1,358 @@
+/**
+ * @file        metrics.c
+ * @brief       Export of runtime metrics for monitoring
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-04 19:52:07
+ * Last modify: 2021-03-04 19:52:07 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Main loop collects frame times and publishes a snapshot of counters once
+ * per METRICS_PERIOD_MS. Exporter thread copies the snapshot without lock,
+ * adds memory usage and writes it in Prometheus text format to a temporary
+ * file which is renamed over the exported file, so a scraper never reads a
+ * partial file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+#include "common.h"
+#include "stats.h"
+#include "quality.h"
+#include "linecache.h"
+#include "replay.h"
+#include "metrics.h"
+
+metrics_t metrics;
+
+/* Upper limits of frame time buckets in microseconds, last bucket is +Inf */
+static const uint32_t bucketLimitsUs[METRICS_BUCKET_COUNT - 1] =
+{
+    1000, 2000, 4000, 8000, 16667, 33333, 66667
+};
+
+/**
+ * @brief readSnapshot Copy snapshot published by main loop.
+ *
+ * @param aSnapshot[out]    Copy of snapshot.
+ * @return TRUE: if a snapshot was already published.
+ */
+static bool_t readSnapshot(metricsSnapshot_t * aSnapshot)
+{
+    uint32_t sequence;
+
+    for (;;)
+    {
+        sequence = metrics.sequence;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (!(sequence & 1))
+        {
+            memcpy(aSnapshot, &metrics.snapshot, sizeof(*aSnapshot));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (metrics.sequence == sequence)
+            {
+                break;
+            }
+        }
+        metrics.retries++;
+        SDL_Delay(1);
+    }
+
+    return sequence != 0;
+}
+
+/**
+ * @brief getResidentKiB Get resident memory of process.
+ *
+ * @return Resident memory in KiB, 0: unknown.
+ */
+static uint64_t getResidentKiB(void)
+{
+    FILE             * file = fopen("/proc/self/statm", "r");
+    unsigned long long size;
+    unsigned long long resident = 0;
+
+    if (file)
+    {
+        if (fscanf(file, "%llu %llu", &size, &resident) != 2)
+        {
+            resident = 0;
+        }
+        fclose(file);
+    }
+
+    return resident * (uint64_t)sysconf(_SC_PAGESIZE) / 1024u;
+}
+
+/**
+ * @brief writeMetrics Write snapshot to a file in Prometheus text format.
+ *
+ * @param aFile[in]         Opened file.
+ * @param aSnapshot[in]     Snapshot to write.
+ */
+static void writeMetrics(FILE * aFile, const metricsSnapshot_t * aSnapshot)
+{
+    uint64_t cumulative = 0;
+    uint32_t i;
+
+    fprintf(aFile, "# TYPE teleprompter_uptime_seconds gauge\n");
+    fprintf(aFile, "teleprompter_uptime_seconds %.3f\n", aSnapshot->uptimeMs / 1000.0);
+    fprintf(aFile, "# TYPE teleprompter_frames_rendered_total counter\n");
+    fprintf(aFile, "teleprompter_frames_rendered_total %llu\n", (unsigned long long)aSnapshot->framesRendered);
+    fprintf(aFile, "# TYPE teleprompter_frames_skipped_total counter\n");
+    fprintf(aFile, "teleprompter_frames_skipped_total %llu\n", (unsigned long long)aSnapshot->framesSkipped);
+    fprintf(aFile, "# TYPE teleprompter_frames_dropped_total counter\n");
+    fprintf(aFile, "teleprompter_frames_dropped_total %llu\n", (unsigned long long)aSnapshot->framesDropped);
+    fprintf(aFile, "# TYPE teleprompter_frame_seconds histogram\n");
+    for (i = 0; i < METRICS_BUCKET_COUNT; i++)
+    {
+        cumulative += aSnapshot->frameBuckets[i];
+        if (i < METRICS_BUCKET_COUNT - 1)
+        {
+            fprintf(aFile, "teleprompter_frame_seconds_bucket{le=\"%.6f\"} %llu\n",
+                    bucketLimitsUs[i] / 1000000.0, (unsigned long long)cumulative);
+        }
+        else
+        {
+            fprintf(aFile, "teleprompter_frame_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+        }
+    }
+    fprintf(aFile, "teleprompter_frame_seconds_sum %.6f\n", aSnapshot->frameUsTotal / 1000000.0);
+    fprintf(aFile, "teleprompter_frame_seconds_count %llu\n", (unsigned long long)cumulative);
+    fprintf(aFile, "# TYPE teleprompter_input_latency_seconds histogram\n");
+    cumulative = 0;
+    for (i = 0; i < LATENCY_BUCKET_COUNT; i++)
+    {
+        cumulative += aSnapshot->latencyBuckets[i];
+        if (i < LATENCY_BUCKET_COUNT - 1)
+        {
+            fprintf(aFile, "teleprompter_input_latency_seconds_bucket{le=\"%.6f\"} %llu\n",
+                    getLatencyBucketLimitUs(i) / 1000000.0, (unsigned long long)cumulative);
+        }
+        else
+        {
+            fprintf(aFile, "teleprompter_input_latency_seconds_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+        }
+    }
+    fprintf(aFile, "teleprompter_input_latency_seconds_sum %.6f\n", aSnapshot->latencyUsTotal / 1000000.0);
+    fprintf(aFile, "teleprompter_input_latency_seconds_count %llu\n", (unsigned long long)cumulative);
+    fprintf(aFile, "# TYPE teleprompter_scroll_velocity_pixels_per_second gauge\n");
+    fprintf(aFile, "teleprompter_scroll_velocity_pixels_per_second %i\n", aSnapshot->scrollVelocityPxPerSec);
+    fprintf(aFile, "# TYPE teleprompter_scroll_position_pixels gauge\n");
+    fprintf(aFile, "teleprompter_scroll_position_pixels %llu\n", (unsigned long long)aSnapshot->scrollPositionPx);
+    fprintf(aFile, "# TYPE teleprompter_line_cache_hits_total counter\n");
+    fprintf(aFile, "teleprompter_line_cache_hits_total %llu\n", (unsigned long long)aSnapshot->lineCacheHits);
+    fprintf(aFile, "# TYPE teleprompter_line_cache_misses_total counter\n");
+    fprintf(aFile, "teleprompter_line_cache_misses_total %llu\n", (unsigned long long)aSnapshot->lineCacheMisses);
+    fprintf(aFile, "# TYPE teleprompter_line_cache_hit_ratio gauge\n");
+    fprintf(aFile, "teleprompter_line_cache_hit_ratio %.4f\n",
+            aSnapshot->lineCacheHits + aSnapshot->lineCacheMisses
+            ? (double)aSnapshot->lineCacheHits / (aSnapshot->lineCacheHits + aSnapshot->lineCacheMisses) : 0.0);
+    fprintf(aFile, "# TYPE teleprompter_layout_seconds gauge\n");
+    fprintf(aFile, "teleprompter_layout_seconds %.6f\n", aSnapshot->layoutUs / 1000000.0);
+    fprintf(aFile, "# TYPE teleprompter_layout_lines gauge\n");
+    fprintf(aFile, "teleprompter_layout_lines %llu\n", (unsigned long long)aSnapshot->lineCount);
+    fprintf(aFile, "# TYPE teleprompter_quality_tier gauge\n");
+    fprintf(aFile, "teleprompter_quality_tier{tier=\"%s\"} %u\n",
+            getQualityName((quality_t)aSnapshot->qualityTier), aSnapshot->qualityTier);
+    fprintf(aFile, "# TYPE teleprompter_resident_memory_bytes gauge\n");
+    fprintf(aFile, "teleprompter_resident_memory_bytes %llu\n", (unsigned long long)getResidentKiB() * 1024u);
+}
+
+/**
+ * @brief exportMetrics Write actual snapshot to the exported file atomically.
+ */
+static void exportMetrics(void)
+{
+    metricsSnapshot_t snapshot;
+    char              path[MAX_PATH_LEN + 8];
+    FILE            * file;
+    bool_t            ok;
+
+    if (!readSnapshot(&snapshot))
+    {
+        return;
+    }
+    snprintf(path, sizeof(path), "%s.tmp", metrics.path);
+    file = fopen(path, "w");
+    if (file)
+    {
+        writeMetrics(file, &snapshot);
+        ok = !ferror(file);
+        ok = fclose(file) == 0 && ok;
+        if (ok && rename(path, metrics.path) == 0)
+        {
+            metrics.exports++;
+        }
+        else
+        {
+            unlink(path);
+        }
+    }
+}
+
+/**
+ * @brief metricsThread Export snapshots until metrics are stopped.
+ */
+static int metricsThread(void * aParam)
+{
+    uint32_t waitedMs = 0;
+
+    (void)aParam;
+    while (!metrics.stop)
+    {
+        SDL_Delay(METRICS_POLL_MS);
+        waitedMs += METRICS_POLL_MS;
+        if (waitedMs >= METRICS_PERIOD_MS)
+        {
+            exportMetrics();
+            waitedMs = 0;
+        }
+    }
+    /* Last values are kept for the scraper */
+    exportMetrics();
+
+    return 0;
+}
+
+/**
+ * @brief initMetrics Start exporter thread.
+ *
+ * @param aPath[in]     Exported file, empty: metrics are not exported.
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initMetrics(const char * aPath)
+{
+    memset(&metrics, 0, sizeof(metrics));
+    metrics.publishTick = getTicks();
+    if (aPath[0])
+    {
+        strncpy(metrics.path, aPath, sizeof(metrics.path) - 1);
+        metrics.thread = SDL_CreateThread(metricsThread, NULL);
+        if (metrics.thread == NULL)
+        {
+            errorprintf("SDL_CreateThread() Failed: %s\n", SDL_GetError());
+            return FALSE;
+        }
+        verboseprintf("Exporting metrics to '%s'\n", metrics.path);
+    }
+
+    return TRUE;
+}
+
+/**
+ * @brief metricsFrameDone Count time of a drawn frame in histogram.
+ *
+ * @param aFrameUs[in]  Time of drawing frame.
+ */
+void metricsFrameDone(uint32_t aFrameUs)
+{
+    uint32_t i;
+
+    for (i = 0; i < METRICS_BUCKET_COUNT - 1 && aFrameUs > bucketLimitsUs[i]; i++)
+    {
+    }
+    metrics.frameBuckets[i]++;
+    metrics.frameUsTotal += aFrameUs;
+    if (aFrameUs > qualityManager.budgetUs)
+    {
+        metrics.framesDropped++;
+    }
+}
+
+/**
+ * @brief publishMetrics Publish a snapshot for the exporter thread. It shall
+ * be called in every loop iteration, snapshot is written only once per
+ * METRICS_PERIOD_MS.
+ *
+ * @param aWrappedScript[in]    Shown script.
+ */
+void publishMetrics(wrappedScript_t * aWrappedScript)
+{
+    metricsSnapshot_t * snapshot = &metrics.snapshot;
+    linkedListElement_t * line = aWrappedScript->wrappedScriptList.actual;
+    uint32_t            now = getTicks();
+    uint32_t            elapsed = now - metrics.publishTick;
+    uint64_t            positionPx = 0;
+
+    if (!metrics.thread || elapsed < METRICS_PERIOD_MS)
+    {
+        return;
+    }
+
+    if (line && aWrappedScript->lineCount)
+    {
+        positionPx = (uint64_t)getScriptLineIndex(aWrappedScript, line) * aWrappedScript->wrappedScriptHeightPx
+                     + aWrappedScript->heightOffsetPx;
+    }
+
+    metrics.sequence++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    snapshot->uptimeMs = now - stats.startTick;
+    snapshot->framesRendered = stats.framesRendered;
+    snapshot->framesSkipped = stats.framesSkipped;
+    snapshot->framesDropped = metrics.framesDropped;
+    memcpy(snapshot->frameBuckets, metrics.frameBuckets, sizeof(snapshot->frameBuckets));
+    snapshot->frameUsTotal = metrics.frameUsTotal;
+    snapshot->scrollVelocityPxPerSec = ((int64_t)positionPx - (int64_t)metrics.publishPositionPx) * 1000 / elapsed;
+    snapshot->scrollPositionPx = positionPx;
+    snapshot->lineCacheHits = lineCache.hits;
+    snapshot->lineCacheMisses = lineCache.misses;
+    snapshot->layoutUs = aWrappedScript->layoutUs;
+    snapshot->lineCount = aWrappedScript->lineCount;
+    snapshot->qualityTier = qualityManager.tier;
+    memcpy(snapshot->latencyBuckets, latency.buckets, sizeof(snapshot->latencyBuckets));
+    snapshot->latencyUsTotal = latency.totalUs;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    metrics.sequence++;
+
+    metrics.publishTick = now;
+    metrics.publishPositionPx = positionPx;
+}
+
+/**
+ * @brief printMetricsStats Print statistics of exporter to console.
+ */
+void printMetricsStats(void)
+{
+    uint32_t i;
+
+    printf("Dropped frames:                   %llu\n", (unsigned long long)metrics.framesDropped);
+    printf("Frame time histogram:            ");
+    for (i = 0; i < METRICS_BUCKET_COUNT; i++)
+    {
+        if (i < METRICS_BUCKET_COUNT - 1)
+        {
+            printf(" <=%uus: %llu", bucketLimitsUs[i], (unsigned long long)metrics.frameBuckets[i]);
+        }
+        else
+        {
+            printf(" more: %llu", (unsigned long long)metrics.frameBuckets[i]);
+        }
+    }
+    printf("\n");
+    if (metrics.path[0])
+    {
+        printf("Metrics exports/retries:          %u / %u\n", metrics.exports, metrics.retries);
+    }
+}
+
+/**
+ * @brief doneMetrics Stop exporter thread. Exported file is left in place.
+ */
+void doneMetrics(void)
+{
+    if (metrics.thread)
+    {
+        metrics.stop = TRUE;
+        SDL_WaitThread(metrics.thread, NULL);
+        metrics.thread = NULL;
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * @file        metrics.h
+ * @brief       Export of runtime metrics for monitoring
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-04 19:52:07
+ * Last modify: 2021-03-04 19:52:07 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_METRICS_H
+#define INCLUDE_METRICS_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+
+#include "common.h"
+#include "script.h"
+#include "latency.h"
+
+#define METRICS_PERIOD_MS           1000    /* Snapshot is published and exported in this period */
+#define METRICS_POLL_MS             50      /* Exporter checks for exit in this period */
+#define METRICS_BUCKET_COUNT        8       /* Buckets of frame time histogram, last one is +Inf */
+
+/* Values published by main loop. Exporter thread reads them without lock,
+ * see metrics_t. */
+typedef struct
+{
+    uint32_t        uptimeMs;
+    uint64_t        framesRendered;
+    uint64_t        framesSkipped;          /* Loop iterations without new frame */
+    uint64_t        framesDropped;          /* Frames which took longer than frame budget */
+    uint64_t        frameBuckets[METRICS_BUCKET_COUNT]; /* Count of frames per bucket, not cumulative */
+    uint64_t        frameUsTotal;           /* Sum of frame times */
+    int32_t         scrollVelocityPxPerSec; /* Positive: text moves up */
+    uint64_t        scrollPositionPx;       /* Distance of shown line from start of script */
+    uint64_t        lineCacheHits;
+    uint64_t        lineCacheMisses;
+    uint32_t        layoutUs;               /* Time of last wrap of script */
+    uint64_t        lineCount;              /* Lines of layout */
+    uint8_t         qualityTier;
+    uint64_t        latencyBuckets[LATENCY_BUCKET_COUNT]; /* Count of inputs per bucket, not cumulative */
+    uint64_t        latencyUsTotal;         /* Sum of input latencies */
+} metricsSnapshot_t;
+
+/* Snapshot is guarded by a sequence lock: writer makes sequence odd while it
+ * changes the snapshot, reader copies it and retries if sequence was odd or
+ * changed meanwhile. Main loop never waits for the exporter. */
+typedef struct
+{
+    SDL_Thread        * thread;             /* Exporter thread, NULL if not running */
+    char                path[MAX_PATH_LEN]; /* Exported file */
+    volatile uint32_t   sequence;
+    metricsSnapshot_t   snapshot;
+    volatile bool_t     stop;               /* TRUE: exporter thread shall exit */
+    /* Collected by main loop, only main loop uses them */
+    uint64_t            framesDropped;
+    uint64_t            frameBuckets[METRICS_BUCKET_COUNT];
+    uint64_t            frameUsTotal;
+    uint32_t            publishTick;        /* Tick of last published snapshot */
+    uint64_t            publishPositionPx;  /* Scroll position of last published snapshot */
+    /* Statistics of exporter */
+    uint32_t            exports;
+    uint32_t            retries;            /* Snapshots read again because main loop was writing */
+} metrics_t;
+
+extern metrics_t metrics;
+
+bool_t initMetrics(const char * aPath);
+void metricsFrameDone(uint32_t aFrameUs);
+void publishMetrics(wrappedScript_t * aWrappedScript);
+void printMetricsStats(void);
+void doneMetrics(void);
+
+#endif /* INCLUDE_METRICS_H */
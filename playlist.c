@@ -0,0 +1,152 @@
+/**
+ * @file        playlist.c
+ * @brief       Scripts shown one after the other
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-01 19:42:10
+ * Last modify: 2021-03-01 19:42:10 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * A show is made of segments, every segment is a script file. Scripts can be
+ * listed after -s or in a playlist file, one path per line. Relative paths of
+ * a playlist file are relative to the directory of playlist file.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "playlist.h"
+
+/**
+ * @brief addPlaylistItem Append a script to the end of playlist.
+ *
+ * @param aPlaylist[in,out] Playlist.
+ * @param aPath[in]         Path of script.
+ * @return TRUE: if script was added.
+ */
+bool_t addPlaylistItem(playlist_t * aPlaylist, const char * aPath)
+{
+    uint32_t size;
+    char  (* items)[MAX_PATH_LEN];
+
+    if (strlen(aPath) >= MAX_PATH_LEN)
+    {
+        errorprintf("Script file path is too long: %s\n", aPath);
+        return FALSE;
+    }
+    if (aPlaylist->count >= aPlaylist->size)
+    {
+        size = MAX(aPlaylist->size * 2, PLAYLIST_MIN_COUNT);
+        items = realloc(aPlaylist->items, size * sizeof(aPlaylist->items[0]));
+        if (items == NULL)
+        {
+            errorprintf("Cannot allocate memory for playlist!\n");
+            return FALSE;
+        }
+        aPlaylist->items = items;
+        aPlaylist->size = size;
+    }
+    strcpy(aPlaylist->items[aPlaylist->count], aPath);
+    aPlaylist->count++;
+
+    return TRUE;
+}
+
+/**
+ * @brief addPlaylistFile Append scripts of a playlist file. Empty lines and
+ * lines starting with PLAYLIST_COMMENT are skipped.
+ *
+ * @param aPlaylist[in,out] Playlist.
+ * @param aPath[in]         Path of playlist file.
+ * @return TRUE: if every script was added.
+ */
+bool_t addPlaylistFile(playlist_t * aPlaylist, const char * aPath)
+{
+    FILE     * file;
+    char       line[MAX_PATH_LEN];
+    char       path[MAX_PATH_LEN];
+    char     * item;
+    const char * slash = strrchr(aPath, '/');
+    int        dirLength = slash ? (int)(slash - aPath + 1) : 0;
+    size_t     len;
+    bool_t     ok = TRUE;
+
+    verboseprintf("Loading playlist '%s'...\n", aPath);
+    file = fopen(aPath, "r");
+    if (file == NULL)
+    {
+        errorprintf("Cannot open playlist '%s'!\n", aPath);
+        return FALSE;
+    }
+    while (ok && fgets(line, sizeof(line), file))
+    {
+        item = line;
+        while (IS_WHITESPACE(*item))
+        {
+            item++;
+        }
+        len = strlen(item);
+        while (len && IS_WHITESPACE(item[len - 1]))
+        {
+            item[--len] = CHR_EOS;
+        }
+        if (len == 0 || item[0] == PLAYLIST_COMMENT)
+        {
+            continue;
+        }
+        if (item[0] == '/' || dirLength == 0)
+        {
+            ok = addPlaylistItem(aPlaylist, item);
+        }
+        else if (snprintf(path, sizeof(path), "%.*s%s", dirLength, aPath, item) < (int)sizeof(path))
+        {
+            ok = addPlaylistItem(aPlaylist, path);
+        }
+        else
+        {
+            errorprintf("Script file path is too long: %s\n", item);
+            ok = FALSE;
+        }
+    }
+    fclose(file);
+
+    return ok;
+}
+
+/**
+ * @brief getPlaylistItem Get path of a script.
+ *
+ * @param aPlaylist[in] Playlist.
+ * @param aIndex[in]    Index of script.
+ * @return Path of script or NULL if index is out of playlist.
+ */
+const char * getPlaylistItem(const playlist_t * aPlaylist, uint32_t aIndex)
+{
+    return aIndex < aPlaylist->count ? aPlaylist->items[aIndex] : NULL;
+}
+
+/**
+ * @brief getNextPlaylistIndex Get index of script shown after the current
+ * one. The first script follows the last one, so the show can be replayed.
+ *
+ * @param aPlaylist[in] Playlist.
+ * @return Index of next script.
+ */
+uint32_t getNextPlaylistIndex(const playlist_t * aPlaylist)
+{
+    return aPlaylist->count ? (aPlaylist->current + 1) % aPlaylist->count : 0;
+}
+
+/**
+ * @brief freePlaylist Release items of playlist.
+ *
+ * @param aPlaylist[in,out] Playlist to release.
+ */
+void freePlaylist(playlist_t * aPlaylist)
+{
+    free(aPlaylist->items);
+    memset(aPlaylist, 0, sizeof(*aPlaylist));
+}
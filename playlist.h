@@ -0,0 +1,37 @@
+/**
+ * @file        playlist.h
+ * @brief       Scripts shown one after the other
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-01 19:42:10
+ * Last modify: 2021-03-01 19:42:10 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_PLAYLIST_H
+#define INCLUDE_PLAYLIST_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define PLAYLIST_MIN_COUNT          8       /* Initial count of items */
+#define PLAYLIST_FILE_PREFIX        '@'     /* Argument "@shows.txt" means a file of script paths */
+#define PLAYLIST_COMMENT            '#'     /* Lines of playlist file starting with this are skipped */
+
+/* Paths of scripts in order of show */
+typedef struct
+{
+    char         (* items)[MAX_PATH_LEN];   /* Paths of scripts */
+    uint32_t        count;                  /* Count of items */
+    uint32_t        size;                   /* Count of allocated items */
+    uint32_t        current;                /* Index of shown script */
+} playlist_t;
+
+bool_t addPlaylistItem(playlist_t * aPlaylist, const char * aPath);
+bool_t addPlaylistFile(playlist_t * aPlaylist, const char * aPath);
+const char * getPlaylistItem(const playlist_t * aPlaylist, uint32_t aIndex);
+uint32_t getNextPlaylistIndex(const playlist_t * aPlaylist);
+void freePlaylist(playlist_t * aPlaylist);
+
+#endif /* INCLUDE_PLAYLIST_H */
@@ -0,0 +1,198 @@
+/**
+ * @file        present.c
+ * @brief       Presentation of composed frames
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-25 20:05:31
+ * Last modify: 2021-02-25 20:05:31 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Video mode is set with hardware double buffering if it is available,
+ * otherwise with a software surface. When rendering ahead, frames are
+ * composed in a back buffer in system memory and only the final copy
+ * touches the display surface. Alpha blending of text needs reading the
+ * destination which is slow in video memory, and locking a page flipped
+ * surface waits for the previous flip. Therefore next frame can be composed
+ * while the previous one is still being flipped.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "present.h"
+#include "stats.h"
+#include "latency.h"
+#include "replay.h"
+
+present_t present;
+
+/**
+ * @brief getPresentModeName Get name of presentation mode.
+ *
+ * @param aMode[in] Mode.
+ * @return Name of mode.
+ */
+const char * getPresentModeName(presentMode_t aMode)
+{
+    static const char * names[PRESENT_MODE_count] = { "auto", "software", "hardware" };
+
+    return aMode < PRESENT_MODE_count ? names[aMode] : "?";
+}
+
+/**
+ * @brief getPresentPathName Get name of presentation path.
+ *
+ * @param aPath[in] Path.
+ * @return Name of path.
+ */
+const char * getPresentPathName(presentPath_t aPath)
+{
+    static const char * names[PRESENT_PATH_count] = { "software surface", "hardware surface", "hardware double buffer" };
+
+    return aPath < PRESENT_PATH_count ? names[aPath] : "?";
+}
+
+/**
+ * @brief createBackBuffer Create surface in system memory with the format of
+ * display surface.
+ *
+ * @return Back buffer. NULL: error occurred.
+ */
+static SDL_Surface * createBackBuffer(void)
+{
+    SDL_PixelFormat * format = present.display->format;
+    SDL_Surface     * surface;
+
+    surface = SDL_CreateRGBSurface(SDL_SWSURFACE, present.display->w, present.display->h,
+                                   format->BitsPerPixel, format->Rmask, format->Gmask, format->Bmask, 0);
+    if (!surface)
+    {
+        errorprintf("Cannot create back buffer: %s\n", SDL_GetError());
+    }
+
+    return surface;
+}
+
+/**
+ * @brief presentInit Set video mode and prepare presentation. It can be called
+ * again to change the mode, surface returned earlier is invalid after that.
+ *
+ * @param aWidthPx[in]      Width of display.
+ * @param aHeightPx[in]     Height of display.
+ * @param aDepthBit[in]     Color depth of display.
+ * @param aFullScreen[in]   TRUE: full screen mode.
+ * @return Surface where frames shall be composed. NULL: error occurred.
+ */
+SDL_Surface * presentInit(uint16_t aWidthPx, uint16_t aHeightPx, uint8_t aDepthBit, bool_t aFullScreen)
+{
+    Uint32 flags = aFullScreen ? SDL_FULLSCREEN : 0;
+
+    presentDone();
+
+    if (config.present_mode != PRESENT_MODE_software)
+    {
+        present.display = SDL_SetVideoMode(aWidthPx, aHeightPx, aDepthBit, flags | SDL_HWSURFACE | SDL_DOUBLEBUF);
+    }
+    if (!present.display)
+    {
+        present.display = SDL_SetVideoMode(aWidthPx, aHeightPx, aDepthBit, flags | SDL_SWSURFACE);
+    }
+
+    if (present.display)
+    {
+        if ((present.display->flags & (SDL_HWSURFACE | SDL_DOUBLEBUF)) == (SDL_HWSURFACE | SDL_DOUBLEBUF))
+        {
+            present.path = PRESENT_PATH_hardware_double;
+        }
+        else if (present.display->flags & SDL_HWSURFACE)
+        {
+            present.path = PRESENT_PATH_hardware_single;
+        }
+        else
+        {
+            present.path = PRESENT_PATH_software;
+        }
+        if (config.present_mode == PRESENT_MODE_hardware && present.path == PRESENT_PATH_software)
+        {
+            errorprintf("Hardware surface is not available, using software surface!\n");
+        }
+
+        /* Display surface is already in system memory in case of software path */
+        if (config.render_ahead && present.path != PRESENT_PATH_software)
+        {
+            present.backBuffer = createBackBuffer();
+        }
+        verboseprintf("Present path: %s, mode: %s, render ahead: %s\n",
+                      getPresentPathName(present.path), getPresentModeName(config.present_mode),
+                      present.backBuffer ? "yes" : "no");
+
+        present.frames = 0;
+        present.totalUs = 0;
+        present.maxUs = 0;
+    }
+    else
+    {
+        errorprintf("SDL_SetVideoMode() Failed: %s\n", SDL_GetError());
+    }
+
+    return present.backBuffer ? present.backBuffer : present.display;
+}
+
+/**
+ * @brief presentFrame Show composed frame on display.
+ */
+void presentFrame(void)
+{
+    uint64_t startUs = getTimeUs();
+    uint32_t us;
+
+    if (present.backBuffer)
+    {
+        SDL_BlitSurface(present.backBuffer, NULL, present.display, NULL);
+    }
+    replayPresent(present.display);
+    SDL_Flip(present.display);
+    latencyFramePresented();
+
+    us = (uint32_t)(getTimeUs() - startUs);
+    present.frames++;
+    present.totalUs += us;
+    present.maxUs = MAX(present.maxUs, us);
+    if (present.frames == PRESENT_PROBE_FRAMES)
+    {
+        /* Cost is measured on real frames, nothing is presented only to measure it */
+        verboseprintf("Present cost: %llu us average, %u us maximum\n",
+                      (unsigned long long)(present.totalUs / present.frames), present.maxUs);
+    }
+}
+
+/**
+ * @brief printPresentStats Print chosen path and cost of presenting to console.
+ */
+void printPresentStats(void)
+{
+    printf("Present path:                     %s%s\n", getPresentPathName(present.path),
+           present.backBuffer ? ", render ahead" : "");
+    if (present.frames)
+    {
+        printf("Present cost:                     %llu us average, %u us maximum\n",
+               (unsigned long long)(present.totalUs / present.frames), present.maxUs);
+    }
+}
+
+/**
+ * @brief presentDone Release back buffer. Display surface is freed by SDL.
+ */
+void presentDone(void)
+{
+    if (present.backBuffer)
+    {
+        SDL_FreeSurface(present.backBuffer);
+        present.backBuffer = NULL;
+    }
+    present.display = NULL;
+}
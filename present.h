@@ -0,0 +1,57 @@
+/**
+ * @file        present.h
+ * @brief       Presentation of composed frames
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-25 20:05:31
+ * Last modify: 2021-02-25 20:05:31 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_PRESENT_H
+#define INCLUDE_PRESENT_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+
+#define PRESENT_PROBE_FRAMES        4       /* Cost of first frames after presentInit() is printed in verbose mode */
+
+typedef enum
+{
+    PRESENT_MODE_auto,          /**< Try hardware double buffering, fall back to software */
+    PRESENT_MODE_software,      /**< Always use software surface */
+    PRESENT_MODE_hardware,      /**< Hardware surface is requested, warn if not available */
+    PRESENT_MODE_count          /**< Not a real mode, only to count modes */
+} presentMode_t;
+
+typedef enum
+{
+    PRESENT_PATH_software,          /**< Display surface in system memory, SDL_Flip() copies it out */
+    PRESENT_PATH_hardware_single,   /**< Display surface in video memory without page flipping */
+    PRESENT_PATH_hardware_double,   /**< Page flipped display surface in video memory */
+    PRESENT_PATH_count              /**< Not a real path, only to count paths */
+} presentPath_t;
+
+typedef struct
+{
+    SDL_Surface   * display;        /* Surface returned by SDL_SetVideoMode() */
+    SDL_Surface   * backBuffer;     /* Frames are composed here when rendering ahead, otherwise NULL */
+    presentPath_t   path;           /* Chosen path */
+    uint64_t        frames;         /* Count of presented frames */
+    uint64_t        totalUs;        /* Sum of present times */
+    uint32_t        maxUs;          /* Longest present time */
+} present_t;
+
+extern present_t present;
+
+const char * getPresentModeName(presentMode_t aMode);
+const char * getPresentPathName(presentPath_t aPath);
+SDL_Surface * presentInit(uint16_t aWidthPx, uint16_t aHeightPx, uint8_t aDepthBit, bool_t aFullScreen);
+void presentFrame(void);
+void printPresentStats(void);
+void presentDone(void);
+
+#endif /* INCLUDE_PRESENT_H */
@@ -0,0 +1,423 @@
+/**
+ * @file        preview.c
+ * @brief       Overview of whole script for the operator
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-02 20:05:48
+ * Last modify: 2021-03-02 20:05:48 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * The panel is drawn next to the text of talent. Script is not wrapped again
+ * for the panel: lines of the layout are taken from its line table and
+ * rendered once in background at a tiny font into one coverage mask. Every
+ * frame only the mask is drawn and the shown lines are marked, so the cost of
+ * a frame does not depend on the size of script.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "blend.h"
+#include "fontpool.h"
+#include "atlas.h"
+#include "rotate.h"
+#include "stats.h"
+#include "replay.h"
+#include "alloctrack.h"
+#include "edit.h"
+#include "preview.h"
+
+preview_t preview;
+
+/**
+ * @brief setPreviewState Change state of thumbnails. It can be called from any thread.
+ */
+static void setPreviewState(previewState_t aState)
+{
+    SDL_mutexP(preview.mutex);
+    preview.state = aState;
+    SDL_mutexV(preview.mutex);
+}
+
+/**
+ * @brief getPreviewState Get state of thumbnails without blocking.
+ */
+static previewState_t getPreviewState(void)
+{
+    previewState_t state;
+
+    SDL_mutexP(preview.mutex);
+    state = preview.state;
+    SDL_mutexV(preview.mutex);
+
+    return state;
+}
+
+/**
+ * @brief isPreviewDone Check if thumbnail thread is finished.
+ */
+static bool_t isPreviewDone(void * aParam)
+{
+    (void)aParam;
+
+    return getPreviewState() == PREVIEW_STATE_done;
+}
+
+/**
+ * @brief copyThumbnail Copy coverage of a line into the mask of thumbnails.
+ * Thumbnail is clipped to the width of mask and height of a row.
+ *
+ * @param aMask[in,out]     Mask of thumbnails.
+ * @param aLine[in]         Coverage of line.
+ * @param aY[in]            Top of row.
+ * @param aRowPx[in]        Height of row.
+ * @param aAlignCenter[in]  TRUE: thumbnail is centered in row.
+ */
+static void copyThumbnail(alphaMask_t * aMask, const alphaMask_t * aLine, uint32_t aY, uint16_t aRowPx,
+                          bool_t aAlignCenter)
+{
+    uint16_t width = MIN(aLine->w, aMask->w);
+    uint16_t height = MIN(aLine->h, aRowPx);
+    uint16_t x = (aAlignCenter && aLine->w < aMask->w) ? (aMask->w - aLine->w) / 2 : 0;
+    uint16_t y;
+
+    for (y = 0; y < height && aY + y < aMask->h; y++)
+    {
+        memcpy(&aMask->pixels[(aY + y) * aMask->w + x], &aLine->pixels[y * aLine->w], width);
+    }
+}
+
+/**
+ * @brief previewThread Render thumbnails of sampled lines. It runs in
+ * separate thread, so it uses its own instance of the tiny font.
+ *
+ * @param aParam Not used.
+ * @return 0: if thumbnails were rendered.
+ */
+static int previewThread(void * aParam)
+{
+    TTF_Font    * pooledFont = NULL;
+    TTF_Font    * font = NULL;
+    alphaMask_t * mask;
+    alphaMask_t * line;
+    const atlasFont_t * atlas;
+    const char  * text = preview.texts;
+    uint64_t      start_us = getTimeUs();
+    uint32_t      i;
+
+    (void)aParam;
+    enterAllocScope(ALLOC_SUBSYSTEM_preview);
+    if (strlen(preview.ttfFilePath))
+    {
+        pooledFont = acquireFont(preview.ttfFilePath, preview.fontSize);
+    }
+    if (pooledFont == NULL)
+    {
+        pooledFont = acquireFont(FONT_SOURCE_EMBEDDED, preview.fontSize);
+    }
+    /* Main thread can draw with the same font of pool */
+    font = openPrivateFont(pooledFont);
+    atlas = getFontAtlas(pooledFont);
+
+    mask = malloc(sizeof(alphaMask_t) + (size_t)preview.width * preview.slotCount * preview.rowPx);
+    if (mask)
+    {
+        mask->w = preview.width;
+        mask->h = preview.slotCount * preview.rowPx;
+        mask->padding = 0;
+        mask->pixels = (uint8_t *)(mask + 1);
+        memset(mask->pixels, 0, (size_t)mask->w * mask->h);
+        for (i = 0; i < preview.slotCount && font; i++)
+        {
+            if (text[0] != CHR_EOS)
+            {
+                line = renderText(font, atlas, text, FALSE);
+                if (line)
+                {
+                    copyThumbnail(mask, line, i * preview.rowPx, preview.rowPx, preview.alignCenter);
+                    freeAlphaMask(line);
+                }
+            }
+            text += strlen(text) + 1;
+        }
+    }
+    else
+    {
+        errorprintf("Cannot allocate memory for preview!\n");
+    }
+
+    closePrivateFont(font);
+    releaseFont(pooledFont);
+    /* Thumbnails are rotated here, so drawing the panel costs the same in any orientation */
+    preview.building = rotateAlphaMask(mask);
+    preview.buildUs = getTimeUs() - start_us;
+    setPreviewState(PREVIEW_STATE_done);
+
+    return mask ? 0 : 1;
+}
+
+/**
+ * @brief startPreview Sample lines of layout and start rendering their
+ * thumbnails in background.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ */
+static void startPreview(wrappedScript_t * aWrappedScript)
+{
+    size_t    size = 0;
+    size_t    len;
+    uint32_t  i;
+    char    * text;
+    const char * line;
+
+    strncpy(preview.ttfFilePath, config.ttf_file_path, sizeof(preview.ttfFilePath) - 1);
+    preview.width = MAX(getPreviewWidth() - 2 * PREVIEW_MARGIN_PX - PREVIEW_MARKER_PX, 1);
+    preview.fontSize = MAX(PREVIEW_MIN_FONT_SIZE, config.ttf_size * preview.width / MAX(aWrappedScript->maxWidthPx, 1));
+    preview.rowPx = MAX(aWrappedScript->wrappedScriptHeightPx * preview.fontSize / MAX(config.ttf_size, 1), 1);
+    preview.alignCenter = config.align_center;
+    preview.layoutGeneration = aWrappedScript->generation;
+    preview.layoutRevision = aWrappedScript->revision;
+    preview.height = config.video_size_y_px;
+    preview.slotCount = MIN(aWrappedScript->lineCount,
+                            (uint32_t)MAX(preview.height - 2 * PREVIEW_MARGIN_PX, 0) / preview.rowPx);
+    if (preview.slotCount == 0)
+    {
+        return;
+    }
+
+    /* Sampled lines are copied, layout can change while thumbnails are rendered */
+    for (i = 0; i < preview.slotCount; i++)
+    {
+        line = aWrappedScript->lineTable[(uint64_t)i * aWrappedScript->lineCount / preview.slotCount]->item;
+        size += strlen(line) + 1;
+    }
+    free(preview.texts);
+    preview.texts = malloc(MAX(size, 1));
+    if (preview.texts == NULL)
+    {
+        errorprintf("Cannot allocate memory for preview!\n");
+        return;
+    }
+    text = preview.texts;
+    for (i = 0; i < preview.slotCount; i++)
+    {
+        line = aWrappedScript->lineTable[(uint64_t)i * aWrappedScript->lineCount / preview.slotCount]->item;
+        len = strlen(line) + 1;
+        memcpy(text, line, len);
+        text += len;
+    }
+
+    setPreviewState(PREVIEW_STATE_busy);
+    preview.starts++;
+    preview.thread = SDL_CreateThread(previewThread, NULL);
+    if (preview.thread == NULL)
+    {
+        errorprintf("SDL_CreateThread() Failed: %s\n", SDL_GetError());
+        setPreviewState(PREVIEW_STATE_idle);
+    }
+}
+
+/**
+ * @brief isPreviewStale Check if layout or panel changed since thumbnails
+ * were started.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @return TRUE: if thumbnails shall be rendered again.
+ */
+static bool_t isPreviewStale(wrappedScript_t * aWrappedScript)
+{
+    uint16_t width = MAX(getPreviewWidth() - 2 * PREVIEW_MARGIN_PX - PREVIEW_MARKER_PX, 1);
+
+    return preview.builds == 0
+        || preview.layoutGeneration != aWrappedScript->generation
+        /* Thumbnails are not rendered again for every key typed, only when editing stops */
+        || (preview.layoutRevision != aWrappedScript->revision && !editPrompt.active)
+        || preview.width != width
+        || preview.alignCenter != config.align_center
+        || preview.height != config.video_size_y_px
+        || strcmp(preview.ttfFilePath, config.ttf_file_path);
+}
+
+/**
+ * @brief initPreview Initialize preview.
+ *
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initPreview(void)
+{
+    memset(&preview, 0, sizeof(preview));
+    preview.mutex = SDL_CreateMutex();
+    if (preview.mutex == NULL)
+    {
+        errorprintf("SDL_CreateMutex() Failed: %s\n", SDL_GetError());
+    }
+
+    return preview.mutex != NULL;
+}
+
+/**
+ * @brief getPreviewWidth Get width of preview panel. Text of talent is
+ * centered on the rest of screen.
+ *
+ * @return Width of panel in pixels, 0 if preview is not shown.
+ */
+uint16_t getPreviewWidth(void)
+{
+    return config.show_preview ? config.video_size_x_px * PREVIEW_WIDTH_PERCENT / 100 : 0;
+}
+
+/**
+ * @brief getWrapWidth Get width of wrapped text. Text fits beside the
+ * preview panel, so script is wrapped again when panel is toggled.
+ *
+ * @param aConfig[in]   Configuration to use.
+ * @return Maximum width of text in pixels.
+ */
+uint16_t getWrapWidth(const config_t * aConfig)
+{
+    uint16_t widthPx = (float)aConfig->video_size_x_px * aConfig->text_width_percent / 100.0f;
+    uint16_t panelPx = aConfig->show_preview ? aConfig->video_size_x_px * PREVIEW_WIDTH_PERCENT / 100 : 0;
+
+    return MIN(widthPx, aConfig->video_size_x_px - panelPx);
+}
+
+/**
+ * @brief updatePreview Take finished thumbnails and start rendering new
+ * ones if layout has changed. It shall be called before the frame key is
+ * made, since new thumbnails change the frame.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ */
+void updatePreview(wrappedScript_t * aWrappedScript)
+{
+    if (!config.show_preview)
+    {
+        return;
+    }
+
+    if (preview.thread && replaySync(REPLAY_GATE_PREVIEW, preview.starts, isPreviewDone, NULL))
+    {
+        SDL_WaitThread(preview.thread, NULL);
+        preview.thread = NULL;
+        if (preview.building)
+        {
+            freeAlphaMask(preview.mask);
+            preview.mask = preview.building;
+            preview.building = NULL;
+            preview.shownSlotCount = preview.slotCount;
+            preview.shownRowPx = preview.rowPx;
+            preview.generation++;
+        }
+        preview.builds++;
+        free(preview.texts);
+        preview.texts = NULL;
+        setPreviewState(PREVIEW_STATE_idle);
+        verboseprintf("Preview: %u thumbnails at font size %u rendered in %u us\n",
+                      preview.slotCount, preview.fontSize, preview.buildUs);
+    }
+
+    if (!preview.thread && aWrappedScript->wrappedScriptList.first && isPreviewStale(aWrappedScript))
+    {
+        startPreview(aWrappedScript);
+    }
+}
+
+/**
+ * @brief drawPreview Draw preview panel with the shown lines marked.
+ *
+ * @param aScreen[in,out]       Surface to draw to.
+ * @param aWrappedScript[in]    Wrapped script.
+ */
+void drawPreview(SDL_Surface * aScreen, wrappedScript_t * aWrappedScript)
+{
+    SDL_Rect rect;
+    Uint32   backgroundColor;
+    Uint32   textColor;
+    size_t   index;
+    uint32_t first;
+    uint32_t last;
+    uint32_t us;
+    uint64_t start_us = getTimeUs();
+
+    if (!config.show_preview)
+    {
+        return;
+    }
+
+    backgroundColor = SDL_MapRGB(aScreen->format, config.background_color.r, config.background_color.g,
+                                 config.background_color.b);
+    textColor = SDL_MapRGB(aScreen->format, config.text_color.r, config.text_color.g, config.text_color.b);
+    rect.x = config.video_size_x_px - getPreviewWidth();
+    rect.y = 0;
+    rect.w = getPreviewWidth();
+    rect.h = config.video_size_y_px;
+    fillRotatedRect(aScreen, &rect, backgroundColor);
+    rect.w = 1;
+    fillRotatedRect(aScreen, &rect, textColor);
+
+    if (preview.mask)
+    {
+        /* Panel is filled with background color, so destination is not read */
+        drawRotatedAlphaMask(aScreen, rect.x + PREVIEW_MARGIN_PX + PREVIEW_MARKER_PX, PREVIEW_MARGIN_PX, preview.mask,
+                             config.text_color, config.background_color, BLEND_MODE_lut);
+    }
+    if (preview.shownSlotCount && aWrappedScript->wrappedScriptList.actual)
+    {
+        index = getScriptLineIndex(aWrappedScript, aWrappedScript->wrappedScriptList.actual);
+        if (aWrappedScript->lineCount)
+        {
+            first = (uint64_t)index * preview.shownSlotCount / aWrappedScript->lineCount;
+            last = (uint64_t)(index + aWrappedScript->linePerScreen) * preview.shownSlotCount
+                   / aWrappedScript->lineCount;
+            last = MIN(MAX(last, first + 1), preview.shownSlotCount);
+            rect.x += PREVIEW_MARGIN_PX;
+            rect.y = PREVIEW_MARGIN_PX + first * preview.shownRowPx;
+            rect.w = PREVIEW_MARKER_PX;
+            rect.h = MAX(last - first, 1) * preview.shownRowPx;
+            fillRotatedRect(aScreen, &rect, textColor);
+        }
+    }
+
+    us = getTimeUs() - start_us;
+    preview.avgDrawUs = (preview.avgDrawUs * 7 + us) / 8;
+    preview.maxDrawUs = MAX(preview.maxDrawUs, us);
+}
+
+/**
+ * @brief printPreviewStats Print statistics of preview to console.
+ */
+void printPreviewStats(void)
+{
+    printf("Preview thumbnail renders:        %u, last: %u us\n", preview.builds, preview.buildUs);
+    printf("Preview draw time avg/max:        %u / %u us\n", preview.avgDrawUs, preview.maxDrawUs);
+}
+
+/**
+ * @brief donePreview Wait for thumbnail thread and release thumbnails.
+ */
+void donePreview(void)
+{
+    if (preview.thread)
+    {
+        SDL_WaitThread(preview.thread, NULL);
+        preview.thread = NULL;
+    }
+    freeAlphaMask(preview.building);
+    freeAlphaMask(preview.mask);
+    free(preview.texts);
+    if (preview.mutex)
+    {
+        SDL_DestroyMutex(preview.mutex);
+    }
+    memset(&preview, 0, sizeof(preview));
+}
@@ -0,0 +1,78 @@
+/**
+ * @file        preview.h
+ * @brief       Overview of whole script for the operator
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-02 20:05:48
+ * Last modify: 2021-03-02 20:05:48 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_PREVIEW_H
+#define INCLUDE_PREVIEW_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_thread.h>
+#include <SDL/SDL_mutex.h>
+
+#include "common.h"
+#include "script.h"
+#include "blend.h"
+
+#define PREVIEW_WIDTH_PERCENT       20      /* Width of preview panel in percent of screen width */
+#define PREVIEW_MARGIN_PX           4       /* Space around thumbnails */
+#define PREVIEW_MARKER_PX           2       /* Width of marker of shown lines */
+#define PREVIEW_MIN_FONT_SIZE       4       /* Thumbnails are not rendered with smaller font */
+
+typedef enum
+{
+    PREVIEW_STATE_idle,         /**< Thumbnails are not being rendered. */
+    PREVIEW_STATE_busy,         /**< Thumbnail thread is running. */
+    PREVIEW_STATE_done,         /**< Thumbnails are ready to show. */
+} previewState_t;
+
+/* Thumbnails of lines are rendered once in background at a tiny font. If the
+ * script has more lines than the panel can show, lines are sampled evenly. */
+typedef struct
+{
+    SDL_Thread    * thread;                 /* Thumbnail thread, NULL if not running */
+    SDL_mutex     * mutex;                  /* Protects state */
+    previewState_t  state;
+    uint32_t        starts;                 /* Count of started thumbnail threads */
+    /* Parameters of thumbnails, they are copied from layout when thread is started */
+    char            ttfFilePath[MAX_PATH_LEN];
+    uint16_t        fontSize;               /* Size of tiny font */
+    uint16_t        width;                  /* Width of thumbnails */
+    uint16_t        rowPx;                  /* Height of a thumbnail */
+    uint16_t        height;                 /* Height of panel */
+    bool_t          alignCenter;
+    uint32_t        layoutGeneration;       /* Layout of thumbnails */
+    uint32_t        layoutRevision;
+    uint32_t        slotCount;              /* Count of thumbnails */
+    char          * texts;                  /* Text of sampled lines, separated by end of string */
+    alphaMask_t   * building;               /* Written by thumbnail thread */
+    uint32_t        buildUs;                /* Time of rendering thumbnails */
+    /* Shown thumbnails */
+    alphaMask_t   * mask;                   /* NULL: not rendered yet */
+    uint32_t        shownSlotCount;         /* Count of thumbnails in mask */
+    uint16_t        shownRowPx;             /* Height of a thumbnail in mask */
+    uint32_t        generation;             /* Incremented when mask changes */
+    /* Statistics */
+    uint32_t        builds;                 /* Count of rendered masks */
+    uint32_t        avgDrawUs;              /* Average time of drawing panel */
+    uint32_t        maxDrawUs;              /* Longest time of drawing panel */
+} preview_t;
+
+extern preview_t preview;
+
+bool_t initPreview(void);
+uint16_t getPreviewWidth(void);
+uint16_t getWrapWidth(const config_t * aConfig);
+void updatePreview(wrappedScript_t * aWrappedScript);
+void drawPreview(SDL_Surface * aScreen, wrappedScript_t * aWrappedScript);
+void printPreviewStats(void);
+void donePreview(void);
+
+#endif /* INCLUDE_PREVIEW_H */
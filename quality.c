@@ -0,0 +1,136 @@
+/**
+ * @file        quality.c
+ * @brief       Adaptive render quality
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-24 19:22:40
+ * Last modify: 2021-02-24 19:22:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Tier of text rendering is selected once per frame by measured frame time,
+ * so every line of a frame is rendered with the same tier. Faster tiers are
+ * used during manual scrolling, and quality is raised again when it settles.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "quality.h"
+#include "replay.h"
+
+qualityManager_t qualityManager =
+{
+    .tier = QUALITY_blended,
+};
+
+/**
+ * @brief getQualityName Get name of tier.
+ *
+ * @param aQuality[in]  Tier.
+ * @return Name of tier.
+ */
+const char * getQualityName(quality_t aQuality)
+{
+    static const char * names[QUALITY_count] = { "auto", "solid", "shaded", "blended" };
+
+    return aQuality < QUALITY_count ? names[aQuality] : "?";
+}
+
+/**
+ * @brief setTier Change tier and log it.
+ */
+static void setTier(quality_t aTier, const char * aReason)
+{
+    if (aTier != qualityManager.tier)
+    {
+        verboseprintf("Render quality: %s -> %s (%s, average frame: %u us, budget: %u us)\n",
+                      getQualityName(qualityManager.tier), getQualityName(aTier), aReason,
+                      qualityManager.avgFrameUs, qualityManager.budgetUs);
+        qualityManager.tier = aTier;
+        qualityManager.calmFrames = 0;
+        qualityManager.framesSinceChange = 0;
+        qualityManager.tierChanges++;
+    }
+}
+
+/**
+ * @brief selectQuality Select tier of next frame. It shall be called once
+ * before drawing a frame.
+ *
+ * @return Tier to use for every line of the frame.
+ */
+quality_t selectQuality(void)
+{
+    qualityManager.budgetUs = config.max_fps ? 1000000u / config.max_fps : QUALITY_DEFAULT_BUDGET_US;
+
+    if (config.render_quality != QUALITY_auto)
+    {
+        setTier(config.render_quality, "configured");
+    }
+    else if (qualityManager.fastMotionTick
+             && getTicks() - qualityManager.fastMotionTick < QUALITY_SETTLE_MS)
+    {
+        setTier(QUALITY_solid, "fast scrolling");
+    }
+    else if (qualityManager.avgFrameUs > qualityManager.budgetUs
+             && qualityManager.tier > QUALITY_solid
+             && qualityManager.framesSinceChange >= QUALITY_DOWNGRADE_FRAMES)
+    {
+        setTier(qualityManager.tier - 1, "over budget");
+    }
+    else if (qualityManager.tier < QUALITY_blended
+             && qualityManager.calmFrames >= QUALITY_UPGRADE_FRAMES)
+    {
+        setTier(qualityManager.tier + 1, "under budget");
+    }
+
+    return qualityManager.tier;
+}
+
+/**
+ * @brief getSettledQuality Get tier of a still script. Time of drawing does
+ * not matter if text does not move, so automatic mode uses the best tier.
+ *
+ * @return Tier to use for every line of the frame.
+ */
+quality_t getSettledQuality(void)
+{
+    return config.render_quality != QUALITY_auto ? config.render_quality : QUALITY_blended;
+}
+
+/**
+ * @brief qualityFrameDone Account render time of a frame.
+ *
+ * @param aFrameUs[in]  Time of drawing the frame in microseconds.
+ */
+void qualityFrameDone(uint32_t aFrameUs)
+{
+    /* Exponential moving average, 1/8 weight of new sample */
+    qualityManager.avgFrameUs = (qualityManager.avgFrameUs * 7u + aFrameUs) / 8u;
+    qualityManager.framesSinceChange++;
+    if (qualityManager.avgFrameUs < qualityManager.budgetUs / 2u)
+    {
+        qualityManager.calmFrames++;
+    }
+    else
+    {
+        qualityManager.calmFrames = 0;
+    }
+}
+
+/**
+ * @brief qualityFastMotion Notify that text is scrolled manually. Fast tier
+ * is used until QUALITY_SETTLE_MS passes without manual scrolling.
+ */
+void qualityFastMotion(void)
+{
+    qualityManager.fastMotionTick = getTicks();
+    if (!qualityManager.fastMotionTick)
+    {
+        qualityManager.fastMotionTick = 1;
+    }
+}
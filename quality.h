@@ -0,0 +1,51 @@
+/**
+ * @file        quality.h
+ * @brief       Adaptive render quality
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-24 19:22:40
+ * Last modify: 2021-02-24 19:22:40 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_QUALITY_H
+#define INCLUDE_QUALITY_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define QUALITY_SETTLE_MS           500     /* Fast tier is used this long after manual scrolling */
+#define QUALITY_UPGRADE_FRAMES      30      /* Frames well under budget before upgrading */
+#define QUALITY_DOWNGRADE_FRAMES    8       /* Frames after a change before downgrading again */
+#define QUALITY_DEFAULT_BUDGET_US   16667   /* Frame budget if frame rate is not limited */
+
+typedef enum
+{
+    QUALITY_auto,               /**< Only for configuration: tier is selected by frame time */
+    QUALITY_solid,              /**< Not anti-aliased, color keyed */
+    QUALITY_shaded,             /**< Anti-aliased on known background color */
+    QUALITY_blended,            /**< Anti-aliased with alpha channel */
+    QUALITY_count               /**< Not a real tier, only to count tiers */
+} quality_t;
+
+typedef struct
+{
+    quality_t   tier;                       /* Tier of actual frame */
+    uint32_t    budgetUs;                   /* Target frame time */
+    uint32_t    avgFrameUs;                 /* Average render time of frames */
+    uint32_t    calmFrames;                 /* Count of consecutive frames well under budget */
+    uint32_t    framesSinceChange;          /* Count of frames since last tier change */
+    uint32_t    fastMotionTick;             /* Tick of last manual scroll */
+    uint32_t    tierChanges;                /* Count of tier changes */
+} qualityManager_t;
+
+extern qualityManager_t qualityManager;
+
+const char * getQualityName(quality_t aQuality);
+quality_t selectQuality(void);
+quality_t getSettledQuality(void);
+void qualityFrameDone(uint32_t aFrameUs);
+void qualityFastMotion(void);
+
+#endif /* INCLUDE_QUALITY_H */
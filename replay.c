@@ -0,0 +1,851 @@
+/**
+ * @file        replay.c
+ * @brief       Recording and replaying of input
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-03 21:14:26
+ * Last modify: 2021-03-03 21:14:26 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * A session is recorded as iterations of main loop. Every iteration has the
+ * time of SDL_GetTicks() and the input read by eventHandler(), so replay
+ * goes through the same iterations with the same virtual time. Iterations
+ * without input are stored as runs, an hour of idle session takes a few
+ * bytes.
+ *
+ * Background jobs (loading, preview) finish at different iterations in every
+ * run. Main thread asks replaySync() if a job is finished, recording stores
+ * the iteration where it was seen finished first and replay waits for the
+ * job at the same iteration. Quality tier, render scale and checksum of
+ * every presented frame are stored as well, replay draws frames with the
+ * recorded tier and scale and compares checksums, so a different picture is
+ * reported.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "playlist.h"
+#include "stats.h"
+#include "replay.h"
+
+replay_t replay;
+
+/**
+ * @brief writeVarint Write unsigned number to log, 7 bits per byte.
+ */
+static void writeVarint(uint32_t aValue)
+{
+    while (aValue >= 0x80)
+    {
+        fputc((aValue & 0x7F) | 0x80, replay.file);
+        aValue >>= 7;
+    }
+    fputc(aValue, replay.file);
+}
+
+/**
+ * @brief readVarint Read unsigned number written by writeVarint().
+ *
+ * @param aValue[out]   Number.
+ * @return TRUE: if number was read.
+ */
+static bool_t readVarint(uint32_t * aValue)
+{
+    int      c;
+    uint32_t shift = 0;
+
+    *aValue = 0;
+    do
+    {
+        c = fgetc(replay.file);
+        if (c == EOF || shift > 28)
+        {
+            return FALSE;
+        }
+        *aValue |= (uint32_t)(c & 0x7F) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    return TRUE;
+}
+
+/**
+ * @brief writeUint32 Write number of header in little endian order.
+ */
+static void writeUint32(uint32_t aValue)
+{
+    uint8_t bytes[4] = { aValue, aValue >> 8, aValue >> 16, aValue >> 24 };
+
+    fwrite(bytes, 1, sizeof(bytes), replay.file);
+}
+
+/**
+ * @brief readUint32 Read number written by writeUint32().
+ */
+static bool_t readUint32(uint32_t * aValue)
+{
+    uint8_t bytes[4];
+    bool_t  ok = fread(bytes, 1, sizeof(bytes), replay.file) == sizeof(bytes);
+
+    *aValue = bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+
+    return ok;
+}
+
+/**
+ * @brief flushRun Write iterations without records.
+ */
+static void flushRun(void)
+{
+    if (replay.runCount)
+    {
+        fputc(REPLAY_RECORD_run, replay.file);
+        writeVarint(replay.runDelta);
+        writeVarint(replay.runCount);
+        replay.runCount = 0;
+    }
+}
+
+/**
+ * @brief writeStep Write start of an iteration which has records.
+ */
+static void writeStep(void)
+{
+    flushRun();
+    fputc(REPLAY_RECORD_step, replay.file);
+    writeVarint(replay.iterationDelta);
+}
+
+/**
+ * @brief recordByte Add a byte to records of actual iteration.
+ */
+static void recordByte(uint8_t aByte)
+{
+    if (replay.recordsLength == sizeof(replay.records))
+    {
+        /* Too many records in one iteration, they are written before the iteration ends */
+        if (!replay.stepWritten)
+        {
+            writeStep();
+            replay.stepWritten = TRUE;
+        }
+        fwrite(replay.records, 1, replay.recordsLength, replay.file);
+        replay.recordsLength = 0;
+    }
+    replay.records[replay.recordsLength++] = aByte;
+}
+
+/**
+ * @brief recordVarint Add a number to records of actual iteration.
+ */
+static void recordVarint(uint32_t aValue)
+{
+    while (aValue >= 0x80)
+    {
+        recordByte((aValue & 0x7F) | 0x80);
+        aValue >>= 7;
+    }
+    recordByte(aValue);
+}
+
+/**
+ * @brief finishIteration Write recorded iteration. Iterations without
+ * records and with the same time step are collected into a run.
+ */
+static void finishIteration(void)
+{
+    if (replay.stepWritten)
+    {
+        fwrite(replay.records, 1, replay.recordsLength, replay.file);
+    }
+    else if (replay.recordsLength == 0)
+    {
+        if (replay.runCount && replay.runDelta == replay.iterationDelta)
+        {
+            replay.runCount++;
+        }
+        else
+        {
+            flushRun();
+            replay.runDelta = replay.iterationDelta;
+            replay.runCount = 1;
+        }
+    }
+    else
+    {
+        writeStep();
+        fwrite(replay.records, 1, replay.recordsLength, replay.file);
+    }
+    replay.recordsLength = 0;
+    replay.stepWritten = FALSE;
+}
+
+/**
+ * @brief queueEvent Add an input event to the actual iteration of replay.
+ */
+static void queueEvent(const SDL_Event * aEvent)
+{
+    if (replay.eventCount < REPLAY_MAX_EVENTS)
+    {
+        replay.events[replay.eventCount++] = *aEvent;
+    }
+    else
+    {
+        errorprintf("Too many events in one iteration of replay!\n");
+    }
+}
+
+/**
+ * @brief readRecord Read a record of actual iteration.
+ *
+ * @param aType[in]     Type of record.
+ * @return TRUE: if record was read.
+ */
+static bool_t readRecord(int aType)
+{
+    SDL_Event     event;
+    uint32_t      value;
+    uint32_t      scale;
+    uint32_t      checksum;
+    replayFrame_t * frame;
+    bool_t        ok = TRUE;
+
+    memset(&event, 0, sizeof(event));
+    switch (aType)
+    {
+        case REPLAY_RECORD_key_down:
+            event.type = SDL_KEYDOWN;
+            ok = readVarint(&value);
+            event.key.keysym.sym = value;
+            ok = ok && readVarint(&value);
+            event.key.keysym.mod = value;
+            queueEvent(&event);
+            break;
+        case REPLAY_RECORD_key_up:
+            event.type = SDL_KEYUP;
+            ok = readVarint(&value);
+            event.key.keysym.sym = value;
+            queueEvent(&event);
+            break;
+        case REPLAY_RECORD_timer:
+            event.type = SDL_USEREVENT;
+            queueEvent(&event);
+            break;
+        case REPLAY_RECORD_quit:
+            event.type = SDL_QUIT;
+            queueEvent(&event);
+            break;
+        case REPLAY_RECORD_gate:
+            ok = readVarint(&value) && value < REPLAY_GATE_COUNT;
+            if (ok)
+            {
+                replay.gates[value] = TRUE;
+            }
+            break;
+        case REPLAY_RECORD_frame:
+            ok = readVarint(&value) && readVarint(&scale) && readUint32(&checksum);
+            if (ok && replay.framePending < REPLAY_MAX_PENDING_FRAMES)
+            {
+                frame = &replay.frames[replay.frameFirst + replay.framePending++];
+                frame->tier = value;
+                frame->scale = scale;
+                frame->checksum = checksum;
+            }
+            break;
+        default:
+            ok = FALSE;
+            break;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief readIteration Read next iteration of replay with its records.
+ *
+ * @return TRUE: if iteration was read, FALSE: end of log.
+ */
+static bool_t readIteration(void)
+{
+    int      c;
+    uint32_t delta;
+    uint32_t count;
+    bool_t   ok = TRUE;
+
+    if (replay.framePending)
+    {
+        /* Frames of recorded session which were not presented by replay */
+        if (!replay.firstMismatch)
+        {
+            replay.firstMismatch = replay.framesChecked + 1;
+        }
+        replay.framesChecked += replay.framePending;
+        replay.framesMismatched += replay.framePending;
+    }
+    replay.frameFirst = 0;
+    replay.framePending = 0;
+    replay.eventFirst = 0;
+    replay.eventCount = 0;
+    memset(replay.gates, 0, sizeof(replay.gates));
+
+    if (replay.runLeft)
+    {
+        replay.runLeft--;
+        replay.tick += replay.runDelta;
+        return TRUE;
+    }
+
+    c = fgetc(replay.file);
+    switch (c)
+    {
+        case REPLAY_RECORD_run:
+            ok = readVarint(&delta) && readVarint(&count) && count > 0;
+            if (ok)
+            {
+                replay.tick += delta;
+                replay.runDelta = delta;
+                replay.runLeft = count - 1;
+            }
+            break;
+        case REPLAY_RECORD_step:
+            ok = readVarint(&delta);
+            replay.tick += delta;
+            while (ok)
+            {
+                c = fgetc(replay.file);
+                if (c == EOF)
+                {
+                    break;
+                }
+                if (c == REPLAY_RECORD_run || c == REPLAY_RECORD_step)
+                {
+                    ungetc(c, replay.file);
+                    break;
+                }
+                ok = readRecord(c);
+            }
+            break;
+        case EOF:
+            ok = FALSE;
+            break;
+        default:
+            ok = FALSE;
+            break;
+    }
+    if (!ok && c != EOF)
+    {
+        errorprintf("Replay log is corrupted!\n");
+    }
+
+    return ok;
+}
+
+/**
+ * @brief getChecksum Get checksum of pixels of a surface.
+ *
+ * @param aSurface[in]  Surface.
+ * @return FNV-1a hash of rows, padding of rows is not included.
+ */
+static uint32_t getChecksum(SDL_Surface * aSurface)
+{
+    uint32_t        hash = 2166136261u;
+    uint32_t        rowBytes = aSurface->w * aSurface->format->BytesPerPixel;
+    const uint8_t * row;
+    uint32_t        word;
+    uint32_t        x;
+    int             y;
+
+    if (SDL_MUSTLOCK(aSurface))
+    {
+        SDL_LockSurface(aSurface);
+    }
+    for (y = 0; y < aSurface->h; y++)
+    {
+        row = (const uint8_t *)aSurface->pixels + y * aSurface->pitch;
+        /* A word per step, frames are big */
+        for (x = 0; x + 4 <= rowBytes; x += 4)
+        {
+            memcpy(&word, &row[x], sizeof(word));
+            hash = (hash ^ word) * 16777619u;
+        }
+        for (; x < rowBytes; x++)
+        {
+            hash = (hash ^ row[x]) * 16777619u;
+        }
+    }
+    if (SDL_MUSTLOCK(aSurface))
+    {
+        SDL_UnlockSurface(aSurface);
+    }
+
+    return hash;
+}
+
+/**
+ * @brief recordStart Start recording of session. It shall be called after
+ * SDL is initialized.
+ *
+ * @param aPath[in]         Path of log.
+ * @param aConfig[in]       Configuration of session.
+ * @param aIntroTimer[in]   Length of intro in iterations.
+ * @param aPlaylist[in]     Scripts of session.
+ * @return TRUE: if log was created.
+ */
+bool_t recordStart(const char * aPath, const config_t * aConfig, uint32_t aIntroTimer, const playlist_t * aPlaylist)
+{
+    uint32_t i;
+    uint32_t len;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.file = fopen(aPath, "wb");
+    if (replay.file == NULL)
+    {
+        errorprintf("Cannot create replay log '%s'!\n", aPath);
+        return FALSE;
+    }
+    replay.mode = REPLAY_MODE_record;
+    replay.firstTick = SDL_GetTicks();
+    replay.tick = replay.firstTick;
+    replay.startUs = getTimeUs();
+
+    fwrite(REPLAY_MAGIC, 1, strlen(REPLAY_MAGIC), replay.file);
+    fputc(REPLAY_VERSION, replay.file);
+    writeUint32(sizeof(config_t));
+    fwrite(aConfig, sizeof(config_t), 1, replay.file);
+    writeUint32(aIntroTimer);
+    writeUint32(replay.firstTick);
+    writeUint32(aPlaylist->count);
+    for (i = 0; i < aPlaylist->count; i++)
+    {
+        len = strlen(aPlaylist->items[i]);
+        writeUint32(len);
+        fwrite(aPlaylist->items[i], 1, len, replay.file);
+    }
+    verboseprintf("Recording input to '%s'\n", aPath);
+
+    return TRUE;
+}
+
+/**
+ * @brief replayStart Start replay of a recorded session. Configuration,
+ * intro and playlist of recorded session are used, only verbose mode is
+ * kept. It shall be called before video mode is set.
+ *
+ * @param aPath[in]             Path of log.
+ * @param aRealTime[in]         TRUE: wait for recorded time, FALSE: maximum speed.
+ * @param aConfig[out]          Configuration of recorded session.
+ * @param aIntroTimer[out]      Length of intro in iterations.
+ * @param aPlaylist[out]        Scripts of recorded session.
+ * @return TRUE: if log is valid.
+ */
+bool_t replayStart(const char * aPath, bool_t aRealTime, config_t * aConfig, uint32_t * aIntroTimer,
+                   playlist_t * aPlaylist)
+{
+    char     magic[sizeof(REPLAY_MAGIC) - 1];
+    char     path[MAX_PATH_LEN];
+    config_t recorded;
+    uint32_t size;
+    uint32_t count;
+    uint32_t len;
+    uint32_t i;
+    bool_t   ok;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.file = fopen(aPath, "rb");
+    if (replay.file == NULL)
+    {
+        errorprintf("Cannot open replay log '%s'!\n", aPath);
+        return FALSE;
+    }
+
+    ok = fread(magic, 1, sizeof(magic), replay.file) == sizeof(magic)
+         && !memcmp(magic, REPLAY_MAGIC, sizeof(magic))
+         && fgetc(replay.file) == REPLAY_VERSION
+         && readUint32(&size) && size == sizeof(config_t)
+         && fread(&recorded, sizeof(recorded), 1, replay.file) == 1
+         && recorded.version == aConfig->version
+         && readUint32(aIntroTimer)
+         && readUint32(&replay.firstTick)
+         && readUint32(&count);
+    if (ok)
+    {
+        recorded.verbose = aConfig->verbose;
+        *aConfig = recorded;
+        freePlaylist(aPlaylist);
+    }
+    for (i = 0; i < count && ok; i++)
+    {
+        ok = readUint32(&len) && len < sizeof(path) && fread(path, 1, len, replay.file) == len;
+        if (ok)
+        {
+            path[len] = CHR_EOS;
+            ok = addPlaylistItem(aPlaylist, path);
+        }
+    }
+
+    if (ok)
+    {
+        replay.mode = REPLAY_MODE_replay;
+        replay.realTime = aRealTime;
+        replay.tick = replay.firstTick;
+        replay.startUs = getTimeUs();
+        verboseprintf("Replaying input from '%s' at %s speed\n", aPath, aRealTime ? "real" : "maximum");
+    }
+    else
+    {
+        errorprintf("Invalid replay log '%s'!\n", aPath);
+        fclose(replay.file);
+        replay.file = NULL;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief getTicks Get time in milliseconds. While recording or replaying,
+ * every part of an iteration sees the same virtual time.
+ *
+ * @return Time in milliseconds.
+ */
+uint32_t getTicks(void)
+{
+    return replay.mode == REPLAY_MODE_off ? SDL_GetTicks() : replay.tick;
+}
+
+/**
+ * @brief replayIteration Start next iteration of main loop.
+ *
+ * @return TRUE: if software shall go on, FALSE: end of replay.
+ */
+bool_t replayIteration(void)
+{
+    bool_t   ok = TRUE;
+    uint32_t now;
+
+    switch (replay.mode)
+    {
+        case REPLAY_MODE_record:
+            if (replay.iterations)
+            {
+                finishIteration();
+            }
+            now = SDL_GetTicks();
+            replay.iterationDelta = now - replay.tick;
+            replay.tick = now;
+            replay.iterations++;
+            break;
+        case REPLAY_MODE_replay:
+            if (replay.iterations == 0)
+            {
+                replay.startTick = SDL_GetTicks();
+            }
+            ok = !replay.end && readIteration();
+            replay.end = !ok;
+            while (ok && replay.realTime && SDL_GetTicks() - replay.startTick < replay.tick - replay.firstTick)
+            {
+                SDL_Delay(1);
+            }
+            replay.iterations += ok;
+            break;
+        case REPLAY_MODE_off:
+        default:
+            break;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief replayNextEvent Get next input event of actual iteration of replay.
+ *
+ * @param aEvent[out]   Event.
+ * @return TRUE: if there was an event.
+ */
+bool_t replayNextEvent(SDL_Event * aEvent)
+{
+    bool_t ok = FALSE;
+
+    if (replay.eventFirst < replay.eventCount)
+    {
+        *aEvent = replay.events[replay.eventFirst++];
+        replay.eventsHandled++;
+        ok = TRUE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief recordEvent Write an input event to log if session is recorded.
+ * Events which do not change the teleprompter are not written.
+ *
+ * @param aEvent[in]    Event got from SDL.
+ */
+void recordEvent(const SDL_Event * aEvent)
+{
+    if (replay.mode == REPLAY_MODE_record)
+    {
+        switch (aEvent->type)
+        {
+            case SDL_KEYDOWN:
+                recordByte(REPLAY_RECORD_key_down);
+                recordVarint(aEvent->key.keysym.sym);
+                recordVarint(aEvent->key.keysym.mod);
+                replay.eventsHandled++;
+                break;
+            case SDL_KEYUP:
+                recordByte(REPLAY_RECORD_key_up);
+                recordVarint(aEvent->key.keysym.sym);
+                replay.eventsHandled++;
+                break;
+            case SDL_USEREVENT:
+                recordByte(REPLAY_RECORD_timer);
+                replay.eventsHandled++;
+                break;
+            case SDL_QUIT:
+                recordByte(REPLAY_RECORD_quit);
+                replay.eventsHandled++;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+/**
+ * @brief replaySync Check if a background job is finished. While recording,
+ * the iteration where a run of job is seen finished first is written. While
+ * replaying, the job is reported finished at the same iteration, replay waits
+ * for it if necessary.
+ *
+ * @param aGate[in]     Identifier of job, see REPLAY_GATE_*.
+ * @param aRun[in]      Counter of starts of job.
+ * @param aIsReady[in]  Function which checks if job is finished.
+ * @param aParam[in]    Parameter of aIsReady.
+ * @return TRUE: if job shall be handled as finished.
+ */
+bool_t replaySync(uint8_t aGate, uint32_t aRun, replayIsReady_t aIsReady, void * aParam)
+{
+    bool_t ready;
+
+    switch (replay.mode)
+    {
+        case REPLAY_MODE_record:
+            ready = aIsReady(aParam);
+            if (ready && replay.gateRuns[aGate] != aRun)
+            {
+                recordByte(REPLAY_RECORD_gate);
+                recordVarint(aGate);
+                replay.gateRuns[aGate] = aRun;
+            }
+            break;
+        case REPLAY_MODE_replay:
+            if (replay.gateRuns[aGate] == aRun)
+            {
+                ready = aIsReady(aParam);
+            }
+            else if (replay.gates[aGate])
+            {
+                /* Recorded session found the job finished in this iteration */
+                while (!aIsReady(aParam))
+                {
+                    SDL_Delay(1);
+                }
+                replay.gates[aGate] = FALSE;
+                replay.gateRuns[aGate] = aRun;
+                ready = TRUE;
+            }
+            else
+            {
+                ready = FALSE;
+            }
+            break;
+        case REPLAY_MODE_off:
+        default:
+            ready = aIsReady(aParam);
+            break;
+    }
+
+    return ready;
+}
+
+/**
+ * @brief replayQuality Select quality tier of frame. Tier depends on the
+ * measured frame times, so replay uses the tier of recorded frame.
+ *
+ * @param aTier[in]     Tier selected by quality manager.
+ * @return Tier to use.
+ */
+uint8_t replayQuality(uint8_t aTier)
+{
+    if (replay.mode == REPLAY_MODE_replay && replay.framePending)
+    {
+        aTier = replay.frames[replay.frameFirst].tier;
+    }
+    else if (replay.mode == REPLAY_MODE_replay && replay.tier)
+    {
+        /* Tier is part of the frame key, it changes only with a recorded frame */
+        aTier = replay.tier;
+    }
+    replay.tier = aTier;
+
+    return aTier;
+}
+
+/**
+ * @brief replayRenderScale Select render scale of frame. Scale depends on
+ * the measured frame times, so replay uses the scale of recorded frame.
+ *
+ * @param aScale[in]    Scale selected by selectRenderScale().
+ * @return Scale to use.
+ */
+uint8_t replayRenderScale(uint8_t aScale)
+{
+    /* Frames drawn before the first script frame have no scale */
+    if (replay.mode == REPLAY_MODE_replay && replay.framePending && replay.frames[replay.frameFirst].scale)
+    {
+        aScale = replay.frames[replay.frameFirst].scale;
+    }
+    else if (replay.mode == REPLAY_MODE_replay && !replay.framePending && replay.scale)
+    {
+        /* Scale is part of the frame key, it changes only with a recorded frame */
+        aScale = replay.scale;
+    }
+    replay.scale = aScale;
+
+    return aScale;
+}
+
+/**
+ * @brief replayFrameTime Collect render time of a script frame.
+ *
+ * @param aFrameUs[in]  Time of drawing frame.
+ */
+void replayFrameTime(uint32_t aFrameUs)
+{
+    replay.scriptFrames++;
+    replay.scriptFrameUsTotal += aFrameUs;
+    replay.scriptFrameUsMax = MAX(replay.scriptFrameUsMax, aFrameUs);
+}
+
+/**
+ * @brief replayVolatileFrame Frame being drawn shows measured times or
+ * progress of a background job, its pixels differ in every run. Only the
+ * presence of frame is checked.
+ */
+void replayVolatileFrame(void)
+{
+    replay.volatileFrame = TRUE;
+}
+
+/**
+ * @brief replayPresent Write or check checksum of a presented frame.
+ *
+ * @param aSurface[in]  Composed frame.
+ */
+void replayPresent(SDL_Surface * aSurface)
+{
+    uint32_t        checksum;
+    replayFrame_t * frame;
+
+    /* Frames of initialization are not part of log */
+    if (replay.mode == REPLAY_MODE_off || replay.iterations == 0)
+    {
+        return;
+    }
+    checksum = replay.volatileFrame ? 0 : getChecksum(aSurface);
+    replay.volatileFrame = FALSE;
+    if (replay.mode == REPLAY_MODE_record)
+    {
+        recordByte(REPLAY_RECORD_frame);
+        recordVarint(replay.tier);
+        recordVarint(replay.scale);
+        recordByte(checksum);
+        recordByte(checksum >> 8);
+        recordByte(checksum >> 16);
+        recordByte(checksum >> 24);
+        replay.framesChecked++;
+    }
+    else
+    {
+        replay.framesChecked++;
+        frame = replay.framePending ? &replay.frames[replay.frameFirst] : NULL;
+        if (frame == NULL || frame->checksum != checksum)
+        {
+            if (!replay.firstMismatch)
+            {
+                replay.firstMismatch = replay.framesChecked;
+            }
+            replay.framesMismatched++;
+            verboseprintf("Replay: frame %llu of iteration %llu differs\n",
+                          (unsigned long long)replay.framesChecked, (unsigned long long)replay.iterations);
+        }
+        if (frame)
+        {
+            replay.frameFirst++;
+            replay.framePending--;
+        }
+    }
+}
+
+/**
+ * @brief printReplayStats Print summary of recording or replay to console.
+ */
+void printReplayStats(void)
+{
+    if (replay.mode == REPLAY_MODE_off)
+    {
+        return;
+    }
+    printf("REPLAY\n");
+    printf("------\n");
+    printf("Mode:                             %s\n", replay.mode == REPLAY_MODE_record ? "record" : "replay");
+    printf("Iterations:                       %llu, %u ms virtual time\n",
+           (unsigned long long)replay.iterations, replay.tick - replay.firstTick);
+    printf("Input events:                     %llu\n", (unsigned long long)replay.eventsHandled);
+    printf("Wall time:                        %llu ms\n",
+           (unsigned long long)((getTimeUs() - replay.startUs) / 1000u));
+    if (replay.mode == REPLAY_MODE_replay)
+    {
+        printf("Frames checked/mismatched:        %llu / %llu",
+               (unsigned long long)replay.framesChecked, (unsigned long long)replay.framesMismatched);
+        if (replay.firstMismatch)
+        {
+            printf(", first: %llu", (unsigned long long)replay.firstMismatch);
+        }
+        printf("\n");
+    }
+    else
+    {
+        printf("Frames recorded:                  %llu\n", (unsigned long long)replay.framesChecked);
+    }
+    if (replay.scriptFrames)
+    {
+        printf("Script frame render time:         %llu us average, %u us maximum\n",
+               (unsigned long long)(replay.scriptFrameUsTotal / replay.scriptFrames), replay.scriptFrameUsMax);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief replayDone Finish log of recording or close log of replay.
+ */
+void replayDone(void)
+{
+    if (replay.file)
+    {
+        if (replay.mode == REPLAY_MODE_record)
+        {
+            finishIteration();
+            flushRun();
+        }
+        fclose(replay.file);
+        replay.file = NULL;
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * @file        replay.h
+ * @brief       Recording and replaying of input
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-03 21:14:26
+ * Last modify: 2021-03-03 21:14:26 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_REPLAY_H
+#define INCLUDE_REPLAY_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "playlist.h"
+
+#define REPLAY_MAGIC                "DTRL"  /* First bytes of log */
+#define REPLAY_VERSION              2       /* Incremented when format of log changes */
+#define REPLAY_GATE_LOADER          0       /* Gates of loaders: REPLAY_GATE_LOADER + index of loader */
+#define REPLAY_GATE_PREVIEW         2       /* Gate of preview thumbnails */
+#define REPLAY_GATE_SAVE            3       /* Gate of saving edited script */
+#define REPLAY_GATE_COUNT           4       /* Count of background jobs synchronized by replay */
+#define REPLAY_MAX_EVENTS           128     /* Input events of an iteration, same as event queue of SDL */
+#define REPLAY_MAX_PENDING_FRAMES   16      /* Frames of an iteration expected by replay */
+
+typedef enum
+{
+    REPLAY_MODE_off,            /**< Input comes from SDL. */
+    REPLAY_MODE_record,         /**< Input comes from SDL and it is written to log. */
+    REPLAY_MODE_replay,         /**< Input comes from log. */
+} replayMode_t;
+
+/* Records of log. Every iteration of main loop starts with a run or step record
+ * followed by input, finished background jobs and presented frames. */
+typedef enum
+{
+    REPLAY_RECORD_run = 1,      /**< Iterations without records: delta ticks, count */
+    REPLAY_RECORD_step,         /**< Iteration with records: delta ticks */
+    REPLAY_RECORD_key_down,     /**< Key pressed: symbol, modifiers */
+    REPLAY_RECORD_key_up,       /**< Key released: symbol */
+    REPLAY_RECORD_timer,        /**< Tick of auto scroll timer */
+    REPLAY_RECORD_quit,         /**< Window was closed */
+    REPLAY_RECORD_gate,         /**< Background job was found finished: gate */
+    REPLAY_RECORD_frame,        /**< Frame was presented: quality tier, render scale, checksum */
+} replayRecord_t;
+
+/* Frame presented by recorded session */
+typedef struct
+{
+    uint8_t         tier;                   /* Quality tier of frame */
+    uint8_t         scale;                  /* Render scale of frame */
+    uint32_t        checksum;               /* Checksum of pixels */
+} replayFrame_t;
+
+typedef struct
+{
+    replayMode_t    mode;
+    FILE          * file;
+    bool_t          realTime;               /* TRUE: replay waits for recorded time, FALSE: maximum speed */
+    uint32_t        tick;                   /* Virtual time of actual iteration */
+    uint32_t        startTick;              /* Real time when replay started */
+    uint32_t        firstTick;              /* Virtual time of first iteration */
+    /* Iterations of recording which are not written yet */
+    uint32_t        runDelta;
+    uint32_t        runCount;
+    uint32_t        iterationDelta;         /* Ticks since previous iteration */
+    uint8_t         records[256];           /* Records of actual iteration */
+    uint32_t        recordsLength;
+    bool_t          stepWritten;            /* TRUE: records of actual iteration are written directly */
+    uint8_t         tier;                   /* Quality tier of frame being drawn */
+    uint8_t         scale;                  /* Render scale of frame being drawn */
+    bool_t          volatileFrame;          /* TRUE: frame being drawn shows measured times */
+    /* Replay: iterations of actual run and records of actual iteration */
+    uint32_t        runLeft;
+    SDL_Event       events[REPLAY_MAX_EVENTS];
+    uint32_t        eventFirst;
+    uint32_t        eventCount;
+    bool_t          gates[REPLAY_GATE_COUNT];   /* TRUE: job shall be seen finished in this iteration */
+    uint32_t        gateRuns[REPLAY_GATE_COUNT]; /* Run of job which was already seen finished */
+    replayFrame_t   frames[REPLAY_MAX_PENDING_FRAMES];
+    uint32_t        frameFirst;
+    uint32_t        framePending;
+    bool_t          end;                    /* TRUE: log is finished */
+    /* Statistics */
+    uint64_t        iterations;
+    uint64_t        eventsHandled;
+    uint64_t        framesChecked;
+    uint64_t        framesMismatched;
+    uint64_t        firstMismatch;          /* Number of first mismatching frame, 0: none */
+    uint64_t        scriptFrames;           /* Count of drawn script frames */
+    uint64_t        scriptFrameUsTotal;     /* Render time of script frames */
+    uint32_t        scriptFrameUsMax;
+    uint64_t        startUs;                /* Wall time of start */
+} replay_t;
+
+/* Background job is finished, it can be called more times */
+typedef bool_t (*replayIsReady_t)(void * aParam);
+
+extern replay_t replay;
+
+bool_t recordStart(const char * aPath, const config_t * aConfig, uint32_t aIntroTimer, const playlist_t * aPlaylist);
+bool_t replayStart(const char * aPath, bool_t aRealTime, config_t * aConfig, uint32_t * aIntroTimer,
+                   playlist_t * aPlaylist);
+uint32_t getTicks(void);
+bool_t replayIteration(void);
+bool_t replayNextEvent(SDL_Event * aEvent);
+void recordEvent(const SDL_Event * aEvent);
+bool_t replaySync(uint8_t aGate, uint32_t aRun, replayIsReady_t aIsReady, void * aParam);
+uint8_t replayQuality(uint8_t aTier);
+uint8_t replayRenderScale(uint8_t aScale);
+void replayFrameTime(uint32_t aFrameUs);
+void replayVolatileFrame(void);
+void replayPresent(SDL_Surface * aSurface);
+void printReplayStats(void);
+void replayDone(void);
+
+#endif /* INCLUDE_REPLAY_H */
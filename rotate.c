@@ -0,0 +1,262 @@
+/**
+ * @file        rotate.c
+ * @brief       Drawing to a display mounted rotated
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 15:20:44
+ * Last modify: 2021-03-07 15:20:44 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Layout and drawing use the coordinates of the picture as the audience
+ * sees it, config.video_size_x_px x config.video_size_y_px. The display is
+ * set to the rotated size and every rectangle, line and mask is placed
+ * there by these functions. Masks are rotated once when they are rendered
+ * (line cache, overlays, preview), so drawing them costs the same as in
+ * upright mode, rows of masks are still copied to rows of display.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_gfxPrimitives.h>
+
+#include "common.h"
+#include "blend.h"
+#include "rotate.h"
+
+/**
+ * @brief isValidRotation Check if display can be rotated by the angle.
+ *
+ * @param aRotation[in] Clockwise rotation in degrees.
+ * @return TRUE: if rotation is 0, 90, 180 or 270.
+ */
+bool_t isValidRotation(int aRotation)
+{
+    return aRotation == 0 || aRotation == 90 || aRotation == 180 || aRotation == 270;
+}
+
+/**
+ * @brief getDisplayWidth Get width of video mode.
+ */
+uint16_t getDisplayWidth(void)
+{
+    return ROTATION_IS_SIDEWAYS(config.rotation) ? config.video_size_y_px : config.video_size_x_px;
+}
+
+/**
+ * @brief getDisplayHeight Get height of video mode.
+ */
+uint16_t getDisplayHeight(void)
+{
+    return ROTATION_IS_SIDEWAYS(config.rotation) ? config.video_size_x_px : config.video_size_y_px;
+}
+
+/**
+ * @brief getMaskWidth Get width of a mask rotated by rotateAlphaMask() as it
+ * is seen on the picture.
+ */
+uint16_t getMaskWidth(const alphaMask_t * aMask)
+{
+    return ROTATION_IS_SIDEWAYS(config.rotation) ? aMask->h : aMask->w;
+}
+
+/**
+ * @brief getMaskHeight Get height of a mask rotated by rotateAlphaMask() as
+ * it is seen on the picture.
+ */
+uint16_t getMaskHeight(const alphaMask_t * aMask)
+{
+    return ROTATION_IS_SIDEWAYS(config.rotation) ? aMask->w : aMask->h;
+}
+
+/**
+ * @brief rotateArea Convert position of an area of picture to position on
+ * display.
+ *
+ * @param aDst[in]      Surface of display size or of reduced resolution.
+ * @param x[in,out]     X coordinate of top left corner.
+ * @param y[in,out]     Y coordinate of top left corner.
+ * @param w[in]         Width of area on picture.
+ * @param h[in]         Height of area on picture.
+ */
+static void rotateArea(const SDL_Surface * aDst, int * x, int * y, int w, int h)
+{
+    int px = *x;
+    int py = *y;
+
+    switch (config.rotation)
+    {
+        case 90:
+            *x = aDst->w - py - h;
+            *y = px;
+            break;
+        case 180:
+            *x = aDst->w - px - w;
+            *y = aDst->h - py - h;
+            break;
+        case 270:
+            *x = py;
+            *y = aDst->h - px - w;
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief rotateAlphaMask Rotate mask to the orientation of display.
+ *
+ * @param aMask[in]     Mask to rotate, it is released. It can be NULL.
+ * @return Rotated mask, it shall be freed by freeAlphaMask(). It is aMask
+ * if display is not rotated. NULL: aMask was NULL or error occurred.
+ */
+alphaMask_t * rotateAlphaMask(alphaMask_t * aMask)
+{
+    alphaMask_t   * rotated;
+    const uint8_t * src;
+    uint8_t       * dst;
+    uint16_t        w;
+    uint16_t        h;
+    uint16_t        x;
+    uint16_t        y;
+
+    if (!aMask || !config.rotation)
+    {
+        return aMask;
+    }
+
+    w = aMask->w;
+    h = aMask->h;
+    rotated = ROTATION_IS_SIDEWAYS(config.rotation) ? allocAlphaMask(h, w) : allocAlphaMask(w, h);
+    if (!rotated)
+    {
+        errorprintf("Cannot allocate memory to rotate text!\n");
+        freeAlphaMask(aMask);
+        return NULL;
+    }
+    rotated->padding = aMask->padding;
+
+    /* Rows of rotated mask are written in order */
+    dst = rotated->pixels;
+    switch (config.rotation)
+    {
+        case 90:
+            /* Row y is column y of source from bottom to top */
+            for (y = 0; y < w; y++)
+            {
+                src = &aMask->pixels[(h - 1) * w + y];
+                for (x = 0; x < h; x++, src -= w)
+                {
+                    *dst++ = *src;
+                }
+            }
+            break;
+        case 180:
+            src = &aMask->pixels[(size_t)w * h];
+            for (y = 0; y < h; y++)
+            {
+                for (x = 0; x < w; x++)
+                {
+                    *dst++ = *--src;
+                }
+            }
+            break;
+        case 270:
+            /* Row y is column w - 1 - y of source from top to bottom */
+            for (y = 0; y < w; y++)
+            {
+                src = &aMask->pixels[w - 1 - y];
+                for (x = 0; x < h; x++, src += w)
+                {
+                    *dst++ = *src;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+    freeAlphaMask(aMask);
+
+    return rotated;
+}
+
+/**
+ * @brief fillRotatedRect Fill a rectangle of picture.
+ *
+ * @param aDst[in,out]  Surface of display size or of reduced resolution.
+ * @param aRect[in]     Rectangle on picture, it is not changed.
+ * @param aColor[in]    Color in format of surface.
+ */
+void fillRotatedRect(SDL_Surface * aDst, const SDL_Rect * aRect, Uint32 aColor)
+{
+    SDL_Rect rect;
+    int      x = aRect->x;
+    int      y = aRect->y;
+
+    rotateArea(aDst, &x, &y, aRect->w, aRect->h);
+    rect.x = x;
+    rect.y = y;
+    rect.w = ROTATION_IS_SIDEWAYS(config.rotation) ? aRect->h : aRect->w;
+    rect.h = ROTATION_IS_SIDEWAYS(config.rotation) ? aRect->w : aRect->h;
+    SDL_FillRect(aDst, &rect, aColor);
+}
+
+/**
+ * @brief drawRotatedLine Draw a line of picture.
+ *
+ * @param aDst[in,out]  Surface of display size or of reduced resolution.
+ * @param x1[in]        X coordinate of start on picture.
+ * @param y1[in]        Y coordinate of start on picture.
+ * @param x2[in]        X coordinate of end on picture.
+ * @param y2[in]        Y coordinate of end on picture.
+ * @param aColor[in]    Color of line.
+ */
+void drawRotatedLine(SDL_Surface * aDst, int x1, int y1, int x2, int y2, SDL_Color aColor)
+{
+    /* A point is an area of one pixel */
+    rotateArea(aDst, &x1, &y1, 1, 1);
+    rotateArea(aDst, &x2, &y2, 1, 1);
+    lineRGBA(aDst, x1, y1, x2, y2, aColor.r, aColor.g, aColor.b, 0xFF);
+}
+
+/**
+ * @brief drawRotatedAlphaMask Draw a mask rotated by rotateAlphaMask() to
+ * its place on picture, see drawAlphaMask().
+ *
+ * @param aDst[in,out]      Surface of display size or of reduced resolution.
+ * @param x[in]             X coordinate of mask on picture.
+ * @param y[in]             Y coordinate of mask on picture.
+ * @param aMask[in]         Rotated coverage mask.
+ * @param aColor[in]        Text color.
+ * @param aBackground[in]   Background color, only used by BLEND_MODE_lut.
+ * @param aMode[in]         How coverage is applied.
+ */
+void drawRotatedAlphaMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                          SDL_Color aColor, SDL_Color aBackground, blendMode_t aMode)
+{
+    rotateArea(aDst, &x, &y, getMaskWidth(aMask), getMaskHeight(aMask));
+    drawAlphaMask(aDst, x, y, aMask, aColor, aBackground, aMode);
+}
+
+/**
+ * @brief drawRotatedEffectMask Draw a mask of two tones rotated by
+ * rotateAlphaMask() to its place on picture, see drawEffectMask().
+ *
+ * @param aDst[in,out]      Surface of display size or of reduced resolution.
+ * @param x[in]             X coordinate of mask on picture, including padding.
+ * @param y[in]             Y coordinate of mask on picture, including padding.
+ * @param aMask[in]         Rotated mask of two tones.
+ * @param aColor[in]        Text color.
+ * @param aEffectColor[in]  Color of outline and shadow.
+ * @param aBackground[in]   Background color, not used by BLEND_MODE_blend.
+ * @param aMode[in]         How coverage is applied.
+ */
+void drawRotatedEffectMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                           SDL_Color aColor, SDL_Color aEffectColor, SDL_Color aBackground, blendMode_t aMode)
+{
+    rotateArea(aDst, &x, &y, getMaskWidth(aMask), getMaskHeight(aMask));
+    drawEffectMask(aDst, x, y, aMask, aColor, aEffectColor, aBackground, aMode);
+}
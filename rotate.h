@@ -0,0 +1,37 @@
+/**
+ * @file        rotate.h
+ * @brief       Drawing to a display mounted rotated
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 15:20:44
+ * Last modify: 2021-03-07 15:20:44 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_ROTATE_H
+#define INCLUDE_ROTATE_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "blend.h"
+
+/* Width and height of picture are swapped on display */
+#define ROTATION_IS_SIDEWAYS(r)     ((r) == 90 || (r) == 270)
+
+bool_t isValidRotation(int aRotation);
+uint16_t getDisplayWidth(void);
+uint16_t getDisplayHeight(void);
+uint16_t getMaskWidth(const alphaMask_t * aMask);
+uint16_t getMaskHeight(const alphaMask_t * aMask);
+alphaMask_t * rotateAlphaMask(alphaMask_t * aMask);
+void fillRotatedRect(SDL_Surface * aDst, const SDL_Rect * aRect, Uint32 aColor);
+void drawRotatedLine(SDL_Surface * aDst, int x1, int y1, int x2, int y2, SDL_Color aColor);
+void drawRotatedAlphaMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                          SDL_Color aColor, SDL_Color aBackground, blendMode_t aMode);
+void drawRotatedEffectMask(SDL_Surface * aDst, int x, int y, const alphaMask_t * aMask,
+                           SDL_Color aColor, SDL_Color aEffectColor, SDL_Color aBackground, blendMode_t aMode);
+
+#endif /* INCLUDE_ROTATE_H */
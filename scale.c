@@ -0,0 +1,350 @@
+/**
+ * @file        scale.c
+ * @brief       Dynamic internal resolution of script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 18:41:09
+ * Last modify: 2021-03-07 18:41:09 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * If the fastest quality tier cannot hold the frame rate, lines of script
+ * are composed to a surface of 1/2, 1/3 or 1/4 of display resolution and it
+ * is enlarged to the display by repeating pixels. Lines are cached at the
+ * reduced size, so blending costs 1/factor^2 of full resolution and the
+ * enlargement is a copy of rows. Layout, preview and overlays are not
+ * affected, they are drawn at full resolution. When the script stops moving
+ * it is drawn again at full resolution.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "gfx.h"
+#include "blend.h"
+#include "blendkernel.h"
+#include "quality.h"
+#include "rotate.h"
+#include "stats.h"
+#include "alloctrack.h"
+#include "scale.h"
+
+renderScale_t renderScale =
+{
+    .factor = 1,
+};
+
+/**
+ * @brief parseRenderScale Parse factor of resolution from command line.
+ *
+ * @param aText[in]     "auto" or 1..RENDER_SCALE_MAX.
+ * @param aScale[out]   Factor, RENDER_SCALE_AUTO for "auto".
+ * @return TRUE: if text is valid.
+ */
+bool_t parseRenderScale(const char * aText, uint8_t * aScale)
+{
+    bool_t ok = TRUE;
+
+    if (!strcmp(aText, "auto"))
+    {
+        *aScale = RENDER_SCALE_AUTO;
+    }
+    else if (aText[0] >= '1' && aText[0] <= '0' + RENDER_SCALE_MAX && aText[1] == CHR_EOS)
+    {
+        *aScale = aText[0] - '0';
+    }
+    else
+    {
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief getRenderScaleName Get name of configured factor.
+ *
+ * @param aScale[in]    Factor or RENDER_SCALE_AUTO.
+ * @return Name of factor.
+ */
+const char * getRenderScaleName(uint8_t aScale)
+{
+    static const char * names[RENDER_SCALE_MAX + 1] = { "auto", "1", "2", "3", "4" };
+
+    return aScale <= RENDER_SCALE_MAX ? names[aScale] : "?";
+}
+
+/**
+ * @brief setFactor Change factor and log it.
+ */
+static void setFactor(uint8_t aFactor, const char * aReason)
+{
+    if (aFactor != renderScale.factor)
+    {
+        verboseprintf("Render scale: 1/%u -> 1/%u (%s, average frame: %u us, budget: %u us)\n",
+                      renderScale.factor, aFactor, aReason, renderScale.avgFrameUs, renderScale.budgetUs);
+        renderScale.factor = aFactor;
+        renderScale.calmFrames = 0;
+        renderScale.framesSinceChange = 0;
+        renderScale.factorChanges++;
+    }
+}
+
+/**
+ * @brief selectRenderScale Select resolution of next frame. It shall be
+ * called once before drawing a frame. Automatic mode reduces resolution only
+ * if quality tier cannot be reduced any more.
+ *
+ * @return Script is composed at 1/factor of display resolution.
+ */
+uint8_t selectRenderScale(void)
+{
+    renderScale.budgetUs = config.max_fps ? 1000000u / config.max_fps : QUALITY_DEFAULT_BUDGET_US;
+
+    if (config.render_scale != RENDER_SCALE_AUTO)
+    {
+        setFactor(MIN(config.render_scale, RENDER_SCALE_MAX), "configured");
+    }
+    else if (renderScale.avgFrameUs > renderScale.budgetUs
+             && renderScale.factor < RENDER_SCALE_MAX
+             && renderScale.framesSinceChange >= RENDER_SCALE_DOWNGRADE_FRAMES
+             && (config.render_quality != QUALITY_auto || qualityManager.tier == QUALITY_solid))
+    {
+        setFactor(renderScale.factor + 1, "over budget");
+    }
+    else if (renderScale.factor > 1 && renderScale.calmFrames >= RENDER_SCALE_UPGRADE_FRAMES)
+    {
+        setFactor(renderScale.factor - 1, "under budget");
+    }
+
+    return renderScale.factor;
+}
+
+/**
+ * @brief getSettledRenderScale Get resolution of a still script. Time of
+ * drawing does not matter if text does not move, so automatic mode uses
+ * full resolution.
+ *
+ * @return Script is composed at 1/factor of display resolution.
+ */
+uint8_t getSettledRenderScale(void)
+{
+    return config.render_scale != RENDER_SCALE_AUTO ? MIN(config.render_scale, RENDER_SCALE_MAX) : 1;
+}
+
+/**
+ * @brief renderScaleFrameDone Account render time of a frame.
+ *
+ * @param aFrameUs[in]  Time of drawing the frame in microseconds.
+ */
+void renderScaleFrameDone(uint32_t aFrameUs)
+{
+    uint32_t finer = renderScale.factor - 1;
+
+    /* Exponential moving average, 1/8 weight of new sample */
+    renderScale.avgFrameUs = (renderScale.avgFrameUs * 7u + aFrameUs) / 8u;
+    renderScale.framesSinceChange++;
+    /* Time of a frame is estimated to be proportional to count of pixels */
+    if (finer && (uint64_t)renderScale.avgFrameUs * renderScale.factor * renderScale.factor
+                 < (uint64_t)renderScale.budgetUs * 3u / 4u * finer * finer)
+    {
+        renderScale.calmFrames++;
+    }
+    else
+    {
+        renderScale.calmFrames = 0;
+    }
+}
+
+/**
+ * @brief downscaleAlphaMask Reduce resolution of a coverage mask by box
+ * filter. Pixels out of mask are background.
+ *
+ * @param aMask[in]     Mask to reduce, it is released. It can be NULL.
+ * @param aFactor[in]   Width and height are divided by factor.
+ * @param aBinary[in]   TRUE: mask is not anti-aliased and it is kept so.
+ * @return Reduced mask, it shall be freed by freeAlphaMask(). It is aMask if
+ * factor is 1. NULL: aMask was NULL or error occurred.
+ */
+alphaMask_t * downscaleAlphaMask(alphaMask_t * aMask, uint8_t aFactor, bool_t aBinary)
+{
+    alphaMask_t   * scaled;
+    const uint8_t * src;
+    uint8_t       * dst;
+    uint32_t        area = aFactor * aFactor;
+    uint32_t        sum;
+    uint16_t        x;
+    uint16_t        y;
+    uint16_t        i;
+    uint16_t        j;
+
+    if (!aMask || aFactor <= 1)
+    {
+        return aMask;
+    }
+
+    scaled = allocAlphaMask((aMask->w + aFactor - 1) / aFactor, (aMask->h + aFactor - 1) / aFactor);
+    if (!scaled)
+    {
+        errorprintf("Cannot allocate memory to scale text!\n");
+        freeAlphaMask(aMask);
+        return NULL;
+    }
+    scaled->padding = aMask->padding / aFactor;
+
+    dst = scaled->pixels;
+    for (y = 0; y < scaled->h; y++)
+    {
+        for (x = 0; x < scaled->w; x++)
+        {
+            sum = 0;
+            for (j = y * aFactor; j < (y + 1) * aFactor && j < aMask->h; j++)
+            {
+                src = &aMask->pixels[(size_t)j * aMask->w];
+                for (i = x * aFactor; i < (x + 1) * aFactor && i < aMask->w; i++)
+                {
+                    sum += src[i];
+                }
+            }
+            if (aBinary)
+            {
+                /* Color key needs full coverage, stroke is kept if it covers half of pixel */
+                *dst++ = sum * 2u >= area * 255u ? 255 : 0;
+            }
+            else
+            {
+                *dst++ = (sum + area / 2u) / area;
+            }
+        }
+    }
+    freeAlphaMask(aMask);
+
+    return scaled;
+}
+
+/**
+ * @brief getScaledSurface Get surface to compose script at reduced
+ * resolution. It is created in the format of screen at first use.
+ *
+ * @param aFactor[in]   Factor of resolution, 2..RENDER_SCALE_MAX.
+ * @return Surface of display size divided by factor and rounded up. NULL:
+ * error occurred.
+ */
+SDL_Surface * getScaledSurface(uint8_t aFactor)
+{
+    if (renderScale.surface && renderScale.surfaceFactor != aFactor)
+    {
+        invalidateScaledSurface();
+    }
+    if (!renderScale.surface)
+    {
+        allocSubsystem_t allocScope = enterAllocScope(ALLOC_SUBSYSTEM_surfaces);
+
+        renderScale.surface = gfx_create_surface((getDisplayWidth() + aFactor - 1) / aFactor,
+                                                 (getDisplayHeight() + aFactor - 1) / aFactor, FALSE);
+        renderScale.surfaceFactor = aFactor;
+        leaveAllocScope(allocScope);
+    }
+
+    return renderScale.surface;
+}
+
+/**
+ * @brief upscaleSurface Enlarge a surface composed at reduced resolution to
+ * the display by repeating pixels.
+ *
+ * @param aSrc[in]      Surface returned by getScaledSurface().
+ * @param aDst[out]     Surface of display size in the same format.
+ * @param aFactor[in]   Factor of resolution.
+ */
+void upscaleSurface(SDL_Surface * aSrc, SDL_Surface * aDst, uint8_t aFactor)
+{
+    const blendKernels_t * k = getBlendKernels();
+    uint8_t                bpp = aDst->format->BytesPerPixel;
+    size_t                 rowBytes = (size_t)aDst->w * bpp;
+    uint64_t               startUs = getTimeUs();
+    const uint8_t        * src;
+    uint8_t              * dst;
+    int                    x;
+    int                    y;
+
+    if (SDL_MUSTLOCK(aSrc))
+    {
+        SDL_LockSurface(aSrc);
+    }
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_LockSurface(aDst);
+    }
+    for (y = 0; y < aDst->h && y / aFactor < aSrc->h; y++)
+    {
+        dst = (uint8_t *)aDst->pixels + (size_t)y * aDst->pitch;
+        if (y % aFactor)
+        {
+            /* Repeated row is a copy of the previous row of display */
+            memcpy(dst, dst - aDst->pitch, rowBytes);
+            continue;
+        }
+        src = (const uint8_t *)aSrc->pixels + (size_t)(y / aFactor) * aSrc->pitch;
+        switch (bpp)
+        {
+            case 4:
+                k->repeatRow32((uint32_t *)dst, (const uint32_t *)src, aDst->w, aFactor);
+                break;
+            case 2:
+                for (x = 0; x < aDst->w; x++)
+                {
+                    ((uint16_t *)dst)[x] = ((const uint16_t *)src)[x / aFactor];
+                }
+                break;
+            default:
+                for (x = 0; x < aDst->w; x++)
+                {
+                    memcpy(&dst[x * bpp], &src[(x / aFactor) * bpp], bpp);
+                }
+                break;
+        }
+    }
+    if (SDL_MUSTLOCK(aDst))
+    {
+        SDL_UnlockSurface(aDst);
+    }
+    if (SDL_MUSTLOCK(aSrc))
+    {
+        SDL_UnlockSurface(aSrc);
+    }
+    renderScale.upscaledFrames++;
+    renderScale.upscaleUsTotal += getTimeUs() - startUs;
+}
+
+/**
+ * @brief printRenderScaleStats Print usage of reduced resolution to console.
+ */
+void printRenderScaleStats(void)
+{
+    printf("Render scale changes:             %u\n", renderScale.factorChanges);
+    printf("Upscaled frames:                  %llu", (unsigned long long)renderScale.upscaledFrames);
+    if (renderScale.upscaledFrames)
+    {
+        printf(", %llu us per frame",
+               (unsigned long long)(renderScale.upscaleUsTotal / renderScale.upscaledFrames));
+    }
+    printf("\n");
+}
+
+/**
+ * @brief invalidateScaledSurface Release surface of reduced resolution. It
+ * shall be called if screen is reinitialized.
+ */
+void invalidateScaledSurface(void)
+{
+    if (renderScale.surface)
+    {
+        SDL_FreeSurface(renderScale.surface);
+        renderScale.surface = NULL;
+    }
+}
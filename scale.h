@@ -0,0 +1,54 @@
+/**
+ * @file        scale.h
+ * @brief       Dynamic internal resolution of script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 18:41:09
+ * Last modify: 2021-03-07 18:41:09 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_SCALE_H
+#define INCLUDE_SCALE_H
+
+#include <stdint.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "blend.h"
+
+#define RENDER_SCALE_AUTO               0       /* Only for configuration: factor is selected by frame time */
+#define RENDER_SCALE_MAX                4       /* Largest reduction of resolution */
+#define RENDER_SCALE_UPGRADE_FRAMES     30      /* Frames when finer resolution fits the budget before using it */
+#define RENDER_SCALE_DOWNGRADE_FRAMES   8       /* Frames after a change before reducing resolution again */
+
+typedef struct
+{
+    uint8_t         factor;                 /* Script is composed at 1/factor of display resolution */
+    uint32_t        budgetUs;               /* Target frame time */
+    uint32_t        avgFrameUs;             /* Average render time of frames */
+    uint32_t        calmFrames;             /* Count of consecutive frames when finer resolution would fit */
+    uint32_t        framesSinceChange;      /* Count of frames since last change of factor */
+    SDL_Surface   * surface;                /* Script composed at reduced resolution */
+    uint8_t         surfaceFactor;          /* Factor of surface */
+    /* Statistics */
+    uint32_t        factorChanges;          /* Count of changes of factor */
+    uint64_t        upscaledFrames;
+    uint64_t        upscaleUsTotal;         /* Time of upscaling frames */
+} renderScale_t;
+
+extern renderScale_t renderScale;
+
+bool_t parseRenderScale(const char * aText, uint8_t * aScale);
+const char * getRenderScaleName(uint8_t aScale);
+uint8_t selectRenderScale(void);
+uint8_t getSettledRenderScale(void);
+void renderScaleFrameDone(uint32_t aFrameUs);
+alphaMask_t * downscaleAlphaMask(alphaMask_t * aMask, uint8_t aFactor, bool_t aBinary);
+SDL_Surface * getScaledSurface(uint8_t aFactor);
+void upscaleSurface(SDL_Surface * aSrc, SDL_Surface * aDst, uint8_t aFactor);
+void printRenderScaleStats(void);
+void invalidateScaledSurface(void);
+
+#endif /* INCLUDE_SCALE_H */
@@ -0,0 +1,2203 @@
+/**
+ * @file        script.c
+ * @brief       Script loading, wrapping and scrolling
+ * @author      Copyright (C) Peter Ivanov, 2013, 2014, 2021
+ *
+ * Created      2013-12-30 11:48:53
+ * Last modify: 2021-02-15 19:01:21 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_ttf.h>
+#include <SDL/SDL_mutex.h>
+#include <SDL/SDL_thread.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "arena.h"
+#include "fontpool.h"
+#include "script.h"
+#include "stats.h"
+#include "alloctrack.h"
+
+#define LOAD_CHUNK_SIZE             (64 * 1024)     /* Script is read in chunks to report progress */
+#define WRAP_PROGRESS_LINES         256             /* Progress is reported after this many wrapped lines */
+#define WRAP_PARALLEL_MIN_BYTES     (256 * 1024)    /* Smaller scripts are wrapped by one thread */
+#define WRAP_MAX_BYTES_PER_PX       4               /* Longer text does not fit: a character is at least 1 pixel wide and at most 4 bytes */
+#define WRAP_SCRATCH_MIN_SIZE       1024            /* Initial size of buffer to measure text */
+#define LAYOUT_BENCH_MIN_BYTES      (1024 * 1024)   /* Size of first script of layout benchmark */
+#define LAYOUT_BENCH_TOKEN_LEN      4096            /* Length of unbreakable tokens in benchmark script */
+#define WRAP_SELFTEST_SCRIPTS       500             /* Count of random scripts wrapped by self test */
+#define WRAP_SELFTEST_MAX_BYTES     4096            /* Maximum size of a random script of self test */
+
+/* Progress of all chunks of a script */
+typedef struct
+{
+    size_t          bytesWrapped;
+    uint64_t        linesWrapped;
+} wrapProgress_t;
+
+/* Lines of previous layout which are compared with new lines while an
+ * edited paragraph is wrapped again */
+typedef struct
+{
+    rewrapState_t * rewrap;                 /* Paragraph which is wrapped again */
+    linkedListElement_t * line;             /* Next old line, at end of paragraph the line after it */
+    bool_t          kept;                   /* TRUE: line is a kept line of previous rewrap */
+    size_t          changeEnd;              /* Text from this column is the same as before the change */
+    ptrdiff_t       shift;                  /* Change of length of paragraph */
+    bool_t          paragraphEnd;           /* TRUE: text of chunk ends at end of paragraph */
+    bool_t          lined;                  /* TRUE: new lines lined up with old ones */
+    bool_t          complete;               /* FALSE: more text is needed to find the lines */
+} rewrapAlign_t;
+
+/* Part of script which starts with a paragraph, it is wrapped by one thread */
+typedef struct
+{
+    TTF_Font      * font;                   /* Font to measure text, it is not used by other threads */
+    int          (* measureWidth)(const char * aText); /* Width of text in self test, NULL: font is used */
+    const atlasFont_t * atlas;              /* Glyphs of font rasterized at build time, shared by threads */
+    uint16_t        maxWidthPx;
+    char          * scriptStart;            /* Start of whole script, offsets of lines are relative to it */
+    size_t          offsetBase;             /* Offset of scriptStart in script buffer */
+    size_t          offsetLimit;            /* Offsets of lines are not bigger than this */
+    size_t          columnBase;             /* Column of scriptStart in its paragraph */
+    char          * start;                  /* Start of chunk */
+    char          * end;                    /* End of chunk, start of next chunk */
+    char          * scriptEnd;              /* End of whole script */
+    linkedList_t  * list;                   /* Wrapped lines are added here */
+    arena_t       * arena;                  /* Memory of wrapped lines */
+    linkedListElement_t ** released;        /* Memory of these lines is reused, NULL: lines are allocated from arena */
+    rewrapAlign_t * align;                  /* Wrapping stops when lines line up with these, NULL: it does not */
+    linkedList_t    ownList;                /* Lines of chunk if it is not the first one */
+    arena_t         ownArena;               /* Memory of chunk if it is not the first one */
+    uint64_t        lineCount;              /* Count of wrapped lines of chunk */
+    uint64_t        reportedLines;          /* Lines already added to progress */
+    char          * scratch;                /* Text to measure is copied here to terminate it */
+    size_t          scratchSize;            /* Size of scratch buffer */
+    char          * reportedPtr;            /* Characters before it are already added to progress */
+    wrapProgress_t* progress;               /* Progress of all chunks, updated atomically */
+    loadStatus_t  * status;                 /* It can be NULL */
+    bool_t          ok;                     /* FALSE: error occurred, cancelled or stopped by align */
+} wrapChunk_t;
+
+static uint32_t layoutGeneration = 0;   /* Last generation given to a wrapped script */
+
+/**
+ * @brief initLoadStatus Initialize load status.
+ *
+ * @param aStatus[out]  Status to initialize.
+ * @return TRUE: if successfully initialized.
+ */
+bool_t initLoadStatus(loadStatus_t * aStatus)
+{
+    bool_t ok = TRUE;
+
+    memset(&aStatus->progress, 0, sizeof(aStatus->progress));
+    aStatus->cancel = FALSE;
+    aStatus->mutex = SDL_CreateMutex();
+    if (aStatus->mutex == NULL)
+    {
+        errorprintf("SDL_CreateMutex() Failed: %s\n", SDL_GetError());
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief doneLoadStatus Release resources of load status.
+ *
+ * @param aStatus[in]   Status to release.
+ */
+void doneLoadStatus(loadStatus_t * aStatus)
+{
+    if (aStatus->mutex)
+    {
+        SDL_DestroyMutex(aStatus->mutex);
+        aStatus->mutex = NULL;
+    }
+}
+
+/**
+ * @brief setLoadStatus Store status message. It can be called from any thread.
+ *
+ * @param aStatus[out]  Status to change. If it is NULL, message is dropped.
+ * @param aFmt[in]      Printf format string.
+ */
+void setLoadStatus(loadStatus_t * aStatus, const char * aFmt, ...)
+{
+    va_list valist;
+
+    if (aStatus)
+    {
+        SDL_mutexP(aStatus->mutex);
+        va_start (valist, aFmt);
+        vsnprintf (aStatus->progress.message, sizeof (aStatus->progress.message), aFmt, valist);
+        va_end (valist);
+        SDL_mutexV(aStatus->mutex);
+    }
+}
+
+/**
+ * @brief setLoadProgressRead Store progress of reading script file.
+ *
+ * @param aStatus[out]      Status to change. It can be NULL.
+ * @param aBytesRead[in]    Bytes already read.
+ * @param aBytesTotal[in]   Size of script file.
+ */
+void setLoadProgressRead(loadStatus_t * aStatus, size_t aBytesRead, size_t aBytesTotal)
+{
+    if (aStatus)
+    {
+        SDL_mutexP(aStatus->mutex);
+        aStatus->progress.bytesRead = aBytesRead;
+        aStatus->progress.bytesTotal = aBytesTotal;
+        aStatus->progress.bytesWrapped = 0;
+        aStatus->progress.linesWrapped = 0;
+        SDL_mutexV(aStatus->mutex);
+    }
+}
+
+/**
+ * @brief setLoadProgressWrap Store progress of wrapping script.
+ *
+ * @param aStatus[out]          Status to change. It can be NULL.
+ * @param aBytesWrapped[in]     Bytes of script already wrapped.
+ * @param aLinesWrapped[in]     Count of lines already wrapped.
+ */
+void setLoadProgressWrap(loadStatus_t * aStatus, size_t aBytesWrapped, uint64_t aLinesWrapped)
+{
+    if (aStatus)
+    {
+        SDL_mutexP(aStatus->mutex);
+        aStatus->progress.bytesWrapped = aBytesWrapped;
+        aStatus->progress.linesWrapped = aLinesWrapped;
+        SDL_mutexV(aStatus->mutex);
+    }
+}
+
+/**
+ * @brief getLoadProgress Copy actual progress. It does not block for long,
+ * so main loop can call it in every frame.
+ *
+ * @param aStatus[in]       Status to read.
+ * @param aProgress[out]    Copy of progress.
+ */
+void getLoadProgress(loadStatus_t * aStatus, loadProgress_t * aProgress)
+{
+    SDL_mutexP(aStatus->mutex);
+    *aProgress = aStatus->progress;
+    SDL_mutexV(aStatus->mutex);
+}
+
+/**
+ * @brief cancelLoad Request to stop loading. Loading functions check it
+ * regularly and return with error.
+ *
+ * @param aStatus[out]  Status to change.
+ */
+void cancelLoad(loadStatus_t * aStatus)
+{
+    SDL_mutexP(aStatus->mutex);
+    aStatus->cancel = TRUE;
+    SDL_mutexV(aStatus->mutex);
+}
+
+/**
+ * @brief isLoadCancelled Check if loading shall be stopped.
+ *
+ * @param aStatus[in]   Status to check. It can be NULL.
+ * @return TRUE: if cancelLoad() was called.
+ */
+bool_t isLoadCancelled(loadStatus_t * aStatus)
+{
+    bool_t cancel = FALSE;
+
+    if (aStatus)
+    {
+        SDL_mutexP(aStatus->mutex);
+        cancel = aStatus->cancel;
+        SDL_mutexV(aStatus->mutex);
+    }
+
+    return cancel;
+}
+
+/**
+ * @brief loadFont Load font from file. If no file path is given it loads embedded font.
+ *
+ * @param aFontFilePath[in]     Font to load. It can be NULL or zero length string as well.
+ * @param aFontSize[in]         Font size to use.
+ * @param aWrappedScript[out]   Font of script to be filled.
+ * @return TRUE: if any font successfully loaded.
+ */
+bool_t loadFont(const char * aFontFilePath, int aFontSize, wrappedScript_t *aWrappedScript)
+{
+    bool ok = TRUE;
+
+    if (aWrappedScript->ttf_font)
+    {
+        /* Previous font is kept open by font pool, so it can be reused */
+        releaseFont(aWrappedScript->ttf_font);
+        aWrappedScript->ttf_font = NULL;
+        aWrappedScript->atlas = NULL;
+    }
+    // Load a TrueType font
+    if (aFontFilePath != NULL && strlen(aFontFilePath))
+    {
+        verboseprintf("Loading font '%s' %i... ", aFontFilePath, aFontSize);
+        aWrappedScript->ttf_font = acquireFont(aFontFilePath, aFontSize);
+        if (aWrappedScript->ttf_font != NULL)
+        {
+            verboseprintf("Done.\n");
+        }
+        else
+        {
+            errorprintf("Cannot load font '%s'!\n", aFontFilePath);
+        }
+    }
+
+    if (aWrappedScript->ttf_font == NULL)
+    {
+        verboseprintf("Loading embedded font %i\n", aFontSize);
+        // Load TrueType font which is embedded into this software
+        aWrappedScript->ttf_font = acquireFont(FONT_SOURCE_EMBEDDED, aFontSize);
+        if (aWrappedScript->ttf_font == NULL)
+        {
+            errorprintf("Cannot load embedded font!\n");
+            ok = FALSE;
+        }
+    }
+    aWrappedScript->atlas = getFontAtlas(aWrappedScript->ttf_font);
+
+    return ok;
+}
+
+/**
+ * @brief loadScript Load script from file.
+ *
+ * @param[in]  aScriptFilePath  Script to load.
+ * @param[out] aScriptBuffer    Target buffer.
+ * @param[out] aStatus          Status messages are stored here. It can be NULL.
+ *
+ * @return TRUE: if script successfully loaded. FALSE: if error occured. Error text is stored in status.
+ */
+bool_t loadScript(const char * aScriptFilePath, char ** aScriptBuffer, loadStatus_t * aStatus)
+{
+    bool_t  ok = FALSE;
+    FILE  * file;
+    size_t  fileSize;
+    size_t  readBytes = 0;
+    size_t  chunkSize;
+
+    setLoadStatus(aStatus, "Loading script...");
+
+    if (*aScriptBuffer)
+    {
+        verboseprintf("Releasing memory... ");
+        free(*aScriptBuffer);
+        *aScriptBuffer = NULL;
+        verboseprintf("Done\n");
+    }
+
+    verboseprintf("Open file %s ... ", aScriptFilePath);
+    file = fopen(aScriptFilePath, "r");
+    if (file)
+    {
+        verboseprintf("Done.\n");
+        if (fseek(file, 0, SEEK_END) == 0)
+        {
+            fileSize = ftell(file);
+            if (fileSize)
+            {
+                if (fseek(file, 0, SEEK_SET) == 0)
+                {
+                    verboseprintf("Script size: %lu\n", fileSize);
+                    verboseprintf("Allocating memory... ");
+                    *aScriptBuffer = malloc(fileSize + 1); // +1 end of string
+                    if (*aScriptBuffer)
+                    {
+                        verboseprintf("Done.\n");
+                        setLoadProgressRead(aStatus, 0, fileSize);
+                        do
+                        {
+                            chunkSize = MIN(fileSize - readBytes, LOAD_CHUNK_SIZE);
+                            chunkSize = fread(*aScriptBuffer + readBytes, 1, chunkSize, file);
+                            readBytes += chunkSize;
+                            setLoadProgressRead(aStatus, readBytes, fileSize);
+                        } while (chunkSize && readBytes < fileSize && !isLoadCancelled(aStatus));
+                        verboseprintf("%lu bytes were read\n", readBytes);
+                        if (readBytes == fileSize)
+                        {
+                            (*aScriptBuffer)[fileSize] = CHR_EOS; // end of string
+                            setLoadStatus(aStatus, "Script loaded.");
+                            ok = TRUE;
+                        }
+                        else if (isLoadCancelled(aStatus))
+                        {
+                            verboseprintf("Loading cancelled\n");
+                            setLoadStatus(aStatus, "Loading cancelled.");
+                        }
+                        else
+                        {
+                            errorprintf("Cannot read from script file!\n");
+                            verboseprintf("errno: %i\n", errno);
+                            verboseprintf("strerror: %s\n", strerror(errno));
+                            setLoadStatus(aStatus, "ERROR: Cannot read from script file!");
+                        }
+                    }
+                    else
+                    {
+                        errorprintf("Cannot allocate memory for script!\n");
+                        setLoadStatus(aStatus, "ERROR: Cannot allocate memory for script!");
+                    }
+                }
+                else
+                {
+                    errorprintf("Cannot seek to beginning of file!\n");
+                    setLoadStatus(aStatus, "ERROR: Cannot seek to beginning of file!");
+                }
+            }
+            else
+            {
+                errorprintf("File is empty!\n");
+                setLoadStatus(aStatus, "ERROR: File is empty!");
+            }
+        }
+        else
+        {
+            setLoadStatus(aStatus, "ERROR: Cannot seek to end of file!");
+        }
+        verboseprintf("Closing file... ");
+        if (!fclose(file))
+        {
+            verboseprintf("Done.\n");
+        }
+        else
+        {
+            errorprintf("Cannot close file!\n");
+        }
+    }
+    else
+    {
+        errorprintf("Cannot open script file!\n");
+        setLoadStatus(aStatus, "ERROR: Cannot open script file!");
+    }
+
+    return ok;
+}
+
+/**
+ * @brief skipWhitespace Find first character which is not white space.
+ *
+ * @param aPtr[in]  Start of search.
+ * @param aEnd[in]  End of text.
+ * @return First non white space character or aEnd.
+ */
+static char * skipWhitespace(char * aPtr, char * aEnd)
+{
+    while (aPtr < aEnd && IS_WHITESPACE(*aPtr))
+    {
+        aPtr++;
+    }
+
+    return aPtr;
+}
+
+/**
+ * @brief findParagraphEnd Find end of paragraph. Paragraphs are separated by
+ * at least one empty line, it can contain white spaces.
+ *
+ * @param aPtr[in]  Start of search.
+ * @param aEnd[in]  End of text.
+ * @return First line feed of separator or aEnd.
+ */
+static char * findParagraphEnd(char * aPtr, char * aEnd)
+{
+    char * next;
+
+    while (aPtr < aEnd)
+    {
+        if (*aPtr == CHR_LF)
+        {
+            for (next = aPtr + 1; next < aEnd && *next != CHR_LF && IS_WHITESPACE(*next); next++)
+            {
+            }
+            if (next < aEnd && *next == CHR_LF)
+            {
+                return aPtr;
+            }
+            aPtr = next;
+        }
+        else
+        {
+            aPtr++;
+        }
+    }
+
+    return aEnd;
+}
+
+/**
+ * @brief reportWrapProgress Add progress of chunk to total progress and check
+ * if loading was cancelled.
+ *
+ * @param aChunk[in,out]    Chunk of script.
+ * @param aPtr[in]          Wrapping of chunk is done until this character.
+ */
+static void reportWrapProgress(wrapChunk_t * aChunk, char * aPtr)
+{
+    size_t   bytes = __sync_add_and_fetch(&aChunk->progress->bytesWrapped, (size_t)(aPtr - aChunk->reportedPtr));
+    uint64_t lines = __sync_add_and_fetch(&aChunk->progress->linesWrapped, aChunk->lineCount - aChunk->reportedLines);
+
+    aChunk->reportedPtr = aPtr;
+    aChunk->reportedLines = aChunk->lineCount;
+    setLoadProgressWrap(aChunk->status, bytes, lines);
+    if (isLoadCancelled(aChunk->status))
+    {
+        setLoadStatus(aChunk->status, "Loading cancelled.");
+        aChunk->ok = FALSE;
+    }
+}
+
+/**
+ * @brief getOldColumn Get column of the next old line of an edited paragraph.
+ *
+ * @param aAlign[in]    Old lines, end of paragraph shall not be reached.
+ * @return Column of line before the change.
+ */
+static size_t getOldColumn(const rewrapAlign_t * aAlign)
+{
+    size_t column = getScriptElementColumn(aAlign->line);
+
+    if (aAlign->kept)
+    {
+        /* Shifted column can be out of range, it is calculated modulo */
+        column += (size_t)aAlign->rewrap->keptShift;
+    }
+
+    return column;
+}
+
+/**
+ * @brief nextOldLine Step to the next old line of an edited paragraph.
+ *
+ * @param aAlign[in,out]    Old lines.
+ */
+static void nextOldLine(rewrapAlign_t * aAlign)
+{
+    aAlign->line = aAlign->line->next;
+    if (aAlign->line && aAlign->line == aAlign->rewrap->kept)
+    {
+        aAlign->kept = TRUE;
+    }
+}
+
+/**
+ * @brief alignWrappedLine Check if the next line starts where an old line
+ * started after the changed text. Greedy wrapping of the same text from there
+ * gives the old lines again, so wrapping is stopped.
+ *
+ * @param aChunk[in,out]    Chunk with text of edited paragraph.
+ * @param aNextStart[in]    Start of next line.
+ * @param aPtr[in]          Text was checked until this character to break the line.
+ */
+static void alignWrappedLine(wrapChunk_t * aChunk, char * aNextStart, char * aPtr)
+{
+    rewrapAlign_t * align = aChunk->align;
+    size_t          column = aChunk->columnBase + (size_t)(aNextStart - aChunk->scriptStart);
+
+    if (!align->paragraphEnd && aPtr >= aChunk->end)
+    {
+        /* Break depends on text which was not given */
+        align->complete = FALSE;
+        aChunk->ok = FALSE;
+        return;
+    }
+    if (aNextStart >= aChunk->end || column < align->changeEnd)
+    {
+        return;
+    }
+    /* Text is the same from here, its column was different before the change */
+    column -= (size_t)align->shift;
+    while (align->line != align->rewrap->next && getOldColumn(align) < column)
+    {
+        nextOldLine(align);
+    }
+    if (align->line != align->rewrap->next && getOldColumn(align) == column)
+    {
+        align->lined = TRUE;
+        aChunk->ok = FALSE;
+    }
+}
+
+/**
+ * @brief addWrappedLine Add a wrapped line to the list of chunk.
+ *
+ * @param aChunk[in,out]    Chunk of script.
+ * @param aLineStart[in]    First character of line in script.
+ * @param aLineEnd[in]      End of line in script.
+ * @param aColumn[in]       Offset of line in its paragraph, LINE_COLUMN_NONE: separator.
+ * @param aPtr[in]          Wrapping of chunk is done until this character.
+ */
+static void addWrappedLine(wrapChunk_t * aChunk, char * aLineStart, char * aLineEnd, size_t aColumn, char * aPtr)
+{
+    size_t offset = aChunk->offsetBase + (size_t)(aLineStart - aChunk->scriptStart);
+
+    if (aColumn != LINE_COLUMN_NONE)
+    {
+        aColumn += aChunk->columnBase;
+    }
+    if (aChunk->released)
+    {
+        aChunk->ok = addReleasedScriptElement(aLineStart, (size_t)(aLineEnd - aLineStart), MIN(offset, aChunk->offsetLimit),
+                                              aColumn, aChunk->released, aChunk->list, aChunk->arena);
+    }
+    else
+    {
+        aChunk->ok = addScriptElement(aLineStart, (size_t)(aLineEnd - aLineStart), MIN(offset, aChunk->offsetLimit),
+                                      aColumn, aChunk->list, aChunk->arena);
+    }
+    aChunk->lineCount++;
+    if (aChunk->ok && aChunk->align)
+    {
+        alignWrappedLine(aChunk, aLineEnd, aPtr);
+    }
+    if (aChunk->ok && aChunk->lineCount % WRAP_PROGRESS_LINES == 0)
+    {
+        reportWrapProgress(aChunk, aPtr);
+    }
+}
+
+/**
+ * @brief fitsWidth Check if text fits into the width of chunk. Text is
+ * measured in the scratch buffer of chunk, because script cannot be
+ * terminated in place: the next character can belong to another chunk.
+ *
+ * @param aChunk[in,out]    Chunk of script.
+ * @param aStart[in]        First character of text.
+ * @param aEnd[in]          End of text.
+ * @return TRUE: if text is narrower than the width.
+ */
+static bool_t fitsWidth(wrapChunk_t * aChunk, char * aStart, char * aEnd)
+{
+    size_t len = (size_t)(aEnd - aStart);
+    size_t size;
+    size_t i;
+    char * scratch;
+    int    text_width_px = 0;
+    int    text_height_px;
+
+    if (len > (size_t)aChunk->maxWidthPx * WRAP_MAX_BYTES_PER_PX)
+    {
+        /* Measuring would cost a lot, result is known */
+        return FALSE;
+    }
+    if (len + 1 > aChunk->scratchSize)
+    {
+        size = MAX(aChunk->scratchSize * 2, MAX(len + 1, WRAP_SCRATCH_MIN_SIZE));
+        scratch = realloc(aChunk->scratch, size);
+        if (scratch == NULL)
+        {
+            errorprintf("Cannot allocate memory to measure text!\n");
+            setLoadStatus(aChunk->status, "ERROR: Out of memory!");
+            aChunk->ok = FALSE;
+            return TRUE;
+        }
+        aChunk->scratch = scratch;
+        aChunk->scratchSize = size;
+    }
+    /* Line feeds and tabs are measured as they are shown */
+    for (i = 0; i < len; i++)
+    {
+        aChunk->scratch[i] = IS_WHITESPACE(aStart[i]) ? CHR_SPACE : aStart[i];
+    }
+    aChunk->scratch[len] = CHR_EOS;
+    if (aChunk->measureWidth)
+    {
+        text_width_px = aChunk->measureWidth(aChunk->scratch);
+    }
+    else
+    {
+        sizeText(aChunk->font, aChunk->atlas, aChunk->scratch, &text_width_px, &text_height_px);
+    }
+
+    return text_width_px < aChunk->maxWidthPx;
+}
+
+/**
+ * @brief findBreak Find where a word which is wider than the chunk shall be
+ * broken. Break is searched by doubling the length, then by halving the
+ * interval, so only about the length of a line is measured.
+ *
+ * @param aChunk[in,out]    Chunk of script.
+ * @param aStart[in]        First character of word.
+ * @param aEnd[in]          End of word, the whole word does not fit.
+ * @return Start of first character which does not fit. At least one
+ *         character is left before it, even if it does not fit.
+ */
+static char * findBreak(wrapChunk_t * aChunk, char * aStart, char * aEnd)
+{
+    char * good = aStart + 1;   /* Longest text which fits, at least one character */
+    char * bad = aEnd;          /* Shortest text which does not fit */
+    char * ptr;
+    size_t step = 1;
+
+    while (good < aEnd && IS_UTF8_CONTINUATION(*good))
+    {
+        good++;
+    }
+
+    /* Double the length until it does not fit */
+    while (good < bad && aChunk->ok)
+    {
+        ptr = good + MIN(step, (size_t)(bad - good));
+        while (ptr < bad && IS_UTF8_CONTINUATION(*ptr))
+        {
+            ptr++;
+        }
+        if (ptr >= bad)
+        {
+            break;
+        }
+        if (fitsWidth(aChunk, aStart, ptr))
+        {
+            good = ptr;
+            step *= 2;
+        }
+        else
+        {
+            bad = ptr;
+            break;
+        }
+    }
+
+    /* Halve the interval until there is no character boundary inside */
+    while (good < bad && aChunk->ok)
+    {
+        ptr = good + (bad - good) / 2;
+        while (ptr > good && IS_UTF8_CONTINUATION(*ptr))
+        {
+            ptr--;
+        }
+        if (ptr == good)
+        {
+            ptr = good + (bad - good) / 2;
+            while (ptr < bad && IS_UTF8_CONTINUATION(*ptr))
+            {
+                ptr++;
+            }
+        }
+        if (ptr == good || ptr == bad)
+        {
+            break;
+        }
+        if (fitsWidth(aChunk, aStart, ptr))
+        {
+            good = ptr;
+        }
+        else
+        {
+            bad = ptr;
+        }
+    }
+
+    return good;
+}
+
+/**
+ * @brief wrapParagraph Wrap a paragraph to the width of chunk. Lines are
+ * broken at white spaces, a word which is wider than a line is broken between
+ * characters. Script is not changed, line feeds inside the paragraph become
+ * spaces in the copied lines.
+ *
+ * @param aChunk[in,out]    Chunk of script which contains the paragraph.
+ * @param aStart[in]        First character of paragraph.
+ * @param aEnd[in]          End of paragraph.
+ */
+static void wrapParagraph(wrapChunk_t * aChunk, char * aStart, char * aEnd)
+{
+    char   * start_ptr = aStart;    /* Start of text */
+    char   * end_ptr = aStart;      /* End of text */
+    char   * prev_end_ptr = aStart; /* Previous end of text (to detect overflow of line) */
+    char   * word_end_ptr;          /* End of last word without white spaces */
+    char   * break_ptr;
+    char   * ptr = aStart;
+
+    while (ptr < aEnd && aChunk->ok)
+    {
+        while (ptr < aEnd && !IS_WHITESPACE(*ptr))
+        {
+            ptr++;
+        }
+        word_end_ptr = ptr;
+
+        // Search end of white spaces
+        ptr = skipWhitespace(ptr, aEnd);
+
+        prev_end_ptr = end_ptr;
+        end_ptr = ptr;
+        // Check if next word is longer than necessary
+        if (!fitsWidth(aChunk, start_ptr, end_ptr))
+        {
+            if (prev_end_ptr > start_ptr)
+            {
+                // It's longer, wrap text at previous word
+                addWrappedLine(aChunk, start_ptr, prev_end_ptr, (size_t)(start_ptr - aStart), ptr);
+                start_ptr = prev_end_ptr;
+            }
+            // Word alone is wider than a line, break it
+            while (aChunk->ok && start_ptr < word_end_ptr && !fitsWidth(aChunk, start_ptr, word_end_ptr))
+            {
+                break_ptr = findBreak(aChunk, start_ptr, word_end_ptr);
+                addWrappedLine(aChunk, start_ptr, break_ptr, (size_t)(start_ptr - aStart), ptr);
+                start_ptr = break_ptr;
+            }
+        }
+    }
+
+    if (aChunk->ok)
+    {
+        // Add last chunk of text
+        addWrappedLine(aChunk, start_ptr, aEnd, (size_t)(start_ptr - aStart), aEnd);
+    }
+}
+
+/**
+ * @brief wrapChunk Wrap all paragraphs of a chunk. Paragraphs are separated
+ * by an empty line.
+ *
+ * @param aChunk[in,out]    Chunk of script.
+ */
+static void wrapChunk(wrapChunk_t * aChunk)
+{
+    char * ptr = skipWhitespace(aChunk->start, aChunk->end);
+    char * paragraph_end;
+
+    aChunk->reportedPtr = aChunk->start;
+    while (ptr < aChunk->end && aChunk->ok)
+    {
+        paragraph_end = findParagraphEnd(ptr, aChunk->end);
+        wrapParagraph(aChunk, ptr, paragraph_end);
+        ptr = skipWhitespace(paragraph_end, aChunk->end);
+        /* End of chunk is start of a paragraph of next chunk, separator belongs to this chunk */
+        if (aChunk->ok && paragraph_end < aChunk->end && ptr < aChunk->scriptEnd)
+        {
+            addWrappedLine(aChunk, paragraph_end, paragraph_end, LINE_COLUMN_NONE, ptr);
+        }
+    }
+    if (aChunk->ok)
+    {
+        reportWrapProgress(aChunk, aChunk->end);
+    }
+    free(aChunk->scratch);
+    aChunk->scratch = NULL;
+    aChunk->scratchSize = 0;
+}
+
+/**
+ * @brief wrapChunkThread Thread which wraps a chunk of script.
+ *
+ * @param aData[in,out] Chunk of script, see wrapChunk_t.
+ * @return 0
+ */
+static int wrapChunkThread(void * aData)
+{
+    enterAllocScope(ALLOC_SUBSYSTEM_script);
+    wrapChunk(aData);
+
+    return 0;
+}
+
+/**
+ * @brief getWrapThreadCount Get count of threads used for wrapping.
+ *
+ * @param aScriptSize[in]   Size of script in bytes.
+ * @return Count of threads: 1 .. WRAP_MAX_THREADS.
+ */
+static uint8_t getWrapThreadCount(size_t aScriptSize)
+{
+    long count = config.wrap_threads;
+
+    if (aScriptSize < WRAP_PARALLEL_MIN_BYTES)
+    {
+        /* Starting threads costs more than wrapping a short script */
+        count = 1;
+    }
+    else if (count == 0)
+    {
+        count = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
+    return MAX(1, MIN(count, WRAP_MAX_THREADS));
+}
+
+/**
+ * @brief findChunkEnd Find end of a chunk when script is split into chunks
+ * of about the same size. Chunks end at the start of a paragraph.
+ *
+ * @param aScriptBuffer[in]     Start of script.
+ * @param aChunkStart[in]       Start of chunk.
+ * @param aScriptEnd[in]        End of script.
+ * @param aIndex[in]            Index of chunk, 1 .. aCount.
+ * @param aCount[in]            Count of chunks.
+ * @return End of chunk, aScriptEnd for the last chunk.
+ */
+static char * findChunkEnd(char * aScriptBuffer, char * aChunkStart, char * aScriptEnd, uint8_t aIndex, uint8_t aCount)
+{
+    char * chunk_end = aScriptEnd;
+
+    if (aIndex < aCount)
+    {
+        chunk_end = aScriptBuffer + (aScriptEnd - aScriptBuffer) / aCount * aIndex;
+        chunk_end = skipWhitespace(findParagraphEnd(MAX(chunk_end, aChunkStart), aScriptEnd), aScriptEnd);
+    }
+
+    return chunk_end;
+}
+
+/**
+ * @brief buildLineTable Collect lines of wrapped script into an array, so a
+ * line can be found by its offset in script buffer with binary search.
+ * rewrapParagraph() updates the array in place.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script.
+ * @return TRUE: if successfully built.
+ */
+static bool_t buildLineTable(wrappedScript_t * aWrappedScript)
+{
+    bool_t                ok = TRUE;
+    size_t                count = 0;
+    linkedListElement_t * element;
+
+    for (element = aWrappedScript->wrappedScriptList.first; element; element = element->next)
+    {
+        count++;
+    }
+    free(aWrappedScript->lineTable);
+    aWrappedScript->lineTable = malloc(MAX(count, 1) * sizeof(linkedListElement_t *));
+    if (aWrappedScript->lineTable)
+    {
+        count = 0;
+        for (element = aWrappedScript->wrappedScriptList.first; element; element = element->next)
+        {
+            aWrappedScript->lineTable[count++] = element;
+        }
+        aWrappedScript->lineCount = count;
+    }
+    else
+    {
+        errorprintf("Cannot allocate memory for line table!\n");
+        aWrappedScript->lineCount = 0;
+        ok = FALSE;
+    }
+
+    return ok;
+}
+
+/**
+ * @brief wrapScriptThreads Wrap script with the specified count of threads.
+ * Script is split into chunks at paragraphs, so the result is the same for
+ * any count of threads.
+ *
+ * @param aScriptBuffer[in]     Input text to wrap.
+ * @param aMaxWidthPx[in]       Maximum width of text in pixels.
+ * @param aMaxHeightPx[in]      Maximum height of text in pixels.
+ * @param aWrappedScript[out]   Wrapped text.
+ * @param aStatus[out]          Status messages are stored here. It can be NULL.
+ * @param aThreadCount[in]      Count of threads, 1 .. WRAP_MAX_THREADS.
+ * @return TRUE: if successfully wrapped.
+ */
+static bool_t wrapScriptThreads(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx,
+                                wrappedScript_t * aWrappedScript, loadStatus_t * aStatus, uint8_t aThreadCount)
+{
+    bool_t          ok = TRUE;
+    uint32_t        i;
+    int             text_width_px;
+    int             text_height_px;
+    char            text[2] = " "; /* Empty string by default, later will be filled */
+    uint32_t        additional_line_count;
+    uint32_t        block_count;
+    size_t          spare_bytes;
+    uint8_t         chunk_count = 0;
+    char          * script_end = aScriptBuffer + strlen(aScriptBuffer);
+    char          * chunk_start;
+    char          * chunk_end;
+    wrapChunk_t     chunks[WRAP_MAX_THREADS];
+    SDL_Thread    * threads[WRAP_MAX_THREADS];
+    TTF_Font      * font;
+    wrapProgress_t  progress = { 0, 0 };
+    uint64_t        start_us = getTimeUs();
+    struct rusage   usage;
+
+    verboseprintf("Wrap script to %i x %i... ", aMaxWidthPx, aMaxHeightPx);
+    setLoadStatus(aStatus, "Wrapping script...");
+    aWrappedScript->maxWidthPx = aMaxWidthPx;
+    aWrappedScript->maxHeightPx = aMaxHeightPx;
+    /* Loader thread and main thread can wrap at the same time */
+    aWrappedScript->generation = __sync_add_and_fetch(&layoutGeneration, 1);
+
+    /* Lines of previous layout are released at once */
+    resetWrappedScript(aWrappedScript);
+    block_count = aWrappedScript->arena.blockCount;
+
+    /* Next script can be wrapped in background while the same font is drawn
+     * by main thread, so this thread measures text with its own instance */
+    font = openPrivateFont(aWrappedScript->ttf_font);
+    ok = font != NULL;
+    additional_line_count = 0;
+    if (ok)
+    {
+        /* Add empty lines, so the scrolling will start with empty screen */
+        sizeText(font, aWrappedScript->atlas, text, &text_width_px, &text_height_px);
+        aWrappedScript->linePerScreen = aMaxHeightPx / text_height_px;
+        additional_line_count = aWrappedScript->linePerScreen + 4;
+    }
+    for (i = 0u; i < additional_line_count && ok; i++)
+    {
+        if (i == additional_line_count - 6)
+        {
+            text[0] = '3';
+        }
+        if (i == additional_line_count - 5)
+        {
+            text[0] = ' ';
+        }
+        if (i == additional_line_count - 4)
+        {
+            text[0] = '2';
+        }
+        if (i == additional_line_count - 3)
+        {
+            text[0] = ' ';
+        }
+        if (i == additional_line_count - 2)
+        {
+            text[0] = '1';
+        }
+        if (i == additional_line_count - 1)
+        {
+            text[0] = ' ';
+        }
+        ok = addScriptElement(text, strlen(text), 0, LINE_COLUMN_NONE,
+                              &(aWrappedScript->wrappedScriptList), &aWrappedScript->arena);
+    }
+
+    /* Split script into chunks of about the same size at paragraph boundaries */
+    memset(chunks, 0, sizeof(chunks));
+    memset(threads, 0, sizeof(threads));
+    chunk_start = skipWhitespace(aScriptBuffer, script_end);
+    spare_bytes = arenaSpare(&aWrappedScript->arena);
+    for (i = 1; i <= aThreadCount && ok; i++)
+    {
+        chunk_end = findChunkEnd(aScriptBuffer, chunk_start, script_end, i, aThreadCount);
+        if (chunk_end > chunk_start || chunk_count == 0)
+        {
+            wrapChunk_t * chunk = &chunks[chunk_count];
+            chunk->scriptStart = aScriptBuffer;
+            chunk->offsetLimit = SIZE_MAX;
+            chunk->start = chunk_start;
+            chunk->end = chunk_end;
+            chunk->scriptEnd = script_end;
+            chunk->maxWidthPx = aMaxWidthPx;
+            chunk->atlas = aWrappedScript->atlas;
+            chunk->status = aStatus;
+            chunk->progress = &progress;
+            chunk->ok = TRUE;
+            if (chunk_count == 0)
+            {
+                /* First chunk is wrapped by this thread directly into the script */
+                chunk->font = font;
+                chunk->list = &aWrappedScript->wrappedScriptList;
+                chunk->arena = &aWrappedScript->arena;
+            }
+            else
+            {
+                /* Faces of FreeType cannot be shared between threads */
+                chunk->font = openPrivateFont(aWrappedScript->ttf_font);
+                resetLinkedList(&chunk->ownList);
+                chunk->list = &chunk->ownList;
+                chunk->arena = &chunk->ownArena;
+                /* Blocks kept from previous wrap are shared by size of chunks,
+                 * so a wrap of the same script does not allocate new ones */
+                arenaLend(&aWrappedScript->arena, chunk->arena,
+                          (size_t)((double)spare_bytes * (chunk_end - chunk_start) / (script_end - aScriptBuffer)));
+                ok = chunk->font != NULL;
+            }
+            chunk_count++;
+            chunk_start = chunk_end;
+        }
+    }
+
+    /* Start from the last chunk, the first one is wrapped by this thread */
+    for (i = chunk_count - 1; i > 0 && ok; i--)
+    {
+        threads[i] = SDL_CreateThread(wrapChunkThread, &chunks[i]);
+        if (threads[i] == NULL)
+        {
+            errorprintf("SDL_CreateThread() Failed: %s\n", SDL_GetError());
+            wrapChunk(&chunks[i]);
+        }
+    }
+    if (ok)
+    {
+        wrapChunk(&chunks[0]);
+        ok = chunks[0].ok;
+    }
+    for (i = 1; i < chunk_count; i++)
+    {
+        if (threads[i])
+        {
+            SDL_WaitThread(threads[i], NULL);
+        }
+        ok = ok && chunks[i].ok;
+    }
+
+    /* Stitch lines of chunks after the first one, their blocks are kept for
+     * next wrap as well */
+    for (i = 1; i < chunk_count; i++)
+    {
+        if (ok)
+        {
+            appendLinkedList(&aWrappedScript->wrappedScriptList, &chunks[i].ownList);
+            arenaAppend(&aWrappedScript->arena, &chunks[i].ownArena);
+        }
+        else
+        {
+            arenaFree(&chunks[i].ownArena);
+        }
+        closePrivateFont(chunks[i].font);
+    }
+    closePrivateFont(font);
+
+    if (ok)
+    {
+        ok = buildLineTable(aWrappedScript);
+    }
+    if (ok)
+    {
+        aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.first;
+        aWrappedScript->wrappedScriptHeightPx = text_height_px;
+    }
+    else
+    {
+        /* Error occurred: free linked list */
+        resetWrappedScript(aWrappedScript);
+    }
+    aWrappedScript->layoutUs = getTimeUs() - start_us;
+    verboseprintf("Done in %llu ms with %u threads.\n",
+                  (unsigned long long)(aWrappedScript->layoutUs / 1000u), chunk_count);
+    if (config.verbose && getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+        printf("Layout: %llu lines, %u new arena blocks instead of %llu malloc() calls, "
+               "%lu KiB used of %lu KiB, peak RSS: %li KiB\n",
+               (unsigned long long)aWrappedScript->lineCount,
+               aWrappedScript->arena.blockCount - block_count,
+               (unsigned long long)aWrappedScript->lineCount * 2u,
+               (unsigned long)(aWrappedScript->arena.bytesUsed / 1024),
+               (unsigned long)(aWrappedScript->arena.bytesReserved / 1024),
+               usage.ru_maxrss);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief wrapScript Wrap script to the specified width. Big scripts are
+ * wrapped by more threads, see config.wrap_threads.
+ *
+ * @param aScriptBuffer[in]     Input text to wrap.
+ * @param aMaxWidthPx[in]       Maximum width of text in pixels.
+ * @param aMaxHeightPx[in]      Maximum height of text in pixels.
+ * @param aWrappedScript[out]   Wrapped text.
+ * @param aStatus[out]          Status messages are stored here. It can be NULL.
+ * @return TRUE: if successfully wrapped.
+ */
+bool_t wrapScript(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript, loadStatus_t * aStatus)
+{
+    return wrapScriptThreads(aScriptBuffer, aMaxWidthPx, aMaxHeightPx, aWrappedScript, aStatus,
+                             getWrapThreadCount(strlen(aScriptBuffer)));
+}
+
+/**
+ * @brief replaceTableLines Replace lines of a paragraph in line table. Lines
+ * after the paragraph are moved if count of lines changed.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script, line table shall exist.
+ * @param aIndex[in]                Index of first line of paragraph in table.
+ * @param aOldCount[in]             Count of old lines of paragraph.
+ * @param aLines[in]                New lines of paragraph.
+ * @param aNewCount[in]             Count of new lines.
+ * @return TRUE: if successfully replaced. FALSE: table is released, it is
+ *         built again at next use.
+ */
+static bool_t replaceTableLines(wrappedScript_t * aWrappedScript, size_t aIndex, size_t aOldCount,
+                                const linkedList_t * aLines, size_t aNewCount)
+{
+    linkedListElement_t ** table = aWrappedScript->lineTable;
+    linkedListElement_t  * element;
+    size_t                 count = aWrappedScript->lineCount - aOldCount + aNewCount;
+    size_t                 i;
+
+    if (aNewCount > aOldCount)
+    {
+        table = realloc(table, count * sizeof(linkedListElement_t *));
+        if (table == NULL)
+        {
+            free(aWrappedScript->lineTable);
+            aWrappedScript->lineTable = NULL;
+            aWrappedScript->lineCount = 0;
+            return FALSE;
+        }
+        aWrappedScript->lineTable = table;
+    }
+    memmove(&table[aIndex + aNewCount], &table[aIndex + aOldCount],
+            (aWrappedScript->lineCount - aIndex - aOldCount) * sizeof(linkedListElement_t *));
+    for (i = aIndex, element = aLines->first; i < aIndex + aNewCount; i++, element = element->next)
+    {
+        table[i] = element;
+    }
+    aWrappedScript->lineCount = count;
+
+    return TRUE;
+}
+
+/**
+ * @brief startRewrap Start wrapping a paragraph again and again while one of
+ * its lines is edited. Wrapping starts at a line which does not depend on the
+ * edited text: a line is broken before a word when the word and the white
+ * spaces after it do not fit, so the first word of the next line and the
+ * character after its white spaces shall be before the edited text.
+ *
+ * @param aRewrap[out]  State of paragraph.
+ * @param aLine[in]     Edited line, text before it is not changed.
+ * @param aNext[in]     Line after the paragraph, NULL: paragraph is the last one.
+ */
+void startRewrap(rewrapState_t * aRewrap, linkedListElement_t * aLine, linkedListElement_t * aNext)
+{
+    linkedListElement_t * first = aLine;
+    linkedListElement_t * element;
+    const char          * text;
+    bool_t                found = FALSE;
+    bool_t                space;
+
+    while (getScriptElementColumn(first) != 0 && !found)
+    {
+        first = first->prev;
+        /* Lines cover their paragraph without gaps */
+        space = FALSE;
+        for (element = first; element != aLine && !found; element = element->next)
+        {
+            for (text = element->item; *text && !found; text++)
+            {
+                space = space || *text == CHR_SPACE;
+                found = space && *text != CHR_SPACE;
+            }
+        }
+    }
+    aRewrap->first = first;
+    aRewrap->next = aNext;
+    aRewrap->kept = NULL;
+    aRewrap->keptShift = 0;
+}
+
+/**
+ * @brief rewrapParagraph Wrap an edited paragraph again from the first line
+ * of rewrap until new lines line up with old ones, and replace the changed
+ * lines in the wrapped script. Other lines are not touched, so their cached
+ * masks stay valid. Only the line table is shifted by the change of line
+ * count. Memory of replaced lines is reused by next rewrap.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script.
+ * @param aRewrap[in,out]           State of paragraph, see startRewrap().
+ * @param aText[in]                 New text of paragraph from the first line of rewrap,
+ *                                  it does not need to be terminated.
+ * @param aLength[in]               Length of text.
+ * @param aParagraphEnd[in]         TRUE: text ends at end of paragraph.
+ * @param aChangeEnd[in]            Column of first character after the changed text.
+ * @param aShift[in]                Change of length of paragraph.
+ * @param aComplete[out]            FALSE: new lines did not line up with old ones
+ *                                  before end of text, more text is needed. Lines are
+ *                                  not changed.
+ * @return TRUE: if successfully wrapped. Lines are not changed if error occurred.
+ */
+bool_t rewrapParagraph(wrappedScript_t * aWrappedScript, rewrapState_t * aRewrap, char * aText, size_t aLength,
+                       bool_t aParagraphEnd, size_t aChangeEnd, ptrdiff_t aShift, bool_t * aComplete)
+{
+    wrapChunk_t           chunk;
+    rewrapAlign_t         align;
+    wrapProgress_t        progress = { 0, 0 };
+    linkedList_t          lines;
+    linkedList_t        * list = &aWrappedScript->wrappedScriptList;
+    linkedListElement_t * first = aRewrap->first;
+    linkedListElement_t * next;
+    linkedListElement_t * element;
+    size_t                column = LINE_COLUMN_NONE;
+    size_t                offset_limit;
+    size_t                index = 0;
+    size_t                count = 0;
+    bool_t                kept = FALSE;
+
+    memset(&chunk, 0, sizeof(chunk));
+    memset(&align, 0, sizeof(align));
+    resetLinkedList(&lines);
+    align.rewrap = aRewrap;
+    align.line = first;
+    nextOldLine(&align);
+    align.changeEnd = aChangeEnd;
+    align.shift = aShift;
+    align.paragraphEnd = aParagraphEnd;
+    align.complete = TRUE;
+    chunk.font = aWrappedScript->ttf_font;
+    chunk.atlas = aWrappedScript->atlas;
+    chunk.maxWidthPx = aWrappedScript->maxWidthPx;
+    chunk.scriptStart = aText;
+    chunk.start = aText;
+    chunk.end = aText + aLength;
+    chunk.scriptEnd = aText + aLength;
+    /* Lines stay between their neighbours in order of offsets, see below */
+    chunk.offsetBase = getScriptElementOffset(first);
+    chunk.offsetLimit = SIZE_MAX;
+    chunk.columnBase = getScriptElementColumn(first);
+    chunk.list = &lines;
+    chunk.arena = &aWrappedScript->arena;
+    chunk.released = &aWrappedScript->releasedLines;
+    chunk.align = &align;
+    chunk.reportedPtr = aText;
+    chunk.progress = &progress;
+    chunk.ok = TRUE;
+    wrapParagraph(&chunk, aText, aText + aLength);
+    free(chunk.scratch);
+    /* Wrapping is stopped like by an error when lines line up or text ends */
+    chunk.ok = chunk.ok || align.lined || !align.complete;
+    *aComplete = align.complete;
+
+    if (!chunk.ok || !align.complete)
+    {
+        for (element = lines.first; element; element = next)
+        {
+            next = element->next;
+            releaseScriptElement(&aWrappedScript->releasedLines, element);
+        }
+        return chunk.ok;
+    }
+
+    /* Old lines until end of paragraph are replaced if new ones did not line up */
+    if (!align.lined)
+    {
+        align.line = aRewrap->next;
+    }
+    for (element = first; element != align.line; element = element->next)
+    {
+        if (element == aRewrap->kept)
+        {
+            kept = TRUE;
+        }
+        if (element == list->actual)
+        {
+            column = getScriptElementColumn(element) + (kept ? (size_t)aRewrap->keptShift : 0);
+        }
+        count++;
+    }
+    if (aWrappedScript->lineTable)
+    {
+        /* Old lines are still in the table */
+        index = getScriptLineIndex(aWrappedScript, first);
+    }
+
+    /* Replace lines */
+    lines.first->prev = first->prev;
+    if (first->prev)
+    {
+        first->prev->next = lines.first;
+    }
+    else
+    {
+        list->first = lines.first;
+    }
+    lines.last->next = align.line;
+    if (align.line)
+    {
+        align.line->prev = lines.last;
+    }
+    else
+    {
+        list->last = lines.last;
+        list->it_prev = lines.last;
+        list->it = &lines.last->next;
+    }
+    offset_limit = align.line ? getScriptElementOffset(align.line) : SIZE_MAX;
+    for (element = lines.first; element != align.line; element = element->next)
+    {
+        setScriptElementOffset(element, MIN(getScriptElementOffset(element), offset_limit));
+    }
+
+    if (column != LINE_COLUMN_NONE)
+    {
+        /* Show the same part of paragraph */
+        for (element = lines.first; element->next != align.line
+             && getScriptElementColumn(element->next) <= column; element = element->next)
+        {
+        }
+        list->actual = element;
+    }
+    if (aWrappedScript->lineTable && aWrappedScript->lineTable[index] == first)
+    {
+        replaceTableLines(aWrappedScript, index, count, &lines, chunk.lineCount);
+    }
+    else
+    {
+        free(aWrappedScript->lineTable);
+        aWrappedScript->lineTable = NULL;
+        aWrappedScript->lineCount = 0;
+    }
+    for (element = first; element != align.line; element = next)
+    {
+        next = element->next;
+        releaseScriptElement(&aWrappedScript->releasedLines, element);
+    }
+
+    /* Columns of kept lines are corrected once by stopRewrap() */
+    if (!align.lined)
+    {
+        aRewrap->kept = NULL;
+        aRewrap->keptShift = 0;
+    }
+    else
+    {
+        if (!align.kept && aRewrap->kept)
+        {
+            /* Lines until the previous kept line have real columns, they are kept as well */
+            for (element = align.line; element != aRewrap->kept; element = element->next)
+            {
+                setScriptElementColumn(element, getScriptElementColumn(element) - (size_t)aRewrap->keptShift);
+            }
+        }
+        aRewrap->kept = align.line;
+        aRewrap->keptShift += aShift;
+    }
+    aRewrap->first = lines.first;
+    aWrappedScript->revision++;
+
+    return TRUE;
+}
+
+/**
+ * @brief stopRewrap Finish wrapping of an edited paragraph: columns of kept
+ * lines are corrected.
+ *
+ * @param aRewrap[in,out]   State of paragraph.
+ */
+void stopRewrap(rewrapState_t * aRewrap)
+{
+    linkedListElement_t * element;
+
+    for (element = aRewrap->kept; element && element != aRewrap->next; element = element->next)
+    {
+        setScriptElementColumn(element, getScriptElementColumn(element) + (size_t)aRewrap->keptShift);
+    }
+    memset(aRewrap, 0, sizeof(rewrapState_t));
+}
+
+/**
+ * @brief hashWrappedScript Calculate hash of all lines to compare layouts.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @return FNV-1a hash of lines.
+ */
+static uint64_t hashWrappedScript(wrappedScript_t * aWrappedScript)
+{
+    uint64_t              hash = 14695981039346656037ull;
+    linkedListElement_t * element;
+    const char          * text;
+
+    for (element = aWrappedScript->wrappedScriptList.first; element; element = element->next)
+    {
+        for (text = element->item; ; text++)
+        {
+            /* End of string is hashed too, it separates lines */
+            hash = (hash ^ (uint8_t)*text) * 1099511628211ull;
+            if (*text == CHR_EOS)
+            {
+                break;
+            }
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * @brief benchWrapScript Wrap script with 1 .. WRAP_MAX_THREADS threads and
+ * print time of wrapping and if layout is the same as with one thread.
+ *
+ * @param aScriptBuffer[in]     Input text to wrap.
+ * @param aMaxWidthPx[in]       Maximum width of text in pixels.
+ * @param aMaxHeightPx[in]      Maximum height of text in pixels.
+ * @param aWrappedScript[out]   Wrapped text.
+ * @return TRUE: if layout was the same with every count of threads.
+ */
+bool_t benchWrapScript(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript)
+{
+    bool_t   ok = TRUE;
+    bool_t   verbose = config.verbose;
+    uint8_t  threads;
+    uint64_t start_us;
+    uint64_t us;
+    uint64_t us_single = 0;
+    uint64_t hash;
+    uint64_t hash_single = 0;
+
+    printf("WRAP BENCHMARK\n");
+    printf("--------------\n");
+    printf("Script size: %lu KiB\n", (unsigned long)(strlen(aScriptBuffer) / 1024));
+    /* Layout report of every run would hide the results */
+    config.verbose = FALSE;
+    for (threads = 1; threads <= WRAP_MAX_THREADS && ok; threads++)
+    {
+        start_us = getTimeUs();
+        ok = wrapScriptThreads(aScriptBuffer, aMaxWidthPx, aMaxHeightPx, aWrappedScript, NULL, threads);
+        us = getTimeUs() - start_us;
+        hash = hashWrappedScript(aWrappedScript);
+        if (threads == 1)
+        {
+            us_single = us;
+            hash_single = hash;
+        }
+        printf("Threads: %u, time: %7.1f ms, speedup: %4.2f, lines: %llu, layout: %s\n",
+               threads, us / 1000.0, us ? (double)us_single / us : 0.0,
+               (unsigned long long)aWrappedScript->arena.allocCount,
+               hash == hash_single ? "identical" : "DIFFERENT");
+        ok = ok && hash == hash_single;
+    }
+    config.verbose = verbose;
+
+    return ok;
+}
+
+/* Line of reference layout in self test */
+typedef struct
+{
+    size_t          offset;
+    size_t          length;
+    size_t          column;
+} wrapTestLine_t;
+
+/* Reference layout of self test */
+typedef struct
+{
+    wrapTestLine_t* lines;
+    size_t          count;
+    size_t          size;                   /* Count of allocated lines */
+} wrapTestLayout_t;
+
+/**
+ * @brief stubCharWidth Width of a byte for the stub measurer of self test.
+ * Every character is at least one pixel wide, like with real fonts.
+ *
+ * @param aChar[in]     Byte of text.
+ * @return Width in pixels.
+ */
+static int stubCharWidth(char aChar)
+{
+    int width;
+
+    if (IS_WHITESPACE(aChar))
+    {
+        width = 4;
+    }
+    else if (IS_UTF8_CONTINUATION(aChar))
+    {
+        width = 0;
+    }
+    else if ((uint8_t)aChar >= 0xC0)
+    {
+        width = 9;
+    }
+    else
+    {
+        width = 3 + ((uint8_t)aChar * 7) % 9;
+    }
+
+    return width;
+}
+
+/**
+ * @brief stubTextWidth Measure text with the stub measurer of self test.
+ *
+ * @param aText[in]     Text, terminated by zero.
+ * @return Width in pixels.
+ */
+static int stubTextWidth(const char * aText)
+{
+    int width = 0;
+
+    for (; *aText != CHR_EOS; aText++)
+    {
+        width += stubCharWidth(*aText);
+    }
+
+    return width;
+}
+
+/**
+ * @brief refFitsWidth Check if text fits with the stub measurer. Unlike
+ * fitsWidth() every character is measured.
+ */
+static bool_t refFitsWidth(const char * aStart, const char * aEnd, uint16_t aMaxWidthPx)
+{
+    int width = 0;
+
+    for (; aStart < aEnd; aStart++)
+    {
+        width += stubCharWidth(*aStart);
+    }
+
+    return width < aMaxWidthPx;
+}
+
+/**
+ * @brief refAddLine Add a line to reference layout.
+ */
+static void refAddLine(wrapTestLayout_t * aLayout, const char * aScript, const char * aStart, const char * aEnd,
+                       size_t aColumn)
+{
+    if (aLayout->count < aLayout->size)
+    {
+        aLayout->lines[aLayout->count].offset = (size_t)(aStart - aScript);
+        aLayout->lines[aLayout->count].length = (size_t)(aEnd - aStart);
+        aLayout->lines[aLayout->count].column = aColumn;
+    }
+    aLayout->count++;
+}
+
+/**
+ * @brief refNextChar Get start of next UTF-8 character.
+ */
+static char * refNextChar(char * aPtr, char * aEnd)
+{
+    aPtr++;
+    while (aPtr < aEnd && IS_UTF8_CONTINUATION(*aPtr))
+    {
+        aPtr++;
+    }
+
+    return aPtr;
+}
+
+/**
+ * @brief refWrapParagraph Reference of wrapParagraph(). A line is extended
+ * word by word and a long word is broken at the last fitting character, so
+ * every break is found by measuring each candidate.
+ */
+static void refWrapParagraph(wrapTestLayout_t * aLayout, char * aScript, char * aStart, char * aEnd,
+                             uint16_t aMaxWidthPx)
+{
+    char * line_start = aStart;
+    char * word_start;
+    char * word_end;
+    char * break_ptr;
+    char * next;
+    char * ptr = aStart;
+
+    while (ptr < aEnd)
+    {
+        word_start = ptr;
+        while (ptr < aEnd && !IS_WHITESPACE(*ptr))
+        {
+            ptr++;
+        }
+        word_end = ptr;
+        while (ptr < aEnd && IS_WHITESPACE(*ptr))
+        {
+            ptr++;
+        }
+        if (refFitsWidth(line_start, ptr, aMaxWidthPx))
+        {
+            continue;
+        }
+        if (word_start > line_start)
+        {
+            refAddLine(aLayout, aScript, line_start, word_start, (size_t)(line_start - aStart));
+            line_start = word_start;
+        }
+        while (line_start < word_end && !refFitsWidth(line_start, word_end, aMaxWidthPx))
+        {
+            /* At least one character is put to a line */
+            break_ptr = refNextChar(line_start, word_end);
+            for (next = refNextChar(break_ptr, word_end);
+                 break_ptr < word_end && next < word_end && refFitsWidth(line_start, next, aMaxWidthPx);
+                 next = refNextChar(next, word_end))
+            {
+                break_ptr = next;
+            }
+            refAddLine(aLayout, aScript, line_start, break_ptr, (size_t)(line_start - aStart));
+            line_start = break_ptr;
+        }
+    }
+    refAddLine(aLayout, aScript, line_start, aEnd, (size_t)(line_start - aStart));
+}
+
+/**
+ * @brief refWrapScript Reference layout of a script, see wrapChunk().
+ */
+static void refWrapScript(wrapTestLayout_t * aLayout, char * aScript, char * aScriptEnd, uint16_t aMaxWidthPx)
+{
+    char * ptr = skipWhitespace(aScript, aScriptEnd);
+    char * paragraph_end;
+
+    aLayout->count = 0;
+    while (ptr < aScriptEnd)
+    {
+        paragraph_end = findParagraphEnd(ptr, aScriptEnd);
+        refWrapParagraph(aLayout, aScript, ptr, paragraph_end, aMaxWidthPx);
+        ptr = skipWhitespace(paragraph_end, aScriptEnd);
+        if (ptr < aScriptEnd)
+        {
+            refAddLine(aLayout, aScript, paragraph_end, paragraph_end, LINE_COLUMN_NONE);
+        }
+    }
+}
+
+/**
+ * @brief generateTestScript Generate a random script for self test. It
+ * contains words, multibyte characters, long tokens, tabs, line feeds and
+ * paragraphs separated by empty lines with white spaces.
+ *
+ * @param aBuffer[out]  Script is generated here.
+ * @param aSize[in]     Size of script, buffer shall be one byte longer.
+ * @param aSeed[in,out] State of random generator.
+ */
+static void generateTestScript(char * aBuffer, size_t aSize, uint32_t * aSeed)
+{
+    static const char * separators[] = { " ", " ", " ", " ", "  ", "\t", "\n", " \n", "\n\n", "\n \t\n", "\r\n\r\n" };
+    const char        * text;
+    uint32_t            len;
+    size_t              i = 0;
+
+    while (i < aSize)
+    {
+        *aSeed = *aSeed * 1103515245u + 12345u;
+        len = (*aSeed >> 16) % 12 + 1;
+        if ((*aSeed >> 8) % 30 == 0)
+        {
+            /* Token which is wider than a line */
+            len = (*aSeed >> 4) % 500 + 50;
+        }
+        for (; len && i < aSize; len--)
+        {
+            *aSeed = *aSeed * 1103515245u + 12345u;
+            switch ((*aSeed >> 16) % 16)
+            {
+                case 0:
+                    text = "\xC3\xA9";     /* e with acute */
+                    break;
+                case 1:
+                    text = "\xE2\x82\xAC"; /* Euro sign */
+                    break;
+                default:
+                    text = NULL;
+                    aBuffer[i++] = 'a' + (*aSeed >> 20) % 26;
+                    break;
+            }
+            for (; text && *text && i < aSize; text++)
+            {
+                aBuffer[i++] = *text;
+            }
+        }
+        *aSeed = *aSeed * 1103515245u + 12345u;
+        for (text = separators[(*aSeed >> 16) % (sizeof(separators) / sizeof(separators[0]))]; *text && i < aSize; text++)
+        {
+            aBuffer[i++] = *text;
+        }
+    }
+    /* Multibyte characters are not cut at end of script */
+    while (i > 0 && IS_UTF8_CONTINUATION(aBuffer[i - 1]))
+    {
+        i--;
+    }
+    if (i > 0 && (uint8_t)aBuffer[i - 1] >= 0xC0)
+    {
+        i--;
+    }
+    aBuffer[i] = CHR_EOS;
+}
+
+/**
+ * @brief compareTestLayout Compare lines of chunks with reference layout.
+ *
+ * @return TRUE: if offset, length and column of every line are the same.
+ */
+static bool_t compareTestLayout(const wrapTestLayout_t * aLayout, wrapChunk_t * aChunks, uint8_t aChunkCount)
+{
+    linkedListElement_t * element;
+    size_t                i = 0;
+    uint8_t               c;
+
+    for (c = 0; c < aChunkCount; c++)
+    {
+        for (element = aChunks[c].ownList.first; element; element = element->next, i++)
+        {
+            if (i >= aLayout->count || aLayout->lines[i].offset != getScriptElementOffset(element)
+                || aLayout->lines[i].length != strlen(element->item)
+                || aLayout->lines[i].column != getScriptElementColumn(element))
+            {
+                printf("Line %lu differs\n", (unsigned long)i);
+                return FALSE;
+            }
+        }
+    }
+    if (i != aLayout->count)
+    {
+        printf("%lu lines instead of %lu\n", (unsigned long)i, (unsigned long)aLayout->count);
+    }
+
+    return i == aLayout->count;
+}
+
+/**
+ * @brief selfTestWrapScript Wrap random scripts with a stub measurer and
+ * compare the layout with a reference wrapper which measures every
+ * candidate break. Every script is split into 1 .. WRAP_MAX_THREADS chunks,
+ * like for wrapping by threads, and the layout shall be the same.
+ *
+ * @return TRUE: if every layout was the same as the reference.
+ */
+bool_t selfTestWrapScript(void)
+{
+    bool_t           ok = TRUE;
+    uint32_t         seed = 1;
+    uint32_t         script;
+    uint16_t         maxWidthPx;
+    uint8_t          chunkCount;
+    uint8_t          count;
+    uint8_t          i;
+    char           * buffer;
+    char           * scriptEnd;
+    char           * chunkStart;
+    char           * chunkEnd;
+    wrapChunk_t      chunks[WRAP_MAX_THREADS];
+    wrapProgress_t   progress;
+    wrapTestLayout_t layout;
+
+    printf("WRAP SELF TEST\n");
+    printf("--------------\n");
+    buffer = malloc(WRAP_SELFTEST_MAX_BYTES + 1);
+    layout.size = WRAP_SELFTEST_MAX_BYTES + 1;
+    layout.lines = malloc(layout.size * sizeof(wrapTestLine_t));
+    if (buffer == NULL || layout.lines == NULL)
+    {
+        errorprintf("Cannot allocate memory for self test!\n");
+        ok = FALSE;
+    }
+    for (script = 0; script < WRAP_SELFTEST_SCRIPTS && ok; script++)
+    {
+        generateTestScript(buffer, seed % WRAP_SELFTEST_MAX_BYTES + 1, &seed);
+        scriptEnd = buffer + strlen(buffer);
+        maxWidthPx = (seed >> 8) % 400 + 10;
+        refWrapScript(&layout, buffer, scriptEnd, maxWidthPx);
+        /* Every line has at least one character or it separates paragraphs */
+        ok = layout.count <= layout.size;
+        for (count = 1; count <= WRAP_MAX_THREADS && ok; count++)
+        {
+            memset(chunks, 0, sizeof(chunks));
+            memset(&progress, 0, sizeof(progress));
+            chunkCount = 0;
+            chunkStart = skipWhitespace(buffer, scriptEnd);
+            for (i = 1; i <= count; i++)
+            {
+                chunkEnd = findChunkEnd(buffer, chunkStart, scriptEnd, i, count);
+                if (chunkEnd > chunkStart || chunkCount == 0)
+                {
+                    wrapChunk_t * chunk = &chunks[chunkCount++];
+                    chunk->measureWidth = stubTextWidth;
+                    chunk->maxWidthPx = maxWidthPx;
+                    chunk->scriptStart = buffer;
+                    chunk->offsetLimit = SIZE_MAX;
+                    chunk->start = chunkStart;
+                    chunk->end = chunkEnd;
+                    chunk->scriptEnd = scriptEnd;
+                    resetLinkedList(&chunk->ownList);
+                    chunk->list = &chunk->ownList;
+                    chunk->arena = &chunk->ownArena;
+                    chunk->progress = &progress;
+                    chunk->ok = TRUE;
+                    wrapChunk(chunk);
+                    ok = ok && chunk->ok;
+                    chunkStart = chunkEnd;
+                }
+            }
+            if (ok && !compareTestLayout(&layout, chunks, chunkCount))
+            {
+                printf("Script %u (%lu bytes, width: %u px) with %u chunks differs from reference\n",
+                       script, (unsigned long)(scriptEnd - buffer), maxWidthPx, chunkCount);
+                ok = FALSE;
+            }
+            for (i = 0; i < chunkCount; i++)
+            {
+                arenaFree(&chunks[i].ownArena);
+            }
+        }
+    }
+    if (ok)
+    {
+        printf("%u random scripts, 1..%u chunks: identical to reference\n", WRAP_SELFTEST_SCRIPTS, WRAP_MAX_THREADS);
+    }
+    free(layout.lines);
+    free(buffer);
+
+    return ok;
+}
+
+/**
+ * @brief generateBenchScript Generate script for layout benchmark. It
+ * contains words of 1..12 letters, some multibyte characters, paragraphs
+ * and sometimes a long token without white spaces.
+ *
+ * @param aBuffer[out]  Script is generated here.
+ * @param aSize[in]     Size of script, buffer shall be one byte longer.
+ */
+static void generateBenchScript(char * aBuffer, size_t aSize)
+{
+    uint32_t seed = 1;  /* Same script is generated for every size */
+    uint32_t word = 0;
+    size_t   len;
+    size_t   i = 0;
+
+    while (i + 2 < aSize)
+    {
+        seed = seed * 1103515245u + 12345u;
+        len = (seed >> 16) % 12 + 1;
+        if ((seed >> 8) % 5000 == 0)
+        {
+            len = LAYOUT_BENCH_TOKEN_LEN;
+        }
+        for (; len && i + 2 < aSize; len--)
+        {
+            if (len % 64 == 7)
+            {
+                /* Two bytes long character: e with acute */
+                aBuffer[i++] = (char)0xC3;
+                aBuffer[i++] = (char)0xA9;
+            }
+            else
+            {
+                aBuffer[i++] = 'a' + (seed + len) % 26;
+            }
+        }
+        word++;
+        aBuffer[i++] = word % 60 ? CHR_SPACE : CHR_LF;
+        if (word % 60 == 0 && i < aSize)
+        {
+            aBuffer[i++] = CHR_LF;
+        }
+    }
+    for (; i < aSize; i++)
+    {
+        aBuffer[i] = CHR_SPACE;
+    }
+    aBuffer[aSize] = CHR_EOS;
+}
+
+/**
+ * @brief benchLayoutScaling Wrap generated scripts of doubling size and
+ * print time and memory of layout per byte of script. Both shall be about
+ * the same for every size.
+ *
+ * @param aMaxBytes[in]         Size of biggest script.
+ * @param aMaxWidthPx[in]       Maximum width of text in pixels.
+ * @param aMaxHeightPx[in]      Maximum height of text in pixels.
+ * @param aWrappedScript[out]   Wrapped text, font shall be loaded.
+ * @return TRUE: if every script was wrapped.
+ */
+bool_t benchLayoutScaling(size_t aMaxBytes, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript)
+{
+    bool_t   ok = TRUE;
+    bool_t   verbose = config.verbose;
+    size_t   size;
+    char   * buffer;
+    uint64_t start_us;
+    uint64_t us;
+    double   ns_per_byte;
+    double   first_ns_per_byte = 0.0;
+    double   last_ns_per_byte = 0.0;
+
+    printf("LAYOUT BENCHMARK\n");
+    printf("----------------\n");
+    config.verbose = FALSE;
+    for (size = LAYOUT_BENCH_MIN_BYTES; size <= MAX(aMaxBytes, LAYOUT_BENCH_MIN_BYTES) && ok; size *= 2)
+    {
+        buffer = malloc(size + 1);
+        if (buffer == NULL)
+        {
+            errorprintf("Cannot allocate %lu MiB for benchmark script!\n", (unsigned long)(size >> 20));
+            ok = FALSE;
+            break;
+        }
+        generateBenchScript(buffer, size);
+        start_us = getTimeUs();
+        ok = wrapScript(buffer, aMaxWidthPx, aMaxHeightPx, aWrappedScript, NULL);
+        us = getTimeUs() - start_us;
+        ns_per_byte = us * 1000.0 / size;
+        if (size == LAYOUT_BENCH_MIN_BYTES)
+        {
+            first_ns_per_byte = ns_per_byte;
+        }
+        last_ns_per_byte = ns_per_byte;
+        printf("Size: %5lu MiB, lines: %10llu, time: %9.1f ms, %6.1f ns/byte, layout memory: %4.2f bytes/byte\n",
+               (unsigned long)(size >> 20), (unsigned long long)aWrappedScript->lineCount, us / 1000.0, ns_per_byte,
+               (double)aWrappedScript->arena.bytesReserved / size);
+        /* Memory of each size is measured separately */
+        freeWrappedScriptLines(aWrappedScript);
+        free(buffer);
+    }
+    config.verbose = verbose;
+    if (first_ns_per_byte > 0.0)
+    {
+        printf("Time per byte of biggest script: %.2fx of smallest one\n", last_ns_per_byte / first_ns_per_byte);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief resetWrappedScript Release all lines of wrapped script at once.
+ * Memory of arena is kept for next wrap.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script.
+ */
+void resetWrappedScript(wrappedScript_t * aWrappedScript)
+{
+    resetLinkedList(&aWrappedScript->wrappedScriptList);
+    free(aWrappedScript->lineTable);
+    aWrappedScript->lineTable = NULL;
+    aWrappedScript->lineCount = 0;
+    aWrappedScript->revision = 0;
+    aWrappedScript->releasedLines = NULL;
+    arenaReset(&aWrappedScript->arena);
+}
+
+/**
+ * @brief freeWrappedScriptLines Release lines and memory of wrapped script,
+ * font is kept.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script.
+ */
+void freeWrappedScriptLines(wrappedScript_t * aWrappedScript)
+{
+    resetLinkedList(&aWrappedScript->wrappedScriptList);
+    free(aWrappedScript->lineTable);
+    aWrappedScript->lineTable = NULL;
+    aWrappedScript->lineCount = 0;
+    aWrappedScript->revision = 0;
+    aWrappedScript->releasedLines = NULL;
+    arenaFree(&aWrappedScript->arena);
+}
+
+/**
+ * @brief freeWrappedScript Release lines, memory and font of wrapped script.
+ *
+ * @param aWrappedScript[in,out]    Wrapped script.
+ */
+void freeWrappedScript(wrappedScript_t * aWrappedScript)
+{
+    freeWrappedScriptLines(aWrappedScript);
+    if (aWrappedScript->ttf_font)
+    {
+        releaseFont(aWrappedScript->ttf_font);
+        aWrappedScript->ttf_font = NULL;
+        aWrappedScript->atlas = NULL;
+    }
+}
+
+/**
+ * @brief printScript Debug function which prints all text from wrapped script.
+ * @param aWrappedScriptList
+ */
+void printScript(linkedList_t * aWrappedScriptList)
+{
+    linkedListElement_t* linkedListElement = aWrappedScriptList->actual;
+
+    printf("%s start\n", __FUNCTION__);
+    while (linkedListElement)
+    {
+        printf("[%s]\n", (char*)linkedListElement->item);
+        linkedListElement = linkedListElement->next;
+    }
+    printf("%s end\n", __FUNCTION__);
+}
+
+/**
+ * @brief scrollScriptUpPx Scroll text up by one pixel.
+ *
+ * @param aWrappedScript[in] Script to be scrolled.
+ */
+void scrollScriptUpPx(wrappedScript_t * aWrappedScript)
+{
+    aWrappedScript->heightOffsetPx++;
+    if (aWrappedScript->heightOffsetPx >= aWrappedScript->wrappedScriptHeightPx
+            && aWrappedScript->wrappedScriptList.actual)
+    {
+        if (aWrappedScript->wrappedScriptList.actual->next)
+        {
+            /* Advance to next line */
+            aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->next;
+            aWrappedScript->heightOffsetPx = 0;
+            aWrappedScript->isEnd = FALSE;
+        }
+        else
+        {
+            aWrappedScript->isEnd = TRUE;
+        }
+    }
+}
+
+/**
+ * @brief scrollScriptUp Scroll text up by specified count of lines.
+ *
+ * @param aWrappedScript[in]    Script to be scrolled.
+ * @param lineCount[in]         Line count to scroll.
+ */
+void scrollScriptUp(wrappedScript_t * aWrappedScript, int lineCount)
+{
+    while (lineCount > 0)
+    {
+        if (aWrappedScript->wrappedScriptList.actual)
+        {
+            if (aWrappedScript->wrappedScriptList.actual->next)
+            {
+                aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->next;
+                aWrappedScript->isEnd = FALSE;
+            }
+            else
+            {
+                aWrappedScript->isEnd = TRUE;
+            }
+        }
+        lineCount--;
+    }
+}
+
+/**
+ * @brief scrollScriptDown Scroll text down by specified count of lines.
+ *
+ * @param aWrappedScript[in]    Script to be scrolled.
+ * @param lineCount[in]         Line count to scroll.
+ */
+void scrollScriptDown(wrappedScript_t * aWrappedScript, int lineCount)
+{
+    while (lineCount > 0)
+    {
+        if (aWrappedScript->wrappedScriptList.actual
+                && aWrappedScript->wrappedScriptList.actual->prev)
+        {
+            aWrappedScript->wrappedScriptList.actual = aWrappedScript->wrappedScriptList.actual->prev;
+        }
+        lineCount--;
+    }
+}
+
+/**
+ * @brief findLineIndex Find index of line which contains the specified
+ * character of script buffer. Line table is built again if lines were
+ * replaced by editing.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @param aOffset[in]           Offset of character in script buffer.
+ * @return Index of line in line table, it is valid if lineCount is not 0.
+ */
+static size_t findLineIndex(wrappedScript_t * aWrappedScript, size_t aOffset)
+{
+    size_t low = 0;
+    size_t high;
+    size_t middle;
+
+    if (aWrappedScript->lineTable == NULL && aWrappedScript->wrappedScriptList.first)
+    {
+        /* Table could not be updated by editing */
+        buildLineTable(aWrappedScript);
+    }
+    high = aWrappedScript->lineCount;
+
+    /* Last line which starts at or before offset. Lines of countdown start at 0,
+     * so first line of script is found for offset 0 */
+    while (high - low > 1)
+    {
+        middle = low + (high - low) / 2;
+        if (getScriptElementOffset(aWrappedScript->lineTable[middle]) <= aOffset)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * @brief findScriptLine Find line which contains the specified character of
+ * script buffer.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @param aOffset[in]           Offset of character in script buffer.
+ * @return Line of character. NULL: script is not wrapped.
+ */
+linkedListElement_t * findScriptLine(wrappedScript_t * aWrappedScript, size_t aOffset)
+{
+    size_t index = findLineIndex(aWrappedScript, aOffset);
+
+    return aWrappedScript->lineCount ? aWrappedScript->lineTable[index] : NULL;
+}
+
+/**
+ * @brief getScriptLineIndex Find position of a line in order of lines.
+ *
+ * @param aWrappedScript[in]    Wrapped script.
+ * @param aLine[in]             Line of script.
+ * @return Index of line in line table. 0: script is not wrapped.
+ */
+size_t getScriptLineIndex(wrappedScript_t * aWrappedScript, linkedListElement_t * aLine)
+{
+    size_t offset = getScriptElementOffset(aLine);
+    size_t index = findLineIndex(aWrappedScript, offset);
+
+    /* Lines of countdown and separators share offset with their neighbours */
+    while (index > 0 && aWrappedScript->lineTable[index] != aLine
+           && getScriptElementOffset(aWrappedScript->lineTable[index - 1]) == offset)
+    {
+        index--;
+    }
+
+    return index;
+}
+
+/**
+ * @brief jumpToScriptLine Show the specified line at top of text.
+ *
+ * @param aWrappedScript[in,out]    Script to be scrolled.
+ * @param aLine[in]                 Line of script. Nothing happens if it is NULL.
+ */
+void jumpToScriptLine(wrappedScript_t * aWrappedScript, linkedListElement_t * aLine)
+{
+    if (aLine)
+    {
+        aWrappedScript->wrappedScriptList.actual = aLine;
+        aWrappedScript->heightOffsetPx = 0;
+        aWrappedScript->isEnd = FALSE;
+    }
+}
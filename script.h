@@ -15,22 +15,92 @@
 
 #include <SDL/SDL.h>
 #include <SDL/SDL_ttf.h>
+#include <SDL/SDL_mutex.h>
 
 #include "common.h"
 #include "linkedlist.h"
+#include "arena.h"
+#include "atlas.h"
+
+#define WRAP_MAX_THREADS            8       /* Maximum count of threads wrapping a script */
 
 typedef struct
 {
     TTF_Font      * ttf_font;
+    const atlasFont_t * atlas;              /* Glyphs of ttf_font rasterized at build time, NULL: none */
     linkedList_t    wrappedScriptList;      /* Linked list of wrapped lines */
+    arena_t         arena;                  /* Memory of lines, released at once by next wrap */
+    linkedListElement_t ** lineTable;       /* Lines in order, NULL: it shall be built again */
+    linkedListElement_t * releasedLines;    /* Lines replaced by rewrapParagraph(), their memory is reused */
+    size_t          lineCount;              /* Count of lines in lineTable */
     uint16_t        wrappedScriptHeightPx;  /* Height of one line */
     uint16_t        heightOffsetPx;         /* Offset inside on line. Range: 0 .. wrappedScriptHeightPx - 1 */
     uint16_t        linePerScreen;          /* Count of lines on screen */
     bool_t          isEnd;                  /* TRUE: End of script reached */
     uint16_t        maxWidthPx;
     uint16_t        maxHeightPx;
+    uint32_t        generation;             /* Incremented by every wrap, identifies layout */
+    uint32_t        revision;               /* Incremented when lines of a paragraph are replaced */
+    uint32_t        layoutUs;               /* Time of last wrap */
     config_t      * config;                 /* Actual configuration */
 } wrappedScript_t;
 
+/* Paragraph which is wrapped again after every change while it is edited */
+typedef struct
+{
+    linkedListElement_t * first;            /* Wrapping starts at this line, text before it is not changed */
+    linkedListElement_t * next;             /* Line after the paragraph, NULL: paragraph is the last one */
+    linkedListElement_t * kept;             /* First line which was not wrapped again, NULL: none */
+    ptrdiff_t       keptShift;              /* Columns from kept line to end of paragraph are smaller by this */
+} rewrapState_t;
+
+/* Progress of loading, a copy can be taken any time by getLoadProgress() */
+typedef struct
+{
+    char            message[128];           /* Last status or error message */
+    size_t          bytesTotal;             /* Size of script */
+    size_t          bytesRead;              /* Bytes read from script file */
+    size_t          bytesWrapped;           /* Bytes of script already wrapped */
+    uint64_t        linesWrapped;           /* Count of wrapped lines */
+} loadProgress_t;
+
+/* Status of loading, it is shared between loader thread and main thread */
+typedef struct
+{
+    SDL_mutex     * mutex;                  /* Protects progress and cancel */
+    loadProgress_t  progress;
+    bool_t          cancel;                 /* TRUE: loading shall be stopped as soon as possible */
+} loadStatus_t;
+
+bool_t initLoadStatus(loadStatus_t * aStatus);
+void doneLoadStatus(loadStatus_t * aStatus);
+void setLoadStatus(loadStatus_t * aStatus, const char * aFmt, ...);
+void setLoadProgressRead(loadStatus_t * aStatus, size_t aBytesRead, size_t aBytesTotal);
+void setLoadProgressWrap(loadStatus_t * aStatus, size_t aBytesWrapped, uint64_t aLinesWrapped);
+void getLoadProgress(loadStatus_t * aStatus, loadProgress_t * aProgress);
+void cancelLoad(loadStatus_t * aStatus);
+bool_t isLoadCancelled(loadStatus_t * aStatus);
+
+bool_t loadFont(const char * aFontFilePath, int aFontSize, wrappedScript_t *aWrappedScript);
+bool_t loadScript(const char * aScriptFilePath, char ** aScriptBuffer, loadStatus_t * aStatus);
+bool_t wrapScript(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript, loadStatus_t * aStatus);
+void startRewrap(rewrapState_t * aRewrap, linkedListElement_t * aLine, linkedListElement_t * aNext);
+bool_t rewrapParagraph(wrappedScript_t * aWrappedScript, rewrapState_t * aRewrap, char * aText, size_t aLength,
+                       bool_t aParagraphEnd, size_t aChangeEnd, ptrdiff_t aShift, bool_t * aComplete);
+void stopRewrap(rewrapState_t * aRewrap);
+bool_t benchWrapScript(char * aScriptBuffer, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript);
+bool_t selfTestWrapScript(void);
+bool_t benchLayoutScaling(size_t aMaxBytes, uint16_t aMaxWidthPx, uint16_t aMaxHeightPx, wrappedScript_t * aWrappedScript);
+void resetWrappedScript(wrappedScript_t * aWrappedScript);
+void freeWrappedScriptLines(wrappedScript_t * aWrappedScript);
+void freeWrappedScript(wrappedScript_t * aWrappedScript);
+void printScript(linkedList_t * aWrappedScriptList);
+void scrollScriptUpPx(wrappedScript_t * aWrappedScript);
+void scrollScriptUp(wrappedScript_t * aWrappedScript, int lineCount);
+void scrollScriptDown(wrappedScript_t * aWrappedScript, int lineCount);
+linkedListElement_t * findScriptLine(wrappedScript_t * aWrappedScript, size_t aOffset);
+size_t getScriptLineIndex(wrappedScript_t * aWrappedScript, linkedListElement_t * aLine);
+void jumpToScriptLine(wrappedScript_t * aWrappedScript, linkedListElement_t * aLine);
+
 #endif /* INCLUDE_SCRIPT_H */
 
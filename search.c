@@ -0,0 +1,749 @@
+/**
+ * @file        search.c
+ * @brief       Full-text search in script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-27 09:12:45
+ * Last modify: 2021-02-27 09:12:45 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * Index is a suffix array of word starts: offset of every word is stored,
+ * sorted by the text which follows the word. Every phrase which starts at a
+ * word is a prefix of such a suffix, so hits of a phrase are next to each
+ * other in the index and they are found by two binary searches. Comparison
+ * ignores case of ASCII letters and treats every white space as space.
+ * Suffixes are sorted by their first SEARCH_KEY_LEN characters only, longer
+ * queries are checked hit by hit.
+ *
+ * Hits are ordered by text in the index, not by position. Nearest hit to a
+ * position is found by checking all hits if there are few of them. If there
+ * are many hits, words are checked in order of script from the position,
+ * using the rank of each word in the index, so a hit is found soon. If hits
+ * are far from the position, the walk stops after as many words as there
+ * are hits and all hits are checked instead.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "common.h"
+#include "linkedlist.h"
+#include "script.h"
+#include "search.h"
+#include "stats.h"
+
+#define SEARCH_INSERTION_SORT_COUNT 16      /* Smaller ranges of suffixes are sorted by insertion sort */
+#define SEARCH_SORT_KEY_CHARS       4       /* Characters compared at once by sorting, SEARCH_KEY_LEN is multiple of it */
+
+/* Item of sorting: offset of suffix in upper half, index of word in lower half */
+#define SORT_ITEM(offset, word)     (((uint64_t)(offset) << 32) | (word))
+#define SORT_ITEM_OFFSET(item)      ((uint32_t)((item) >> 32))
+#define SORT_ITEM_WORD(item)        ((uint32_t)(item))
+
+searchPrompt_t searchPrompt;
+
+/**
+ * @brief foldChar Convert character to the form used for comparison.
+ *
+ * @param aChr[in]  Character of script or query.
+ * @return Lower case of ASCII letters, space for white spaces, others unchanged.
+ */
+static inline uint8_t foldChar(uint8_t aChr)
+{
+    if (aChr >= 'A' && aChr <= 'Z')
+    {
+        return aChr + ('a' - 'A');
+    }
+    if (IS_WHITESPACE(aChr))
+    {
+        return CHR_SPACE;
+    }
+
+    return aChr;
+}
+
+/**
+ * @brief isWordChar Check if character can be part of a word. Bytes of UTF-8
+ * sequences are part of words, so words never start inside a character.
+ *
+ * @param aChr[in]  Character.
+ * @return TRUE: if character is a letter, digit or part of UTF-8 sequence.
+ */
+static inline bool_t isWordChar(uint8_t aChr)
+{
+    return (aChr >= '0' && aChr <= '9') || (aChr >= 'a' && aChr <= 'z')
+            || (aChr >= 'A' && aChr <= 'Z') || aChr >= 0x80;
+}
+
+/**
+ * @brief compareSuffixes Compare suffixes from the specified depth.
+ *
+ * @param aText[in]     Indexed text.
+ * @param aFirst[in]    Offset of first suffix.
+ * @param aSecond[in]   Offset of second suffix.
+ * @param aDepth[in]    Characters before this depth are already equal.
+ * @return <0: first is smaller, 0: equal in SEARCH_KEY_LEN characters, >0: first is bigger.
+ */
+static int compareSuffixes(const uint8_t * aText, uint32_t aFirst, uint32_t aSecond, uint16_t aDepth)
+{
+    uint8_t first;
+    uint8_t second;
+
+    for (; aDepth < SEARCH_KEY_LEN; aDepth++)
+    {
+        first = foldChar(aText[aFirst + aDepth]);
+        second = foldChar(aText[aSecond + aDepth]);
+        if (first != second)
+        {
+            return (int)first - (int)second;
+        }
+        if (first == CHR_EOS)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief getSortKey Get next SEARCH_SORT_KEY_CHARS characters of suffix
+ * packed into a number, first character is the most significant one.
+ * Characters after end of script are zero.
+ *
+ * @param aText[in]     Indexed text.
+ * @param aSuffix[in]   Offset of suffix.
+ * @param aDepth[in]    Index of first character.
+ * @return Key of characters.
+ */
+static inline uint32_t getSortKey(const uint8_t * aText, uint32_t aSuffix, uint16_t aDepth)
+{
+    const uint8_t * ptr = aText + aSuffix + aDepth;
+    uint32_t        key = 0;
+    uint8_t         chr;
+    uint8_t         i;
+
+    for (i = 0; i < SEARCH_SORT_KEY_CHARS; i++)
+    {
+        chr = foldChar(ptr[i]);
+        key = (key << 8) | chr;
+        if (chr == CHR_EOS)
+        {
+            key <<= 8 * (SEARCH_SORT_KEY_CHARS - 1 - i);
+            break;
+        }
+    }
+
+    return key;
+}
+
+/**
+ * @brief medianKey Get median of three keys.
+ */
+static inline uint32_t medianKey(uint32_t a, uint32_t b, uint32_t c)
+{
+    if (a < b)
+    {
+        return b < c ? b : MAX(a, c);
+    }
+
+    return a < c ? a : MAX(b, c);
+}
+
+/**
+ * @brief sortSuffixes Sort suffixes by multikey quicksort: suffixes are
+ * partitioned by some characters, then the equal part is sorted by the next
+ * characters. Characters before aDepth are equal in all suffixes. More
+ * characters are taken at once, because reading the script is the slow part.
+ *
+ * @param aText[in]             Indexed text.
+ * @param aItems[in,out]        Suffixes to sort, see SORT_ITEM().
+ * @param aCount[in]            Count of suffixes.
+ * @param aDepth[in]            Index of first character to sort by.
+ */
+static void sortSuffixes(const uint8_t * aText, uint64_t * aItems, uint32_t aCount, uint16_t aDepth)
+{
+    uint32_t i;
+    uint32_t j;
+    uint32_t lt;
+    uint32_t gt;
+    uint64_t item;
+    uint32_t pivot;
+    uint32_t key;
+
+    while (aCount > SEARCH_INSERTION_SORT_COUNT && aDepth < SEARCH_KEY_LEN)
+    {
+        pivot = medianKey(getSortKey(aText, SORT_ITEM_OFFSET(aItems[0]), aDepth),
+                          getSortKey(aText, SORT_ITEM_OFFSET(aItems[aCount / 2]), aDepth),
+                          getSortKey(aText, SORT_ITEM_OFFSET(aItems[aCount - 1]), aDepth));
+        lt = 0;
+        gt = aCount;
+        i = 0;
+        while (i < gt)
+        {
+            item = aItems[i];
+            key = getSortKey(aText, SORT_ITEM_OFFSET(item), aDepth);
+            if (key < pivot)
+            {
+                aItems[i++] = aItems[lt];
+                aItems[lt++] = item;
+            }
+            else if (key > pivot)
+            {
+                aItems[i] = aItems[--gt];
+                aItems[gt] = item;
+            }
+            else
+            {
+                i++;
+            }
+        }
+        sortSuffixes(aText, aItems, lt, aDepth);
+        sortSuffixes(aText, aItems + gt, aCount - gt, aDepth);
+        if ((pivot & 0xFFu) == CHR_EOS)
+        {
+            /* Suffixes reached end of script, they are equal */
+            return;
+        }
+        aItems += lt;
+        aCount = gt - lt;
+        aDepth += SEARCH_SORT_KEY_CHARS;
+    }
+
+    for (i = 1; i < aCount; i++)
+    {
+        item = aItems[i];
+        for (j = i; j > 0 && compareSuffixes(aText, SORT_ITEM_OFFSET(aItems[j - 1]), SORT_ITEM_OFFSET(item), aDepth) > 0; j--)
+        {
+            aItems[j] = aItems[j - 1];
+        }
+        aItems[j] = item;
+    }
+}
+
+/**
+ * @brief findWord Find first word at or after the specified offset.
+ *
+ * @param aIndex[in]    Search index.
+ * @param aOffset[in]   Offset in script.
+ * @return Index of word in order of script, count of words if there is none.
+ */
+static uint32_t findWord(const searchIndex_t * aIndex, size_t aOffset)
+{
+    uint32_t low = 0;
+    uint32_t high = aIndex->count;
+    uint32_t middle;
+
+    while (low < high)
+    {
+        middle = low + (high - low) / 2;
+        if (aIndex->words[middle] < aOffset)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/**
+ * @brief buildSearchIndex Build search index of script. Script shall not be
+ * changed or released while index is used. Edits are not seen by the index
+ * until it is built again.
+ *
+ * @param aIndex[out]   Index to build. Previous index is released.
+ * @param aText[in]     Script.
+ * @param aStatus[out]  Status messages are stored here. It can be NULL.
+ * @return TRUE: if successfully built.
+ */
+bool_t buildSearchIndex(searchIndex_t * aIndex, const char * aText, loadStatus_t * aStatus)
+{
+    bool_t          ok = TRUE;
+    const uint8_t * text = (const uint8_t *)aText;
+    size_t          length = strlen(aText);
+    size_t          i;
+    uint32_t        count = 0;
+    uint64_t      * items = NULL;
+    uint64_t        start_us = getTimeUs();
+
+    freeSearchIndex(aIndex);
+    aIndex->text = aText;
+    if (length > UINT32_MAX)
+    {
+        errorprintf("Script is too big to build search index!\n");
+        ok = FALSE;
+    }
+
+    if (ok)
+    {
+        setLoadStatus(aStatus, "Indexing script...");
+        for (i = 0; i < length; i++)
+        {
+            if (isWordChar(text[i]) && (i == 0 || !isWordChar(text[i - 1])))
+            {
+                count++;
+            }
+        }
+        aIndex->suffixes = malloc(MAX(count, 1) * sizeof(uint32_t));
+        aIndex->words = malloc(MAX(count, 1) * sizeof(uint32_t));
+        aIndex->ranks = malloc(MAX(count, 1) * sizeof(uint32_t));
+        items = malloc(MAX(count, 1) * sizeof(uint64_t));
+        if (!aIndex->suffixes || !aIndex->words || !aIndex->ranks || !items)
+        {
+            errorprintf("Cannot allocate memory for search index!\n");
+            freeSearchIndex(aIndex);
+            ok = FALSE;
+        }
+    }
+
+    if (ok)
+    {
+        for (i = 0; i < length; i++)
+        {
+            if (isWordChar(text[i]) && (i == 0 || !isWordChar(text[i - 1])))
+            {
+                items[aIndex->count] = SORT_ITEM(i, aIndex->count);
+                aIndex->words[aIndex->count++] = (uint32_t)i;
+            }
+        }
+        /* Index of word is sorted together with offset, so ranks are known without searching */
+        sortSuffixes(text, items, aIndex->count, 0);
+        for (i = 0; i < aIndex->count; i++)
+        {
+            aIndex->suffixes[i] = SORT_ITEM_OFFSET(items[i]);
+            aIndex->ranks[SORT_ITEM_WORD(items[i])] = (uint32_t)i;
+        }
+        verboseprintf("Search index: %u words, %lu KiB, built in %llu ms\n", aIndex->count,
+                      (unsigned long)(count * 3u * sizeof(uint32_t) / 1024),
+                      (unsigned long long)((getTimeUs() - start_us) / 1000u));
+    }
+    if (items)
+    {
+        free(items);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief freeSearchIndex Release search index.
+ *
+ * @param aIndex[in,out]    Index to release.
+ */
+void freeSearchIndex(searchIndex_t * aIndex)
+{
+    if (aIndex->suffixes)
+    {
+        free(aIndex->suffixes);
+    }
+    if (aIndex->words)
+    {
+        free(aIndex->words);
+    }
+    if (aIndex->ranks)
+    {
+        free(aIndex->ranks);
+    }
+    aIndex->suffixes = NULL;
+    aIndex->words = NULL;
+    aIndex->ranks = NULL;
+    aIndex->count = 0;
+    aIndex->text = NULL;
+}
+
+/**
+ * @brief foldQuery Convert query to the form used for comparison. Leading
+ * white spaces are removed, because hits start at words.
+ *
+ * @param aQuery[in]    Text typed by user.
+ * @param aFolded[out]  Converted query, at least SEARCH_MAX_QUERY_LEN bytes.
+ * @return Length of converted query.
+ */
+static uint16_t foldQuery(const char * aQuery, uint8_t * aFolded)
+{
+    uint16_t len = 0;
+
+    while (IS_WHITESPACE(*aQuery))
+    {
+        aQuery++;
+    }
+    while (*aQuery && len < SEARCH_MAX_QUERY_LEN - 1)
+    {
+        aFolded[len++] = foldChar(*aQuery++);
+    }
+
+    return len;
+}
+
+/**
+ * @brief comparePrefix Compare beginning of suffix with query.
+ *
+ * @param aText[in]     Indexed text.
+ * @param aSuffix[in]   Offset of suffix.
+ * @param aQuery[in]    Converted query.
+ * @param aLen[in]      Count of characters to compare.
+ * @return <0: suffix is smaller, 0: query is prefix of suffix, >0: suffix is bigger.
+ */
+static int comparePrefix(const uint8_t * aText, uint32_t aSuffix, const uint8_t * aQuery, uint16_t aLen)
+{
+    uint16_t i;
+    uint8_t  chr;
+
+    /* End of script never equals to a character of query */
+    for (i = 0; i < aLen; i++)
+    {
+        chr = foldChar(aText[aSuffix + i]);
+        if (chr != aQuery[i])
+        {
+            return chr < aQuery[i] ? -1 : 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief isHit Check if the specified suffix of the range of query is a hit.
+ * Range contains only hits, except if query is longer than sorted keys.
+ */
+static inline bool_t isHit(const searchIndex_t * aIndex, uint32_t aSuffix, const uint8_t * aQuery, uint16_t aLen)
+{
+    return aLen <= SEARCH_KEY_LEN || comparePrefix((const uint8_t *)aIndex->text, aSuffix, aQuery, aLen) == 0;
+}
+
+/**
+ * @brief scanHits Find hit nearest to the specified offset by checking all
+ * hits of actual query. Search wraps around at the ends of script.
+ *
+ * @param aIndex[in]    Search index.
+ * @param aQuery[in]    Converted query.
+ * @param aLen[in]      Length of query.
+ * @param aFrom[in]     Offset to start search from.
+ * @param aForward[in]  TRUE: first hit at or after aFrom, FALSE: last hit at or before aFrom.
+ * @return TRUE: if hit was found, it is stored in searchPrompt with its number.
+ */
+static bool_t scanHits(const searchIndex_t * aIndex, const uint8_t * aQuery, uint16_t aLen,
+                       size_t aFrom, bool_t aForward)
+{
+    uint32_t i;
+    uint32_t offset;
+    uint32_t number = 1;
+    size_t   best = SIZE_MAX;
+    size_t   first = SIZE_MAX;      /* First hit in script */
+    size_t   last = 0;              /* Last hit in script */
+    bool_t   found = FALSE;
+
+    for (i = searchPrompt.first; i < searchPrompt.end; i++)
+    {
+        offset = aIndex->suffixes[i];
+        if (!isHit(aIndex, offset, aQuery, aLen))
+        {
+            continue;
+        }
+        found = TRUE;
+        first = MIN(first, offset);
+        last = MAX(last, offset);
+        if (aForward && offset >= aFrom && (best == SIZE_MAX || offset < best))
+        {
+            best = offset;
+        }
+        else if (!aForward && offset <= aFrom && (best == SIZE_MAX || offset > best))
+        {
+            best = offset;
+        }
+    }
+    if (found && best == SIZE_MAX)
+    {
+        best = aForward ? first : last;
+    }
+
+    if (found)
+    {
+        for (i = searchPrompt.first; i < searchPrompt.end; i++)
+        {
+            offset = aIndex->suffixes[i];
+            if (offset < best && isHit(aIndex, offset, aQuery, aLen))
+            {
+                number++;
+            }
+        }
+        searchPrompt.hitOffset = best;
+        searchPrompt.hitNumber = number;
+    }
+
+    return found;
+}
+
+/**
+ * @brief walkHits Find hit nearest to the specified offset by checking words
+ * in order of script. Search wraps around at the ends of script. Number of
+ * hit is not known after that.
+ *
+ * @param aIndex[in]    Search index.
+ * @param aQuery[in]    Converted query.
+ * @param aLen[in]      Length of query.
+ * @param aFrom[in]     Offset to start search from.
+ * @param aForward[in]  TRUE: first hit at or after aFrom, FALSE: last hit at or before aFrom.
+ * @param aMaxSteps[in] Maximum count of words to check.
+ * @return TRUE: if hit was found, it is stored in searchPrompt. FALSE: no hit
+ *         or no hit within aMaxSteps words.
+ */
+static bool_t walkHits(const searchIndex_t * aIndex, const uint8_t * aQuery, uint16_t aLen,
+                       size_t aFrom, bool_t aForward, uint32_t aMaxSteps)
+{
+    uint32_t word = findWord(aIndex, aFrom);
+    uint32_t start;
+    uint32_t rank;
+    uint32_t i;
+
+    if (!aForward && (word == aIndex->count || aIndex->words[word] > aFrom))
+    {
+        /* Last word before aFrom, or the last one if there is none */
+        word = word ? word - 1 : aIndex->count - 1;
+    }
+    start = word;
+    for (i = 0; i < aIndex->count && i < aMaxSteps; i++)
+    {
+        if (word >= aIndex->count)
+        {
+            word = 0;
+        }
+        rank = aIndex->ranks[word];
+        if (rank >= searchPrompt.first && rank < searchPrompt.end
+                && isHit(aIndex, aIndex->words[word], aQuery, aLen))
+        {
+            searchPrompt.hitOffset = aIndex->words[word];
+            searchPrompt.hitNumber = 0;
+            /* No word is skipped from the ends of script */
+            if (aForward && start == 0)
+            {
+                searchPrompt.hitNumber = 1;
+            }
+            else if (!aForward && start == aIndex->count - 1)
+            {
+                searchPrompt.hitNumber = searchPrompt.hitCount;
+            }
+            return TRUE;
+        }
+        if (aForward)
+        {
+            word++;
+        }
+        else
+        {
+            word = word ? word - 1 : aIndex->count - 1;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief findHit Find hit of actual query nearest to the specified offset.
+ * Cost is about square root of count of words in both ways. Worst case, when
+ * hits are far from the offset, is checking three times as many words as
+ * there are hits.
+ *
+ * @param aIndex[in]    Search index.
+ * @param aFrom[in]     Offset to start search from.
+ * @param aForward[in]  TRUE: first hit at or after aFrom, FALSE: last hit at or before aFrom.
+ * @return TRUE: if hit was found, it is stored in searchPrompt.
+ */
+static bool_t findHit(const searchIndex_t * aIndex, size_t aFrom, bool_t aForward)
+{
+    uint8_t  query[SEARCH_MAX_QUERY_LEN];
+    uint16_t len = foldQuery(searchPrompt.lastQuery, query);
+    uint64_t range = searchPrompt.end - searchPrompt.first;
+
+    if (range * range <= aIndex->count)
+    {
+        return scanHits(aIndex, query, len, aFrom, aForward);
+    }
+
+    /* Every range/count word is a hit in average. Walking more words than
+     * there are hits costs more than checking all hits. */
+    return walkHits(aIndex, query, len, aFrom, aForward, (uint32_t)range)
+           || scanHits(aIndex, query, len, aFrom, aForward);
+}
+
+/**
+ * @brief startSearch Show search prompt. Actual line is the origin of search.
+ *
+ * @param aWrappedScript[in]    Script to search in.
+ */
+void startSearch(wrappedScript_t * aWrappedScript)
+{
+    memset(&searchPrompt.query, 0, sizeof(searchPrompt.query));
+    memset(&searchPrompt.lastQuery, 0, sizeof(searchPrompt.lastQuery));
+    searchPrompt.first = 0;
+    searchPrompt.end = 0;
+    searchPrompt.hitCount = 0;
+    searchPrompt.hitNumber = 0;
+    searchPrompt.hitOffset = 0;
+    searchPrompt.originLine = aWrappedScript->wrappedScriptList.actual;
+    searchPrompt.originOffset = searchPrompt.originLine ? getScriptElementOffset(searchPrompt.originLine) : 0;
+    searchPrompt.active = TRUE;
+    searchPrompt.generation++;
+}
+
+/**
+ * @brief updateSearch Search again if query has changed and show first hit
+ * after origin. If there is no hit, origin is shown.
+ *
+ * @param aIndex[in]                Search index of script.
+ * @param aWrappedScript[in,out]    Script to be scrolled.
+ */
+void updateSearch(const searchIndex_t * aIndex, wrappedScript_t * aWrappedScript)
+{
+    uint8_t  query[SEARCH_MAX_QUERY_LEN];
+    uint16_t len;
+    uint16_t key_len;
+    uint32_t low;
+    uint32_t high;
+    uint32_t middle;
+    uint32_t i;
+    uint64_t start_us = getTimeUs();
+
+    if (!searchPrompt.active || !strcmp(searchPrompt.query, searchPrompt.lastQuery))
+    {
+        return;
+    }
+
+    strncpy(searchPrompt.lastQuery, searchPrompt.query, sizeof(searchPrompt.lastQuery));
+    len = foldQuery(searchPrompt.lastQuery, query);
+    key_len = MIN(len, SEARCH_KEY_LEN);
+    searchPrompt.first = 0;
+    searchPrompt.end = 0;
+    searchPrompt.hitCount = 0;
+    searchPrompt.hitNumber = 0;
+    if (len && aIndex->count)
+    {
+        /* First suffix which is not smaller than query */
+        low = 0;
+        high = aIndex->count;
+        while (low < high)
+        {
+            middle = low + (high - low) / 2;
+            if (comparePrefix((const uint8_t *)aIndex->text, aIndex->suffixes[middle], query, key_len) < 0)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        searchPrompt.first = low;
+        /* First suffix which is bigger than query */
+        high = aIndex->count;
+        while (low < high)
+        {
+            middle = low + (high - low) / 2;
+            if (comparePrefix((const uint8_t *)aIndex->text, aIndex->suffixes[middle], query, key_len) <= 0)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+        searchPrompt.end = low;
+        if (len <= SEARCH_KEY_LEN)
+        {
+            searchPrompt.hitCount = searchPrompt.end - searchPrompt.first;
+        }
+        else
+        {
+            for (i = searchPrompt.first; i < searchPrompt.end; i++)
+            {
+                if (isHit(aIndex, aIndex->suffixes[i], query, len))
+                {
+                    searchPrompt.hitCount++;
+                }
+            }
+        }
+    }
+
+    if (searchPrompt.hitCount && findHit(aIndex, searchPrompt.originOffset, TRUE))
+    {
+        jumpToScriptLine(aWrappedScript, findScriptLine(aWrappedScript, searchPrompt.hitOffset));
+    }
+    else
+    {
+        jumpToScriptLine(aWrappedScript, searchPrompt.originLine);
+    }
+    searchPrompt.generation++;
+    verboseprintf("Search '%s': %u hits in %llu us\n", searchPrompt.lastQuery, searchPrompt.hitCount,
+                  (unsigned long long)(getTimeUs() - start_us));
+}
+
+/**
+ * @brief jumpToNextHit Show next or previous hit of query.
+ *
+ * @param aIndex[in]                Search index of script.
+ * @param aWrappedScript[in,out]    Script to be scrolled.
+ * @param aForward[in]              TRUE: next hit, FALSE: previous hit.
+ */
+void jumpToNextHit(const searchIndex_t * aIndex, wrappedScript_t * aWrappedScript, bool_t aForward)
+{
+    size_t   from;
+    size_t   offset = searchPrompt.hitOffset;
+    uint32_t number = searchPrompt.hitNumber;
+
+    if (searchPrompt.active && searchPrompt.hitCount)
+    {
+        if (aForward)
+        {
+            from = searchPrompt.hitOffset + 1;
+        }
+        else
+        {
+            /* Before first character: search wraps to the last hit */
+            from = searchPrompt.hitOffset ? searchPrompt.hitOffset - 1 : SIZE_MAX;
+        }
+        if (findHit(aIndex, from, aForward))
+        {
+            if (!searchPrompt.hitNumber && number)
+            {
+                /* Number is known from previous hit */
+                if (aForward)
+                {
+                    searchPrompt.hitNumber = searchPrompt.hitOffset > offset ? number + 1 : 1;
+                }
+                else
+                {
+                    searchPrompt.hitNumber = searchPrompt.hitOffset < offset ? number - 1 : searchPrompt.hitCount;
+                }
+            }
+            jumpToScriptLine(aWrappedScript, findScriptLine(aWrappedScript, searchPrompt.hitOffset));
+            searchPrompt.generation++;
+        }
+    }
+}
+
+/**
+ * @brief stopSearch Hide search prompt.
+ *
+ * @param aWrappedScript[in,out]    Script to be scrolled.
+ * @param aAccept[in]               TRUE: actual hit stays on the screen, FALSE: origin is shown again.
+ */
+void stopSearch(wrappedScript_t * aWrappedScript, bool_t aAccept)
+{
+    if (searchPrompt.active)
+    {
+        if (!aAccept)
+        {
+            jumpToScriptLine(aWrappedScript, searchPrompt.originLine);
+        }
+        searchPrompt.active = FALSE;
+        searchPrompt.originLine = NULL;
+        searchPrompt.generation++;
+    }
+}
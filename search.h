@@ -0,0 +1,57 @@
+/**
+ * @file        search.h
+ * @brief       Full-text search in script
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-27 09:12:45
+ * Last modify: 2021-02-27 09:12:45 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_SEARCH_H
+#define INCLUDE_SEARCH_H
+
+#include <stdint.h>
+
+#include "common.h"
+#include "script.h"
+
+#define SEARCH_KEY_LEN              32      /* Suffixes are sorted by this many characters */
+#define SEARCH_MAX_QUERY_LEN        128     /* Maximum length of search text, including end of string */
+
+/* Offsets of word starts sorted by the text which follows them */
+typedef struct
+{
+    const char    * text;                   /* Indexed script, it is not owned by the index */
+    uint32_t      * suffixes;               /* Sorted offsets, NULL if index is not built */
+    uint32_t      * words;                  /* Offsets in order of script */
+    uint32_t      * ranks;                  /* Position of words[i] in suffixes */
+    uint32_t        count;                  /* Count of words */
+} searchIndex_t;
+
+/* State of incremental search prompt */
+typedef struct
+{
+    bool_t          active;                 /* TRUE: prompt is shown */
+    char            query[SEARCH_MAX_QUERY_LEN]; /* Text typed by user */
+    char            lastQuery[SEARCH_MAX_QUERY_LEN]; /* Query of hits below */
+    uint32_t        first;                  /* First matching suffix in index */
+    uint32_t        end;                    /* End of matching suffixes in index */
+    uint32_t        hitCount;               /* Count of hits */
+    uint32_t        hitNumber;              /* Number of shown hit in order of script: 1 .. hitCount, 0: unknown */
+    size_t          hitOffset;              /* Offset of shown hit in script, valid if hitCount is not 0 */
+    linkedListElement_t * originLine;       /* Line shown when search was started */
+    size_t          originOffset;           /* Offset of origin line */
+    uint32_t        generation;             /* Incremented when prompt changes */
+} searchPrompt_t;
+
+extern searchPrompt_t searchPrompt;
+
+bool_t buildSearchIndex(searchIndex_t * aIndex, const char * aText, loadStatus_t * aStatus);
+void freeSearchIndex(searchIndex_t * aIndex);
+void startSearch(wrappedScript_t * aWrappedScript);
+void updateSearch(const searchIndex_t * aIndex, wrappedScript_t * aWrappedScript);
+void jumpToNextHit(const searchIndex_t * aIndex, wrappedScript_t * aWrappedScript, bool_t aForward);
+void stopSearch(wrappedScript_t * aWrappedScript, bool_t aAccept);
+
+#endif /* INCLUDE_SEARCH_H */
@@ -0,0 +1,139 @@
+/**
+ * @file        stats.c
+ * @brief       Runtime statistics
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-21 09:40:12
+ * Last modify: 2021-02-21 09:40:12 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <SDL/SDL.h>
+
+#include "common.h"
+#include "stats.h"
+#include "quality.h"
+#include "linecache.h"
+#include "present.h"
+#include "preview.h"
+#include "replay.h"
+#include "metrics.h"
+#include "latency.h"
+#include "atlas.h"
+#include "scale.h"
+#include "alloctrack.h"
+
+stats_t stats;
+
+/**
+ * @brief getTimeUs Get time with microsecond resolution. SDL_GetTicks() is
+ * too coarse to measure frame times.
+ *
+ * @return Monotonic time in microseconds.
+ */
+uint64_t getTimeUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000u;
+}
+
+/**
+ * @brief initStats Reset all statistics.
+ */
+void initStats(void)
+{
+    memset(&stats, 0, sizeof(stats));
+    stats.startTick = getTicks();
+    stats.periodStartTick = stats.startTick;
+}
+
+/**
+ * @brief updateStats Calculate rates of last period. It shall be called
+ * in every loop iteration, values change only once per STATS_PERIOD_MS.
+ */
+void updateStats(void)
+{
+    uint32_t now = getTicks();
+    uint32_t elapsed = now - stats.periodStartTick;
+
+    if (elapsed >= STATS_PERIOD_MS)
+    {
+        stats.renderedPerSec = (stats.framesRendered - stats.periodFramesRendered) * 1000u / elapsed;
+        stats.skippedPerSec = (stats.framesSkipped - stats.periodFramesSkipped) * 1000u / elapsed;
+        stats.periodFramesRendered = stats.framesRendered;
+        stats.periodFramesSkipped = stats.framesSkipped;
+        stats.periodStartTick = now;
+        stats.generation++;
+    }
+}
+
+/**
+ * @brief getStatsText Print statistics of last period to a one line text.
+ *
+ * @param aText[out]    Text buffer.
+ * @param aTextSize[in] Size of text buffer.
+ */
+void getStatsText(char * aText, size_t aTextSize)
+{
+    int len;
+
+    len = snprintf(aText, aTextSize, "Frames/s: %u skipped/s: %u quality: %s conv/frame: %u",
+                   stats.renderedPerSec, stats.skippedPerSec, getQualityName(qualityManager.tier),
+                   stats.lastFrameConversionBlits);
+    if (renderScale.factor > 1 && len >= 0 && (size_t)len < aTextSize)
+    {
+        len += snprintf(&aText[len], aTextSize - len, " scale: 1/%u", renderScale.factor);
+    }
+    if (config.show_preview && len >= 0 && (size_t)len < aTextSize)
+    {
+        len += snprintf(&aText[len], aTextSize - len, " preview: %u us", preview.avgDrawUs);
+    }
+    if (latency.count && len >= 0 && (size_t)len < aTextSize)
+    {
+        snprintf(&aText[len], aTextSize - len, " input: %u ms", (latency.lastUs + 500u) / 1000u);
+    }
+}
+
+/**
+ * @brief printStats Print summary of statistics to console.
+ */
+void printStats(void)
+{
+    uint32_t elapsed = getTicks() - stats.startTick;
+
+    printf("STATISTICS\n");
+    printf("----------\n");
+    printf("Run time:                         %u ms\n", elapsed);
+    printf("Frames rendered:                  %llu\n", (unsigned long long)stats.framesRendered);
+    printf("Frames skipped:                   %llu\n", (unsigned long long)stats.framesSkipped);
+    if (elapsed)
+    {
+        printf("Average frame rate:               %.1f frames/s\n", stats.framesRendered * 1000.0 / elapsed);
+    }
+    printf("Conversion blits:                 %llu", (unsigned long long)stats.conversionBlits);
+    if (stats.framesRendered)
+    {
+        printf(", %.2f per frame", (double)stats.conversionBlits / stats.framesRendered);
+    }
+    printf("\n");
+    printf("Render quality changes:           %u\n", qualityManager.tierChanges);
+    printRenderScaleStats();
+    printAllocStats();
+    printf("Line cache hits/misses:           %llu / %llu\n",
+           (unsigned long long)lineCache.hits, (unsigned long long)lineCache.misses);
+    printPresentStats();
+    printPreviewStats();
+    printAtlasStats();
+    printMetricsStats();
+    printLatencyStats();
+    printf("\n");
+}
@@ -0,0 +1,46 @@
+/**
+ * @file        stats.h
+ * @brief       Runtime statistics
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-02-21 09:40:12
+ * Last modify: 2021-02-21 09:40:12 ivanovp {Time-stamp}
+ * Licence:     GPL
+ */
+
+#ifndef INCLUDE_STATS_H
+#define INCLUDE_STATS_H
+
+#include <stdint.h>
+
+#include "common.h"
+
+#define STATS_PERIOD_MS             1000    /* Rates are calculated in this period */
+
+typedef struct
+{
+    uint32_t    startTick;                  /* Tick of initStats() */
+    uint64_t    framesRendered;             /* Count of presented frames */
+    uint64_t    framesSkipped;              /* Count of loop iterations without new frame */
+    uint64_t    conversionBlits;            /* Count of blits which converted pixel format */
+    uint32_t    frameConversionBlits;       /* Conversion blits of the frame being drawn */
+    uint32_t    lastFrameConversionBlits;   /* Conversion blits of last completed frame */
+    /* Values of last period, used by stats overlay */
+    uint32_t    periodStartTick;
+    uint64_t    periodFramesRendered;
+    uint64_t    periodFramesSkipped;
+    uint32_t    renderedPerSec;
+    uint32_t    skippedPerSec;
+    uint32_t    generation;                 /* Incremented when values of last period change */
+    bool_t      visible;                    /* TRUE: stats overlay is shown */
+} stats_t;
+
+extern stats_t stats;
+
+uint64_t getTimeUs(void);
+void initStats(void);
+void updateStats(void);
+void getStatsText(char * aText, size_t aTextSize);
+void printStats(void);
+
+#endif /* INCLUDE_STATS_H */
@@ -0,0 +1,335 @@
+/**
+ * @file        mkatlas.c
+ * @brief       Rasterize glyphs of fonts into an atlas, see atlas.h
+ * @author      Copyright (C) Peter Ivanov, 2021
+ *
+ * Created      2021-03-07 09:02:51
+ * Last modify: 2021-03-07 09:02:51 ivanovp {Time-stamp}
+ * Licence:     GPL
+ *
+ * It runs on the build machine. Glyphs are loaded, measured and rendered
+ * by FreeType with the same settings as SDL_ttf uses, so text drawn from
+ * the atlas looks the same as text rendered at runtime.
+ *
+ * Usage: mkatlas <atlas.bin> <name>:<font.ttf>:<size> [...]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include "common.h"
+#include "atlas.h"
+
+#define MKATLAS_MAX_FONTS           16
+
+/* Same rounding of 26.6 fixed point values as SDL_ttf */
+#define FT_FLOOR(X)                 (((X) & -64) / 64)
+#define FT_CEIL(X)                  ((((X) + 63) & -64) / 64)
+
+/* Ranges of code points in atlas: Latin-1, Latin Extended-A and typographic punctuation */
+static const uint32_t charRanges[][2] =
+{
+    { 0x0020, 0x007E },
+    { 0x00A0, 0x017F },
+    { 0x2013, 0x2014 },
+    { 0x2018, 0x201E },
+    { 0x2026, 0x2026 },
+};
+
+typedef struct
+{
+    atlasFont_t      font;                  /* Offsets are filled when atlas is written */
+    atlasGlyph_t   * glyphs;
+    uint8_t       ** pixels;                /* Coverage of each glyph */
+    atlasKerning_t * kerning;
+} mkatlasFont_t;
+
+/**
+ * @brief alignOffset Round offset up to a multiple of 4.
+ */
+static uint32_t alignOffset(uint32_t aOffset)
+{
+    return (aOffset + 3u) & ~3u;
+}
+
+/**
+ * @brief rasterizeFont Load, measure and render every glyph of the ranges.
+ *
+ * @param aLibrary[in]  FreeType library.
+ * @param aName[in]     Name of font in atlas, ATLAS_NAME_*.
+ * @param aPath[in]     Path of font file.
+ * @param aSize[in]     Point size.
+ * @param aFont[out]    Rasterized font.
+ * @return TRUE: if font was rasterized.
+ */
+static bool_t rasterizeFont(FT_Library aLibrary, const char * aName, const char * aPath, int aSize, mkatlasFont_t * aFont)
+{
+    FT_Face             face;
+    FT_Glyph_Metrics  * metrics;
+    FT_Bitmap         * bitmap;
+    FT_Vector           delta;
+    FT_Fixed            scale;
+    atlasGlyph_t      * glyph;
+    uint32_t            maxGlyphs = 0;
+    uint32_t            codePoint;
+    uint32_t            index;
+    uint16_t            w;
+    uint16_t            i;
+    uint16_t            j;
+    uint16_t            row;
+
+    if (strlen(aName) >= ATLAS_NAME_LEN)
+    {
+        errorprintf("Name of font '%s' is too long!\n", aName);
+        return FALSE;
+    }
+    if (FT_New_Face(aLibrary, aPath, 0, &face) || !FT_IS_SCALABLE(face))
+    {
+        errorprintf("Cannot open scalable font '%s'!\n", aPath);
+        return FALSE;
+    }
+    FT_Set_Char_Size(face, 0, aSize * 64, 0, 0);
+    scale = face->size->metrics.y_scale;
+
+    memset(aFont, 0, sizeof(*aFont));
+    strcpy(aFont->font.name, aName);
+    aFont->font.size = aSize;
+    aFont->font.ascent = FT_CEIL(FT_MulFix(face->ascender, scale));
+    aFont->font.descent = FT_CEIL(FT_MulFix(face->descender, scale));
+    aFont->font.height = aFont->font.ascent - aFont->font.descent + 1;
+    aFont->font.lineSkip = FT_CEIL(FT_MulFix(face->height, scale));
+
+    for (i = 0; i < sizeof(charRanges) / sizeof(charRanges[0]); i++)
+    {
+        maxGlyphs += charRanges[i][1] - charRanges[i][0] + 1;
+    }
+    aFont->glyphs = calloc(maxGlyphs, sizeof(atlasGlyph_t));
+    aFont->pixels = calloc(maxGlyphs, sizeof(uint8_t *));
+    if (!aFont->glyphs || !aFont->pixels)
+    {
+        errorprintf("Cannot allocate memory!\n");
+        FT_Done_Face(face);
+        return FALSE;
+    }
+
+    for (i = 0; i < sizeof(charRanges) / sizeof(charRanges[0]); i++)
+    {
+        for (codePoint = charRanges[i][0]; codePoint <= charRanges[i][1]; codePoint++)
+        {
+            index = FT_Get_Char_Index(face, codePoint);
+            if (!index || FT_Load_Glyph(face, index, FT_LOAD_DEFAULT)
+                    || FT_Render_Glyph(face->glyph, FT_RENDER_MODE_NORMAL))
+            {
+                /* Character is rendered at runtime */
+                continue;
+            }
+            metrics = &face->glyph->metrics;
+            bitmap = &face->glyph->bitmap;
+            glyph = &aFont->glyphs[aFont->font.glyphCount];
+            glyph->codePoint = codePoint;
+            glyph->index = index;
+            glyph->minX = FT_FLOOR(metrics->horiBearingX);
+            glyph->maxX = glyph->minX + FT_CEIL(metrics->width);
+            glyph->maxY = FT_FLOOR(metrics->horiBearingY);
+            glyph->minY = glyph->maxY - FT_CEIL(metrics->height);
+            glyph->advance = FT_CEIL(metrics->horiAdvance);
+            /* FreeType may report wider bitmap than the glyph */
+            w = MIN((int)bitmap->width, glyph->maxX - glyph->minX);
+            glyph->w = MAX(w, 0);
+            glyph->h = bitmap->rows;
+            aFont->pixels[aFont->font.glyphCount] = malloc((size_t)glyph->w * glyph->h + 1);
+            if (!aFont->pixels[aFont->font.glyphCount])
+            {
+                errorprintf("Cannot allocate memory!\n");
+                FT_Done_Face(face);
+                return FALSE;
+            }
+            for (row = 0; row < glyph->h; row++)
+            {
+                memcpy(&aFont->pixels[aFont->font.glyphCount][row * glyph->w],
+                       bitmap->buffer + row * bitmap->pitch, glyph->w);
+            }
+            aFont->font.glyphCount++;
+        }
+    }
+
+    if (FT_HAS_KERNING(face))
+    {
+        aFont->kerning = calloc((size_t)aFont->font.glyphCount * aFont->font.glyphCount, sizeof(atlasKerning_t));
+        if (!aFont->kerning)
+        {
+            errorprintf("Cannot allocate memory!\n");
+            FT_Done_Face(face);
+            return FALSE;
+        }
+        for (i = 0; i < aFont->font.glyphCount; i++)
+        {
+            for (j = 0; j < aFont->font.glyphCount; j++)
+            {
+                FT_Get_Kerning(face, aFont->glyphs[i].index, aFont->glyphs[j].index, FT_KERNING_DEFAULT, &delta);
+                if (delta.x >> 6)
+                {
+                    aFont->kerning[aFont->font.kerningCount].left = aFont->glyphs[i].index;
+                    aFont->kerning[aFont->font.kerningCount].right = aFont->glyphs[j].index;
+                    aFont->kerning[aFont->font.kerningCount].x = delta.x >> 6;
+                    aFont->font.kerningCount++;
+                }
+            }
+        }
+    }
+    FT_Done_Face(face);
+
+    return TRUE;
+}
+
+/**
+ * @brief compareKerning Order kerning pairs by left then right glyph.
+ */
+static int compareKerning(const void * aPair1, const void * aPair2)
+{
+    const atlasKerning_t * pair1 = aPair1;
+    const atlasKerning_t * pair2 = aPair2;
+
+    if (pair1->left != pair2->left)
+    {
+        return pair1->left < pair2->left ? -1 : 1;
+    }
+    return pair1->right < pair2->right ? -1 : pair1->right > pair2->right;
+}
+
+/**
+ * @brief writeAtlas Write fonts to atlas file.
+ *
+ * @return TRUE: if file was written.
+ */
+static bool_t writeAtlas(const char * aPath, mkatlasFont_t * aFonts, uint16_t aFontCount)
+{
+    static const uint8_t zeros[4] = { 0 };
+    atlasHeader_t        header;
+    FILE               * file;
+    uint32_t             offset;
+    uint32_t             position;
+    bool_t               ok = TRUE;
+    uint16_t             i;
+    uint16_t             j;
+
+    memcpy(header.magic, ATLAS_MAGIC, sizeof(header.magic));
+    header.version = ATLAS_VERSION;
+    header.fontCount = aFontCount;
+
+    /* Tables of each font, then coverage of glyphs */
+    offset = sizeof(header) + aFontCount * sizeof(atlasFont_t);
+    for (i = 0; i < aFontCount; i++)
+    {
+        qsort(aFonts[i].kerning, aFonts[i].font.kerningCount, sizeof(atlasKerning_t), compareKerning);
+        aFonts[i].font.glyphOffset = alignOffset(offset);
+        offset = aFonts[i].font.glyphOffset + aFonts[i].font.glyphCount * sizeof(atlasGlyph_t);
+        aFonts[i].font.kerningOffset = alignOffset(offset);
+        offset = aFonts[i].font.kerningOffset + aFonts[i].font.kerningCount * sizeof(atlasKerning_t);
+    }
+    for (i = 0; i < aFontCount; i++)
+    {
+        for (j = 0; j < aFonts[i].font.glyphCount; j++)
+        {
+            aFonts[i].glyphs[j].pixelOffset = offset;
+            offset += aFonts[i].glyphs[j].w * aFonts[i].glyphs[j].h;
+        }
+    }
+
+    file = fopen(aPath, "wb");
+    if (!file)
+    {
+        errorprintf("Cannot create '%s'!\n", aPath);
+        return FALSE;
+    }
+    ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (i = 0; i < aFontCount && ok; i++)
+    {
+        ok = fwrite(&aFonts[i].font, sizeof(atlasFont_t), 1, file) == 1;
+    }
+    position = sizeof(header) + aFontCount * sizeof(atlasFont_t);
+    for (i = 0; i < aFontCount && ok; i++)
+    {
+        ok = fwrite(zeros, 1, aFonts[i].font.glyphOffset - position, file) == aFonts[i].font.glyphOffset - position
+             && fwrite(aFonts[i].glyphs, sizeof(atlasGlyph_t), aFonts[i].font.glyphCount, file) == aFonts[i].font.glyphCount;
+        position = aFonts[i].font.glyphOffset + aFonts[i].font.glyphCount * sizeof(atlasGlyph_t);
+        ok = ok && fwrite(zeros, 1, aFonts[i].font.kerningOffset - position, file) == aFonts[i].font.kerningOffset - position
+             && fwrite(aFonts[i].kerning, sizeof(atlasKerning_t), aFonts[i].font.kerningCount, file) == aFonts[i].font.kerningCount;
+        position = aFonts[i].font.kerningOffset + aFonts[i].font.kerningCount * sizeof(atlasKerning_t);
+    }
+    for (i = 0; i < aFontCount && ok; i++)
+    {
+        for (j = 0; j < aFonts[i].font.glyphCount && ok; j++)
+        {
+            ok = fwrite(aFonts[i].pixels[j], 1, aFonts[i].glyphs[j].w * aFonts[i].glyphs[j].h, file)
+                 == (size_t)aFonts[i].glyphs[j].w * aFonts[i].glyphs[j].h;
+        }
+    }
+    ok = !fclose(file) && ok;
+    if (!ok)
+    {
+        errorprintf("Cannot write '%s'!\n", aPath);
+        remove(aPath);
+    }
+    else
+    {
+        printf("%s: %u fonts, %u bytes\n", aPath, aFontCount, offset);
+    }
+
+    return ok;
+}
+
+int main(int argc, char * argv[])
+{
+    static mkatlasFont_t fonts[MKATLAS_MAX_FONTS];
+    FT_Library           library;
+    char                 spec[MAX_PATH_LEN + ATLAS_NAME_LEN + 16];
+    char               * path;
+    char               * size;
+    uint16_t             fontCount = 0;
+    bool_t               ok = TRUE;
+    int                  i;
+
+    if (argc < 3 || argc - 2 > MKATLAS_MAX_FONTS)
+    {
+        printf("Usage: %s <atlas.bin> <name>:<font.ttf>:<size> [...]\n", argv[0]);
+        return 2;
+    }
+    if (FT_Init_FreeType(&library))
+    {
+        errorprintf("Cannot initialize FreeType!\n");
+        return 1;
+    }
+
+    for (i = 2; i < argc && ok; i++)
+    {
+        strncpy(spec, argv[i], sizeof(spec) - 1);
+        spec[sizeof(spec) - 1] = CHR_EOS;
+        path = strchr(spec, ':');
+        size = path ? strrchr(path + 1, ':') : NULL;
+        if (!size || path - spec >= ATLAS_NAME_LEN || atoi(size + 1) <= 0)
+        {
+            errorprintf("Invalid font '%s'!\n", argv[i]);
+            ok = FALSE;
+            break;
+        }
+        *path++ = CHR_EOS;
+        *size++ = CHR_EOS;
+        ok = rasterizeFont(library, spec, path, atoi(size), &fonts[fontCount]);
+        if (ok)
+        {
+            printf("%s %s %i: %u glyphs, %u kerning pairs\n", spec, path, atoi(size),
+                   fonts[fontCount].font.glyphCount, fonts[fontCount].font.kerningCount);
+            fontCount++;
+        }
+    }
+    ok = ok && writeAtlas(argv[1], fonts, fontCount);
+    FT_Done_FreeType(library);
+
+    return ok ? 0 : 1;
+}